@@ -3179,6 +3179,16 @@ typedef struct stats_info_response_msg {
 	time_t   bf_when_last_cycle;
 	uint32_t bf_active;
 
+	uint32_t intern_strings;	/* distinct interned strings */
+	uint64_t intern_refs;		/* references to interned strings */
+	uint64_t intern_bytes;		/* memory used by interned strings */
+	uint64_t intern_bytes_saved;	/* memory saved by sharing them */
+
+	uint32_t agent_workers;		/* threads sending agent RPCs */
+	uint32_t agent_workers_busy;
+	uint32_t agent_work_queue;	/* agent RPCs waiting for a worker */
+	uint32_t agent_work_queue_max;
+
 	uint32_t rpc_type_size;
 	uint16_t *rpc_type_id;
 	uint32_t *rpc_type_cnt;
@@ -3196,6 +3206,18 @@ typedef struct stats_info_response_msg {
 	uint32_t rpc_dump_count;
 	uint32_t *rpc_dump_types;
 	char **rpc_dump_hostlist;
+
+	uint32_t fwd_type_size;		/* messages sent through a tree */
+	uint16_t *fwd_type_id;
+	uint32_t *fwd_type_cnt;
+	uint64_t *fwd_type_time;	/* total usec until all replied */
+	uint64_t *fwd_type_max;		/* max usec until all replied */
+
+	uint32_t agent_type_size;	/* agent RPCs sent */
+	uint16_t *agent_type_id;
+	uint32_t *agent_type_cnt;
+	uint64_t *agent_type_time;	/* total usec from queued to done */
+	uint64_t *agent_type_max;	/* max usec from queued to done */
 } stats_info_response_msg_t;
 
 #define TRIGGER_FLAG_PERM		0x0001
@@ -292,6 +292,7 @@ typedef enum {
 	ESLURMD_CONTAINER_RUNTIME_INVALID,
 	ESLURMD_CPU_BIND_ERROR,
 	ESLURMD_CPU_LAYOUT_ERROR,
+	ESLURMD_FILE_BCAST_CACHED,
 
 	/* socket specific Slurm communications error */
 	ESLURM_PROTOCOL_INCOMPLETE_PACKET = 5003,
@@ -208,6 +208,9 @@ enum cluster_fed_states {
 						    */
 #define JOBCOND_FLAG_SCRIPT           SLURM_BIT(8) /* Get batch script only */
 #define JOBCOND_FLAG_ENV              SLURM_BIT(9) /* Get job's env only */
+#define JOBCOND_FLAG_STREAM           SLURM_BIT(10) /* Send jobs back in
+						     * parts as they are read,
+						     * set internally */
 
 /* Archive / Purge time flags */
 #define SLURMDB_PURGE_BASE    0x0000ffff   /* Apply to get the number
@@ -1370,9 +1373,15 @@ typedef struct {
 						     * for each rollup */
 	uint64_t time_total[DBD_ROLLUP_COUNT]; /* Time it took to do each
 						 * rollup */
+	uint64_t time_window_max[DBD_ROLLUP_COUNT]; /* Longest time window of
+						     * the last rollup */
+	uint16_t windows[DBD_ROLLUP_COUNT]; /* Time windows the last rollup
+					     * was split into */
 } slurmdb_rollup_stats_t;
 
 typedef struct {
+	uint32_t batch_cnt;  /* count of batched writes of this object */
+	uint32_t batch_rows; /* count of object written in batches */
 	uint32_t cnt;	   /* count of object processed */
 	uint32_t id;	   /* ID of object */
 	uint64_t time;	   /* total usecs this object */
@@ -1704,6 +1713,16 @@ extern List slurmdb_job_modify(void *db_conn,
  */
 extern List slurmdb_jobs_get(void *db_conn, slurmdb_job_cond_t *job_cond);
 
+/*
+ * get info from the storage one part at a time
+ * IN:  f - called with each List of slurmdb_job_rec_t * as it is received.
+ *      The List is freed once f returns; f may remove records it wants to
+ *      keep. A negative return stops calling f.
+ * RET: SLURM_SUCCESS on success, else an error code
+ */
+extern int slurmdb_jobs_get_parts(void *db_conn, slurmdb_job_cond_t *job_cond,
+				  ListForF f, void *arg);
+
 /*
  * Fix runaway jobs
  * IN: jobs, a list of all the runaway jobs
@@ -70,6 +70,21 @@ extern List slurmdb_jobs_get(void *db_conn, slurmdb_job_cond_t *job_cond)
 	return jobacct_storage_g_get_jobs_cond(db_conn, db_api_uid, job_cond);
 }
 
+/*
+ * get info from the storage one part at a time
+ * IN:  f - called with each List of slurmdb_job_rec_t * as it is received
+ * RET: SLURM_SUCCESS on success SLURM_ERROR else
+ */
+extern int slurmdb_jobs_get_parts(void *db_conn, slurmdb_job_cond_t *job_cond,
+				  ListForF f, void *arg)
+{
+	if (db_api_uid == -1)
+		db_api_uid = getuid();
+
+	return jobacct_storage_g_get_jobs_cond_parts(db_conn, db_api_uid,
+						     job_cond, f, arg);
+}
+
 /*
  * Fix runaway jobs
  * IN: jobs, a list of all the runaway jobs
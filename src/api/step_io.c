@@ -64,6 +64,7 @@
 struct io_buf {
 	int ref_count;
 	uint32_t length;
+	uint32_t size;	/* capacity of data, excluding the header */
 	void *data;
 	io_hdr_t header;
 };
@@ -111,6 +112,7 @@ struct io_operations server_ops = {
 struct server_io_info {
 	client_io_t *cio;
 	int node_id;
+	bitstr_t *nodes;	/* node_id and the nodes relayed through it */
 	bool testing_connection;
 
 	/* incoming variables */
@@ -225,6 +227,8 @@ _create_server_eio_obj(int fd, client_io_t *cio, int nodeid,
 
 	info->cio = cio;
 	info->node_id = nodeid;
+	info->nodes = bit_alloc(cio->num_nodes);
+	bit_set(info->nodes, nodeid);
 	info->testing_connection = false;
 	info->in_msg = NULL;
 	info->in_remaining = 0;
@@ -242,6 +246,76 @@ _create_server_eio_obj(int fd, client_io_t *cio, int nodeid,
 	return eio;
 }
 
+/* Notify an io failure for the node and the ones relayed through it */
+static void _notify_io_failure(struct server_io_info *s)
+{
+	if (!s->cio->sls)
+		return;
+
+	for (int i = 0; (i = bit_ffs_from_bit(s->nodes, i)) >= 0; i++)
+		step_launch_notify_io_failure(s->cio->sls, i);
+}
+
+static void _clear_questionable_state(struct server_io_info *s)
+{
+	if (!s->cio->sls)
+		return;
+
+	for (int i = 0; (i = bit_ffs_from_bit(s->nodes, i)) >= 0; i++)
+		step_launch_clear_questionable_state(s->cio->sls, i);
+}
+
+/*
+ * A node connected to the slurmstepd of another one, which relays its stdio
+ * (LaunchParameters=stdio_tree).
+ */
+static int _server_relay_init(eio_obj_t *obj, struct server_io_info *s)
+{
+	client_io_t *cio = s->cio;
+	io_relay_init_t init = { 0 };
+	buf_t *buffer;
+	int rc;
+
+	buffer = create_buf(s->in_msg->data, s->header.length);
+	rc = io_relay_init_unpack(&init, buffer);
+	buffer->head = NULL;	/* not ours */
+	FREE_NULL_BUFFER(buffer);
+	if (rc != SLURM_SUCCESS)
+		return rc;
+
+	if (init.nodeid >= cio->num_nodes) {
+		error("Invalid relayed nodeid %u from node %d",
+		      init.nodeid, s->node_id);
+		io_relay_init_free_members(&init);
+		return SLURM_ERROR;
+	}
+	debug2("IO: node %u relayed through node %d, %u tasks",
+	       init.nodeid, s->node_id, init.ntasks);
+
+	slurm_mutex_lock(&cio->ioservers_lock);
+	if (cio->ioserver[init.nodeid] != NULL) {
+		error("IO: Node %u already established stream!", init.nodeid);
+	} else if (bit_test(cio->ioservers_ready_bits, init.nodeid)) {
+		error("IO: Hey, you told me node %u was down!", init.nodeid);
+	}
+	cio->ioserver[init.nodeid] = obj;
+	bit_set(cio->ioservers_ready_bits, init.nodeid);
+	cio->ioservers_ready = bit_set_count(cio->ioservers_ready_bits);
+	bit_set(s->nodes, init.nodeid);
+	/* The relaying node counted one stdout stream for it until now */
+	s->remote_stdout_objs += init.stdout_objs - 1;
+	s->remote_stderr_objs += init.stderr_objs;
+	if ((s->remote_stdout_objs == 0) && (s->remote_stderr_objs == 0))
+		obj->shutdown = true;
+	slurm_mutex_unlock(&cio->ioservers_lock);
+
+	if (cio->sls)
+		step_launch_clear_questionable_state(cio->sls, init.nodeid);
+
+	io_relay_init_free_members(&init);
+	return SLURM_SUCCESS;
+}
+
 static bool
 _server_readable(eio_obj_t *obj)
 {
@@ -286,6 +360,7 @@ static int
 _server_read(eio_obj_t *obj, List objs)
 {
 	struct server_io_info *s = (struct server_io_info *) obj->arg;
+	uint32_t max_len = MAX_IO_MSG_LEN;
 	void *buf;
 	int n;
 
@@ -309,11 +384,7 @@ _server_read(eio_obj_t *obj, List objs)
 						error("%s: fd %d error reading header: %m",
 						      __func__, obj->fd);
 					}
-					if (s->cio->sls) {
-						step_launch_notify_io_failure(
-							s->cio->sls,
-							s->node_id);
-					}
+					_notify_io_failure(s);
 				}
 			}
 			if (obj->fd > STDERR_FILENO)
@@ -326,9 +397,7 @@ _server_read(eio_obj_t *obj, List objs)
 			return SLURM_SUCCESS;
 		}
 		if (s->header.type == SLURM_IO_CONNECTION_TEST) {
-			if (s->cio->sls)
-				step_launch_clear_questionable_state(
-					s->cio->sls, s->node_id);
+			_clear_questionable_state(s);
 			list_enqueue(s->cio->free_outgoing, s->in_msg);
 			s->in_msg = NULL;
 			s->testing_connection = false;
@@ -356,6 +425,27 @@ _server_read(eio_obj_t *obj, List objs)
 			s->in_msg = NULL;
 			return SLURM_SUCCESS;
 		}
+		if (s->header.type == SLURM_IO_RELAY_INIT)
+			max_len = (4 + s->cio->num_tasks) * sizeof(uint32_t);
+		if (s->header.length > max_len) {
+			error("%s: fd %d message length %u exceeds maximum of %u",
+			      __func__, obj->fd, s->header.length, max_len);
+			_notify_io_failure(s);
+			if (obj->fd > STDERR_FILENO)
+				close(obj->fd);
+			obj->fd = -1;
+			s->in_eof = true;
+			s->out_eof = true;
+			list_enqueue(s->cio->free_outgoing, s->in_msg);
+			s->in_msg = NULL;
+			return SLURM_SUCCESS;
+		}
+		if (s->header.length > s->in_msg->size) {
+			/* slurmstepd configured with a larger stdio_msg_size */
+			xrealloc_nz(s->in_msg->data, s->header.length +
+				    io_hdr_packed_size() + 1);
+			s->in_msg->size = s->header.length;
+		}
 		s->in_remaining = s->header.length;
 		s->in_msg->length = s->header.length;
 		s->in_msg->header = s->header;
@@ -389,9 +479,7 @@ _server_read(eio_obj_t *obj, List objs)
 		if (n <= 0) { /* got eof or unhandled error */
 			error("%s: fd %d got error or unexpected eof reading message body",
 				  __func__, obj->fd);
-			if (s->cio->sls)
-				step_launch_notify_io_failure(
-					s->cio->sls, s->node_id);
+			_notify_io_failure(s);
 			if (obj->fd > STDERR_FILENO)
 				close(obj->fd);
 			obj->fd = -1;
@@ -410,6 +498,15 @@ _server_read(eio_obj_t *obj, List objs)
 		debug3("***** passing on eof message");
 	}
 
+	if (s->header.type == SLURM_IO_RELAY_INIT) {
+		if (_server_relay_init(obj, s) != SLURM_SUCCESS)
+			error("%s: fd %d invalid relay init message from node %d",
+			      __func__, obj->fd, s->node_id);
+		list_enqueue(s->cio->free_outgoing, s->in_msg);
+		s->in_msg = NULL;
+		return SLURM_SUCCESS;
+	}
+
 	/*
 	 * Route the message to the proper output
 	 */
@@ -500,9 +597,7 @@ again:
 			return SLURM_SUCCESS;
 		} else {
 			error("_server_write write failed: %m");
-			if (s->cio->sls)
-				step_launch_notify_io_failure(s->cio->sls,
-							      s->node_id);
+			_notify_io_failure(s);
 			s->out_eof = true;
 			/* FIXME - perhaps we should free the message here? */
 			return SLURM_ERROR;
@@ -754,6 +849,11 @@ again:
 		int i;
 		struct server_io_info *server;
 		for (i = 0; i < info->cio->num_nodes; i++) {
+			/* Relayed nodes share the stream of another one */
+			if (info->cio->ioserver[i] &&
+			    (((struct server_io_info *)
+			      info->cio->ioserver[i]->arg)->node_id != i))
+				continue;
 			msg->ref_count++;
 			if (info->cio->ioserver[i] == NULL)
 				/* client_io_handler_abort() or
@@ -970,6 +1070,7 @@ _alloc_io_buf(void)
 
 	buf->ref_count = 0;
 	buf->length = 0;
+	buf->size = MAX_MSG_LEN;
 	/* The following "+ 1" is just temporary so I can stick a \0 at
 	   the end and do a printf of the data pointer */
 	buf->data = xmalloc(MAX_MSG_LEN + io_hdr_packed_size() + 1);
@@ -1232,6 +1333,12 @@ client_io_handler_downnodes(client_io_t *cio,
 		    && cio->ioserver[node_id] != NULL) {
 			tmp = cio->ioserver[node_id]->arg;
 			info = (struct server_io_info *)tmp;
+			/*
+			 * Relayed through a node which is still up, it sends
+			 * the eofs of this one when it loses it.
+			 */
+			if (info->node_id != node_id)
+				continue;
 			info->remote_stdout_objs = 0;
 			info->remote_stderr_objs = 0;
 			info->testing_connection = false;
@@ -70,6 +70,7 @@
 #include "src/common/uid.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
+#include "src/interfaces/hash.h"
 
 #include "file_bcast.h"
 
@@ -81,6 +82,25 @@
 #define DEFAULT_THREADS 8
 #define MAX_THREADS     64	/* These can be huge messages, so
 				 * only run MAX_THREADS at one time */
+#define DEFAULT_PIPELINE 4	/* Blocks in flight at one time */
+#define BCAST_HASH_CHUNK (1024 * 1024 * 1024)
+#define MAX_PIPELINE    16
+
+/* State shared by the threads sending the blocks of one file */
+typedef struct {
+	file_bcast_msg_t *bcast_msg;	/* template message for every block */
+	hostlist_t *cached;		/* nodes restoring the file from their
+					 * cache, set for the first block */
+	char *node_list;		/* nodes still needing the file */
+	int64_t num_blocks;		/* number of blocks in the file */
+	struct bcast_parameters *params;
+	pthread_mutex_t mutex;		/* protects everything below */
+	int64_t next_block;		/* index of next block to send */
+	int rc;				/* first error sending a block */
+	uint64_t size_compressed;
+	uint64_t size_uncompressed;
+	uint32_t time_compression;	/* usec spent reading/compressing */
+} bcast_xfer_t;
 
 int block_len;				/* block size */
 int fd;					/* source file descriptor */
@@ -90,8 +110,8 @@ job_sbcast_cred_msg_t *sbcast_cred;	/* job alloc info and sbcast cred */
 
 static int   _bcast_file(struct bcast_parameters *params);
 static int   _file_bcast(struct bcast_parameters *params,
-			 file_bcast_msg_t *bcast_msg,
-			 job_sbcast_cred_msg_t *sbcast_cred);
+			 file_bcast_msg_t *bcast_msg, char *node_list,
+			 hostlist_t *cached);
 static int   _file_state(struct bcast_parameters *params);
 static List _fill_in_excluded_paths(struct bcast_parameters *params);
 static int _find_subpath(void *x, void *key);
@@ -163,10 +183,15 @@ static int _get_job_info(struct bcast_parameters *params)
 	return rc;
 }
 
-/* Issue the RPC to transfer the file's data */
+/*
+ * Issue the RPC to transfer the file's data
+ * IN node_list - nodes to send the block to
+ * IN/OUT cached - if set, nodes which already had the file in their cache
+ *		   are added to it
+ */
 static int _file_bcast(struct bcast_parameters *params,
-		       file_bcast_msg_t *bcast_msg,
-		       job_sbcast_cred_msg_t *sbcast_cred)
+		       file_bcast_msg_t *bcast_msg, char *node_list,
+		       hostlist_t *cached)
 {
 	List ret_list = NULL;
 	ListIterator itr;
@@ -181,8 +206,7 @@ static int _file_bcast(struct bcast_parameters *params,
 	msg.forward.tree_width = params->fanout;
 	msg.msg_type = REQUEST_FILE_BCAST;
 
-	ret_list = slurm_send_recv_msgs(sbcast_cred->node_list, &msg,
-					params->timeout);
+	ret_list = slurm_send_recv_msgs(node_list, &msg, params->timeout);
 	if (ret_list == NULL) {
 		error("slurm_send_recv_msgs: %m");
 		exit(1);
@@ -194,6 +218,10 @@ static int _file_bcast(struct bcast_parameters *params,
 					       ret_data_info->data);
 		if (msg_rc == SLURM_SUCCESS)
 			continue;
+		if (cached && (msg_rc == ESLURMD_FILE_BCAST_CACHED)) {
+			hostlist_push_host(cached, ret_data_info->node_name);
+			continue;
+		}
 
 		error("REQUEST_FILE_BCAST(%s): %s",
 		      ret_data_info->node_name,
@@ -206,125 +234,182 @@ static int _file_bcast(struct bcast_parameters *params,
 	return rc;
 }
 
-/* load a buffer with data from the file to broadcast,
- * return number of bytes read, zero on end of file */
-static int _get_block_none(char **buffer, int *orig_len, bool *more,
-			   bool file_start)
+/*
+ * Point block at the data of block block_inx, as the messages are only packed
+ * there is no need to copy it out of the mmap.
+ * RET number of bytes in the block
+ */
+static int _get_block_none(int64_t block_inx, char **block, int32_t *orig_len)
 {
-	static int64_t remaining = -1;
-	static void *position;
-	int size;
+	int64_t offset = block_inx * block_len;
 
-	if (file_start) {
-		remaining = -1;
-		position = NULL;
-	}
-
-	if (remaining < 0) {
-		*buffer = xmalloc(block_len);
-		remaining = f_stat.st_size;
-		position = src;
-	}
-
-	size = MIN(block_len, remaining);
-	memcpy(*buffer, position, size);
-	remaining -= size;
-	position += size;
-
-	*orig_len = size;
-	*more = (remaining) ? true : false;
-	return size;
+	*orig_len = MIN(block_len, f_stat.st_size - offset);
+	*block = (char *) src + offset;
+	return *orig_len;
 }
 
-static int _get_block_lz4(struct bcast_parameters *params,
-			  char **buffer,
-			  int32_t *orig_len,
-			  bool *more, bool file_start)
+/*
+ * Compress block block_inx into buffer, every block holds block_len bytes of
+ * the file (but the last one) so they can be compressed independently.
+ * RET number of compressed bytes in buffer
+ */
+static int _get_block_lz4(int64_t block_inx, char *buffer, int buffer_len,
+			  int32_t *orig_len)
 {
 #if HAVE_LZ4
+	int64_t offset = block_inx * block_len;
 	int size_out;
-	static int64_t remaining = -1;
-	static void *position;
-	int size;
 
-	if (file_start) {
-		remaining = -1;
-		position = NULL;
-	}
-
-	if (!f_stat.st_size) {
-		*more = false;
+	*orig_len = MIN(block_len, f_stat.st_size - offset);
+	if (!*orig_len)
 		return 0;
-	}
 
-	if (remaining < 0) {
-		position = src;
-		remaining = f_stat.st_size;
-		*buffer = xmalloc(block_len);
-	}
-
-	/* intentionally limit decompressed size to 10x compressed
-	 * to avoid problems on receive size when decompressed */
-	size = MIN(block_len * 10, remaining);
-	if (!(size_out = LZ4_compress_destSize(position, *buffer,
-					       &size, block_len))) {
+	if (!(size_out = LZ4_compress_default((char *) src + offset, buffer,
+					      *orig_len, buffer_len))) {
 		/* compression failure */
 		fatal("LZ4 compression error");
 	}
-	position += size;
-	remaining -= size;
-
-	*orig_len = size;
-	*more = (remaining) ? true : false;
 	return size_out;
 #else
-	info("lz4 compression not supported, sending uncompressed file.");
-	params->compress = 0;
-	return _get_block_none(buffer, orig_len, more, file_start);
+	fatal("%s: lz4 compression not supported", __func__);
+	return 0;
+#endif
+}
+
+/* Size of the buffer needed to compress one block */
+static int _block_buffer_len(struct bcast_parameters *params)
+{
+#if HAVE_LZ4
+	if (params->compress == COMPRESS_LZ4)
+		return LZ4_compressBound(block_len);
 #endif
+	return 0;
+}
 
+/*
+ * Read, compress as needed and send block block_inx of the file.
+ * IN xfer - shared transfer state, bcast_msg in it is the template of the
+ *	     message of every block
+ * IN buffer - compression buffer of _block_buffer_len() bytes
+ */
+static int _send_block(bcast_xfer_t *xfer, int64_t block_inx, char *buffer)
+{
+	struct bcast_parameters *params = xfer->params;
+	file_bcast_msg_t bcast_msg = *xfer->bcast_msg;
+	int32_t orig_len = 0;
+	DEF_TIMERS;
+
+	START_TIMER;
+	if (params->compress == COMPRESS_LZ4) {
+		bcast_msg.block_len = _get_block_lz4(block_inx, buffer,
+						     _block_buffer_len(params),
+						     &orig_len);
+		bcast_msg.block = buffer;
+	} else {
+		bcast_msg.block_len = _get_block_none(block_inx,
+						      &bcast_msg.block,
+						      &orig_len);
+	}
+	END_TIMER;
+
+	bcast_msg.block_no = block_inx + 1;
+	bcast_msg.block_offset = block_inx * block_len;
+	bcast_msg.uncomp_len = orig_len;
+	bcast_msg.compress = params->compress;
+	if (block_inx == (xfer->num_blocks - 1))
+		bcast_msg.flags |= FILE_BCAST_LAST_BLOCK;
+	debug("block %u, size %u", bcast_msg.block_no, bcast_msg.block_len);
+
+	slurm_mutex_lock(&xfer->mutex);
+	xfer->time_compression += DELTA_TIMER;
+	xfer->size_uncompressed += orig_len;
+	xfer->size_compressed += bcast_msg.block_len;
+	slurm_mutex_unlock(&xfer->mutex);
+
+	return _file_bcast(params, &bcast_msg, xfer->node_list,
+			   (block_inx ? NULL : xfer->cached));
 }
 
-static int _next_block(struct bcast_parameters *params,
-		       char **buffer,
-		       int32_t *orig_len,
-		       bool *more, bool file_start)
+/*
+ * Send the blocks after the first one, each thread compresses and sends the
+ * next block left until all are sent or one of them fails. This keeps up to
+ * params->pipeline blocks in flight through the forwarding tree.
+ */
+static void *_send_blocks(void *arg)
 {
-	switch (params->compress) {
-	case COMPRESS_OFF:
-		return _get_block_none(buffer, orig_len, more, file_start);
-	case COMPRESS_LZ4:
-		return _get_block_lz4(params, buffer, orig_len, more,
-				      file_start);
+	bcast_xfer_t *xfer = arg;
+	char *buffer = NULL;
+	int64_t block_inx;
+	int buffer_len, rc;
+
+	if ((buffer_len = _block_buffer_len(xfer->params)))
+		buffer = xmalloc(buffer_len);
+
+	while (true) {
+		slurm_mutex_lock(&xfer->mutex);
+		if ((xfer->rc != SLURM_SUCCESS) ||
+		    (xfer->next_block >= xfer->num_blocks)) {
+			slurm_mutex_unlock(&xfer->mutex);
+			break;
+		}
+		block_inx = xfer->next_block++;
+		slurm_mutex_unlock(&xfer->mutex);
+
+		if ((rc = _send_block(xfer, block_inx, buffer))) {
+			slurm_mutex_lock(&xfer->mutex);
+			if (xfer->rc == SLURM_SUCCESS)
+				xfer->rc = rc;
+			slurm_mutex_unlock(&xfer->mutex);
+			break;
+		}
 	}
 
-	/* compression type not recognized */
-	error("File compression type %u not supported,"
-	      " sending uncompressed file.", params->compress);
-	params->compress = 0;
-	return _get_block_none(buffer, orig_len, more, file_start);
+	xfree(buffer);
+	return NULL;
 }
 
 /* read and broadcast the file */
 static int _bcast_file(struct bcast_parameters *params)
 {
-	int rc = SLURM_SUCCESS;
 	file_bcast_msg_t bcast_msg;
-	char *buffer = NULL;
-	int32_t orig_len = 0;
-	uint64_t size_uncompressed = 0, size_compressed = 0;
-	uint32_t time_compression = 0;
-	bool more = true, file_start = true;
-	DEF_TIMERS;
+	bcast_xfer_t xfer = {
+		.bcast_msg = &bcast_msg,
+		.params = params,
+		.rc = SLURM_SUCCESS,
+	};
+	pthread_t *threads = NULL;
+	char *buffer = NULL, *miss_list = NULL;
+	int buffer_len, thread_cnt = 0;
 
 	if (params->block_size)
 		block_len = MIN(params->block_size, f_stat.st_size);
 	else
 		block_len = MIN((512 * 1024), f_stat.st_size);
 
+	if (f_stat.st_size)
+		xfer.num_blocks = (f_stat.st_size + block_len - 1) / block_len;
+	else
+		xfer.num_blocks = 1;
+
+	switch (params->compress) {
+	case COMPRESS_OFF:
+		break;
+	case COMPRESS_LZ4:
+#if !HAVE_LZ4
+		info("lz4 compression not supported, sending uncompressed file.");
+		params->compress = COMPRESS_OFF;
+#endif
+		break;
+	default:
+		/* compression type not recognized */
+		error("File compression type %u not supported,"
+		      " sending uncompressed file.", params->compress);
+		params->compress = COMPRESS_OFF;
+		break;
+	}
+
 	memset(&bcast_msg, 0, sizeof(file_bcast_msg_t));
 	bcast_msg.fname		= params->dst_fname;
-	bcast_msg.block_no	= 1;
 	if (params->flags & BCAST_FLAG_FORCE)
 		bcast_msg.flags |= FILE_BCAST_FORCE;
 	if (params->flags & BCAST_FLAG_SHARED_OBJECT)
@@ -343,53 +428,97 @@ static int _bcast_file(struct bcast_parameters *params)
 		bcast_msg.mtime     = f_stat.st_mtime;
 	}
 
+	/*
+	 * With the slurmd broadcast cache nodes which already have this
+	 * content only need the first block to restore the file.
+	 */
+	xfer.node_list = sbcast_cred->node_list;
+	if (f_stat.st_size && bcast_cache_size()) {
+		DEF_TIMERS;
+
+		START_TIMER;
+		if (bcast_hash_file(src, f_stat.st_size, &bcast_msg.file_hash)) {
+			error("Unable to hash `%s`, not using the broadcast cache",
+			      params->src_fname);
+			memset(&bcast_msg.file_hash, 0,
+			       sizeof(bcast_msg.file_hash));
+		} else {
+			xfer.cached = hostlist_create(NULL);
+		}
+		END_TIMER;
+		verbose("File hashed in %s", TIME_STR);
+	}
+
 	if (!params->fanout)
 		params->fanout = DEFAULT_THREADS;
 	else
 		params->fanout = MIN(MAX_THREADS, params->fanout);
 
-	while (more) {
-		START_TIMER;
-		bcast_msg.block_len = _next_block(params, &buffer, &orig_len,
-						  &more, file_start);
-		END_TIMER;
-		file_start = false;
-		time_compression += DELTA_TIMER;
-		size_uncompressed += orig_len;
-		size_compressed += bcast_msg.block_len;
-		debug("block %u, size %u", bcast_msg.block_no,
-		      bcast_msg.block_len);
-		bcast_msg.compress = params->compress;
-		bcast_msg.uncomp_len = orig_len;
-		bcast_msg.block = buffer;
-		if (!more)
-			bcast_msg.flags |= FILE_BCAST_LAST_BLOCK;
+	if (params->pipeline <= 0)
+		params->pipeline = DEFAULT_PIPELINE;
+	else
+		params->pipeline = MIN(MAX_PIPELINE, params->pipeline);
 
-		rc = _file_bcast(params, &bcast_msg, sbcast_cred);
-		if (rc != SLURM_SUCCESS)
-			break;
-		if (bcast_msg.flags & FILE_BCAST_LAST_BLOCK)
-			break;	/* end of file */
-		bcast_msg.block_no++;
-		bcast_msg.block_offset += orig_len;
+	/*
+	 * The first block registers the file and fully verifies the
+	 * credential on every node, the other ones can only be accepted once
+	 * that is done so it must be sent alone.
+	 */
+	slurm_mutex_init(&xfer.mutex);
+	if ((buffer_len = _block_buffer_len(params)))
+		buffer = xmalloc(buffer_len);
+	xfer.rc = _send_block(&xfer, 0, buffer);
+	xfer.next_block = 1;
+	xfree(buffer);
+
+	if ((xfer.rc == SLURM_SUCCESS) && xfer.cached &&
+	    hostlist_count(xfer.cached)) {
+		hostlist_t *hl = hostlist_create(xfer.node_list);
+		char *hosts = hostlist_ranged_string_xmalloc(xfer.cached);
+
+		verbose("File restored from the broadcast cache of %s", hosts);
+		hostlist_delete(hl, hosts);
+		xfree(hosts);
+		if (hostlist_count(hl)) {
+			miss_list = hostlist_ranged_string_xmalloc(hl);
+			xfer.node_list = miss_list;
+		} else {
+			xfer.next_block = xfer.num_blocks;
+		}
+		FREE_NULL_HOSTLIST(hl);
 	}
+
+	if ((xfer.rc == SLURM_SUCCESS) &&
+	    (xfer.next_block < xfer.num_blocks)) {
+		thread_cnt = MIN(params->pipeline,
+				 xfer.num_blocks - xfer.next_block);
+		threads = xcalloc(thread_cnt, sizeof(*threads));
+		for (int i = 0; i < thread_cnt; i++)
+			slurm_thread_create(&threads[i], _send_blocks, &xfer);
+		for (int i = 0; i < thread_cnt; i++)
+			pthread_join(threads[i], NULL);
+		xfree(threads);
+	}
+	slurm_mutex_destroy(&xfer.mutex);
+	FREE_NULL_HOSTLIST(xfer.cached);
+	xfree(miss_list);
 	xfree(bcast_msg.user_name);
-	xfree(buffer);
 
-	if (size_uncompressed && (params->compress != 0)) {
-		int64_t pct = (int64_t) size_uncompressed - size_compressed;
+	if (xfer.size_uncompressed && (params->compress != 0)) {
+		int64_t pct = (int64_t) xfer.size_uncompressed -
+			      xfer.size_compressed;
 		/* Dividing a negative by a positive in C99 results in
 		 * "truncation towards zero" which gives unexpected values for
 		 * pct. This construct avoids that problem.
 		 */
-		pct = (pct>=0) ? pct * 100 / size_uncompressed
-			       : - (-pct * 100 / size_uncompressed);
+		pct = (pct>=0) ? pct * 100 / xfer.size_uncompressed
+			       : - (-pct * 100 / xfer.size_uncompressed);
 		verbose("File compressed from %"PRIu64" to %"PRIu64" (%d percent) in %u usec",
-			size_uncompressed, size_compressed, (int) pct,
-			time_compression);
+			xfer.size_uncompressed, xfer.size_compressed, (int) pct,
+			xfer.time_compression);
 	}
 
-	return rc;
+	return xfer.rc;
 }
 
 
@@ -656,6 +785,57 @@ extern int bcast_file(struct bcast_parameters *params)
 	return rc;
 }
 
+extern uint64_t bcast_cache_size(void)
+{
+	char *tmp = conf_get_opt_str(slurm_conf.bcast_parameters,
+				     "CacheSize=");
+	uint64_t mbytes = 0;
+
+	if (tmp && ((mbytes = str_to_mbytes(tmp)) == NO_VAL64)) {
+		error("Invalid BcastParameters CacheSize=%s, broadcast cache disabled",
+		      tmp);
+		mbytes = 0;
+	}
+	xfree(tmp);
+
+	return mbytes;
+}
+
+extern int bcast_hash_file(char *data, uint64_t size, slurm_hash_t *hash)
+{
+	uint64_t chunks = (size + BCAST_HASH_CHUNK - 1) / BCAST_HASH_CHUNK;
+	slurm_hash_t chunk_hash = { .type = HASH_PLUGIN_K12 };
+	char *hashes;
+	int rc = SLURM_SUCCESS;
+
+	/*
+	 * hash_g_compute() only takes an int length, so hash the file in
+	 * chunks and then the hashes of all the chunks along with the size.
+	 */
+	hashes = xcalloc(MAX(chunks, 1), sizeof(chunk_hash.hash));
+	for (uint64_t i = 0; i < chunks; i++) {
+		uint64_t offset = i * BCAST_HASH_CHUNK;
+
+		if (hash_g_compute(data + offset,
+				   MIN(BCAST_HASH_CHUNK, size - offset),
+				   NULL, 0, &chunk_hash) < 0) {
+			rc = SLURM_ERROR;
+			goto fini;
+		}
+		memcpy(hashes + (i * sizeof(chunk_hash.hash)), chunk_hash.hash,
+		       sizeof(chunk_hash.hash));
+	}
+
+	hash->type = HASH_PLUGIN_K12;
+	if (hash_g_compute(hashes, chunks * sizeof(chunk_hash.hash),
+			   (char *) &size, sizeof(size), hash) < 0)
+		rc = SLURM_ERROR;
+
+fini:
+	xfree(hashes);
+	return rc;
+}
+
 extern int bcast_decompress_data(file_bcast_msg_t *req)
 {
 	switch (req->compress) {
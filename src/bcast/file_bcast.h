@@ -52,6 +52,7 @@ struct bcast_parameters {
 	char *dst_fname;
 	int fanout;
 	uint16_t flags;
+	int pipeline;
 	slurm_selected_step_t *selected_step;
 	char *src_fname;
 	uint32_t step_id;
@@ -68,7 +69,7 @@ typedef struct file_bcast_info {
 	uint32_t job_id;	/* job id */
 	uint32_t step_id;	/* step id */
 	time_t last_update;	/* transfer last block received */
-	int received_blocks;	/* number of blocks received */
+	uint64_t received_size;	/* number of bytes received */
 	time_t start_time;	/* transfer start time */
 	uid_t uid;		/* uid of owner */
 } file_bcast_info_t;
@@ -85,4 +86,14 @@ extern int bcast_file(struct bcast_parameters *params);
 
 extern int bcast_decompress_data(file_bcast_msg_t *req);
 
+/* RET size in MB of the slurmd broadcast cache, 0 if disabled */
+extern uint64_t bcast_cache_size(void);
+
+/*
+ * Hash size bytes of file data, this is the key of the file in the slurmd
+ * broadcast cache (BcastParameters=CacheSize).
+ * RET SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int bcast_hash_file(char *data, uint64_t size, slurm_hash_t *hash);
+
 #endif
@@ -44,20 +44,47 @@
 #include <stdlib.h>
 #include <ctype.h>
 
+#include "src/common/id_hash.h"
 #include "src/common/uid.h"
 #include "src/common/xstring.h"
 #include "src/interfaces/priority.h"
 #include "src/common/slurmdbd_pack.h"
 #include "src/slurmdbd/read_config.h"
 
+/* Minimum buckets in the assoc hashes, they grow with the associations */
 #define ASSOC_HASH_SIZE 1000
-#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % ASSOC_HASH_SIZE)
+#define ASSOC_HASH_ID_INX(_assoc_id)	(_assoc_id % assoc_hash_size)
+
+#define FNV_32_INIT 0x811c9dc5U
+#define FNV_32_PRIME 0x01000193U
+#define FNV_64_INIT 0xcbf29ce484222325ULL
+#define FNV_64_PRIME 0x00000100000001b3ULL
 
 typedef struct {
 	char *req;
 	list_t *ret_list;
 } find_coord_t;
 
+/*
+ * Index of the user, QOS or wckey list mapping a key of each record to the
+ * first record in the list with it. Keys built from names are hashes, so a
+ * record found must still be checked. Records key() returns false for are not
+ * indexed. The index is only used while the current list (*cur) is the list
+ * it was built for, lookups fall back to searching the list otherwise.
+ */
+typedef struct {
+	id_hash_t *hash;
+	bool (*key)(void *item, uint64_t *key);
+	List *cur;
+	List list;
+} list_index_t;
+
+typedef struct {
+	list_index_t *index;
+	void *item;
+	uint64_t key;
+} index_find_t;
+
 slurmdb_assoc_rec_t *assoc_mgr_root_assoc = NULL;
 uint32_t g_qos_max_priority = 0;
 uint32_t g_assoc_max_priority = 0;
@@ -77,11 +104,15 @@ List assoc_mgr_wckey_list = NULL;
 
 static int setup_children = 0;
 static pthread_rwlock_t assoc_mgr_locks[ASSOC_MGR_ENTITY_COUNT];
+/* Updates applied to each list, under its write lock, see _fetch_list() */
+static uint32_t assoc_mgr_list_gen[ASSOC_MGR_ENTITY_COUNT];
 static pthread_mutex_t assoc_lock_init = PTHREAD_MUTEX_INITIALIZER;
 
 static assoc_init_args_t init_setup;
 static slurmdb_assoc_rec_t **assoc_hash_id = NULL;
 static slurmdb_assoc_rec_t **assoc_hash = NULL;
+static uint32_t assoc_hash_size = 0;
+static uint32_t assoc_hash_cnt = 0;
 static int *assoc_mgr_tres_old_pos = NULL;
 
 static bool _running_cache(void)
@@ -93,60 +124,105 @@ static bool _running_cache(void)
 	return false;
 }
 
-static int _get_str_inx(char *name)
+/* Case insensitive FNV-1a, names are all compared with xstrcasecmp() */
+static uint32_t _hash_str(uint32_t hash, char *name)
 {
-	int j, index = 0;
-
 	if (!name)
-		return 0;
+		return hash;
+
+	for (; *name; name++) {
+		hash ^= (uint32_t) tolower((unsigned char) *name);
+		hash *= FNV_32_PRIME;
+	}
 
-	for (j = 1; *name; name++, j++)
-		index += (int)tolower(*name) * j;
+	/* Keep ("ab", "c") apart from ("a", "bc") */
+	hash ^= 0xff;
+	hash *= FNV_32_PRIME;
 
-	return index;
+	return hash;
 }
 
 static int _assoc_hash_index(slurmdb_assoc_rec_t *assoc)
 {
-	int index;
+	uint32_t hash = FNV_32_INIT;
 
 	xassert(assoc);
 
-	/* Multiply each character by its numerical position in the
-	 * name string to add a bit of entropy.
-	 */
+	hash ^= assoc->uid;
+	hash *= FNV_32_PRIME;
 
-	index = assoc->uid;
+	/*
+	 * Records without a uid can only be found by user name, and only with
+	 * a lookup without a uid either, so hash the name to spread them.
+	 */
+	if (assoc->uid == NO_VAL)
+		hash = _hash_str(hash, assoc->user);
 
 	/* only set on the slurmdbd */
 	if (slurmdbd_conf && assoc->cluster)
-		index += _get_str_inx(assoc->cluster);
+		hash = _hash_str(hash, assoc->cluster);
 
 	if (assoc->acct)
-		index += _get_str_inx(assoc->acct);
+		hash = _hash_str(hash, assoc->acct);
 
 	if (assoc->partition)
-		index += _get_str_inx(assoc->partition);
+		hash = _hash_str(hash, assoc->partition);
+
+	return hash % assoc_hash_size;
+}
 
-	index %= ASSOC_HASH_SIZE;
-	if (index < 0)
-		index += ASSOC_HASH_SIZE;
+static void _free_assoc_hash(void)
+{
+	xfree(assoc_hash_id);
+	xfree(assoc_hash);
+	assoc_hash_size = 0;
+	assoc_hash_cnt = 0;
+}
 
-	return index;
+/* Resize both hashes to size buckets, relinking what is in them */
+static void _resize_assoc_hash(uint32_t size)
+{
+	slurmdb_assoc_rec_t **old_hash_id = assoc_hash_id;
+	slurmdb_assoc_rec_t **old_hash = assoc_hash;
+	uint32_t old_size = assoc_hash_size;
 
+	assoc_hash_size = MAX(size, ASSOC_HASH_SIZE);
+	assoc_hash_id = xcalloc(assoc_hash_size, sizeof(*assoc_hash_id));
+	assoc_hash = xcalloc(assoc_hash_size, sizeof(*assoc_hash));
+
+	for (int i = 0; i < old_size; i++) {
+		slurmdb_assoc_rec_t *assoc, *next;
+
+		for (assoc = old_hash_id[i]; assoc; assoc = next) {
+			int inx = ASSOC_HASH_ID_INX(assoc->id);
+
+			next = assoc->assoc_next_id;
+			assoc->assoc_next_id = assoc_hash_id[inx];
+			assoc_hash_id[inx] = assoc;
+		}
+		for (assoc = old_hash[i]; assoc; assoc = next) {
+			int inx = _assoc_hash_index(assoc);
+
+			next = assoc->assoc_next;
+			assoc->assoc_next = assoc_hash[inx];
+			assoc_hash[inx] = assoc;
+		}
+	}
+
+	xfree(old_hash_id);
+	xfree(old_hash);
 }
 
 static void _add_assoc_hash(slurmdb_assoc_rec_t *assoc)
 {
-	int inx = ASSOC_HASH_ID_INX(assoc->id);
+	int inx;
 
-	if (!assoc_hash_id)
-		assoc_hash_id = xcalloc(ASSOC_HASH_SIZE,
-					sizeof(slurmdb_assoc_rec_t *));
-	if (!assoc_hash)
-		assoc_hash = xcalloc(ASSOC_HASH_SIZE,
-				     sizeof(slurmdb_assoc_rec_t *));
+	/* Keep chains about one record long */
+	if (assoc_hash_cnt >= assoc_hash_size)
+		_resize_assoc_hash(assoc_hash_size * 2);
+	assoc_hash_cnt++;
 
+	inx = ASSOC_HASH_ID_INX(assoc->id);
 	assoc->assoc_next_id = assoc_hash_id[inx];
 	assoc_hash_id[inx] = assoc;
 
@@ -323,6 +399,8 @@ static void _delete_assoc_hash(slurmdb_assoc_rec_t *assoc)
 		return;	/* Fix CLANG false positive error */
 	} else
 		*assoc_pptr = assoc_ptr->assoc_next;
+
+	assoc_hash_cnt--;
 }
 
 
@@ -525,6 +603,230 @@ static int _clear_used_qos_info(slurmdb_qos_rec_t *qos)
 	return SLURM_SUCCESS;
 }
 
+/* 64-bit version of _hash_str() for the list indexes */
+static uint64_t _name_key(uint64_t key, char *name)
+{
+	if (!name)
+		return key;
+
+	for (; *name; name++) {
+		key ^= (uint64_t) tolower((unsigned char) *name);
+		key *= FNV_64_PRIME;
+	}
+
+	key ^= 0xff;
+	key *= FNV_64_PRIME;
+
+	return key;
+}
+
+static bool _user_uid_key(void *x, uint64_t *key)
+{
+	slurmdb_user_rec_t *user = x;
+
+	if (user->uid == NO_VAL)
+		return false;
+
+	*key = user->uid;
+	return true;
+}
+
+static bool _user_name_key(void *x, uint64_t *key)
+{
+	slurmdb_user_rec_t *user = x;
+
+	if (!user->name)
+		return false;
+
+	*key = _name_key(FNV_64_INIT, user->name);
+	return true;
+}
+
+static bool _qos_id_key(void *x, uint64_t *key)
+{
+	slurmdb_qos_rec_t *qos = x;
+
+	*key = qos->id;
+	return true;
+}
+
+static bool _qos_name_key(void *x, uint64_t *key)
+{
+	slurmdb_qos_rec_t *qos = x;
+
+	if (!qos->name)
+		return false;
+
+	*key = _name_key(FNV_64_INIT, qos->name);
+	return true;
+}
+
+/* Only set on the slurmdbd, which holds the wckeys of every cluster */
+static uint64_t _wckey_cluster_key(slurmdb_wckey_rec_t *wckey)
+{
+	if (!slurmdbd_conf)
+		return FNV_64_INIT;
+
+	return _name_key(FNV_64_INIT, wckey->cluster);
+}
+
+static bool _wckey_id_key(void *x, uint64_t *key)
+{
+	slurmdb_wckey_rec_t *wckey = x;
+
+	*key = (_wckey_cluster_key(wckey) ^ wckey->id) * FNV_64_PRIME;
+	return true;
+}
+
+static bool _wckey_key(void *x, uint64_t *key)
+{
+	slurmdb_wckey_rec_t *wckey = x;
+
+	if ((wckey->uid == NO_VAL) || !wckey->name)
+		return false;
+
+	*key = (_wckey_cluster_key(wckey) ^ wckey->uid) * FNV_64_PRIME;
+	*key = _name_key(*key, wckey->name);
+	return true;
+}
+
+static list_index_t user_uid_index = {
+	.key = _user_uid_key, .cur = &assoc_mgr_user_list
+};
+static list_index_t user_name_index = {
+	.key = _user_name_key, .cur = &assoc_mgr_user_list
+};
+static list_index_t qos_id_index = {
+	.key = _qos_id_key, .cur = &assoc_mgr_qos_list
+};
+static list_index_t qos_name_index = {
+	.key = _qos_name_key, .cur = &assoc_mgr_qos_list
+};
+static list_index_t wckey_id_index = {
+	.key = _wckey_id_key, .cur = &assoc_mgr_wckey_list
+};
+static list_index_t wckey_index = {
+	.key = _wckey_key, .cur = &assoc_mgr_wckey_list
+};
+
+static void _index_insert(list_index_t *index, void *item)
+{
+	uint64_t key;
+
+	if (!index->key(item, &key))
+		return;
+
+	/* Keep the first record with the key as list_find_first() would */
+	if (!id_hash_find(index->hash, key))
+		id_hash_add(index->hash, key, item);
+}
+
+static int _index_add_for_each(void *x, void *arg)
+{
+	_index_insert(arg, x);
+	return 0;
+}
+
+/* Index all the records of list, freeing the index if there is no list */
+static void _index_build(list_index_t *index, List list)
+{
+	if (index->hash)
+		id_hash_destroy(index->hash);
+	index->hash = NULL;
+	index->list = list;
+
+	if (!list)
+		return;
+
+	index->hash = id_hash_create(list_count(list));
+	list_for_each(list, _index_add_for_each, index);
+}
+
+/* Locks should be in place before calling this, write lock of the list */
+static void _index_add(list_index_t *index, void *item)
+{
+	if (index->list != *index->cur)
+		_index_build(index, *index->cur);
+	else if (index->hash)
+		_index_insert(index, item);
+}
+
+static int _find_other_with_key(void *x, void *arg)
+{
+	index_find_t *find = arg;
+	uint64_t key;
+
+	return ((x != find->item) && find->index->key(x, &key) &&
+		(key == find->key));
+}
+
+/*
+ * Remove item from the index, while it still has the key it was indexed with.
+ * Locks should be in place before calling this, write lock of the list
+ */
+static void _index_remove(list_index_t *index, void *item)
+{
+	index_find_t find = { .index = index, .item = item };
+	void *other;
+
+	if (index->list != *index->cur)
+		_index_build(index, *index->cur);
+
+	if (!index->hash || !index->key(item, &find.key) ||
+	    !id_hash_remove(index->hash, find.key, item))
+		return;
+
+	/* Another record may have the same key, it is the first one now */
+	if ((other = list_find_first(index->list, _find_other_with_key,
+				     &find)))
+		id_hash_add(index->hash, find.key, other);
+}
+
+/*
+ * Find the first record in list that match(record, arg) is true for, like
+ * list_find_first() but going through the index with the key arg has.
+ */
+static void *_index_find(list_index_t *index, List list, uint64_t key,
+			 ListFindF match, void *arg)
+{
+	void *item;
+
+	if (!list)
+		return NULL;
+	if (!index->hash || (index->list != list))
+		return list_find_first(list, match, arg);
+
+	if (!(item = id_hash_find(index->hash, key)))
+		return NULL;
+	if (match(item, arg))
+		return item;
+
+	/* Another record with the same hash, not worth indexing */
+	return list_find_first(list, match, arg);
+}
+
+/*
+ * Called by the _post_*_list() functions, usually on a new list before it
+ * replaces the current one.
+ */
+static void _index_users(List user_list)
+{
+	_index_build(&user_uid_index, user_list);
+	_index_build(&user_name_index, user_list);
+}
+
+static void _index_qos(List qos_list)
+{
+	_index_build(&qos_id_index, qos_list);
+	_index_build(&qos_name_index, qos_list);
+}
+
+static void _index_wckeys(List wckey_list)
+{
+	_index_build(&wckey_id_index, wckey_list);
+	_index_build(&wckey_index, wckey_list);
+}
+
 /* Locks should be in place before calling this. */
 static int _change_user_name(slurmdb_user_rec_t *user)
 {
@@ -571,9 +873,11 @@ static int _change_user_name(slurmdb_user_rec_t *user)
 		itr = list_iterator_create(assoc_mgr_wckey_list);
 		while ((wckey = list_next(itr))) {
 			if (!xstrcmp(user->old_name, wckey->user)) {
+				_index_remove(&wckey_index, wckey);
 				xfree(wckey->user);
 				wckey->user = xstrdup(user->name);
 				wckey->uid = user->uid;
+				_index_add(&wckey_index, wckey);
 				debug3("changing wckey %d", wckey->id);
 			}
 		}
@@ -696,6 +1000,135 @@ static int _list_find_user(void *x, void *key)
 	return 0;
 }
 
+static int _list_find_user_name(void *x, void *key)
+{
+	slurmdb_user_rec_t *user = x;
+
+	if (!xstrcasecmp(user->name, key))
+		return 1;
+	return 0;
+}
+
+/* Locks should be in place before calling this, USER_READ */
+static slurmdb_user_rec_t *_find_user_uid(uint32_t uid)
+{
+	return _index_find(&user_uid_index, assoc_mgr_user_list, uid,
+			   _list_find_uid, &uid);
+}
+
+/* Locks should be in place before calling this, USER_READ */
+static slurmdb_user_rec_t *_find_user_name(char *name)
+{
+	if (!name)
+		return list_find_first(assoc_mgr_user_list,
+				       _list_find_user_name, name);
+
+	return _index_find(&user_name_index, assoc_mgr_user_list,
+			   _name_key(FNV_64_INIT, name),
+			   _list_find_user_name, name);
+}
+
+/* Locks should be in place before calling this, USER_READ */
+static slurmdb_user_rec_t *_find_user_rec(slurmdb_user_rec_t *user)
+{
+	if (user->uid != NO_VAL)
+		return _find_user_uid(user->uid);
+	return _find_user_name(user->name);
+}
+
+static int _list_find_qos_name(void *x, void *key)
+{
+	slurmdb_qos_rec_t *qos = x;
+
+	if (!xstrcasecmp(qos->name, key))
+		return 1;
+	return 0;
+}
+
+/*
+ * Find the QOS with the id of qos, or else its name.
+ * Locks should be in place before calling this, QOS_READ
+ */
+static slurmdb_qos_rec_t *_find_qos_rec(slurmdb_qos_rec_t *qos)
+{
+	slurmdb_qos_rec_t *found_qos;
+
+	if ((found_qos = _index_find(&qos_id_index, assoc_mgr_qos_list,
+				     qos->id, slurmdb_find_qos_in_list,
+				     &qos->id)))
+		return found_qos;
+	if (!qos->name)
+		return NULL;
+
+	return _index_find(&qos_name_index, assoc_mgr_qos_list,
+			   _name_key(FNV_64_INIT, qos->name),
+			   _list_find_qos_name, qos->name);
+}
+
+static int _list_find_wckey(void *x, void *key)
+{
+	slurmdb_wckey_rec_t *found_wckey = x;
+	slurmdb_wckey_rec_t *wckey = key;
+
+	/* only and always check for on the slurmdbd */
+	if (slurmdbd_conf &&
+	    (!wckey->cluster ||
+	     xstrcasecmp(wckey->cluster, found_wckey->cluster))) {
+		debug4("not the right cluster");
+		return 0;
+	}
+
+	if (wckey->id)
+		return (wckey->id == found_wckey->id);
+
+	if (wckey->uid != NO_VAL) {
+		if (wckey->uid != found_wckey->uid) {
+			debug4("not the right user %u != %u",
+			       wckey->uid, found_wckey->uid);
+			return 0;
+		}
+	} else if (wckey->user &&
+		   xstrcasecmp(wckey->user, found_wckey->user))
+		return 0;
+
+	if (wckey->name &&
+	    (!found_wckey->name ||
+	     xstrcasecmp(wckey->name, found_wckey->name))) {
+		debug4("not the right name %s != %s",
+		       wckey->name, found_wckey->name);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Find the wckey with the id of wckey, or else its user and name.
+ * Locks should be in place before calling this, WCKEY_READ
+ */
+static slurmdb_wckey_rec_t *_find_wckey_rec(slurmdb_wckey_rec_t *wckey)
+{
+	list_index_t *index = NULL;
+	uint64_t key;
+
+	if (slurmdbd_conf && !wckey->cluster) {
+		error("No cluster name was given to check against, we need one to get a wckey.");
+		return NULL;
+	}
+
+	if (wckey->id)
+		index = &wckey_id_index;
+	else if ((wckey->uid != NO_VAL) && wckey->name)
+		index = &wckey_index;
+
+	if (!index || !index->key(wckey, &key))
+		return list_find_first(assoc_mgr_wckey_list, _list_find_wckey,
+				       wckey);
+
+	return _index_find(index, assoc_mgr_wckey_list, key, _list_find_wckey,
+			   wckey);
+}
+
 static int _list_find_coord(void *x, void *key)
 {
 	slurmdb_user_rec_t *user = x;
@@ -727,8 +1160,7 @@ static void _set_user_default_acct(slurmdb_assoc_rec_t *assoc)
 
 	/* set up the default if this is it */
 	if ((assoc->is_def == 1) && (assoc->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = list_find_first(
-			assoc_mgr_user_list, _list_find_uid, &assoc->uid);
+		slurmdb_user_rec_t *user = _find_user_uid(assoc->uid);
 
 		if (!user)
 			return;
@@ -758,8 +1190,7 @@ static void _clear_user_default_acct(slurmdb_assoc_rec_t *assoc)
 
 	/* set up the default if this is it */
 	if ((assoc->is_def == 0) && (assoc->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = list_find_first(
-			assoc_mgr_user_list, _list_find_uid, &assoc->uid);
+		slurmdb_user_rec_t *user = _find_user_uid(assoc->uid);
 
 		if (!user)
 			return;
@@ -784,8 +1215,7 @@ static void _set_user_default_wckey(slurmdb_wckey_rec_t *wckey)
 
 	/* set up the default if this is it */
 	if ((wckey->is_def == 1) && (wckey->uid != NO_VAL)) {
-		slurmdb_user_rec_t *user = list_find_first(
-			assoc_mgr_user_list, _list_find_uid, &wckey->uid);
+		slurmdb_user_rec_t *user = _find_user_uid(wckey->uid);
 
 		if (!user)
 			return;
@@ -1089,8 +1519,8 @@ static int _post_assoc_list(void)
 	if (!assoc_mgr_assoc_list)
 		return SLURM_ERROR;
 
-	xfree(assoc_hash_id);
-	xfree(assoc_hash);
+	_free_assoc_hash();
+	_resize_assoc_hash(list_count(assoc_mgr_assoc_list));
 
 	itr = list_iterator_create(assoc_mgr_assoc_list);
 
@@ -1160,6 +1590,7 @@ static int _post_user_list(List user_list)
 			list_append(assoc_mgr_coord_list, user);
 	}
 	list_iterator_destroy(itr);
+	_index_users(user_list);
 	END_TIMER2(__func__);
 	return SLURM_SUCCESS;
 }
@@ -1185,6 +1616,7 @@ static int _post_wckey_list(List wckey_list)
 		_set_user_default_wckey(wckey);
 	}
 	list_iterator_destroy(itr);
+	_index_wckeys(wckey_list);
 	return SLURM_SUCCESS;
 }
 
@@ -1226,6 +1658,7 @@ static int _post_qos_list(List qos_list)
 			_set_qos_norm_priority(qos);
 	}
 	list_iterator_destroy(itr);
+	_index_qos(qos_list);
 
 	return SLURM_SUCCESS;
 }
@@ -1565,10 +1998,69 @@ extern int assoc_mgr_post_tres_list(List new_list)
 	return (changed_size || changed_pos) ? 1 : 0;
 }
 
+static List _fetch_tres(void *db_conn, void *cond)
+{
+	return acct_storage_g_get_tres(db_conn, getuid(), cond);
+}
+
+static List _fetch_assocs(void *db_conn, void *cond)
+{
+	return acct_storage_g_get_assocs(db_conn, getuid(), cond);
+}
+
+static List _fetch_res(void *db_conn, void *cond)
+{
+	return acct_storage_g_get_res(db_conn, getuid(), cond);
+}
+
+static List _fetch_qos(void *db_conn, void *cond)
+{
+	return acct_storage_g_get_qos(db_conn, getuid(), cond);
+}
+
+static List _fetch_users(void *db_conn, void *cond)
+{
+	return acct_storage_g_get_users(db_conn, getuid(), cond);
+}
+
+static List _fetch_wckeys(void *db_conn, void *cond)
+{
+	return acct_storage_g_get_wckeys(db_conn, getuid(), cond);
+}
+
+/*
+ * Fetch a list from the storage without holding any lock, so nothing waits
+ * on the slurmdbd round trip, then take locks to publish it. If an update
+ * was applied to the current list of entity meanwhile, swapping it out would
+ * lose the update, so the list is fetched again with the locks held.
+ * RET the new list or NULL, with locks held either way
+ */
+static List _fetch_list(void *db_conn, List (*fetch)(void *, void *),
+			void *cond, assoc_mgr_lock_t *locks, int entity)
+{
+	List new_list;
+	uint32_t gen;
+
+	assoc_mgr_lock(locks);
+	gen = assoc_mgr_list_gen[entity];
+	assoc_mgr_unlock(locks);
+
+	new_list = (*fetch)(db_conn, cond);
+
+	assoc_mgr_lock(locks);
+	if (gen != assoc_mgr_list_gen[entity]) {
+		debug("%s: list updated while fetching it, fetching it again",
+		      __func__);
+		FREE_NULL_LIST(new_list);
+		new_list = (*fetch)(db_conn, cond);
+	}
+
+	return new_list;
+}
+
 static int _get_assoc_mgr_tres_list(void *db_conn, int enforce)
 {
 	slurmdb_tres_cond_t tres_q;
-	uid_t uid = getuid();
 	List new_list = NULL;
 	int changed;
 	assoc_mgr_lock_t locks =
@@ -1576,16 +2068,14 @@ static int _get_assoc_mgr_tres_list(void *db_conn, int enforce)
 
 	memset(&tres_q, 0, sizeof(slurmdb_tres_cond_t));
 
-	assoc_mgr_lock(&locks);
-
 	/* If this exists we only want/care about tracking/caching these TRES */
 	if (slurm_conf.accounting_storage_tres) {
 		tres_q.type_list = list_create(xfree_ptr);
 		slurm_addto_char_list(tres_q.type_list,
 				      slurm_conf.accounting_storage_tres);
 	}
-	new_list = acct_storage_g_get_tres(
-		db_conn, uid, &tres_q);
+	new_list = _fetch_list(db_conn, _fetch_tres, &tres_q, &locks,
+			       TRES_LOCK);
 
 	FREE_NULL_LIST(tres_q.type_list);
 
@@ -1615,14 +2105,11 @@ static int _get_assoc_mgr_tres_list(void *db_conn, int enforce)
 static int _get_assoc_mgr_assoc_list(void *db_conn, int enforce)
 {
 	slurmdb_assoc_cond_t assoc_q;
-	uid_t uid = getuid();
+	List new_list;
 	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .qos = READ_LOCK,
 				   .tres = READ_LOCK, .user = WRITE_LOCK };
 
 //	DEF_TIMERS;
-	assoc_mgr_lock(&locks);
-	FREE_NULL_LIST(assoc_mgr_assoc_list);
-
 	memset(&assoc_q, 0, sizeof(slurmdb_assoc_cond_t));
 	if (!slurmdbd_conf) {
 		assoc_q.cluster_list = list_create(NULL);
@@ -1633,12 +2120,15 @@ static int _get_assoc_mgr_assoc_list(void *db_conn, int enforce)
 	}
 
 //	START_TIMER;
-	assoc_mgr_assoc_list =
-		acct_storage_g_get_assocs(db_conn, uid, &assoc_q);
+	new_list = _fetch_list(db_conn, _fetch_assocs, &assoc_q, &locks,
+			       ASSOC_LOCK);
 //	END_TIMER2("get_assocs");
 
 	FREE_NULL_LIST(assoc_q.cluster_list);
 
+	FREE_NULL_LIST(assoc_mgr_assoc_list);
+	assoc_mgr_assoc_list = new_list;
+
 	if (!assoc_mgr_assoc_list) {
 		/* create list so we don't keep calling this if there
 		   isn't anything there */
@@ -1665,12 +2155,9 @@ static int _get_assoc_mgr_assoc_list(void *db_conn, int enforce)
 static int _get_assoc_mgr_res_list(void *db_conn, int enforce)
 {
 	slurmdb_res_cond_t res_q;
-	uid_t uid = getuid();
+	List new_list;
 	assoc_mgr_lock_t locks = { .res = WRITE_LOCK };
 
-	assoc_mgr_lock(&locks);
-	FREE_NULL_LIST(assoc_mgr_res_list);
-
 	slurmdb_init_res_cond(&res_q, 0);
 	if (!slurmdbd_conf) {
 		res_q.with_clusters = 1;
@@ -1681,10 +2168,13 @@ static int _get_assoc_mgr_res_list(void *db_conn, int enforce)
 		      __func__);
 	}
 
-	assoc_mgr_res_list = acct_storage_g_get_res(db_conn, uid, &res_q);
+	new_list = _fetch_list(db_conn, _fetch_res, &res_q, &locks, RES_LOCK);
 
 	FREE_NULL_LIST(res_q.cluster_list);
 
+	FREE_NULL_LIST(assoc_mgr_res_list);
+	assoc_mgr_res_list = new_list;
+
 	if (!assoc_mgr_res_list) {
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
@@ -1703,13 +2193,13 @@ static int _get_assoc_mgr_res_list(void *db_conn, int enforce)
 
 static int _get_assoc_mgr_qos_list(void *db_conn, int enforce)
 {
-	uid_t uid = getuid();
 	List new_list = NULL;
 	assoc_mgr_lock_t locks = { .qos = WRITE_LOCK };
 
-	new_list = acct_storage_g_get_qos(db_conn, uid, NULL);
+	new_list = _fetch_list(db_conn, _fetch_qos, NULL, &locks, QOS_LOCK);
 
 	if (!new_list) {
+		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS) {
 			error("%s: no list was made.", __func__);
 			return SLURM_ERROR;
@@ -1718,8 +2208,6 @@ static int _get_assoc_mgr_qos_list(void *db_conn, int enforce)
 		}
 	}
 
-	assoc_mgr_lock(&locks);
-
 	FREE_NULL_LIST(assoc_mgr_qos_list);
 	assoc_mgr_qos_list = new_list;
 	new_list = NULL;
@@ -1734,16 +2222,17 @@ static int _get_assoc_mgr_qos_list(void *db_conn, int enforce)
 static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 {
 	slurmdb_user_cond_t user_q;
-	uid_t uid = getuid();
+	List new_list;
 	assoc_mgr_lock_t locks = { .user = WRITE_LOCK };
 
 	memset(&user_q, 0, sizeof(slurmdb_user_cond_t));
 	user_q.with_coords = 1;
 
-	assoc_mgr_lock(&locks);
+	new_list = _fetch_list(db_conn, _fetch_users, &user_q, &locks,
+			       USER_LOCK);
 	FREE_NULL_LIST(assoc_mgr_user_list);
 	FREE_NULL_LIST(assoc_mgr_coord_list);
-	assoc_mgr_user_list = acct_storage_g_get_users(db_conn, uid, &user_q);
+	assoc_mgr_user_list = new_list;
 
 	if (!assoc_mgr_user_list) {
 		assoc_mgr_unlock(&locks);
@@ -1765,13 +2254,10 @@ static int _get_assoc_mgr_user_list(void *db_conn, int enforce)
 static int _get_assoc_mgr_wckey_list(void *db_conn, int enforce)
 {
 	slurmdb_wckey_cond_t wckey_q;
-	uid_t uid = getuid();
+	List new_list;
 	assoc_mgr_lock_t locks = { .user = WRITE_LOCK, .wckey = WRITE_LOCK };
 
 //	DEF_TIMERS;
-	assoc_mgr_lock(&locks);
-	FREE_NULL_LIST(assoc_mgr_wckey_list);
-
 	memset(&wckey_q, 0, sizeof(slurmdb_wckey_cond_t));
 	if (!slurmdbd_conf) {
 		wckey_q.cluster_list = list_create(NULL);
@@ -1782,16 +2268,20 @@ static int _get_assoc_mgr_wckey_list(void *db_conn, int enforce)
 	}
 
 //	START_TIMER;
-	assoc_mgr_wckey_list =
-		acct_storage_g_get_wckeys(db_conn, uid, &wckey_q);
+	new_list = _fetch_list(db_conn, _fetch_wckeys, &wckey_q, &locks,
+			       WCKEY_LOCK);
 //	END_TIMER2("get_wckeys");
 
 	FREE_NULL_LIST(wckey_q.cluster_list);
 
+	FREE_NULL_LIST(assoc_mgr_wckey_list);
+	assoc_mgr_wckey_list = new_list;
+
 	if (!assoc_mgr_wckey_list) {
 		/* create list so we don't keep calling this if there
 		   isn't anything there */
 		assoc_mgr_wckey_list = list_create(slurmdb_destroy_wckey_rec);
+		_index_wckeys(assoc_mgr_wckey_list);
 		assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_WCKEYS) {
 			error("%s: no list was made.", __func__);
@@ -1824,8 +2314,7 @@ static int _refresh_assoc_mgr_tres_list(void *db_conn, int enforce)
 static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 {
 	slurmdb_assoc_cond_t assoc_q;
-	List current_assocs = NULL;
-	uid_t uid = getuid();
+	List current_assocs = NULL, new_list;
 	ListIterator curr_itr = NULL;
 	slurmdb_assoc_rec_t *curr_assoc = NULL, *assoc = NULL;
 	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .qos = READ_LOCK,
@@ -1841,19 +2330,14 @@ static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 		      __func__);
 	}
 
-	assoc_mgr_lock(&locks);
-
-	current_assocs = assoc_mgr_assoc_list;
-
 //	START_TIMER;
-	assoc_mgr_assoc_list =
-		acct_storage_g_get_assocs(db_conn, uid, &assoc_q);
+	new_list = _fetch_list(db_conn, _fetch_assocs, &assoc_q, &locks,
+			       ASSOC_LOCK);
 //	END_TIMER2("get_assocs");
 
 	FREE_NULL_LIST(assoc_q.cluster_list);
 
-	if (!assoc_mgr_assoc_list) {
-		assoc_mgr_assoc_list = current_assocs;
+	if (!new_list) {
 		assoc_mgr_unlock(&locks);
 
 		error("%s: no new list given back keeping cached one.",
@@ -1861,6 +2345,9 @@ static int _refresh_assoc_mgr_assoc_list(void *db_conn, int enforce)
 		return SLURM_ERROR;
 	}
 
+	current_assocs = assoc_mgr_assoc_list;
+	assoc_mgr_assoc_list = new_list;
+
 	_post_assoc_list();
 
 	if (!current_assocs) {
@@ -1904,7 +2391,6 @@ static int _refresh_assoc_mgr_res_list(void *db_conn, int enforce)
 {
 	slurmdb_res_cond_t res_q;
 	List current_res = NULL;
-	uid_t uid = getuid();
 	assoc_mgr_lock_t locks = { .res = WRITE_LOCK };
 
 	slurmdb_init_res_cond(&res_q, 0);
@@ -1917,18 +2403,18 @@ static int _refresh_assoc_mgr_res_list(void *db_conn, int enforce)
 		      __func__);
 	}
 
-	current_res = acct_storage_g_get_res(db_conn, uid, &res_q);
+	current_res = _fetch_list(db_conn, _fetch_res, &res_q, &locks,
+				  RES_LOCK);
 
 	FREE_NULL_LIST(res_q.cluster_list);
 
 	if (!current_res) {
+		assoc_mgr_unlock(&locks);
 		error("%s: no new list given back keeping cached one.",
 		      __func__);
 		return SLURM_ERROR;
 	}
 
-	assoc_mgr_lock(&locks);
-
 	_post_res_list(current_res);
 
 	FREE_NULL_LIST(assoc_mgr_res_list);
@@ -1946,19 +2432,17 @@ static int _refresh_assoc_mgr_res_list(void *db_conn, int enforce)
 static int _refresh_assoc_mgr_qos_list(void *db_conn, int enforce)
 {
 	List current_qos = NULL;
-	uid_t uid = getuid();
 	assoc_mgr_lock_t locks = { .qos = WRITE_LOCK };
 
-	current_qos = acct_storage_g_get_qos(db_conn, uid, NULL);
+	current_qos = _fetch_list(db_conn, _fetch_qos, NULL, &locks, QOS_LOCK);
 
 	if (!current_qos) {
+		assoc_mgr_unlock(&locks);
 		error("%s: no new list given back keeping cached one.",
 		      __func__);
 		return SLURM_ERROR;
 	}
 
-	assoc_mgr_lock(&locks);
-
 	_post_qos_list(current_qos);
 
 	/* move usage from old list over to the new one */
@@ -1993,23 +2477,22 @@ static int _refresh_assoc_mgr_user_list(void *db_conn, int enforce)
 {
 	List current_users = NULL;
 	slurmdb_user_cond_t user_q;
-	uid_t uid = getuid();
 	assoc_mgr_lock_t locks = { .user = WRITE_LOCK };
 
 	memset(&user_q, 0, sizeof(slurmdb_user_cond_t));
 	user_q.with_coords = 1;
 
-	current_users = acct_storage_g_get_users(db_conn, uid, &user_q);
+	current_users = _fetch_list(db_conn, _fetch_users, &user_q, &locks,
+				    USER_LOCK);
 
 	if (!current_users) {
+		assoc_mgr_unlock(&locks);
 		error("%s: no new list given back keeping cached one.",
 		      __func__);
 		return SLURM_ERROR;
 	}
 	_post_user_list(current_users);
 
-	assoc_mgr_lock(&locks);
-
 	FREE_NULL_LIST(assoc_mgr_user_list);
 
 	assoc_mgr_user_list = current_users;
@@ -2026,7 +2509,6 @@ static int _refresh_assoc_wckey_list(void *db_conn, int enforce)
 {
 	slurmdb_wckey_cond_t wckey_q;
 	List current_wckeys = NULL;
-	uid_t uid = getuid();
 	assoc_mgr_lock_t locks = { .user = WRITE_LOCK, .wckey = WRITE_LOCK };
 
 	memset(&wckey_q, 0, sizeof(slurmdb_wckey_cond_t));
@@ -2038,11 +2520,13 @@ static int _refresh_assoc_wckey_list(void *db_conn, int enforce)
 		      __func__);
 	}
 
-	current_wckeys = acct_storage_g_get_wckeys(db_conn, uid, &wckey_q);
+	current_wckeys = _fetch_list(db_conn, _fetch_wckeys, &wckey_q, &locks,
+				     WCKEY_LOCK);
 
 	FREE_NULL_LIST(wckey_q.cluster_list);
 
 	if (!current_wckeys) {
+		assoc_mgr_unlock(&locks);
 		error("%s: no new list given back keeping cached one.",
 		      __func__);
 		return SLURM_ERROR;
@@ -2050,7 +2534,6 @@ static int _refresh_assoc_wckey_list(void *db_conn, int enforce)
 
 	_post_wckey_list(current_wckeys);
 
-	assoc_mgr_lock(&locks);
 	FREE_NULL_LIST(assoc_mgr_wckey_list);
 
 	assoc_mgr_wckey_list = current_wckeys;
@@ -2172,14 +2655,16 @@ extern int assoc_mgr_fini(bool save_state)
 	assoc_mgr_qos_list = NULL;
 	assoc_mgr_user_list = NULL;
 	assoc_mgr_wckey_list = NULL;
+	_index_qos(NULL);
+	_index_users(NULL);
+	_index_wckeys(NULL);
 
 	assoc_mgr_root_assoc = NULL;
 
 	if (_running_cache())
 		*init_setup.running_cache = RUNNING_CACHE_STATE_NOTRUNNING;
 
-	xfree(assoc_hash_id);
-	xfree(assoc_hash);
+	_free_assoc_hash();
 
 	assoc_mgr_unlock(&locks);
 
@@ -2209,7 +2694,7 @@ static slurmdb_admin_level_t _get_admin_level_internal(void *db_conn,
 		return SLURMDB_ADMIN_NOTSET;
 	}
 
-	found_user = list_find_first(assoc_mgr_user_list, _list_find_uid, &uid);
+	found_user = _find_user_uid(uid);
 
 	if (found_user)
 		level = found_user->admin_level;
@@ -2848,8 +3333,7 @@ extern int assoc_mgr_fill_in_user(void *db_conn, slurmdb_user_rec_t *user,
 		return SLURM_SUCCESS;
 	}
 
-	if (!(found_user = list_find_first(assoc_mgr_user_list,
-					   _list_find_user, user))) {
+	if (!(found_user = _find_user_rec(user))) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_ASSOCS)
@@ -2893,7 +3377,6 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 				 int enforce,
 				 slurmdb_qos_rec_t **qos_pptr, bool locked)
 {
-	ListIterator itr = NULL;
 	slurmdb_qos_rec_t * found_qos = NULL;
 	assoc_mgr_lock_t locks = { .qos = READ_LOCK };
 
@@ -2928,16 +3411,7 @@ extern int assoc_mgr_fill_in_qos(void *db_conn, slurmdb_qos_rec_t *qos,
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_qos_list);
-	while ((found_qos = list_next(itr))) {
-		if (qos->id == found_qos->id)
-			break;
-		else if (qos->name && !xstrcasecmp(qos->name, found_qos->name))
-			break;
-	}
-	list_iterator_destroy(itr);
-
-	if (!found_qos) {
+	if (!(found_qos = _find_qos_rec(qos))) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_QOS)
@@ -3042,8 +3516,6 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 				   slurmdb_wckey_rec_t **wckey_pptr,
 				   bool locked)
 {
-	ListIterator itr = NULL;
-	slurmdb_wckey_rec_t * found_wckey = NULL;
 	slurmdb_wckey_rec_t * ret_wckey = NULL;
 	assoc_mgr_lock_t locks = { .wckey = READ_LOCK };
 
@@ -3127,55 +3599,7 @@ extern int assoc_mgr_fill_in_wckey(void *db_conn, slurmdb_wckey_rec_t *wckey,
 
 	xassert(verify_assoc_lock(WCKEY_LOCK, READ_LOCK));
 
-	itr = list_iterator_create(assoc_mgr_wckey_list);
-	while ((found_wckey = list_next(itr))) {
-		/* only and always check for on the slurmdbd */
-		if (slurmdbd_conf) {
-			if (!wckey->cluster) {
-				error("No cluster name was given "
-				      "to check against, "
-				      "we need one to get a wckey.");
-				continue;
-			}
-
-			if (xstrcasecmp(wckey->cluster, found_wckey->cluster)) {
-				debug4("not the right cluster");
-				continue;
-			}
-		}
-
-		if (wckey->id) {
-			if (wckey->id == found_wckey->id) {
-				ret_wckey = found_wckey;
-				break;
-			}
-			continue;
-		} else {
-			if (wckey->uid != NO_VAL) {
-				if (wckey->uid != found_wckey->uid) {
-					debug4("not the right user %u != %u",
-					       wckey->uid, found_wckey->uid);
-					continue;
-				}
-			} else if (wckey->user &&
-				   xstrcasecmp(wckey->user, found_wckey->user))
-				continue;
-
-			if (wckey->name
-			    && (!found_wckey->name
-				|| xstrcasecmp(wckey->name,
-					       found_wckey->name))) {
-				debug4("not the right name %s != %s",
-				       wckey->name, found_wckey->name);
-				continue;
-			}
-		}
-		ret_wckey = found_wckey;
-		break;
-	}
-	list_iterator_destroy(itr);
-
-	if (!ret_wckey) {
+	if (!(ret_wckey = _find_wckey_rec(wckey))) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
 		if (enforce & ACCOUNTING_ENFORCE_WCKEYS)
@@ -3913,6 +4337,7 @@ extern int assoc_mgr_update_assocs(slurmdb_update_object_t *update, bool locked)
 
 	if (!locked)
 		assoc_mgr_lock(&locks);
+	assoc_mgr_list_gen[ASSOC_LOCK]++;
 	if (!assoc_mgr_assoc_list) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
@@ -4472,6 +4897,7 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update, bool locked)
 
 	if (!locked)
 		assoc_mgr_lock(&locks);
+	assoc_mgr_list_gen[WCKEY_LOCK]++;
 	if (!assoc_mgr_wckey_list) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
@@ -4493,29 +4919,25 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update, bool locked)
 			continue;
 		}
 
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			/* only and always check for on the slurmdbd */
-			if (slurmdbd_conf &&
-			    xstrcasecmp(object->cluster, rec->cluster)) {
-				debug4("not the right cluster");
-				continue;
-			}
-			if (object->id) {
-				if (object->id == rec->id) {
-					break;
+		if (object->id || (object->uid != NO_VAL)) {
+			rec = _find_wckey_rec(object);
+		} else {
+			/* Only matches wckeys of users without a uid either */
+			list_iterator_reset(itr);
+			while ((rec = list_next(itr))) {
+				/* only and always check for on the slurmdbd */
+				if (slurmdbd_conf &&
+				    xstrcasecmp(object->cluster, rec->cluster)) {
+					debug4("not the right cluster");
+					continue;
 				}
-				continue;
-			} else {
-				if (object->uid != rec->uid) {
+				if (rec->uid != NO_VAL) {
 					debug4("not the right user");
 					continue;
 				}
-
-				if (object->name
-				    && (!rec->name
-					|| xstrcasecmp(object->name,
-						       rec->name))) {
+				if (object->name &&
+				    (!rec->name ||
+				     xstrcasecmp(object->name, rec->name))) {
 					debug4("not the right wckey");
 					continue;
 				}
@@ -4560,6 +4982,8 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update, bool locked)
 			else
 				object->is_def = 0;
 			list_append(assoc_mgr_wckey_list, object);
+			_index_add(&wckey_id_index, object);
+			_index_add(&wckey_index, object);
 			object = NULL;
 			break;
 		case SLURMDB_REMOVE_WCKEY:
@@ -4567,7 +4991,9 @@ extern int assoc_mgr_update_wckeys(slurmdb_update_object_t *update, bool locked)
 				//rc = SLURM_ERROR;
 				break;
 			}
-			list_delete_item(itr);
+			_index_remove(&wckey_id_index, rec);
+			_index_remove(&wckey_index, rec);
+			list_delete_ptr(assoc_mgr_wckey_list, rec);
 			break;
 		default:
 			break;
@@ -4587,7 +5013,6 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 	slurmdb_user_rec_t * rec = NULL;
 	slurmdb_user_rec_t * object = NULL;
 
-	ListIterator itr = NULL;
 	int rc = SLURM_SUCCESS;
 	uid_t pw_uid;
 	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .user = WRITE_LOCK,
@@ -4595,24 +5020,18 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 
 	if (!locked)
 		assoc_mgr_lock(&locks);
+	assoc_mgr_list_gen[USER_LOCK]++;
 	if (!assoc_mgr_user_list) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
 		return SLURM_SUCCESS;
 	}
 
-	itr = list_iterator_create(assoc_mgr_user_list);
 	while ((object = list_pop(update->objects))) {
-		list_iterator_reset(itr);
-		while ((rec = list_next(itr))) {
-			char *name;
-			if (object->old_name)
-				name = object->old_name;
-			else
-				name = object->name;
-			if (!xstrcasecmp(name, rec->name))
-				break;
-		}
+		if (object->old_name)
+			rec = _find_user_name(object->old_name);
+		else
+			rec = _find_user_name(object->name);
 
 		//info("%d user %s", update->type, object->name);
 		switch(update->type) {
@@ -4632,11 +5051,15 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 					      rec->name);
 					break;
 				}
+				_index_remove(&user_uid_index, rec);
+				_index_remove(&user_name_index, rec);
 				xfree(rec->old_name);
 				rec->old_name = rec->name;
 				rec->name = object->name;
 				object->name = NULL;
 				rc = _change_user_name(rec);
+				_index_add(&user_uid_index, rec);
+				_index_add(&user_name_index, rec);
 			}
 
 			if (object->default_acct) {
@@ -4667,6 +5090,8 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 			} else
 				object->uid = pw_uid;
 			list_append(assoc_mgr_user_list, object);
+			_index_add(&user_uid_index, object);
+			_index_add(&user_name_index, object);
 			_handle_new_user_coord(object);
 			object = NULL;
 			break;
@@ -4677,7 +5102,9 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 			}
 			list_delete_first(assoc_mgr_coord_list,
 					  slurm_find_ptr_in_list, rec);
-			list_delete_item(itr);
+			_index_remove(&user_uid_index, rec);
+			_index_remove(&user_name_index, rec);
+			list_delete_ptr(assoc_mgr_user_list, rec);
 			break;
 		case SLURMDB_ADD_COORD:
 			/* same as SLURMDB_REMOVE_COORD */
@@ -4704,7 +5131,6 @@ extern int assoc_mgr_update_users(slurmdb_update_object_t *update, bool locked)
 
 		slurmdb_destroy_user_rec(object);
 	}
-	list_iterator_destroy(itr);
 	if (!locked)
 		assoc_mgr_unlock(&locks);
 
@@ -4728,6 +5154,7 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 
 	if (!locked)
 		assoc_mgr_lock(&locks);
+	assoc_mgr_list_gen[QOS_LOCK]++;
 	if (!assoc_mgr_qos_list) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
@@ -4759,6 +5186,8 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 			assoc_mgr_set_qos_tres_cnt(object);
 
 			list_append(assoc_mgr_qos_list, object);
+			_index_add(&qos_id_index, object);
+			_index_add(&qos_name_index, object);
 /* 			char *tmp = get_qos_complete_str_bitstr( */
 /* 				assoc_mgr_qos_list, */
 /* 				object->preempt_bitstr); */
@@ -5048,6 +5477,8 @@ extern int assoc_mgr_update_qos(slurmdb_update_object_t *update, bool locked)
 			if (rec->priority == g_qos_max_priority)
 				redo_priority = 2;
 
+			_index_remove(&qos_id_index, rec);
+			_index_remove(&qos_name_index, rec);
 			if (init_setup.remove_qos_notify) {
 				/* since there are some deadlock
 				   issues while inside our lock here
@@ -5170,6 +5601,7 @@ extern int assoc_mgr_update_res(slurmdb_update_object_t *update, bool locked)
 
 	if (!locked)
 		assoc_mgr_lock(&locks);
+	assoc_mgr_list_gen[RES_LOCK]++;
 	if (!assoc_mgr_res_list) {
 		if (!locked)
 			assoc_mgr_unlock(&locks);
@@ -5326,6 +5758,7 @@ extern int assoc_mgr_update_tres(slurmdb_update_object_t *update, bool locked)
 				   .tres = WRITE_LOCK };
 	if (!locked)
 		assoc_mgr_lock(&locks);
+	assoc_mgr_list_gen[TRES_LOCK]++;
 
 	if (!assoc_mgr_tres_list) {
 		tmp_list = list_create(slurmdb_destroy_tres_rec);
@@ -6371,6 +6804,7 @@ extern int load_assoc_mgr_state(bool only_tres)
 			}
 			FREE_NULL_LIST(assoc_mgr_wckey_list);
 			assoc_mgr_wckey_list = msg->my_list;
+			_index_wckeys(assoc_mgr_wckey_list);
 			debug("Recovered %u wckeys",
 			      list_count(assoc_mgr_wckey_list));
 			msg->my_list = NULL;
@@ -6496,8 +6930,11 @@ extern int assoc_mgr_set_missing_uids()
 					debug2("refresh wckey "
 					       "couldn't get a uid for user %s",
 					       object->user);
-				} else
+				} else {
+					/* Not indexed without a uid */
 					object->uid = pw_uid;
+					_index_add(&wckey_index, object);
+				}
 			}
 		}
 		list_iterator_destroy(itr);
@@ -6516,6 +6953,7 @@ extern int assoc_mgr_set_missing_uids()
 					debug5("%s: found uid %u for user %s",
 					       __func__, pw_uid, object->name);
 					object->uid = pw_uid;
+					_index_add(&user_uid_index, object);
 				}
 			}
 		}
@@ -38,12 +38,19 @@
 
 #define _GNU_SOURCE	/* For POLLRDHUP */
 
+#include "config.h"
+
 #include <errno.h>
+#include <fcntl.h>
 #include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifndef POLLRDHUP
 #define POLLRDHUP POLLHUP
 #endif
@@ -88,6 +95,13 @@ struct eio_handle_components {
 	uint16_t shutdown_wait;
 	List obj_list;
 	List new_objs;
+#ifdef HAVE_SYS_EPOLL_H
+	int epfd;		/* -1 to use poll() */
+	uint32_t iteration;
+	uint32_t next_serial;
+	struct eio_fd_map *fd_map;
+	int fd_map_size;
+#endif
 };
 
 typedef struct {
@@ -96,21 +110,77 @@ typedef struct {
 	struct pollfd *pfds;
 } foreach_pollfd_t;
 
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * With epoll, objects are registered once and armed EPOLLONESHOT with the
+ * events their readable()/writable() ask for, so a wakeup only returns the
+ * objects that are ready. An object is re-armed, one epoll_ctl(), after it
+ * got an event or when the events it asks for change.
+ *
+ * Handlers close and replace obj->fd and free objects behind our back, so
+ * events carry the serial of the object and the fd registered instead of a
+ * pointer, and are only trusted if that object owned the fd in the current
+ * iteration. Any event left armed for a stale registration fires once.
+ */
+typedef enum {
+	EIO_REG_NONE = 0,	/* not registered */
+	EIO_REG_EPOLL,		/* obj->fd is registered */
+	EIO_REG_DUP,		/* obj->fd is shared, a dup is registered */
+	EIO_REG_ALWAYS,		/* not pollable (regular file), always ready */
+} eio_reg_state_t;
+
+struct eio_reg {
+	uint32_t serial;	/* unique within the eio handle, never 0 */
+	eio_reg_state_t state;
+	int fd;			/* fd registered with epoll */
+	int src_fd;		/* obj->fd when it was registered */
+	uint32_t armed;		/* events armed in epoll */
+	uint32_t want;		/* events wanted this iteration */
+};
+
+/* Owner of the registration of an fd, only valid for iteration */
+struct eio_fd_map {
+	eio_obj_t *obj;
+	uint32_t serial;
+	uint32_t iteration;
+};
+
+#define EIO_TOKEN(serial, fd) (((uint64_t) (serial) << 32) | (uint32_t) (fd))
+#define EIO_TOKEN_SERIAL(token) ((uint32_t) ((token) >> 32))
+#define EIO_TOKEN_FD(token) ((int) ((token) & 0xffffffff))
+
+typedef struct {
+	eio_handle_t *eio;
+	eio_obj_t **ready;	/* objects with events not from epoll_wait() */
+	short *ready_revents;
+	int nready;
+	int nobjs;		/* objects wanting events */
+} foreach_epoll_t;
+#endif
+
 /* Function prototypes */
 
 static int          _poll_internal(struct pollfd *pfds, unsigned int nfds,
 				   time_t shutdown_time);
+static int          _poll_mainloop(eio_handle_t *eio);
 static unsigned int _poll_setup_pollfds(struct pollfd *, eio_obj_t **, List);
 static void         _poll_dispatch(struct pollfd *, unsigned int, eio_obj_t **,
 		                   List objList);
 static void         _poll_handle_event(short revents, eio_obj_t *obj,
 		                       List objList);
+#ifdef HAVE_SYS_EPOLL_H
+static void _epoll_init(eio_handle_t *eio);
+static int _epoll_mainloop(eio_handle_t *eio);
+#endif
 
 eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
 {
 	eio_handle_t *eio = xmalloc(sizeof(*eio));
 
 	eio->magic = EIO_MAGIC;
+#ifdef HAVE_SYS_EPOLL_H
+	eio->epfd = -1;
+#endif
 
 	if (pipe2(eio->fds, O_CLOEXEC) < 0) {
 		error("%s: pipe: %m", __func__);
@@ -119,6 +189,9 @@ eio_handle_t *eio_handle_create(uint16_t shutdown_wait)
 	}
 
 	fd_set_nonblocking(eio->fds[0]);
+#ifdef HAVE_SYS_EPOLL_H
+	_epoll_init(eio);
+#endif
 
 	eio->obj_list = list_create(eio_obj_destroy);
 	eio->new_objs = list_create(eio_obj_destroy);
@@ -137,6 +210,11 @@ void eio_handle_destroy(eio_handle_t *eio)
 	xassert(eio->magic == EIO_MAGIC);
 	close(eio->fds[0]);
 	close(eio->fds[1]);
+#ifdef HAVE_SYS_EPOLL_H
+	if (eio->epfd >= 0)
+		close(eio->epfd);
+	xfree(eio->fd_map);
+#endif
 	FREE_NULL_LIST(eio->obj_list);
 	FREE_NULL_LIST(eio->new_objs);
 	slurm_mutex_destroy(&eio->shutdown_mutex);
@@ -267,6 +345,18 @@ static int _eio_wakeup_handler(eio_handle_t *eio)
 }
 
 int eio_handle_mainloop(eio_handle_t *eio)
+{
+	xassert(eio != NULL);
+	xassert(eio->magic == EIO_MAGIC);
+
+#ifdef HAVE_SYS_EPOLL_H
+	if (eio->epfd >= 0)
+		return _epoll_mainloop(eio);
+#endif
+	return _poll_mainloop(eio);
+}
+
+static int _poll_mainloop(eio_handle_t *eio)
 {
 	int            retval  = 0;
 	struct pollfd *pollfds = NULL;
@@ -275,9 +365,6 @@ int eio_handle_mainloop(eio_handle_t *eio)
 	unsigned int   n       = 0;
 	time_t shutdown_time;
 
-	xassert (eio != NULL);
-	xassert (eio->magic == EIO_MAGIC);
-
 	while (1) {
 		/* Alloc memory for pfds and map if needed */
 		n = list_count(eio->obj_list);
@@ -498,6 +585,312 @@ static void _poll_handle_event(short revents, eio_obj_t *obj, List objList)
 	}
 }
 
+#ifdef HAVE_SYS_EPOLL_H
+static void _epoll_init(eio_handle_t *eio)
+{
+	struct epoll_event ev = {
+		.events = EPOLLIN,
+		.data.u64 = EIO_TOKEN(0, eio->fds[0]),
+	};
+
+	if ((eio->epfd = epoll_create1(EPOLL_CLOEXEC)) < 0) {
+		error("%s: epoll_create1: %m, using poll", __func__);
+		return;
+	}
+
+	if (epoll_ctl(eio->epfd, EPOLL_CTL_ADD, eio->fds[0], &ev)) {
+		error("%s: epoll_ctl: %m, using poll", __func__);
+		close(eio->epfd);
+		eio->epfd = -1;
+	}
+}
+
+static void _epoll_set_owner(eio_handle_t *eio, eio_obj_t *obj)
+{
+	int fd = obj->reg->fd;
+
+	if (fd >= eio->fd_map_size) {
+		int old_size = eio->fd_map_size;
+
+		eio->fd_map_size = MAX(fd + 1, old_size * 2);
+		xrecalloc(eio->fd_map, eio->fd_map_size,
+			  sizeof(*eio->fd_map));
+	}
+
+	eio->fd_map[fd].obj = obj;
+	eio->fd_map[fd].serial = obj->reg->serial;
+	eio->fd_map[fd].iteration = eio->iteration;
+}
+
+/* Drop the registration of obj, its fd was closed or replaced */
+static void _epoll_unregister(eio_handle_t *eio, eio_obj_t *obj)
+{
+	eio_reg_t *reg = obj->reg;
+
+	if ((reg->state == EIO_REG_EPOLL) || (reg->state == EIO_REG_DUP)) {
+		/*
+		 * Unless the fd got closed and reused by another object since,
+		 * in which case the kernel already dropped this registration.
+		 */
+		if ((reg->fd < eio->fd_map_size) &&
+		    (eio->fd_map[reg->fd].serial == reg->serial)) {
+			(void) epoll_ctl(eio->epfd, EPOLL_CTL_DEL, reg->fd,
+					 NULL);
+			eio->fd_map[reg->fd].serial = 0;
+		}
+		if (reg->state == EIO_REG_DUP)
+			close(reg->fd);
+	}
+
+	reg->state = EIO_REG_NONE;
+	reg->fd = -1;
+	reg->src_fd = -1;
+	reg->armed = 0;
+}
+
+/*
+ * Arm obj for the events it wants.
+ * RET events to handle right away without epoll_wait(), or 0
+ */
+static short _epoll_arm(eio_handle_t *eio, eio_obj_t *obj)
+{
+	eio_reg_t *reg = obj->reg;
+	struct epoll_event ev = {
+		.events = reg->want | EPOLLONESHOT,
+		.data.u64 = EIO_TOKEN(reg->serial, obj->fd),
+	};
+	int dup_fd;
+
+	if (reg->state == EIO_REG_ALWAYS) {
+		/* poll() returns regular files readable and writable */
+		return reg->want & (EPOLLIN | EPOLLOUT);
+	}
+
+	if (reg->state != EIO_REG_NONE) {
+		ev.data.u64 = EIO_TOKEN(reg->serial, reg->fd);
+		if (!epoll_ctl(eio->epfd, EPOLL_CTL_MOD, reg->fd, &ev)) {
+			reg->armed = reg->want;
+			return 0;
+		}
+		if (errno != ENOENT) {
+			/* The fd was closed without telling us, like POLLNVAL */
+			debug2("%s: epoll_ctl(MOD) on fd %d: %m",
+			       __func__, reg->fd);
+			_epoll_unregister(eio, obj);
+			return POLLNVAL;
+		}
+		/*
+		 * The fd was closed and the same number reused by the object
+		 * since, the kernel dropped the registration on close. Add it
+		 * again.
+		 */
+		_epoll_unregister(eio, obj);
+		ev.data.u64 = EIO_TOKEN(reg->serial, obj->fd);
+	}
+
+	if (!epoll_ctl(eio->epfd, EPOLL_CTL_ADD, obj->fd, &ev)) {
+		reg->state = EIO_REG_EPOLL;
+		reg->fd = obj->fd;
+	} else if (errno == EPERM) {
+		reg->state = EIO_REG_ALWAYS;
+		reg->src_fd = obj->fd;
+		return reg->want & (EPOLLIN | EPOLLOUT);
+	} else if (errno == EEXIST) {
+		/* Another object uses the same fd, e.g. a pty */
+		if ((dup_fd = fcntl(obj->fd, F_DUPFD_CLOEXEC, 0)) < 0) {
+			error("%s: fcntl(F_DUPFD_CLOEXEC) on fd %d: %m",
+			      __func__, obj->fd);
+			return POLLNVAL;
+		}
+		ev.data.u64 = EIO_TOKEN(reg->serial, dup_fd);
+		if (epoll_ctl(eio->epfd, EPOLL_CTL_ADD, dup_fd, &ev)) {
+			error("%s: epoll_ctl(ADD) on fd %d: %m",
+			      __func__, dup_fd);
+			close(dup_fd);
+			return POLLNVAL;
+		}
+		reg->state = EIO_REG_DUP;
+		reg->fd = dup_fd;
+	} else {
+		debug2("%s: epoll_ctl(ADD) on fd %d: %m", __func__, obj->fd);
+		return POLLNVAL;
+	}
+
+	reg->src_fd = obj->fd;
+	reg->armed = reg->want;
+	_epoll_set_owner(eio, obj);
+
+	return 0;
+}
+
+static int _foreach_epoll_setup(void *x, void *arg)
+{
+	eio_obj_t *obj = x;
+	foreach_epoll_t *args = arg;
+	eio_handle_t *eio = args->eio;
+	eio_reg_t *reg;
+	bool readable, writable;
+	short revents;
+
+	if (!obj->reg) {
+		obj->reg = xmalloc(sizeof(*obj->reg));
+		obj->reg->fd = -1;
+		obj->reg->src_fd = -1;
+	}
+	reg = obj->reg;
+	if (!reg->serial) {
+		if (!++eio->next_serial)
+			eio->next_serial++;
+		reg->serial = eio->next_serial;
+	}
+
+	/* Same order and events as _foreach_helper_setup_pollfds() */
+	writable = _is_writable(obj);
+	readable = _is_readable(obj);
+	if (writable && readable)
+		reg->want = EPOLLOUT | EPOLLIN | EPOLLRDHUP;
+	else if (readable)
+		reg->want = EPOLLIN | EPOLLRDHUP;
+	else if (writable)
+		reg->want = EPOLLOUT;
+	else
+		reg->want = 0;
+
+	if (reg->want)
+		args->nobjs++;
+
+	if ((reg->state != EIO_REG_NONE) && (reg->src_fd != obj->fd))
+		_epoll_unregister(eio, obj);
+
+	/* poll() ignores negative fds as well */
+	if (obj->fd < 0)
+		return 0;
+
+	if ((reg->state == EIO_REG_EPOLL) || (reg->state == EIO_REG_DUP))
+		_epoll_set_owner(eio, obj);
+
+	if (!reg->want || (reg->want == reg->armed))
+		return 0;
+
+	if ((revents = _epoll_arm(eio, obj))) {
+		args->ready[args->nready] = obj;
+		args->ready_revents[args->nready] = revents;
+		args->nready++;
+	}
+
+	return 0;
+}
+
+/* RET object an epoll event is for, or NULL if stale */
+static eio_obj_t *_epoll_event_obj(eio_handle_t *eio, struct epoll_event *ev)
+{
+	int fd = EIO_TOKEN_FD(ev->data.u64);
+	struct eio_fd_map *owner;
+	eio_obj_t *obj;
+
+	if ((fd < 0) || (fd >= eio->fd_map_size))
+		return NULL;
+
+	owner = &eio->fd_map[fd];
+	if ((owner->serial != EIO_TOKEN_SERIAL(ev->data.u64)) ||
+	    (owner->iteration != eio->iteration))
+		return NULL;
+
+	obj = owner->obj;
+	/* EPOLLONESHOT disarmed it */
+	obj->reg->armed = 0;
+	if (!obj->reg->want)
+		return NULL;
+
+	return obj;
+}
+
+static int _epoll_mainloop(eio_handle_t *eio)
+{
+	int retval = 0;
+	struct epoll_event *events = NULL;
+	eio_obj_t *obj;
+	foreach_epoll_t args = { .eio = eio };
+	int max_events = 0, n, i, timeout;
+	time_t shutdown_time;
+
+	while (1) {
+		n = list_count(eio->obj_list);
+		if (max_events < (n + 1)) {
+			max_events = n + 1;
+			xrecalloc(events, max_events, sizeof(*events));
+			xrecalloc(args.ready, max_events, sizeof(*args.ready));
+			xrecalloc(args.ready_revents, max_events,
+				  sizeof(*args.ready_revents));
+		}
+
+		debug4("eio: handling events for %d objects", n);
+		eio->iteration++;
+		args.nready = 0;
+		args.nobjs = 0;
+		list_for_each(eio->obj_list, _foreach_epoll_setup, &args);
+		if (args.nobjs <= 0)
+			goto done;
+
+		slurm_mutex_lock(&eio->shutdown_mutex);
+		shutdown_time = eio->shutdown_time;
+		slurm_mutex_unlock(&eio->shutdown_mutex);
+		if (args.nready)
+			timeout = 0;
+		else if (shutdown_time)
+			timeout = 1000;	/* Return every 1000 msec during shutdown */
+		else
+			timeout = -1;
+
+		while ((n = epoll_wait(eio->epfd, events, max_events,
+				       timeout)) < 0) {
+			if (errno == EINTR) {
+				n = 0;
+				break;
+			}
+			error("epoll_wait: %m");
+			goto error;
+		}
+
+		/* See if we've been told to shut down by eio_signal_shutdown */
+		for (i = 0; i < n; i++) {
+			if (!EIO_TOKEN_SERIAL(events[i].data.u64)) {
+				_eio_wakeup_handler(eio);
+				break;
+			}
+		}
+
+		/* The EPOLL* event bits are the same as the POLL* ones */
+		for (i = 0; i < n; i++) {
+			if ((obj = _epoll_event_obj(eio, &events[i])))
+				_poll_handle_event(events[i].events, obj,
+						   eio->obj_list);
+		}
+		for (i = 0; i < args.nready; i++)
+			_poll_handle_event(args.ready_revents[i], args.ready[i],
+					   eio->obj_list);
+
+		slurm_mutex_lock(&eio->shutdown_mutex);
+		shutdown_time = eio->shutdown_time;
+		slurm_mutex_unlock(&eio->shutdown_mutex);
+		if (shutdown_time &&
+		    (difftime(time(NULL), shutdown_time)>=eio->shutdown_wait)) {
+			error("%s: Abandoning IO %d secs after job shutdown initiated",
+			      __func__, eio->shutdown_wait);
+			break;
+		}
+	}
+
+error:
+	retval = -1;
+done:
+	xfree(events);
+	xfree(args.ready);
+	xfree(args.ready_revents);
+	return retval;
+}
+#endif
+
 static struct io_operations *_ops_copy(struct io_operations *ops)
 {
 	struct io_operations *ret = xmalloc(sizeof(*ops));
@@ -529,6 +922,11 @@ void eio_obj_destroy(void *arg)
 		/* 	close(obj->fd); */
 		/* 	obj->fd = -1; */
 		/* } */
+#ifdef HAVE_SYS_EPOLL_H
+		if (obj->reg && (obj->reg->state == EIO_REG_DUP))
+			close(obj->reg->fd);
+#endif
+		xfree(obj->reg);
 		xfree(obj->ops);
 		xfree(obj);
 	}
@@ -32,6 +32,7 @@
 #include "src/common/macros.h"
 #include "src/common/slurm_protocol_defs.h"
 typedef struct eio_obj eio_obj_t;
+typedef struct eio_reg eio_reg_t;
 
 typedef struct eio_handle_components eio_handle_t;
 
@@ -67,6 +68,7 @@ struct eio_obj {
 	void *arg;                        /* application-specific data       */
 	struct io_operations *ops;        /* pointer to ops struct for obj   */
 	bool shutdown;
+	eio_reg_t *reg;                   /* private to eio, epoll state     */
 };
 
 eio_handle_t *eio_handle_create(uint16_t);
@@ -53,6 +53,8 @@
 #include "src/common/read_config.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/slurm_protocol_pack.h"
+#include "src/common/timers.h"
+#include "src/common/xhash.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
@@ -66,6 +68,30 @@ typedef struct {
 	pthread_mutex_t *tree_mutex;
 } fwd_tree_t;
 
+#define FWD_SLOW_FACTOR		4	/* slow if this many times the median */
+#define FWD_SLOW_MIN_USEC	100000	/* and at least this slow */
+#define FWD_STATS_SIZE		100	/* message types with tree statistics */
+
+typedef struct {
+	char *key;		/* message type and node name */
+	uint64_t usec;		/* moving average of the response time per
+				 * hop of the tree below the node */
+} fwd_latency_t;
+
+typedef struct {
+	char *name;
+	uint64_t usec;
+} fwd_node_t;
+
+static pthread_mutex_t fwd_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool fwd_stats_enabled = false;
+static bool fwd_adaptive = false;
+static xhash_t *fwd_latency = NULL;
+static uint16_t fwd_stats_type[FWD_STATS_SIZE];
+static uint32_t fwd_stats_cnt[FWD_STATS_SIZE];
+static uint64_t fwd_stats_time[FWD_STATS_SIZE];
+static uint64_t fwd_stats_max[FWD_STATS_SIZE];
+
 static void _start_msg_tree_internal(hostlist_t *hl, hostlist_t **sp_hl,
 				     fwd_tree_t *fwd_tree_in,
 				     int hl_count);
@@ -343,6 +369,248 @@ cleanup:
 	return (NULL);
 }
 
+static void _latency_id(void *item, const char **key, uint32_t *key_len)
+{
+	fwd_latency_t *latency = item;
+
+	*key = latency->key;
+	*key_len = strlen(latency->key);
+}
+
+static void _latency_free(void *item)
+{
+	fwd_latency_t *latency = item;
+
+	xfree(latency->key);
+	xfree(latency);
+}
+
+/* RET xmalloc'ed key of the latency of name for messages of msg_type */
+static char *_latency_key(const char *name, uint16_t msg_type)
+{
+	return xstrdup_printf("%hu:%s", msg_type, name);
+}
+
+/* RET levels of the tree a node forwarding a message to fwd_cnt nodes heads */
+static int _tree_depth(int fwd_cnt, uint16_t tree_width)
+{
+	int depth = 1;
+
+	if (!tree_width)
+		tree_width = slurm_conf.tree_width;
+
+	while (fwd_cnt > 0) {
+		depth++;
+		fwd_cnt = ((fwd_cnt + tree_width - 1) / tree_width) - 1;
+	}
+
+	return depth;
+}
+
+/*
+ * Fold a response time sample of name into its moving average for msg_type.
+ * The time a node took to answer for a subtree is spread over the levels of
+ * the subtree so samples of spans of any size compare, and message types are
+ * kept apart so a slow launch doesn't make a node look slow to answer a ping.
+ */
+static void _latency_sample(const char *name, uint16_t msg_type, int fwd_cnt,
+			    uint16_t tree_width, uint64_t usec)
+{
+	fwd_latency_t *latency;
+	char *key;
+
+	usec /= _tree_depth(fwd_cnt, tree_width);
+
+	slurm_mutex_lock(&fwd_stats_mutex);
+	if (!fwd_adaptive) {
+		slurm_mutex_unlock(&fwd_stats_mutex);
+		return;
+	}
+	key = _latency_key(name, msg_type);
+	if (!(latency = xhash_get_str(fwd_latency, key))) {
+		latency = xmalloc(sizeof(*latency));
+		latency->key = key;
+		latency->usec = usec;
+		xhash_add(fwd_latency, latency);
+	} else {
+		latency->usec = (latency->usec * 3 + usec) / 4;
+		xfree(key);
+	}
+	slurm_mutex_unlock(&fwd_stats_mutex);
+}
+
+/* Caller must hold fwd_stats_mutex. Nodes not measured yet give 0. */
+static uint64_t _latency_get(const char *name, uint16_t msg_type)
+{
+	char *key = _latency_key(name, msg_type);
+	fwd_latency_t *latency = xhash_get_str(fwd_latency, key);
+
+	xfree(key);
+	return latency ? latency->usec : 0;
+}
+
+static void _tree_stats_add(uint16_t msg_type, uint64_t usec)
+{
+	int i;
+
+	slurm_mutex_lock(&fwd_stats_mutex);
+	if (!fwd_stats_enabled) {
+		slurm_mutex_unlock(&fwd_stats_mutex);
+		return;
+	}
+	for (i = 0; i < FWD_STATS_SIZE; i++) {
+		if ((fwd_stats_type[i] == msg_type) ||
+		    (fwd_stats_type[i] == 0)) {
+			fwd_stats_type[i] = msg_type;
+			fwd_stats_cnt[i]++;
+			fwd_stats_time[i] += usec;
+			fwd_stats_max[i] = MAX(fwd_stats_max[i], usec);
+			break;
+		}
+	}
+	slurm_mutex_unlock(&fwd_stats_mutex);
+}
+
+static int _node_usec_desc(const void *x, const void *y)
+{
+	const fwd_node_t *a = x, *b = y;
+
+	if (a->usec < b->usec)
+		return 1;
+	if (a->usec > b->usec)
+		return -1;
+	return 0;
+}
+
+static int _node_name_cmp(const void *x, const void *y)
+{
+	const fwd_node_t *a = x, *b = y;
+
+	return xstrcmp(a->name, b->name);
+}
+
+/*
+ * Move the node with the lowest response time to the head of span, it will
+ * relay the message to all the others. nodes is sorted by name, nodes not
+ * measured yet count as median.
+ */
+static void _head_fastest(hostlist_t **span, fwd_node_t *nodes, int node_cnt,
+			  uint64_t median)
+{
+	hostlist_iterator_t *itr = hostlist_iterator_create(*span);
+	hostlist_t *hl;
+	fwd_node_t key, *node;
+	char *name, *fastest = NULL;
+	uint64_t usec, fastest_usec = 0;
+
+	while ((name = hostlist_next(itr))) {
+		key.name = name;
+		node = bsearch(&key, nodes, node_cnt, sizeof(*nodes),
+			       _node_name_cmp);
+		usec = (node && node->usec) ? node->usec : median;
+		if (!fastest || (usec < fastest_usec)) {
+			free(fastest);
+			fastest = name;
+			fastest_usec = usec;
+		} else
+			free(name);
+	}
+	hostlist_iterator_destroy(itr);
+
+	if (!fastest)
+		return;
+
+	hostlist_delete_host(*span, fastest);
+	hl = hostlist_create(fastest);
+	hostlist_push_list(hl, *span);
+	hostlist_destroy(*span);
+	*span = hl;
+	free(fastest);
+}
+
+/*
+ * Split hl into spans like route_g_split_hostlist() does, except that nodes
+ * much slower than the median for msg_type are sent the message directly
+ * instead of being used as relays or left at the bottom of a subtree, and
+ * each span is headed by its fastest node.
+ */
+static int _adaptive_split_hostlist(hostlist_t *hl, uint16_t msg_type,
+				    hostlist_t ***sp_hl, int *count,
+				    uint16_t tree_width)
+{
+	hostlist_iterator_t *itr;
+	fwd_node_t *nodes;
+	hostlist_t **spans = NULL;
+	char *name;
+	int i, known = 0, slow = 0, span_cnt = 0, rc = SLURM_SUCCESS;
+	int node_cnt = hostlist_count(hl);
+	uint64_t median = 0;
+
+	if (!tree_width)
+		tree_width = slurm_conf.tree_width;
+
+	nodes = xcalloc(node_cnt, sizeof(*nodes));
+
+	itr = hostlist_iterator_create(hl);
+	slurm_mutex_lock(&fwd_stats_mutex);
+	for (i = 0; (i < node_cnt) && (name = hostlist_next(itr)); i++) {
+		nodes[i].name = name;
+		if ((nodes[i].usec = _latency_get(name, msg_type)))
+			known++;
+	}
+	slurm_mutex_unlock(&fwd_stats_mutex);
+	hostlist_iterator_destroy(itr);
+	node_cnt = i;
+
+	if (known) {
+		/* Measured nodes first, slowest first */
+		qsort(nodes, node_cnt, sizeof(*nodes), _node_usec_desc);
+		median = nodes[known / 2].usec;
+
+		while ((slow < node_cnt) && (slow < tree_width - 1) &&
+		       (nodes[slow].usec > FWD_SLOW_MIN_USEC) &&
+		       (nodes[slow].usec > median * FWD_SLOW_FACTOR))
+			slow++;
+	}
+
+	for (i = 0; i < slow; i++) {
+		debug2("%s: sending directly to slow node %s (%"PRIu64" usec, median %"PRIu64" usec)",
+		       __func__, nodes[i].name, nodes[i].usec, median);
+		hostlist_delete_host(hl, nodes[i].name);
+	}
+
+	if (hostlist_count(hl) &&
+	    route_g_split_hostlist(hl, &spans, &span_cnt, tree_width - slow)) {
+		rc = SLURM_ERROR;
+		goto fini;
+	}
+
+	*sp_hl = xcalloc(span_cnt + slow, sizeof(hostlist_t *));
+	for (i = 0; i < slow; i++)
+		(*sp_hl)[span_cnt + i] = hostlist_create(nodes[i].name);
+	*count = span_cnt + slow;
+
+	if (known) {
+		/* The slow nodes have their own span, look up the others */
+		qsort(nodes + slow, node_cnt - slow, sizeof(*nodes),
+		      _node_name_cmp);
+	}
+	for (i = 0; i < span_cnt; i++) {
+		if (known)
+			_head_fastest(&spans[i], nodes + slow, node_cnt - slow,
+				      median);
+		(*sp_hl)[i] = spans[i];
+	}
+
+fini:
+	for (i = 0; i < node_cnt; i++)
+		free(nodes[i].name);
+	xfree(nodes);
+	xfree(spans);
+
+	return rc;
+}
+
 void *_fwd_tree_thread(void *arg)
 {
 	fwd_tree_t *fwd_tree = (fwd_tree_t *)arg;
@@ -350,6 +618,7 @@ void *_fwd_tree_thread(void *arg)
 	char *name = NULL;
 	char *buf = NULL;
 	slurm_msg_t send_msg;
+	DEF_TIMERS;
 
 	slurm_msg_t_init(&send_msg);
 	send_msg.msg_type = fwd_tree->orig_msg->msg_type;
@@ -390,8 +659,13 @@ void *_fwd_tree_thread(void *arg)
 		} else
 			debug3("Tree sending to %s", name);
 
+		START_TIMER;
 		ret_list = slurm_send_addr_recv_msgs(&send_msg, name,
 						     fwd_tree->timeout);
+		END_TIMER;
+		_latency_sample(name, send_msg.msg_type, send_msg.forward.cnt,
+				fwd_tree->orig_msg->forward.tree_width,
+				DELTA_TIMER);
 
 		xfree(send_msg.forward.nodelist);
 
@@ -645,15 +919,29 @@ extern List start_msg_tree(hostlist_t *hl, slurm_msg_t *msg, int timeout)
 	int host_count = 0;
 	hostlist_t **sp_hl;
 	int hl_count = 0;
+	bool adaptive;
+	DEF_TIMERS;
 
 	xassert(hl);
 	xassert(msg);
 
+	START_TIMER;
 	hostlist_uniq(hl);
 	host_count = hostlist_count(hl);
 
-	if (route_g_split_hostlist(hl, &sp_hl, &hl_count,
-				   msg->forward.tree_width)) {
+	slurm_mutex_lock(&fwd_stats_mutex);
+	adaptive = fwd_adaptive;
+	slurm_mutex_unlock(&fwd_stats_mutex);
+
+	if (adaptive) {
+		if (_adaptive_split_hostlist(hl, msg->msg_type, &sp_hl,
+					     &hl_count,
+					     msg->forward.tree_width)) {
+			error("unable to split forward hostlist");
+			return NULL;
+		}
+	} else if (route_g_split_hostlist(hl, &sp_hl, &hl_count,
+					  msg->forward.tree_width)) {
 		error("unable to split forward hostlist");
 		return NULL;
 	}
@@ -690,6 +978,9 @@ extern List start_msg_tree(hostlist_t *hl, slurm_msg_t *msg, int timeout)
 	slurm_mutex_destroy(&tree_mutex);
 	slurm_cond_destroy(&notify);
 
+	END_TIMER;
+	_tree_stats_add(msg->msg_type, DELTA_TIMER);
+
 	return ret_list;
 }
 
@@ -778,3 +1069,51 @@ void destroy_forward_struct(forward_struct_t *forward_struct)
 		xfree(forward_struct);
 	}
 }
+
+extern void forward_tree_stats_init(bool adaptive)
+{
+	slurm_mutex_lock(&fwd_stats_mutex);
+	fwd_stats_enabled = true;
+	fwd_adaptive = adaptive;
+	if (adaptive && !fwd_latency)
+		fwd_latency = xhash_init(_latency_id, _latency_free);
+	else if (!adaptive && fwd_latency)
+		xhash_free(fwd_latency);
+	slurm_mutex_unlock(&fwd_stats_mutex);
+}
+
+extern void forward_tree_stats_fini(void)
+{
+	slurm_mutex_lock(&fwd_stats_mutex);
+	fwd_stats_enabled = false;
+	fwd_adaptive = false;
+	if (fwd_latency)
+		xhash_free(fwd_latency);
+	slurm_mutex_unlock(&fwd_stats_mutex);
+}
+
+extern void forward_pack_tree_stats(buf_t *buffer)
+{
+	uint32_t count;
+
+	slurm_mutex_lock(&fwd_stats_mutex);
+	for (count = 0; count < FWD_STATS_SIZE; count++) {
+		if (!fwd_stats_type[count])
+			break;
+	}
+	pack16_array(fwd_stats_type, count, buffer);
+	pack32_array(fwd_stats_cnt, count, buffer);
+	pack64_array(fwd_stats_time, count, buffer);
+	pack64_array(fwd_stats_max, count, buffer);
+	slurm_mutex_unlock(&fwd_stats_mutex);
+}
+
+extern void forward_reset_tree_stats(void)
+{
+	slurm_mutex_lock(&fwd_stats_mutex);
+	memset(fwd_stats_type, 0, sizeof(fwd_stats_type));
+	memset(fwd_stats_cnt, 0, sizeof(fwd_stats_cnt));
+	memset(fwd_stats_time, 0, sizeof(fwd_stats_time));
+	memset(fwd_stats_max, 0, sizeof(fwd_stats_max));
+	slurm_mutex_unlock(&fwd_stats_mutex);
+}
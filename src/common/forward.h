@@ -111,6 +111,20 @@ extern void mark_as_failed_forward(List *ret_list, char *node_name, int err);
 
 extern void forward_wait(slurm_msg_t *msg);
 
+/*
+ * Start collecting statistics on the messages sent through start_msg_tree().
+ * IN adaptive - also measure the response time of the nodes so that the
+ *		 fastest are used as relays and much slower ones are sent
+ *		 the message directly
+ * Can be called again to change adaptive.
+ */
+extern void forward_tree_stats_init(bool adaptive);
+extern void forward_tree_stats_fini(void);
+
+/* Pack the per message type count, total and max time spent in trees */
+extern void forward_pack_tree_stats(buf_t *buffer);
+extern void forward_reset_tree_stats(void);
+
 /* destroyers */
 extern void destroy_data_info(void *object);
 extern void destroy_forward(forward_t *forward);
@@ -42,6 +42,7 @@
 #include <errno.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -147,9 +148,19 @@ typedef struct {
 	char *suffix;
 } hostname_t;
 
+/*
+ * hostrange prefixes are never modified once created, so copies of a
+ * hostrange (including copies pushed onto other hostlists) share one
+ * reference counted string. hostrange_t.prefix points at str.
+ */
+typedef struct {
+	uint32_t refcnt;
+	char str[];
+} hostprefix_t;
+
 /* hostrange type: A single prefix with `hi' and `lo' numeric suffix values */
 typedef struct {
-	char *prefix;        /* alphanumeric prefix: */
+	char *prefix;        /* alphanumeric prefix (hostprefix_t.str) */
 
 	/* beginning (lo) and end (hi) of suffix range */
 	unsigned long lo, hi;
@@ -556,6 +567,40 @@ static int hostname_suffix_width(hostname_t *hn)
 }
 
 
+/* ----[ hostprefix_t functions ]---- */
+
+static char *_prefix_create(const char *str)
+{
+	size_t len = strlen(str);
+	hostprefix_t *p = xmalloc_nz(sizeof(*p) + len + 1);
+
+	p->refcnt = 1;
+	memcpy(p->str, str, len + 1);
+
+	return p->str;
+}
+
+static char *_prefix_ref(char *str)
+{
+	hostprefix_t *p = (hostprefix_t *) (str - offsetof(hostprefix_t, str));
+
+	__atomic_add_fetch(&p->refcnt, 1, __ATOMIC_RELAXED);
+
+	return str;
+}
+
+static void _prefix_free(char *str)
+{
+	hostprefix_t *p;
+
+	if (!str)
+		return;
+
+	p = (hostprefix_t *) (str - offsetof(hostprefix_t, str));
+	if (!__atomic_sub_fetch(&p->refcnt, 1, __ATOMIC_ACQ_REL))
+		xfree(p);
+}
+
 /* ----[ hostrange_t functions ]---- */
 
 /* allocate a new hostrange object
@@ -576,7 +621,7 @@ static hostrange_t *hostrange_create_single(const char *prefix)
 
 	new = hostrange_new();
 
-	new->prefix = xstrdup(prefix);
+	new->prefix = _prefix_create(prefix);
 
 	new->singlehost = 1;
 	new->lo = 0L;
@@ -598,7 +643,7 @@ static hostrange_t *hostrange_create(char *prefix, unsigned long lo,
 
 	new = hostrange_new();
 
-	new->prefix = xstrdup(prefix);
+	new->prefix = _prefix_create(prefix);
 
 	new->lo = lo;
 	new->hi = hi;
@@ -621,17 +666,19 @@ static unsigned long hostrange_count(hostrange_t *hr)
 		return hr->hi - hr->lo + 1;
 }
 
-/* Copy a hostrange object
+/* Copy a hostrange object, sharing its prefix
  */
 static hostrange_t *hostrange_copy(hostrange_t *hr)
 {
+	hostrange_t *new;
+
 	xassert(hr);
 
-	if (hr->singlehost)
-		return hostrange_create_single(hr->prefix);
-	else
-		return hostrange_create(hr->prefix, hr->lo, hr->hi,
-					hr->width);
+	new = hostrange_new();
+	*new = *hr;
+	new->prefix = _prefix_ref(hr->prefix);
+
+	return new;
 }
 
 
@@ -641,7 +688,7 @@ static void hostrange_destroy(hostrange_t *hr)
 {
 	if (hr == NULL)
 		return;
-	xfree(hr->prefix);
+	_prefix_free(hr->prefix);
 	xfree(hr);
 }
 
@@ -712,7 +759,10 @@ static int hostrange_prefix_cmp(hostrange_t *h1, hostrange_t *h2)
 	if (h2 == NULL)
 		return -1;
 
-	retval = strnatcmp(h1->prefix, h2->prefix);
+	if ((h1->prefix == h2->prefix) || !strcmp(h1->prefix, h2->prefix))
+		retval = 0;
+	else
+		retval = strnatcmp(h1->prefix, h2->prefix);
 	return retval == 0 ? h2->singlehost - h1->singlehost : retval;
 }
 
@@ -1172,12 +1222,12 @@ static void hostlist_resize(hostlist_t *hl, size_t newsize)
 	xrecalloc(hl->hr, hl->size, sizeof(hostrange_t *));
 }
 
-/* Resize hostlist by one HOSTLIST_CHUNK
+/* Grow hostlist geometrically so that pushing n ranges is O(n)
  * Assumes that hostlist hl is locked by caller
  */
 static void hostlist_expand(hostlist_t *hl)
 {
-	hostlist_resize(hl, hl->size + HOSTLIST_CHUNK);
+	hostlist_resize(hl, hl->size + MAX(hl->size, HOSTLIST_CHUNK));
 }
 
 /* Push a hostrange object onto hostlist hl
@@ -1203,6 +1253,13 @@ static int hostlist_push_range(hostlist_t *hl, hostrange_t *hr)
 		tail->hi = hr->hi;
 	} else {
 		hostrange_t *new = hostrange_copy(hr);
+
+		/* intern prefix of consecutive ranges, e.g. "tux1,tux3,tux5" */
+		if ((hl->nranges > 0) && (tail->prefix != new->prefix) &&
+		    !strcmp(tail->prefix, new->prefix)) {
+			_prefix_free(new->prefix);
+			new->prefix = _prefix_ref(tail->prefix);
+		}
 		hl->hr[hl->nranges++] = new;
 	}
 
@@ -1232,8 +1289,6 @@ static int hostlist_push_hr(hostlist_t *hl, char *prefix, unsigned long lo,
  */
 static int hostlist_insert_range(hostlist_t *hl, hostrange_t *hr, int n)
 {
-	int i;
-	hostrange_t *tmp;
 	hostlist_iterator_t *hli;
 
 	xassert(hl && hr);
@@ -1245,16 +1300,10 @@ static int hostlist_insert_range(hostlist_t *hl, hostrange_t *hr, int n)
 	if (hl->size == hl->nranges)
 		hostlist_expand(hl);
 
-	/* copy new hostrange into slot "n" in array */
-	tmp = hl->hr[n];
+	/* push remaining hostrange entries up, copy new one into slot "n" */
+	memmove(&hl->hr[n + 1], &hl->hr[n],
+		(hl->nranges - n) * sizeof(hostrange_t *));
 	hl->hr[n] = hostrange_copy(hr);
-
-	/* push remaining hostrange entries up */
-	for (i = n + 1; i < hl->nranges + 1; i++) {
-		hostrange_t *last = hl->hr[i];
-		hl->hr[i] = tmp;
-		tmp = last;
-	}
 	hl->nranges++;
 
 	/* adjust hostlist iterators if needed */
@@ -1271,7 +1320,6 @@ static int hostlist_insert_range(hostlist_t *hl, hostrange_t *hr, int n)
  */
 static void hostlist_delete_range(hostlist_t *hl, int n)
 {
-	int i;
 	hostrange_t *old;
 
 	xassert(hl);
@@ -1279,8 +1327,8 @@ static void hostlist_delete_range(hostlist_t *hl, int n)
 	xassert((n < hl->nranges) && (n >= 0));
 
 	old = hl->hr[n];
-	for (i = n; i < hl->nranges - 1; i++)
-		hl->hr[i] = hl->hr[i + 1];
+	memmove(&hl->hr[n], &hl->hr[n + 1],
+		(hl->nranges - n - 1) * sizeof(hostrange_t *));
 	hl->nranges--;
 	hl->hr[hl->nranges] = NULL;
 	hostlist_shift_iterators(hl, n, 0, 1);
@@ -2124,6 +2172,27 @@ int hostlist_count(hostlist_t *hl)
 	return retval;
 }
 
+int hostlist_for_each_range(hostlist_t *hl, hostlist_range_f f, void *arg)
+{
+	int i, rc = 0;
+
+	if (!hl)
+		return -1;
+
+	LOCK_HOSTLIST(hl);
+	for (i = 0; (i < hl->nranges) && !rc; i++) {
+		hostrange_t *hr = hl->hr[i];
+
+		if (hr->singlehost)
+			rc = f(hr->prefix, 0, 0, -1, arg);
+		else
+			rc = f(hr->prefix, hr->lo, hr->hi, hr->width, arg);
+	}
+	UNLOCK_HOSTLIST(hl);
+
+	return rc;
+}
+
 int hostlist_find_dims(hostlist_t *hl, const char *hostname, int dims)
 {
 	int i, count, ret = -1;
@@ -2292,7 +2361,7 @@ static int _attempt_range_join(hostlist_t *hl, int loc)
 
 void hostlist_uniq(hostlist_t *hl)
 {
-	int i = 1;
+	int i, j = 0;
 	hostlist_iterator_t *hli;
 	LOCK_HOSTLIST(hl);
 	if (hl->nranges <= 1) {
@@ -2301,10 +2370,24 @@ void hostlist_uniq(hostlist_t *hl)
 	}
 	qsort(hl->hr, hl->nranges, sizeof(hostrange_t *), &_cmp);
 
-	while (i < hl->nranges) {
-		if (_attempt_range_join(hl, i) < 0) /* No range join occurred */
-			i++;
+	/*
+	 * Join each range into the last kept range in one pass rather than
+	 * deleting joined ranges one at a time, which shifts the rest of the
+	 * array on every join. Iterators are reset below.
+	 */
+	for (i = 1; i < hl->nranges; i++) {
+		int ndup = hostrange_join(hl->hr[j], hl->hr[i]);
+
+		if (ndup >= 0) {
+			hostrange_destroy(hl->hr[i]);
+			hl->nhosts -= ndup;
+		} else {
+			hl->hr[++j] = hl->hr[i];
+		}
+		if (i != j)
+			hl->hr[i] = NULL;
 	}
+	hl->nranges = j + 1;
 
 	/* reset all iterators */
 	for (hli = hl->ilist; hli; hli = hli->next)
@@ -3204,7 +3287,23 @@ static int hostset_insert_range(hostset_t *set, hostrange_t *hr)
 
 	nhosts = hostrange_count(hr);
 
-	for (i = 0; i < hl->nranges; i++) {
+	/* set is sorted, find the first range not less than hr */
+	if (hl->nranges && (hostrange_cmp(hr, hl->hr[hl->nranges - 1]) > 0)) {
+		i = hl->nranges;
+	} else {
+		int hi = hl->nranges;
+
+		for (i = 0; i < hi;) {
+			int mid = i + (hi - i) / 2;
+
+			if (hostrange_cmp(hr, hl->hr[mid]) <= 0)
+				hi = mid;
+			else
+				i = mid + 1;
+		}
+	}
+
+	for (; i < hl->nranges; i++) {
 		if (hostrange_cmp(hr, hl->hr[i]) <= 0) {
 
 			if ((ndups = hostrange_join(hr, hl->hr[i])) >= 0)
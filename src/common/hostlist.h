@@ -272,6 +272,23 @@ int hostlist_count(hostlist_t *hl);
 /* hostlist_is_empty(): return true if hostlist is empty. */
 #define hostlist_is_empty(__hl) ( hostlist_count(__hl) == 0 )
 
+/* hostlist_for_each_range():
+ *
+ * Call f() once for each range of hosts in hostlist hl without expanding
+ * the range into individual hostnames. Each hostname in a range is the
+ * prefix followed by a number between lo and hi (inclusive), zero padded
+ * to width digits. A hostname without a numeric suffix is passed as the
+ * prefix with a width of -1.
+ *
+ * Iteration stops at the first non-zero return from f(), which is
+ * returned. Returns 0 if every range was visited, -1 if hl is NULL.
+ *
+ * Note: f() is called with the hostlist locked and must not access hl.
+ */
+typedef int (*hostlist_range_f)(const char *prefix, unsigned long lo,
+				unsigned long hi, int width, void *arg);
+int hostlist_for_each_range(hostlist_t *hl, hostlist_range_f f, void *arg);
+
 /* ----[ Other hostlist operations ]---- */
 
 /* hostlist_sort():
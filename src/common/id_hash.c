@@ -0,0 +1,247 @@
+/*****************************************************************************\
+ *  id_hash.c - open addressing hash table of pointers keyed by integer ids
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "src/common/id_hash.h"
+#include "src/common/log.h"
+#include "src/common/xassert.h"
+#include "src/common/xmalloc.h"
+
+#define ID_HASH_MAGIC 0x1d4a5400
+#define ID_HASH_MIN_SIZE 64
+/* Grow once the table is more than 70% full to keep probe sequences short */
+#define ID_HASH_FULL(_table) \
+	(((uint64_t) (_table)->count * 10) >= ((uint64_t) (_table)->size * 7))
+
+typedef struct {
+	uint64_t key;
+	void *item;			/* NULL if slot is empty */
+} id_hash_slot_t;
+
+struct id_hash {
+	int magic;			/* ID_HASH_MAGIC */
+	uint32_t count;			/* entries in use */
+	uint32_t size;			/* number of slots, a power of 2 */
+	uint32_t shift;			/* 64 - log2(size) */
+	id_hash_slot_t *slots;
+};
+
+/* Fibonacci hashing spreads sequential ids across the whole table */
+static inline uint32_t _home(id_hash_t *table, uint64_t key)
+{
+	return (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> table->shift);
+}
+
+static void _alloc_slots(id_hash_t *table, uint32_t size)
+{
+	uint32_t bits = 0;
+
+	while ((1U << bits) < size)
+		bits++;
+
+	table->size = 1U << bits;
+	table->shift = 64 - bits;
+	table->slots = xcalloc(table->size, sizeof(*table->slots));
+}
+
+static void _insert(id_hash_t *table, uint64_t key, void *item)
+{
+	uint32_t mask = table->size - 1;
+	uint32_t i = _home(table, key);
+
+	while (table->slots[i].item)
+		i = (i + 1) & mask;
+
+	table->slots[i].key = key;
+	table->slots[i].item = item;
+	table->count++;
+}
+
+static void _grow(id_hash_t *table)
+{
+	id_hash_slot_t *old_slots = table->slots;
+	uint32_t old_size = table->size;
+
+	if (old_size >= (1U << 31))
+		fatal("%s: table can not grow beyond %u entries",
+		      __func__, old_size);
+
+	_alloc_slots(table, old_size * 2);
+	table->count = 0;
+
+	for (uint32_t i = 0; i < old_size; i++) {
+		if (old_slots[i].item)
+			_insert(table, old_slots[i].key, old_slots[i].item);
+	}
+
+	xfree(old_slots);
+}
+
+/* Return slot index holding key or -1 if not found */
+static int64_t _find_slot(id_hash_t *table, uint64_t key)
+{
+	uint32_t mask = table->size - 1;
+	uint32_t i = _home(table, key);
+
+	while (table->slots[i].item) {
+		if (table->slots[i].key == key)
+			return i;
+		i = (i + 1) & mask;
+	}
+
+	return -1;
+}
+
+extern id_hash_t *id_hash_create(uint32_t size)
+{
+	id_hash_t *table = xmalloc(sizeof(*table));
+	/* Size so "size" entries fit without growing */
+	uint64_t slots = (((uint64_t) size * 10) / 7) + 1;
+
+	if (slots < ID_HASH_MIN_SIZE)
+		slots = ID_HASH_MIN_SIZE;
+	else if (slots > (1U << 31))
+		slots = 1U << 31;
+
+	table->magic = ID_HASH_MAGIC;
+	_alloc_slots(table, slots);
+
+	return table;
+}
+
+extern void id_hash_destroy(id_hash_t *table)
+{
+	if (!table)
+		return;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+	table->magic = ~ID_HASH_MAGIC;
+	xfree(table->slots);
+	xfree(table);
+}
+
+extern void *id_hash_add(id_hash_t *table, uint64_t key, void *item)
+{
+	int64_t i;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+	xassert(item);
+
+	if ((i = _find_slot(table, key)) >= 0) {
+		void *old_item = table->slots[i].item;
+		table->slots[i].item = item;
+		return old_item;
+	}
+
+	if (ID_HASH_FULL(table))
+		_grow(table);
+
+	_insert(table, key, item);
+
+	return NULL;
+}
+
+extern void *id_hash_find(id_hash_t *table, uint64_t key)
+{
+	int64_t i;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+
+	if ((i = _find_slot(table, key)) < 0)
+		return NULL;
+
+	return table->slots[i].item;
+}
+
+extern bool id_hash_remove(id_hash_t *table, uint64_t key, void *item)
+{
+	uint32_t mask = table->size - 1;
+	uint32_t hole, i, home;
+	int64_t found;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+
+	if ((found = _find_slot(table, key)) < 0)
+		return false;
+	if (item && (table->slots[found].item != item))
+		return false;
+
+	/*
+	 * Shift following entries of the probe sequence back into the hole
+	 * rather than leaving a tombstone, so lookups never slow down as
+	 * entries come and go.
+	 */
+	hole = i = found;
+	while (true) {
+		i = (i + 1) & mask;
+		if (!table->slots[i].item)
+			break;
+		home = _home(table, table->slots[i].key);
+		/* Entry can move only if its home is not within (hole, i] */
+		if ((i > hole) ? ((home <= hole) || (home > i)) :
+				 ((home <= hole) && (home > i))) {
+			table->slots[hole] = table->slots[i];
+			hole = i;
+		}
+	}
+	table->slots[hole].item = NULL;
+	table->count--;
+
+	return true;
+}
+
+extern uint32_t id_hash_count(id_hash_t *table)
+{
+	xassert(table->magic == ID_HASH_MAGIC);
+
+	return table->count;
+}
+
+extern int id_hash_for_each(id_hash_t *table, id_hash_for_each_t f,
+			    void *arg)
+{
+	int n = 0;
+
+	xassert(table->magic == ID_HASH_MAGIC);
+
+	for (uint32_t i = 0; i < table->size; i++) {
+		if (!table->slots[i].item)
+			continue;
+		n++;
+		if (f(table->slots[i].key, table->slots[i].item, arg) < 0)
+			return -n;
+	}
+
+	return n;
+}
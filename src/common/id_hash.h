@@ -0,0 +1,97 @@
+/*****************************************************************************\
+ *  id_hash.h - open addressing hash table of pointers keyed by integer ids
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_ID_HASH_H
+#define _SLURM_ID_HASH_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/*
+ * An id_hash_t maps unique 64-bit keys (job ids, job_id/task_id pairs, ...)
+ * to non-NULL pointers. Entries are stored inline in one array using linear
+ * probing, so a lookup normally touches a single cache line and never
+ * dereferences the stored items. The table grows as needed.
+ *
+ * The table does no locking of its own, callers must serialize access.
+ */
+typedef struct id_hash id_hash_t;
+
+typedef int (*id_hash_for_each_t)(uint64_t key, void *item, void *arg);
+
+/*
+ * Create a new table able to hold at least "size" entries before growing.
+ */
+extern id_hash_t *id_hash_create(uint32_t size);
+
+/*
+ * Free the table. The items stored are not freed.
+ */
+extern void id_hash_destroy(id_hash_t *table);
+
+/*
+ * Store item under key.
+ * RET the item previously stored with the same key which has been replaced,
+ *     or NULL if the key was not already present
+ */
+extern void *id_hash_add(id_hash_t *table, uint64_t key, void *item);
+
+/*
+ * RET the item stored with key or NULL if not found
+ */
+extern void *id_hash_find(id_hash_t *table, uint64_t key);
+
+/*
+ * Remove key from the table.
+ * IN item - if not NULL only remove the entry if it stores this item
+ * RET true if an entry was removed
+ */
+extern bool id_hash_remove(id_hash_t *table, uint64_t key, void *item);
+
+/*
+ * RET number of entries in the table
+ */
+extern uint32_t id_hash_count(id_hash_t *table);
+
+/*
+ * Call f for every entry in the table until it returns a negative value.
+ * The table must not be modified by f.
+ * RET number of entries processed, or the negative count of entries processed
+ *     if f stopped the iteration
+ */
+extern int id_hash_for_each(id_hash_t *table, id_hash_for_each_t f,
+			    void *arg);
+
+#endif
@@ -39,6 +39,7 @@
 #include "src/common/fd.h"
 #include "src/common/io_hdr.h"
 #include "src/common/slurm_protocol_defs.h"
+#include "src/common/slurm_protocol_interface.h"
 
 /* If this changes, io_hdr_pack|unpack must change. */
 int g_io_hdr_size = sizeof(uint32_t) + 3*sizeof(uint16_t);
@@ -258,3 +259,68 @@ rwfail:
 	error("%s: reading slurm_io_init_msg failed: %m",__func__);
 	return SLURM_ERROR;
 }
+
+extern int io_init_msg_read_from_fd_timeout(int fd, io_init_msg_t *msg,
+					    int timeout)
+{
+	buf_t *buf = NULL;
+	uint32_t len;
+	int rc;
+
+	xassert(msg);
+
+	debug2("Entering %s", __func__);
+	if (slurm_recv_timeout(fd, (char *) &len, sizeof(len), 0, timeout) !=
+	    sizeof(len))
+		goto rwfail;
+	len = ntohl(len);
+	if (len > MAX_IO_MSG_LEN) {
+		error("%s: slurm_io_init_msg of %u bytes refused",
+		      __func__, len);
+		return SLURM_ERROR;
+	}
+	buf = init_buf(len);
+	if (slurm_recv_timeout(fd, buf->head, len, 0, timeout) != len)
+		goto rwfail;
+
+	if ((rc = io_init_msg_unpack(msg, buf)))
+		error("%s: io_init_msg_unpack failed: rc=%d", __func__, rc);
+
+	FREE_NULL_BUFFER(buf);
+	debug2("Leaving %s", __func__);
+	return rc;
+
+rwfail:
+	FREE_NULL_BUFFER(buf);
+	error("%s: reading slurm_io_init_msg failed: %m", __func__);
+	return SLURM_ERROR;
+}
+
+extern void io_relay_init_pack(io_relay_init_t *msg, buf_t *buffer)
+{
+	pack32(msg->nodeid, buffer);
+	pack32(msg->stdout_objs, buffer);
+	pack32(msg->stderr_objs, buffer);
+	pack32_array(msg->gtids, msg->ntasks, buffer);
+}
+
+extern int io_relay_init_unpack(io_relay_init_t *msg, buf_t *buffer)
+{
+	safe_unpack32(&msg->nodeid, buffer);
+	safe_unpack32(&msg->stdout_objs, buffer);
+	safe_unpack32(&msg->stderr_objs, buffer);
+	safe_unpack32_array(&msg->gtids, &msg->ntasks, buffer);
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	error("%s: unpack error", __func__);
+	io_relay_init_free_members(msg);
+	return SLURM_ERROR;
+}
+
+extern void io_relay_init_free_members(io_relay_init_t *msg)
+{
+	xfree(msg->gtids);
+	msg->ntasks = 0;
+}
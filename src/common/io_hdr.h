@@ -47,6 +47,11 @@
 #include "src/common/xmalloc.h"
 
 #define MAX_MSG_LEN 1024
+/*
+ * Largest stdout/stderr message body a 23.11 or newer client accepts, the
+ * default pipe buffer size. See LaunchParameters=stdio_msg_size.
+ */
+#define MAX_IO_MSG_LEN (64 * 1024)
 #define SLURM_IO_KEY_SIZE 8
 
 #define SLURM_IO_STDIN 0
@@ -54,6 +59,11 @@
 #define SLURM_IO_STDERR 2
 #define SLURM_IO_ALLSTDIN 3
 #define SLURM_IO_CONNECTION_TEST 4
+/*
+ * Sent upstream by a slurmstepd whose stdio is relayed through the slurmstepd
+ * of its parent node (LaunchParameters=stdio_tree), body is io_relay_init_t.
+ */
+#define SLURM_IO_RELAY_INIT 5
 
 typedef struct {
 	uint16_t      version;
@@ -64,6 +74,14 @@ typedef struct {
 	uint32_t      stderr_objs;
 } io_init_msg_t;
 
+typedef struct {
+	uint32_t      nodeid;
+	uint32_t      stdout_objs;
+	uint32_t      stderr_objs;
+	uint32_t      ntasks;
+	uint32_t      *gtids;
+} io_relay_init_t;
+
 
 typedef struct {
 	uint16_t      type;
@@ -89,4 +107,20 @@ int io_init_msg_validate(io_init_msg_t *msg, const char *sig, uint32_t sig_len);
 int io_init_msg_write_to_fd(int fd, io_init_msg_t *msg);
 int io_init_msg_read_from_fd(int fd, io_init_msg_t *msg);
 
+/*
+ * Like io_init_msg_read_from_fd() but the whole message must arrive within
+ * timeout milliseconds and its length is bounded, for connections which are
+ * not yet trusted. RET SLURM_SUCCESS or SLURM_ERROR
+ */
+extern int io_init_msg_read_from_fd_timeout(int fd, io_init_msg_t *msg,
+					    int timeout);
+
+/*
+ * Pack/unpack the body of a SLURM_IO_RELAY_INIT message, the io header is
+ * handled by the caller as for any other message.
+ */
+extern void io_relay_init_pack(io_relay_init_t *msg, buf_t *buffer);
+extern int io_relay_init_unpack(io_relay_init_t *msg, buf_t *buffer);
+extern void io_relay_init_free_members(io_relay_init_t *msg);
+
 #endif /* !_HAVE_IO_HDR_H */
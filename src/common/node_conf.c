@@ -63,6 +63,7 @@
 #include "src/common/pack.h"
 #include "src/common/parse_time.h"
 #include "src/common/read_config.h"
+#include "src/common/str_intern.h"
 #include "src/interfaces/select.h"
 #include "src/interfaces/accounting_storage.h"
 #include "src/interfaces/acct_gather_energy.h"
@@ -74,6 +75,9 @@
 
 #define _DEBUG 0
 
+/* Longest numeric suffix tracked by the node range index (fits uint64_t) */
+#define NODE_RANGE_MAX_DIGITS 19
+
 strong_alias(init_node_conf, slurm_init_node_conf);
 strong_alias(build_all_nodeline_info, slurm_build_all_nodeline_info);
 strong_alias(rehash_node, slurm_rehash_node);
@@ -97,9 +101,53 @@ uint16_t *cr_node_num_cores = NULL;
 uint32_t *cr_node_cores_offset = NULL;
 bool spec_cores_first = false;
 
+/*
+ * Node range index: node names split into a prefix and a decimal suffix,
+ * sorted by prefix, suffix digit count and suffix value. Each segment covers
+ * a run of consecutive suffix values whose records are also consecutive in
+ * node_record_table_ptr, so a hostlist range such as "tux[0001-4096]" maps
+ * onto a bitmap range without expanding or hashing each hostname.
+ *
+ * There is no locking of its own. Like node_record_table_ptr it is protected
+ * by the slurmctld node lock: rehash_node() builds it and adding or removing a
+ * node record afterwards rebuilds it, so callers of those must hold the node
+ * write lock. Readers holding only the node read lock never modify it, they
+ * resolve names one by one while it is not built.
+ */
+typedef struct {
+	char *prefix;		/* hostname up to the numeric suffix */
+	int prefix_len;		/* strlen(prefix) */
+	int digits;		/* characters in the numeric suffix */
+	uint64_t lo;		/* suffix value of first node in segment */
+	uint64_t hi;		/* suffix value of last node in segment */
+	int index;		/* node_record_table_ptr index of lo */
+} node_range_seg_t;
+
+typedef struct {
+	const char *name;
+	int prefix_len;
+	int digits;
+	uint64_t num;
+	int index;
+} node_range_ent_t;
+
+typedef struct {
+	bitstr_t *bitmap;
+	bool best_effort;
+	const char *caller;
+	int rc;
+} node_range_args_t;
+
+static node_range_seg_t *node_range_segs = NULL;
+static int node_range_seg_cnt = 0;
+static bool node_range_valid = false;
+
 /* Local function definitions */
 static void _delete_config_record(void);
 static void _delete_node_config_ptr(node_record_t *node_ptr);
+static void _free_node_range_index(void);
+static void _node_range_changed(void);
+static void _rehash_node_table(void);
 #if _DEBUG
 static void	_dump_hash (void);
 #endif
@@ -819,7 +867,7 @@ extern void grow_node_record_table_ptr(void)
 	 * You need to rehash the hash after we realloc or we will have
 	 * only bad memory references in the hash.
 	 */
-	rehash_node();
+	_rehash_node_table();
 }
 
 /*
@@ -869,6 +917,7 @@ extern node_record_t *create_node_record_at(int index, char *node_name,
 	node_ptr->index = index;
 	node_ptr->name = xstrdup(node_name);
 	xhash_add(node_hash_table, node_ptr);
+	_node_range_changed();
 	active_node_record_count++;
 
 	_init_node_record(node_ptr, config_ptr);
@@ -936,6 +985,7 @@ extern void insert_node_record(node_record_t *node_ptr)
 		node_ptr->index = i;
 		bit_set(node_ptr->config_ptr->node_bitmap, node_ptr->index);
 		xhash_add(node_hash_table, node_ptr);
+		_node_range_changed();
 		active_node_record_count++;
 
 		/* re-add node to conf node hash tables */
@@ -954,6 +1004,7 @@ extern void delete_node_record(node_record_t *node_ptr)
 	xassert(node_ptr);
 
 	node_record_table_ptr[node_ptr->index] = NULL;
+	_node_range_changed();
 
 	if (node_ptr->index == last_node_index) {
 		int i = 0;
@@ -1071,6 +1122,7 @@ extern void init_node_conf(void)
 	int i;
 	node_record_t *node_ptr;
 
+	_free_node_range_index();
 	for (i = 0; (node_ptr = next_node(&i)); i++)
 		delete_node_record(node_ptr);
 
@@ -1100,6 +1152,7 @@ extern void node_fini2 (void)
 	node_record_t *node_ptr;
 
 	xhash_free(node_hash_table);
+	_free_node_range_index();
 	for (i = 0; (node_ptr = next_node(&i)); i++)
 		delete_node_record(node_ptr);
 
@@ -1129,6 +1182,285 @@ extern int node_name_get_inx(char *node_name)
 	return node_ptr->index;
 }
 
+/* Free the node range index, it is rebuilt by rehash_node() */
+static void _free_node_range_index(void)
+{
+	for (int i = 0; i < node_range_seg_cnt; i++)
+		xfree(node_range_segs[i].prefix);
+	xfree(node_range_segs);
+	node_range_seg_cnt = 0;
+	node_range_valid = false;
+}
+
+static int _cmp_range_key(const char *prefix1, int len1, int digits1,
+			  const char *prefix2, int len2, int digits2)
+{
+	int rc = memcmp(prefix1, prefix2, MIN(len1, len2));
+
+	if (rc)
+		return rc;
+	if (len1 != len2)
+		return (len1 < len2) ? -1 : 1;
+	if (digits1 != digits2)
+		return (digits1 < digits2) ? -1 : 1;
+	return 0;
+}
+
+static int _cmp_range_ent(const void *x, const void *y)
+{
+	const node_range_ent_t *e1 = x, *e2 = y;
+	int rc = _cmp_range_key(e1->name, e1->prefix_len, e1->digits,
+				e2->name, e2->prefix_len, e2->digits);
+
+	if (rc)
+		return rc;
+	if (e1->num != e2->num)
+		return (e1->num < e2->num) ? -1 : 1;
+	return 0;
+}
+
+/*
+ * Split a node name into prefix and numeric suffix the same way a one
+ * dimensional hostlist does.
+ * RET false if the name has no usable numeric suffix
+ */
+static bool _split_node_name(const char *name, node_range_ent_t *ent)
+{
+	int len = strlen(name), i = len;
+
+	while ((i > 0) && isdigit((int) name[i - 1]))
+		i--;
+	if ((i == len) || ((len - i) > NODE_RANGE_MAX_DIGITS))
+		return false;
+
+	ent->name = name;
+	ent->prefix_len = i;
+	ent->digits = len - i;
+	ent->num = strtoull(name + i, NULL, 10);
+	return true;
+}
+
+/* Build node_range_segs from node_record_table_ptr */
+static void _build_node_range_index(void)
+{
+	node_range_ent_t *ents;
+	node_range_seg_t *seg = NULL;
+	node_record_t *node_ptr;
+	int ent_cnt = 0;
+
+	if (!node_record_table_ptr || !active_node_record_count)
+		return;
+
+	ents = xcalloc(active_node_record_count, sizeof(*ents));
+	for (int i = 0; (node_ptr = next_node(&i)); i++) {
+		if (ent_cnt >= active_node_record_count)
+			break;
+		if (!node_ptr->name || !_split_node_name(node_ptr->name,
+							 &ents[ent_cnt]))
+			continue;
+		ents[ent_cnt++].index = node_ptr->index;
+	}
+	qsort(ents, ent_cnt, sizeof(*ents), _cmp_range_ent);
+
+	for (int i = 0; i < ent_cnt; i++) {
+		node_range_ent_t *ent = &ents[i];
+
+		if (seg && (seg->hi + 1 == ent->num) &&
+		    (seg->index + (seg->hi - seg->lo) + 1 == ent->index) &&
+		    !_cmp_range_key(seg->prefix, seg->prefix_len, seg->digits,
+				    ent->name, ent->prefix_len, ent->digits)) {
+			seg->hi = ent->num;
+			continue;
+		}
+
+		if (!(node_range_seg_cnt % 64))
+			xrecalloc(node_range_segs, node_range_seg_cnt + 64,
+				  sizeof(*node_range_segs));
+		seg = &node_range_segs[node_range_seg_cnt++];
+		seg->prefix = xstrndup(ent->name, ent->prefix_len);
+		seg->prefix_len = ent->prefix_len;
+		seg->digits = ent->digits;
+		seg->lo = seg->hi = ent->num;
+		seg->index = ent->index;
+	}
+	xfree(ents);
+
+	debug3("%s: %d nodes indexed in %d ranges",
+	       __func__, ent_cnt, node_range_seg_cnt);
+}
+
+/* Node write lock needed */
+static void _rebuild_node_range_index(void)
+{
+	_free_node_range_index();
+	_build_node_range_index();
+	node_range_valid = true;
+}
+
+/*
+ * A node record was added or removed, node write lock held. Rebuild the index
+ * right away if it is built so readers never find it stale. While the node
+ * table is being loaded it is not built yet and is left to rehash_node().
+ */
+static void _node_range_changed(void)
+{
+	if (node_range_valid)
+		_rebuild_node_range_index();
+}
+
+/* Set the bit for one hostname, testing aliases as before */
+static void _node_name_to_bitmap(char *name, node_range_args_t *args)
+{
+	node_record_t *node_ptr;
+
+	if ((node_ptr = _find_node_record(name, args->best_effort, true))) {
+		bit_set(args->bitmap, node_ptr->index);
+	} else {
+		error("%s: invalid node specified: \"%s\"", args->caller, name);
+		if (!args->best_effort)
+			args->rc = EINVAL;
+	}
+}
+
+static void _node_nums_to_bitmap(const char *prefix, uint64_t lo,
+				 uint64_t hi, int width,
+				 node_range_args_t *args)
+{
+	for (uint64_t num = lo; num <= hi; num++) {
+		char *name = xstrdup_printf("%s%0*"PRIu64, prefix, width, num);
+		_node_name_to_bitmap(name, args);
+		xfree(name);
+		if (num == UINT64_MAX)
+			break;
+	}
+}
+
+/*
+ * Resolve suffix values lo..hi, all printed with the given number of digits,
+ * using the node range index. Values not in the index (unknown names or
+ * aliases) are resolved individually.
+ */
+static void _node_digits_to_bitmap(const char *prefix, int prefix_len,
+				   int digits, uint64_t lo, uint64_t hi,
+				   int width, node_range_args_t *args)
+{
+	int first = 0, last = node_range_seg_cnt;
+	uint64_t next = lo;
+
+	/* first segment of this prefix and digit count with hi >= lo */
+	while (first < last) {
+		int mid = first + (last - first) / 2;
+		node_range_seg_t *seg = &node_range_segs[mid];
+		int rc = _cmp_range_key(seg->prefix, seg->prefix_len,
+					seg->digits, prefix, prefix_len,
+					digits);
+
+		if ((rc < 0) || (!rc && (seg->hi < lo)))
+			first = mid + 1;
+		else
+			last = mid;
+	}
+
+	for (int i = first; i < node_range_seg_cnt; i++) {
+		node_range_seg_t *seg = &node_range_segs[i];
+		uint64_t seg_lo, seg_hi;
+
+		if ((seg->lo > hi) ||
+		    _cmp_range_key(seg->prefix, seg->prefix_len, seg->digits,
+				   prefix, prefix_len, digits))
+			break;
+
+		seg_lo = MAX(seg->lo, lo);
+		seg_hi = MIN(seg->hi, hi);
+		if (next < seg_lo)
+			_node_nums_to_bitmap(prefix, next, seg_lo - 1, width,
+					     args);
+		if ((seg->index + (seg_hi - seg->lo)) < node_record_count) {
+			bit_nset(args->bitmap, seg->index + (seg_lo - seg->lo),
+				 seg->index + (seg_hi - seg->lo));
+		} else {
+			/* table shrunk under us, resolve names directly */
+			_node_nums_to_bitmap(prefix, seg_lo, seg_hi, width,
+					     args);
+		}
+		if (seg_hi == hi)
+			return;
+		next = seg_hi + 1;
+	}
+
+	_node_nums_to_bitmap(prefix, next, hi, width, args);
+}
+
+/* hostlist_for_each_range() callback */
+static int _node_range_to_bitmap(const char *prefix, unsigned long lo,
+				 unsigned long hi, int width, void *arg)
+{
+	node_range_args_t *args = arg;
+	int prefix_len = strlen(prefix);
+	uint64_t digit_max = 9;
+
+	if (width < 0) {
+		_node_name_to_bitmap((char *) prefix, args);
+		return 0;
+	}
+	if (width > NODE_RANGE_MAX_DIGITS) {
+		_node_nums_to_bitmap(prefix, lo, hi, width, args);
+		return 0;
+	}
+
+	/*
+	 * Suffix values are zero padded to width digits but may print with
+	 * more digits, e.g. "tux[8-12]" is tux8 through tux12. Split the range
+	 * by printed digit count, each piece is one index lookup.
+	 */
+	for (int i = 1; i < width; i++)
+		digit_max = (digit_max * 10) + 9;
+	for (int digits = MAX(width, 1); lo <= hi; digits++) {
+		uint64_t piece_hi = MIN(hi, digit_max);
+
+		if (digits > NODE_RANGE_MAX_DIGITS) {
+			_node_nums_to_bitmap(prefix, lo, hi, width, args);
+			break;
+		}
+		_node_digits_to_bitmap(prefix, prefix_len, digits, lo,
+				       piece_hi, width, args);
+		if (piece_hi == hi)
+			break;
+		lo = piece_hi + 1;
+		digit_max = (digit_max * 10) + 9;
+	}
+
+	return 0;
+}
+
+/* Set bits in bitmap for every host in hl */
+static int _hostlist2bitmap(hostlist_t *hl, bool best_effort,
+			    bitstr_t *bitmap, const char *caller)
+{
+	node_range_args_t args = {
+		.bitmap = bitmap,
+		.best_effort = best_effort,
+		.caller = caller,
+		.rc = SLURM_SUCCESS,
+	};
+
+	if ((slurmdb_setup_cluster_name_dims() > 1) || !node_range_valid) {
+		hostlist_iterator_t *hi = hostlist_iterator_create(hl);
+		char *name;
+
+		while ((name = hostlist_next(hi))) {
+			_node_name_to_bitmap(name, &args);
+			free(name);
+		}
+		hostlist_iterator_destroy(hi);
+		return args.rc;
+	}
+
+	hostlist_for_each_range(hl, _node_range_to_bitmap, &args);
+
+	return args.rc;
+}
+
 /*
  * node_name2bitmap - given a node name regular expression, build a bitmap
  *	representation
@@ -1142,7 +1474,6 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 			     bitstr_t **bitmap)
 {
 	int rc = SLURM_SUCCESS;
-	char *this_node_name;
 	bitstr_t *my_bitmap;
 	hostlist_t *host_list;
 
@@ -1162,19 +1493,7 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 		return rc;
 	}
 
-	while ( (this_node_name = hostlist_shift (host_list)) ) {
-		node_record_t *node_ptr;
-		node_ptr = _find_node_record(this_node_name, best_effort, true);
-		if (node_ptr) {
-			bit_set(my_bitmap, node_ptr->index);
-		} else {
-			error("%s: invalid node specified: \"%s\"", __func__,
-			      this_node_name);
-			if (!best_effort)
-				rc = EINVAL;
-		}
-		free (this_node_name);
-	}
+	rc = _hostlist2bitmap(host_list, best_effort, my_bitmap, __func__);
 	hostlist_destroy (host_list);
 
 	return rc;
@@ -1189,33 +1508,10 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
  */
 extern int hostlist2bitmap(hostlist_t *hl, bool best_effort, bitstr_t **bitmap)
 {
-	int rc = SLURM_SUCCESS;
-	bitstr_t *my_bitmap;
-	char *name;
-	hostlist_iterator_t *hi;
-
 	FREE_NULL_BITMAP(*bitmap);
-	my_bitmap = (bitstr_t *) bit_alloc (node_record_count);
-	*bitmap = my_bitmap;
-
-	hi = hostlist_iterator_create(hl);
-	while ((name = hostlist_next(hi))) {
-		node_record_t *node_ptr;
-		node_ptr = _find_node_record(name, best_effort, true);
-		if (node_ptr) {
-			bit_set(my_bitmap, node_ptr->index);
-		} else {
-			error ("hostlist2bitmap: invalid node specified %s",
-			       name);
-			if (!best_effort)
-				rc = EINVAL;
-		}
-		free (name);
-	}
-
-	hostlist_iterator_destroy(hi);
-	return rc;
+	*bitmap = bit_alloc(node_record_count);
 
+	return _hostlist2bitmap(hl, best_effort, *bitmap, __func__);
 }
 
 /* Only delete config_ptr if isn't referenced by another node. */
@@ -1248,7 +1544,7 @@ static void _delete_node_config_ptr(node_record_t *node_ptr)
 /* Purge the contents of a node record */
 extern void purge_node_rec(node_record_t *node_ptr)
 {
-	xfree(node_ptr->arch);
+	xfree_intern(node_ptr->arch);
 	xfree(node_ptr->comment);
 	xfree(node_ptr->comm_name);
 	xfree(node_ptr->cpu_spec_list);
@@ -1261,12 +1557,12 @@ extern void purge_node_rec(node_record_t *node_ptr)
 	xfree(node_ptr->name);
 	xfree(node_ptr->node_hostname);
 	FREE_NULL_BITMAP(node_ptr->node_spec_bitmap);
-	xfree(node_ptr->os);
+	xfree_intern(node_ptr->os);
 	xfree(node_ptr->part_pptr);
 	xfree(node_ptr->power);
 	xfree(node_ptr->reason);
 	xfree(node_ptr->resv_name);
-	xfree(node_ptr->version);
+	xfree_intern(node_ptr->version);
 	acct_gather_energy_destroy(node_ptr->energy);
 	ext_sensors_destroy(node_ptr->ext_sensors);
 	if (running_in_slurmctld())
@@ -1279,10 +1575,22 @@ extern void purge_node_rec(node_record_t *node_ptr)
 }
 
 /*
- * rehash_node - build a hash table of the node_record entries.
+ * rehash_node - build a hash table of the node_record entries and the node
+ *	range index. Callers must hold the node write lock.
  * NOTE: using xhash implementation
  */
 extern void rehash_node (void)
+{
+	_rehash_node_table();
+	_rebuild_node_range_index();
+
+#if _DEBUG
+	_dump_hash();
+#endif
+	return;
+}
+
+static void _rehash_node_table(void)
 {
 	int i;
 	node_record_t *node_ptr;
@@ -1295,11 +1603,6 @@ extern void rehash_node (void)
 			continue;	/* vestigial record */
 		xhash_add(node_hash_table, node_ptr);
 	}
-
-#if _DEBUG
-	_dump_hash();
-#endif
-	return;
 }
 
 /* Convert a node state string to it's equivalent enum value */
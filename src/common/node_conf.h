@@ -408,8 +408,10 @@ extern int node_name2bitmap (char *node_names, bool best_effort,
 extern void purge_node_rec(node_record_t *node_ptr);
 
 /*
- * rehash_node - build a hash table of the node_record entries.
+ * rehash_node - build a hash table of the node_record entries and the node
+ *	range index used by hostlist2bitmap() and node_name2bitmap()
  * NOTE: manages memory for node_hash_table
+ * NOTE: callers must hold the node write lock
  */
 extern void rehash_node (void);
 
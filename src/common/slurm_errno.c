@@ -521,6 +521,8 @@ slurm_errtab_t slurm_errtab[] = {
 	  "Unable to satisfy cpu bind request"			},
 	{ ERRTAB_ENTRY(ESLURMD_CPU_LAYOUT_ERROR),
 	  "Unable to layout tasks on given cpus"		},
+	{ ERRTAB_ENTRY(ESLURMD_FILE_BCAST_CACHED),
+	  "File restored from the node's broadcast cache"	},
 
 	/* socket specific Slurm communications error */
 
@@ -817,10 +817,11 @@ extern int slurm_persist_conn_writeable(slurm_persist_conn_t *persist_conn)
 		 * If not then exit out and notify the conn.  This
 		 * is here since a write doesn't always tell you the
 		 * socket is gone, but getting 0 back from a
-		 * nonblocking read means just that.
+		 * nonblocking read means just that. Only peek, replies
+		 * to messages pipelined before this one may be waiting.
 		 */
 		if (ufds.revents & POLLHUP ||
-		    (recv(persist_conn->fd, &temp, 1, 0) == 0)) {
+		    (recv(persist_conn->fd, &temp, 1, MSG_PEEK) == 0)) {
 			log_flag(NET, "%s: persistent connection %d is closed for writes",
 				 __func__, persist_conn->fd);
 			if (persist_conn->trigger_callbacks.dbd_fail)
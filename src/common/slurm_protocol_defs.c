@@ -1466,6 +1466,27 @@ extern void slurm_free_job_launch_msg(batch_job_launch_msg_t * msg)
 	}
 }
 
+extern void slurm_free_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t *msg)
+{
+	if (msg) {
+		for (int i = 0; msg->launch_msgs && (i < msg->job_cnt); i++)
+			slurm_free_job_launch_msg(msg->launch_msgs[i]);
+		xfree(msg->launch_msgs);
+		xfree(msg);
+	}
+}
+
+extern void slurm_free_job_launch_multi_resp_msg(
+	batch_job_launch_multi_resp_msg_t *msg)
+{
+	if (msg) {
+		xfree(msg->job_ids);
+		xfree(msg->return_codes);
+		xfree(msg);
+	}
+}
+
 extern void slurm_free_job_info(job_info_t * job)
 {
 	if (job) {
@@ -2004,6 +2025,14 @@ extern void slurm_free_stats_response_msg(stats_info_response_msg_t *msg)
 			xfree(msg->rpc_dump_hostlist[i]);
 		}
 		xfree(msg->rpc_dump_hostlist);
+		xfree(msg->fwd_type_id);
+		xfree(msg->fwd_type_cnt);
+		xfree(msg->fwd_type_time);
+		xfree(msg->fwd_type_max);
+		xfree(msg->agent_type_id);
+		xfree(msg->agent_type_cnt);
+		xfree(msg->agent_type_time);
+		xfree(msg->agent_type_max);
 		xfree(msg);
 	}
 }
@@ -5557,6 +5586,7 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_JOB_STEP_STAT:
 	case REQUEST_JOB_STEP_PIDS:
 	case REQUEST_STEP_LAYOUT:
+	case REQUEST_STEP_IO_RELAY:
 		slurm_free_step_id(data);
 		break;
 	case RESPONSE_JOB_STEP_STAT:
@@ -5565,6 +5595,12 @@ extern int slurm_free_msg_data(slurm_msg_type_t type, void *data)
 	case REQUEST_BATCH_JOB_LAUNCH:
 		slurm_free_job_launch_msg(data);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		slurm_free_job_launch_multi_msg(data);
+		break;
+	case RESPONSE_BATCH_JOB_LAUNCH_MULTI:
+		slurm_free_job_launch_multi_resp_msg(data);
+		break;
 	case REQUEST_LAUNCH_TASKS:
 		slurm_free_launch_tasks_request_msg(data);
 		break;
@@ -5820,6 +5856,15 @@ extern uint32_t slurm_get_return_code(slurm_msg_type_t type, void *data)
 	case RESPONSE_ACCT_GATHER_UPDATE:
 		rc = SLURM_SUCCESS;
 		break;
+	case RESPONSE_BATCH_JOB_LAUNCH_MULTI:
+	{
+		batch_job_launch_multi_resp_msg_t *resp = data;
+
+		/* The first failure, callers should check every job */
+		for (int i = 0; !rc && (i < resp->job_cnt); i++)
+			rc = resp->return_codes[i];
+		break;
+	}
 	case RESPONSE_FORWARD_FAILED:
 		/* There may be other reasons for the failure, but
 		 * this may be a slurm_msg_t data type lacking the
@@ -6148,6 +6193,10 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_HET_JOB_ALLOC_INFO";
 	case REQUEST_SUBMIT_BATCH_HET_JOB:
 		return "REQUEST_SUBMIT_BATCH_HET_JOB";
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		return "REQUEST_BATCH_JOB_LAUNCH_MULTI";
+	case RESPONSE_BATCH_JOB_LAUNCH_MULTI:
+		return "RESPONSE_BATCH_JOB_LAUNCH_MULTI";
 
 	case REQUEST_JOB_STEP_CREATE:				/* 5001 */
 		return "REQUEST_JOB_STEP_CREATE";
@@ -6244,6 +6293,8 @@ rpc_num2string(uint16_t opcode)
 		return "REQUEST_COMPLETE_PROLOG";
 	case RESPONSE_PROLOG_EXECUTING:				/* 6019 */
 		return "RESPONSE_PROLOG_EXECUTING";
+	case REQUEST_STEP_IO_RELAY:
+		return "REQUEST_STEP_IO_RELAY";
 
 	case SRUN_PING:						/* 7001 */
 		return "SRUN_PING";
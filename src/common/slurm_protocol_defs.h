@@ -360,6 +360,8 @@ typedef enum {
 	RESPONSE_HET_JOB_ALLOCATION,
 	REQUEST_HET_JOB_ALLOC_INFO,
 	REQUEST_SUBMIT_BATCH_HET_JOB,
+	REQUEST_BATCH_JOB_LAUNCH_MULTI,
+	RESPONSE_BATCH_JOB_LAUNCH_MULTI,
 
 	REQUEST_CTLD_MULT_MSG = 4500,
 	RESPONSE_CTLD_MULT_MSG,
@@ -431,6 +433,7 @@ typedef enum {
 	REQUEST_LAUNCH_PROLOG,
 	REQUEST_COMPLETE_PROLOG,
 	RESPONSE_PROLOG_EXECUTING,	/* 6019 */
+	REQUEST_STEP_IO_RELAY,
 
 	REQUEST_PERSIST_INIT = 6500,
 
@@ -1165,6 +1168,20 @@ typedef struct batch_job_launch_msg {
 	char *tres_freq;	/* frequency/power for TRES (e.g. GPUs) */
 } batch_job_launch_msg_t;
 
+/* Batch jobs launched on the same node at once */
+#define BATCH_LAUNCH_MAX_JOBS	64	/* batch jobs launched per RPC */
+
+typedef struct {
+	uint32_t job_cnt;
+	batch_job_launch_msg_t **launch_msgs;
+} batch_job_launch_multi_msg_t;
+
+typedef struct {
+	uint32_t job_cnt;
+	uint32_t *job_ids;	/* in the order of the request */
+	uint32_t *return_codes;	/* what REQUEST_BATCH_JOB_LAUNCH replies */
+} batch_job_launch_multi_resp_msg_t;
+
 typedef struct job_id_request_msg {
 	uint32_t job_pid;	/* local process_id of a job */
 } job_id_request_msg_t;
@@ -1236,6 +1253,8 @@ typedef struct file_bcast_msg {
 	uint32_t uncomp_len;	/* uncompressed length of this data block */
 	char *block;		/* data for this block */
 	uint64_t file_size;	/* file size */
+	slurm_hash_t file_hash;	/* hash of the file content, see
+				 * bcast_hash_file() */
 } file_bcast_msg_t;
 
 typedef struct multi_core_data {
@@ -1678,6 +1697,10 @@ extern void slurm_free_config_response_msg(config_response_msg_t *msg);
 extern void slurm_free_step_id(slurm_step_id_t *msg);
 
 extern void slurm_free_job_launch_msg(batch_job_launch_msg_t * msg);
+extern void slurm_free_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t *msg);
+extern void slurm_free_job_launch_multi_resp_msg(
+	batch_job_launch_multi_resp_msg_t *msg);
 
 extern void slurm_free_update_front_end_msg(update_front_end_msg_t * msg);
 extern void slurm_free_update_node_msg(update_node_msg_t * msg);
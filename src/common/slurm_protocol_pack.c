@@ -9175,6 +9175,80 @@ unpack_error:
 	return SLURM_ERROR;
 }
 
+static void _pack_batch_job_launch_multi_msg(batch_job_launch_multi_msg_t *msg,
+					     buf_t *buffer,
+					     uint16_t protocol_version)
+{
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		pack32(msg->job_cnt, buffer);
+		for (int i = 0; i < msg->job_cnt; i++)
+			_pack_batch_job_launch_msg(msg->launch_msgs[i], buffer,
+						   protocol_version);
+	}
+}
+
+static int _unpack_batch_job_launch_multi_msg(
+	batch_job_launch_multi_msg_t **msg, buf_t *buffer,
+	uint16_t protocol_version)
+{
+	batch_job_launch_multi_msg_t *launch_msg = xmalloc(sizeof(*launch_msg));
+
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		safe_unpack32(&launch_msg->job_cnt, buffer);
+		if (launch_msg->job_cnt > BATCH_LAUNCH_MAX_JOBS)
+			goto unpack_error;
+		safe_xcalloc(launch_msg->launch_msgs, launch_msg->job_cnt,
+			     sizeof(batch_job_launch_msg_t *));
+		for (int i = 0; i < launch_msg->job_cnt; i++) {
+			if (_unpack_batch_job_launch_msg(
+				    &launch_msg->launch_msgs[i], buffer,
+				    protocol_version))
+				goto unpack_error;
+		}
+	}
+
+	*msg = launch_msg;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_launch_multi_msg(launch_msg);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
+static void _pack_batch_job_launch_multi_resp_msg(
+	batch_job_launch_multi_resp_msg_t *msg, buf_t *buffer,
+	uint16_t protocol_version)
+{
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		pack32_array(msg->job_ids, msg->job_cnt, buffer);
+		pack32_array(msg->return_codes, msg->job_cnt, buffer);
+	}
+}
+
+static int _unpack_batch_job_launch_multi_resp_msg(
+	batch_job_launch_multi_resp_msg_t **msg, buf_t *buffer,
+	uint16_t protocol_version)
+{
+	batch_job_launch_multi_resp_msg_t *resp = xmalloc(sizeof(*resp));
+	uint32_t uint32_tmp;
+
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		safe_unpack32_array(&resp->job_ids, &resp->job_cnt, buffer);
+		safe_unpack32_array(&resp->return_codes, &uint32_tmp, buffer);
+		if (uint32_tmp != resp->job_cnt)
+			goto unpack_error;
+	}
+
+	*msg = resp;
+	return SLURM_SUCCESS;
+
+unpack_error:
+	slurm_free_job_launch_multi_resp_msg(resp);
+	*msg = NULL;
+	return SLURM_ERROR;
+}
+
 static void
 _pack_job_id_request_msg(job_id_request_msg_t * msg, buf_t *buffer,
 			 uint16_t protocol_version)
@@ -9844,7 +9918,30 @@ static void _pack_file_bcast(file_bcast_msg_t * msg , buf_t *buffer,
 
 	grow_buf(buffer,  msg->block_len);
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		pack32(msg->block_no, buffer);
+		pack16(msg->compress, buffer);
+		pack16(msg->flags, buffer);
+		pack16(msg->modes, buffer);
+
+		pack32(msg->uid, buffer);
+		packstr(msg->user_name, buffer);
+		pack32(msg->gid, buffer);
+
+		pack_time(msg->atime, buffer);
+		pack_time(msg->mtime, buffer);
+
+		packstr(msg->fname, buffer);
+		pack32(msg->block_len, buffer);
+		pack32(msg->uncomp_len, buffer);
+		pack64(msg->block_offset, buffer);
+		pack64(msg->file_size, buffer);
+		packmem(msg->block, msg->block_len, buffer);
+		pack_sbcast_cred(msg->cred, buffer, protocol_version);
+		pack8(msg->file_hash.type, buffer);
+		packmem_array((char *) msg->file_hash.hash,
+			      sizeof(msg->file_hash.hash), buffer);
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		pack32(msg->block_no, buffer);
 		pack16(msg->compress, buffer);
 		pack16(msg->flags, buffer);
@@ -9878,7 +9975,35 @@ static int _unpack_file_bcast(file_bcast_msg_t ** msg_ptr , buf_t *buffer,
 	msg = xmalloc ( sizeof (file_bcast_msg_t) ) ;
 	*msg_ptr = msg;
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		safe_unpack32(&msg->block_no, buffer);
+		safe_unpack16(&msg->compress, buffer);
+		safe_unpack16(&msg->flags, buffer);
+		safe_unpack16(&msg->modes, buffer);
+
+		safe_unpack32(&msg->uid, buffer);
+		safe_unpackstr(&msg->user_name, buffer);
+		safe_unpack32(&msg->gid, buffer);
+
+		safe_unpack_time(&msg->atime, buffer);
+		safe_unpack_time(&msg->mtime, buffer);
+
+		safe_unpackstr(&msg->fname, buffer);
+		safe_unpack32(&msg->block_len, buffer);
+		safe_unpack32(&msg->uncomp_len, buffer);
+		safe_unpack64(&msg->block_offset, buffer);
+		safe_unpack64(&msg->file_size, buffer);
+		safe_unpackmem_xmalloc(&msg->block, &uint32_tmp, buffer);
+		if (uint32_tmp != msg->block_len)
+			goto unpack_error;
+
+		msg->cred = unpack_sbcast_cred(buffer, protocol_version);
+		if (msg->cred == NULL)
+			goto unpack_error;
+		safe_unpack8(&msg->file_hash.type, buffer);
+		safe_unpackmem_array((char *) msg->file_hash.hash,
+				     sizeof(msg->file_hash.hash), buffer);
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&msg->block_no, buffer);
 		safe_unpack16(&msg->compress, buffer);
 		safe_unpack16(&msg->flags, buffer);
@@ -10621,6 +10746,19 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 
 			safe_unpack32(&msg->bf_active,		buffer);
 			safe_unpack32(&msg->bf_backfilled_het_jobs, buffer);
+
+			if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+				safe_unpack32(&msg->intern_strings, buffer);
+				safe_unpack64(&msg->intern_refs, buffer);
+				safe_unpack64(&msg->intern_bytes, buffer);
+				safe_unpack64(&msg->intern_bytes_saved,
+					      buffer);
+				safe_unpack32(&msg->agent_workers, buffer);
+				safe_unpack32(&msg->agent_workers_busy, buffer);
+				safe_unpack32(&msg->agent_work_queue, buffer);
+				safe_unpack32(&msg->agent_work_queue_max,
+					      buffer);
+			}
 		}
 
 		safe_unpack32(&msg->rpc_type_size,		buffer);
@@ -10649,6 +10787,38 @@ static int  _unpack_stats_response_msg(stats_info_response_msg_t **msg_ptr,
 				     buffer);
 		if (uint32_tmp != msg->rpc_dump_count)
 			goto unpack_error;
+
+		if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+			safe_unpack16_array(&msg->fwd_type_id,
+					    &msg->fwd_type_size, buffer);
+			safe_unpack32_array(&msg->fwd_type_cnt,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->fwd_type_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->fwd_type_time,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->fwd_type_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->fwd_type_max,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->fwd_type_size)
+				goto unpack_error;
+
+			safe_unpack16_array(&msg->agent_type_id,
+					    &msg->agent_type_size, buffer);
+			safe_unpack32_array(&msg->agent_type_cnt,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->agent_type_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->agent_type_time,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->agent_type_size)
+				goto unpack_error;
+			safe_unpack64_array(&msg->agent_type_max,
+					    &uint32_tmp, buffer);
+			if (uint32_tmp != msg->agent_type_size)
+				goto unpack_error;
+		}
 	}
 
 	return SLURM_SUCCESS;
@@ -11783,6 +11953,7 @@ pack_msg(slurm_msg_t const *msg, buf_t *buffer)
 	case REQUEST_STEP_LAYOUT:
 	case REQUEST_JOB_STEP_STAT:
 	case REQUEST_JOB_STEP_PIDS:
+	case REQUEST_STEP_IO_RELAY:
 		pack_step_id((slurm_step_id_t *)msg->data, buffer,
 			     msg->protocol_version);
 		break;
@@ -11817,6 +11988,14 @@ pack_msg(slurm_msg_t const *msg, buf_t *buffer)
 					   msg->data, buffer,
 					   msg->protocol_version);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		_pack_batch_job_launch_multi_msg(msg->data, buffer,
+						 msg->protocol_version);
+		break;
+	case RESPONSE_BATCH_JOB_LAUNCH_MULTI:
+		_pack_batch_job_launch_multi_resp_msg(msg->data, buffer,
+						      msg->protocol_version);
+		break;
 	case REQUEST_LAUNCH_PROLOG:
 		_pack_prolog_launch_msg(msg, buffer);
 		break;
@@ -12422,6 +12601,7 @@ unpack_msg(slurm_msg_t * msg, buf_t *buffer)
 	case REQUEST_STEP_LAYOUT:
 	case REQUEST_JOB_STEP_STAT:
 	case REQUEST_JOB_STEP_PIDS:
+	case REQUEST_STEP_IO_RELAY:
 		rc = unpack_step_id((slurm_step_id_t **)&msg->data,
 				    buffer, msg->protocol_version);
 		break;
@@ -12464,6 +12644,16 @@ unpack_msg(slurm_msg_t * msg, buf_t *buffer)
 						  & (msg->data), buffer,
 						  msg->protocol_version);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		rc = _unpack_batch_job_launch_multi_msg(
+			(batch_job_launch_multi_msg_t **) &msg->data, buffer,
+			msg->protocol_version);
+		break;
+	case RESPONSE_BATCH_JOB_LAUNCH_MULTI:
+		rc = _unpack_batch_job_launch_multi_resp_msg(
+			(batch_job_launch_multi_resp_msg_t **) &msg->data,
+			buffer, msg->protocol_version);
+		break;
 	case REQUEST_LAUNCH_PROLOG:
 		rc = _unpack_prolog_launch_msg(msg, buffer);
 		break;
@@ -5792,7 +5792,14 @@ extern void slurmdb_pack_rpc_obj(void *in, uint16_t protocol_version,
 {
 	slurmdb_rpc_obj_t *object = (slurmdb_rpc_obj_t *)in;
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		pack32(object->batch_cnt, buffer);
+		pack32(object->batch_rows, buffer);
+		pack32(object->cnt, buffer);
+		pack32(object->id, buffer);
+		pack64(object->time, buffer);
+		/* pack64(object->time_ave, buffer); NO need to pack */
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		pack32(object->cnt, buffer);
 		pack32(object->id, buffer);
 		pack64(object->time, buffer);
@@ -5810,7 +5817,16 @@ extern int slurmdb_unpack_rpc_obj(void **object, uint16_t protocol_version,
 
 	*object = object_ptr;
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		safe_unpack32(&object_ptr->batch_cnt, buffer);
+		safe_unpack32(&object_ptr->batch_rows, buffer);
+		safe_unpack32(&object_ptr->cnt, buffer);
+		safe_unpack32(&object_ptr->id, buffer);
+		safe_unpack64(&object_ptr->time, buffer);
+		if (object_ptr->cnt)
+			object_ptr->time_ave =
+				object_ptr->time / object_ptr->cnt;
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpack32(&object_ptr->cnt, buffer);
 		safe_unpack32(&object_ptr->id, buffer);
 		safe_unpack64(&object_ptr->time, buffer);
@@ -5837,7 +5853,19 @@ extern void slurmdb_pack_rollup_stats(void *in, uint16_t protocol_version,
 	slurmdb_rollup_stats_t *object = (slurmdb_rollup_stats_t *) in;
 	uint32_t i;
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		packstr(object->cluster_name, buffer);
+		pack16(DBD_ROLLUP_COUNT, buffer);
+		for (i = 0; i < DBD_ROLLUP_COUNT; i++) {
+			pack16(object->count[i], buffer);
+			pack_time(object->timestamp[i], buffer);
+			pack64(object->time_last[i], buffer);
+			pack64(object->time_max[i], buffer);
+			pack64(object->time_total[i], buffer);
+			pack64(object->time_window_max[i], buffer);
+			pack16(object->windows[i], buffer);
+		}
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		packstr(object->cluster_name, buffer);
 		pack16(DBD_ROLLUP_COUNT, buffer);
 		for (i = 0; i < DBD_ROLLUP_COUNT; i++) {
@@ -5865,7 +5893,31 @@ extern int slurmdb_unpack_rollup_stats(void **object, uint16_t protocol_version,
 
 	*object = object_ptr;
 
-	if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+		safe_unpackstr_xmalloc(&object_ptr->cluster_name,
+				       &uint32_tmp, buffer);
+		safe_unpack16(&rollup_count, buffer);
+		/*
+		 * If we got more than we can handle just overwrite the
+		 * last one.  This is more just to avoid potential
+		 * overflows.  It shouldn't happen in practice.
+		 */
+		if (rollup_count > DBD_ROLLUP_COUNT) {
+			error("%s: our DBD_ROLLUP_COUNT = %d, but we just got a count of %d.  We can't handle this.",
+			      __func__, DBD_ROLLUP_COUNT, rollup_count);
+			goto unpack_error;
+		}
+
+		for (i = 0; i < rollup_count; i++) {
+			safe_unpack16(&object_ptr->count[i], buffer);
+			safe_unpack_time(&object_ptr->timestamp[i], buffer);
+			safe_unpack64(&object_ptr->time_last[i], buffer);
+			safe_unpack64(&object_ptr->time_max[i], buffer);
+			safe_unpack64(&object_ptr->time_total[i], buffer);
+			safe_unpack64(&object_ptr->time_window_max[i], buffer);
+			safe_unpack16(&object_ptr->windows[i], buffer);
+		}
+	} else if (protocol_version >= SLURM_MIN_PROTOCOL_VERSION) {
 		safe_unpackstr_xmalloc(&object_ptr->cluster_name,
 				       &uint32_tmp, buffer);
 		safe_unpack16(&rollup_count, buffer);
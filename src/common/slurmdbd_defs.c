@@ -121,6 +121,8 @@ extern slurmdbd_msg_type_t str_2_slurmdbd_msg_type(char *msg_type)
 		return DBD_GOT_FEDERATIONS;
 	} else if (!xstrcasecmp(msg_type, "Got Jobs")) {
 		return DBD_GOT_JOBS;
+	} else if (!xstrcasecmp(msg_type, "Got Jobs Part")) {
+		return DBD_GOT_JOBS_PART;
 	} else if (!xstrcasecmp(msg_type, "Got List")) {
 		return DBD_GOT_LIST;
 	} else if (!xstrcasecmp(msg_type, "Got Problems")) {
@@ -450,6 +452,12 @@ extern char *slurmdbd_msg_type_2_str(slurmdbd_msg_type_t msg_type, int get_enum)
 		} else
 			return "Got Jobs";
 		break;
+	case DBD_GOT_JOBS_PART:
+		if (get_enum) {
+			return "DBD_GOT_JOBS_PART";
+		} else
+			return "Got Jobs Part";
+		break;
 	case DBD_GOT_LIST:
 		if (get_enum) {
 			return "DBD_GOT_LIST";
@@ -862,6 +870,7 @@ extern void slurmdbd_free_msg(persist_msg_t *msg)
 	case DBD_GOT_EVENTS:
 	case DBD_GOT_FEDERATIONS:
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_GOT_LIST:
 	case DBD_GOT_PROBS:
 	case DBD_GOT_RES:
@@ -160,6 +160,8 @@ typedef enum {
 				 * add_assoc_cond */
 	DBD_ADD_USERS_COND,     /* Add new user to the mix with user_rec and
 				 * add_assoc_cond */
+	DBD_GOT_JOBS_PART,	/* Part of a response to DBD_GET_JOBS_COND,
+				 * more parts or DBD_GOT_JOBS follow */
 	SLURM_DBD_MESSAGES_END = 2000, /* So that we don't overlap with any
 					* slurm_msg_type_t numbers. */
 	SLURM_PERSIST_INIT = 6500, /* So we don't use the
@@ -339,6 +341,9 @@ typedef struct {
 	uint32_t return_code;   /* If there was an error and a list of
 				 * them this is the type of error it
 				 * was */
+	uint32_t seq;		/* DBD_SEND_MULT_MSG sequence number of the
+				 * first message, 0 if not sequenced. Echoed
+				 * back in DBD_GOT_MULT_MSG. */
 } dbd_list_msg_t;
 
 typedef struct {
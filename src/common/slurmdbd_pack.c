@@ -1317,6 +1317,7 @@ extern void slurmdbd_pack_list_msg(dbd_list_msg_t *msg, uint16_t rpc_version,
 		my_function = pack_config_key_pair;
 		break;
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_FIX_RUNAWAY_JOB:
 		my_function = slurmdb_pack_job_rec;
 		break;
@@ -1373,6 +1374,10 @@ extern void slurmdbd_pack_list_msg(dbd_list_msg_t *msg, uint16_t rpc_version,
 		msg->return_code = rc;
 
 	pack32(msg->return_code, buffer);
+
+	if ((rpc_version >= SLURM_23_11_PROTOCOL_VERSION) &&
+	    ((type == DBD_SEND_MULT_MSG) || (type == DBD_GOT_MULT_MSG)))
+		pack32(msg->seq, buffer);
 }
 
 extern int slurmdbd_unpack_list_msg(dbd_list_msg_t **msg, uint16_t rpc_version,
@@ -1414,6 +1419,7 @@ extern int slurmdbd_unpack_list_msg(dbd_list_msg_t **msg, uint16_t rpc_version,
 		my_destroy = destroy_config_key_pair;
 		break;
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_FIX_RUNAWAY_JOB:
 		my_function = slurmdb_unpack_job_rec;
 		my_destroy = slurmdb_destroy_job_rec;
@@ -1485,6 +1491,10 @@ extern int slurmdbd_unpack_list_msg(dbd_list_msg_t **msg, uint16_t rpc_version,
 
 	safe_unpack32(&msg_ptr->return_code, buffer);
 
+	if ((rpc_version >= SLURM_23_11_PROTOCOL_VERSION) &&
+	    ((type == DBD_SEND_MULT_MSG) || (type == DBD_GOT_MULT_MSG)))
+		safe_unpack32(&msg_ptr->seq, buffer);
+
 	return SLURM_SUCCESS;
 
 unpack_error:
@@ -1527,6 +1537,7 @@ extern buf_t *pack_slurmdbd_msg(persist_msg_t *req, uint16_t rpc_version)
 	case DBD_GOT_EVENTS:
 	case DBD_GOT_FEDERATIONS:
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_GOT_LIST:
 	case DBD_GOT_PROBS:
 	case DBD_GOT_RES:
@@ -1733,6 +1744,7 @@ extern int unpack_slurmdbd_msg(persist_msg_t *resp, uint16_t rpc_version,
 	case DBD_GOT_EVENTS:
 	case DBD_GOT_FEDERATIONS:
 	case DBD_GOT_JOBS:
+	case DBD_GOT_JOBS_PART:
 	case DBD_GOT_LIST:
 	case DBD_GOT_PROBS:
 	case DBD_ADD_QOS:
@@ -382,6 +382,31 @@ rwfail:
 	return -1;
 }
 
+/*
+ * Hand a connection from the slurmstepd of a child node over to the step, so
+ * the step relays its stdio to srun.
+ */
+extern int stepd_relay_io(int fd, uint16_t protocol_version, int conn_fd,
+			  uint16_t conn_protocol_version, uid_t conn_uid)
+{
+	int req = REQUEST_IO_RELAY;
+	int rc;
+
+	safe_write(fd, &req, sizeof(int));
+	send_fd_over_pipe(fd, conn_fd);
+	safe_write(fd, &conn_protocol_version, sizeof(uint16_t));
+	safe_write(fd, &conn_uid, sizeof(uid_t));
+
+	safe_read(fd, &rc, sizeof(int));
+	if (rc != SLURM_SUCCESS)
+		errno = rc;
+
+	return rc;
+
+rwfail:
+	return SLURM_ERROR;
+}
+
 /*
  * Attach a client to a running job step.
  *
@@ -80,6 +80,7 @@ typedef enum {
 	REQUEST_GETGR,
 	REQUEST_GET_NS_FD,
 	REQUEST_GETHOST,
+	REQUEST_IO_RELAY,
 } step_msg_t;
 
 typedef enum {
@@ -334,4 +335,15 @@ extern uint32_t stepd_get_nodeid(int fd, uint16_t protocol_version);
  * On error returns -1.
  */
 extern int stepd_get_namespace_fd(int fd, uint16_t protocol_version);
+
+/*
+ * Pass conn_fd, a connection from the slurmstepd of a child node of the step
+ * (LaunchParameters=stdio_tree), to the step which will relay its stdio. The
+ * step answers the request of the child, sent with conn_protocol_version by
+ * conn_uid, itself so its answer comes before anything it relays on conn_fd.
+ * RET SLURM_SUCCESS once the step has answered, or an error code for the
+ *     caller to answer with, conn_fd is not closed
+ */
+extern int stepd_relay_io(int fd, uint16_t protocol_version, int conn_fd,
+			  uint16_t conn_protocol_version, uid_t conn_uid);
 #endif /* _STEPD_API_H */
@@ -0,0 +1,162 @@
+/*****************************************************************************\
+ *  str_intern.c - reference counted shared strings
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <pthread.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "src/common/macros.h"
+#include "src/common/str_intern.h"
+#include "src/common/xassert.h"
+#include "src/common/xhash.h"
+#include "src/common/xmalloc.h"
+
+#define STR_INTERN_MAGIC 0x5eed1e55
+
+typedef struct {
+	int magic;		/* STR_INTERN_MAGIC */
+	uint32_t refcnt;
+	uint32_t len;
+	char str[];
+} intern_ent_t;
+
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+static xhash_t *intern_table = NULL;
+static str_intern_stats_t intern_stats = { 0 };
+
+static void _ent_identity(void *item, const char **key, uint32_t *key_len)
+{
+	intern_ent_t *ent = item;
+
+	*key = ent->str;
+	*key_len = ent->len;
+}
+
+static void _ent_free(void *item)
+{
+	intern_ent_t *ent = item;
+
+	ent->magic = ~STR_INTERN_MAGIC;
+	xfree(ent);
+}
+
+static intern_ent_t *_str_to_ent(char *str)
+{
+	intern_ent_t *ent = (intern_ent_t *) (str - offsetof(intern_ent_t, str));
+
+	xassert(ent->magic == STR_INTERN_MAGIC);
+
+	return ent;
+}
+
+extern char *str_intern(const char *str)
+{
+	intern_ent_t *ent;
+	uint32_t len;
+
+	if (!str)
+		return NULL;
+
+	len = strlen(str);
+
+	slurm_mutex_lock(&intern_lock);
+	if (!intern_table)
+		intern_table = xhash_init(_ent_identity, _ent_free);
+
+	if ((ent = xhash_get(intern_table, str, len))) {
+		ent->refcnt++;
+		intern_stats.bytes_saved += len + 1;
+	} else {
+		ent = xmalloc_nz(sizeof(*ent) + len + 1);
+		ent->magic = STR_INTERN_MAGIC;
+		ent->refcnt = 1;
+		ent->len = len;
+		memcpy(ent->str, str, len + 1);
+		xhash_add(intern_table, ent);
+		intern_stats.strings++;
+		intern_stats.bytes += sizeof(*ent) + len + 1;
+	}
+	intern_stats.refs++;
+	slurm_mutex_unlock(&intern_lock);
+
+	return ent->str;
+}
+
+extern char *str_intern_ref(char *str)
+{
+	intern_ent_t *ent;
+
+	if (!str)
+		return NULL;
+
+	ent = _str_to_ent(str);
+
+	slurm_mutex_lock(&intern_lock);
+	ent->refcnt++;
+	intern_stats.refs++;
+	intern_stats.bytes_saved += ent->len + 1;
+	slurm_mutex_unlock(&intern_lock);
+
+	return str;
+}
+
+extern void str_intern_free(char *str)
+{
+	intern_ent_t *ent;
+
+	if (!str)
+		return;
+
+	ent = _str_to_ent(str);
+
+	slurm_mutex_lock(&intern_lock);
+	xassert(ent->refcnt);
+	intern_stats.refs--;
+	if (--ent->refcnt) {
+		intern_stats.bytes_saved -= ent->len + 1;
+	} else {
+		intern_stats.strings--;
+		intern_stats.bytes -= sizeof(*ent) + ent->len + 1;
+		xhash_delete(intern_table, ent->str, ent->len);
+	}
+	slurm_mutex_unlock(&intern_lock);
+}
+
+extern void str_intern_get_stats(str_intern_stats_t *stats)
+{
+	slurm_mutex_lock(&intern_lock);
+	*stats = intern_stats;
+	slurm_mutex_unlock(&intern_lock);
+}
@@ -0,0 +1,80 @@
+/*****************************************************************************\
+ *  str_intern.h - reference counted shared strings
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURM_STR_INTERN_H
+#define _SLURM_STR_INTERN_H
+
+#include <inttypes.h>
+
+/*
+ * Interned strings are immutable, reference counted copies shared by every
+ * holder of an equal string, e.g. the partition, account or user name of
+ * thousands of job records. They are read like any other string but must
+ * only be released with xfree_intern() and must never be modified in place.
+ *
+ * The intern table is thread safe.
+ */
+
+typedef struct {
+	uint32_t strings;	/* distinct strings held */
+	uint64_t refs;		/* references to those strings */
+	uint64_t bytes;		/* memory used by the strings */
+	uint64_t bytes_saved;	/* memory separate copies would add */
+} str_intern_stats_t;
+
+/*
+ * RET a reference to the interned copy of str, NULL if str is NULL
+ */
+extern char *str_intern(const char *str);
+
+/*
+ * RET another reference to str, which must be interned or NULL
+ */
+extern char *str_intern_ref(char *str);
+
+/*
+ * Release a reference obtained from str_intern() or str_intern_ref()
+ */
+extern void str_intern_free(char *str);
+
+#define xfree_intern(__p)		\
+	do {				\
+		str_intern_free(__p);	\
+		__p = NULL;		\
+	} while (0)
+
+extern void str_intern_get_stats(str_intern_stats_t *stats);
+
+#endif
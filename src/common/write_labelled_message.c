@@ -37,10 +37,14 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#define _GNU_SOURCE	/* for IOV_MAX */
+
+#include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdio.h>
-#include <errno.h>
 #include <string.h>
+#include <sys/uio.h>
 
 #include "src/common/write_labelled_message.h"
 #include "slurm/slurm_errno.h"
@@ -48,10 +52,14 @@
 #include "src/common/xmalloc.h"
 #include "src/common/xstring.h"
 
+#ifndef IOV_MAX
+#  define IOV_MAX 16
+#endif
+
 static char *_build_label(int task_id, int task_id_width,
 			  uint32_t het_job_offset,
 			  uint32_t het_job_task_offset);
-static int _write_line(int fd, char *prefix, char *suffix, void *buf, int len);
+static int _write_iov(int fd, struct iovec *iov, int iovcnt);
 
 /*
  * fd             is the file descriptor to write to
@@ -77,49 +85,79 @@ extern int write_labelled_message(int fd, void *buf, int len, int task_id,
 				  uint32_t het_job_task_offset,
 				  bool label, int task_id_width)
 {
+	struct iovec iov[IOV_MAX];
 	void *start, *end;
-	char *prefix = NULL, *suffix = NULL;
+	char *prefix = NULL;
+	int prefix_len;
 	int remaining = len;
-	int written = 0;
-	int line_len;
-	int rc = -1;
+	int offset = 0, written = 0;
+	int iovcnt = 0, batch_len = 0;
+	int line_len, out_len;
+
+	if (len <= 0)
+		return -1;
 
-	if (label) {
-		prefix = _build_label(task_id, task_id_width, het_job_offset,
-				      het_job_task_offset);
+	if (!label) {
+		iov[0].iov_base = buf;
+		iov[0].iov_len = len;
+		if (_write_iov(fd, iov, 1))
+			return -1;
+		return len;
 	}
 
+	prefix = _build_label(task_id, task_id_width, het_job_offset,
+			      het_job_task_offset);
+	prefix_len = strlen(prefix);
+
+	/*
+	 * Point the iovecs at the label and the lines in place rather than
+	 * copying them, and write as many lines as fit in PIPE_BUF bytes per
+	 * writev().
+	 */
 	while (remaining > 0) {
-		start = buf + written;
+		start = buf + offset;
 		end = memchr(start, '\n', remaining);
-		if (end == NULL) { /* no newline found */
-			if (label)
-				suffix = "\n";
-			rc = _write_line(fd, prefix, suffix, start, remaining);
-			if (rc <= 0) {
-				goto done;
-			} else {
-				remaining -= rc;
-				written += rc;
-			}
-		} else {
+		if (end)
 			line_len = (int)(end - start) + 1;
-			rc = _write_line(fd, prefix, suffix, start, line_len);
-			if (rc <= 0) {
-				goto done;
-			} else {
-				remaining -= rc;
-				written += rc;
-			}
+		else
+			line_len = remaining;
+		out_len = prefix_len + line_len + (end ? 0 : 1);
+
+		if (iovcnt && ((batch_len + out_len) > PIPE_BUF)) {
+			if (_write_iov(fd, iov, iovcnt))
+				break;
+			written = offset;
+			iovcnt = 0;
+			batch_len = 0;
 		}
 
+		iov[iovcnt].iov_base = prefix;
+		iov[iovcnt++].iov_len = prefix_len;
+		iov[iovcnt].iov_base = start;
+		iov[iovcnt++].iov_len = line_len;
+		if (!end) { /* no newline found */
+			iov[iovcnt].iov_base = "\n";
+			iov[iovcnt++].iov_len = 1;
+		}
+
+		offset += line_len;
+		remaining -= line_len;
+		batch_len += out_len;
+
+		if (!remaining || (iovcnt > (IOV_MAX - 3))) {
+			if (_write_iov(fd, iov, iovcnt))
+				break;
+			written = offset;
+			iovcnt = 0;
+			batch_len = 0;
+		}
 	}
-done:
+
 	xfree(prefix);
 	if (written > 0)
 		return written;
 	else
-		return rc;
+		return -1;
 }
 
 /*
@@ -149,49 +187,39 @@ static char *_build_label(int task_id, int task_id_width,
 /*
  * Blocks until write is complete, regardless of the file descriptor being in
  * non-blocking mode.
- * I/O from multiple hetjob components may be present, so add prefix/suffix to
- * buffer before issuing write to avoid interleaved output from multiple
- * components.
+ * I/O from multiple hetjob components may be present, so each labelled line
+ * is written with its prefix/suffix in the same writev(). Callers keep a
+ * writev() to PIPE_BUF bytes, which a pipe writes without interleaving output
+ * from multiple components. A single line longer than that can still be
+ * interleaved.
+ * RET 0 on success, -1 on error
  */
-static int _write_line(int fd, char *prefix, char *suffix, void *buf, int len)
+static int _write_iov(int fd, struct iovec *iov, int iovcnt)
 {
-	int left, n, pre = 0, post = 0;
-	void *ptr, *tmp = NULL;
-
-	if (prefix || suffix) {
-		if (prefix)
-			pre = strlen(prefix);
-		if (suffix)
-			post = strlen(suffix);
-		tmp = xmalloc(pre + len + post);
-		if (prefix)
-			memcpy(tmp, prefix, pre);
-		memcpy(tmp + pre, buf, len);
-		if (suffix)
-			memcpy(tmp + pre + len, suffix, post);
-		ptr = tmp;
-		left = pre + len + post;
-	} else {
-		ptr = buf;
-		left = len;
-	}
+	ssize_t n;
 
-	while (left > 0) {
-	again:
-		if ((n = write(fd, ptr, left)) < 0) {
+	while (iovcnt > 0) {
+		if ((n = writev(fd, iov, iovcnt)) < 0) {
 			if (errno == EINTR)
-				goto again;
+				continue;
 			if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
-				debug3("  got EAGAIN in _write_line");
-				goto again;
+				debug3("  got EAGAIN in %s", __func__);
+				continue;
 			}
-			len = -1;
-			break;
+			return -1;
+		}
+
+		/* Skip what was written, resuming within a partial iovec */
+		while (iovcnt && (n >= iov->iov_len)) {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt) {
+			iov->iov_base += n;
+			iov->iov_len -= n;
 		}
-		left -= n;
-		ptr += n;
 	}
-	xfree(tmp);
 
-	return len;
+	return 0;
 }
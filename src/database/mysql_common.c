@@ -790,6 +790,7 @@ extern int destroy_mysql_conn(mysql_conn_t *mysql_conn)
 {
 	if (mysql_conn) {
 		mysql_db_close_db_connection(mysql_conn);
+		xfree(mysql_conn->batch_query);
 		xfree(mysql_conn->pre_commit_query);
 		xfree(mysql_conn->cluster_name);
 		slurm_mutex_destroy(&mysql_conn->lock);
@@ -1087,6 +1088,33 @@ fini:
 	return result;
 }
 
+/*
+ * Like mysql_db_query_ret() but rows are only read from the server as they are
+ * fetched, so a large result doesn't have to fit in memory. The result must be
+ * freed before the next query on this connection.
+ */
+extern MYSQL_RES *mysql_db_query_use(mysql_conn_t *mysql_conn, char *query)
+{
+	MYSQL_RES *result = NULL;
+
+	slurm_mutex_lock(&mysql_conn->lock);
+	if (_mysql_query_internal(mysql_conn->db_conn, query) != SLURM_ERROR)  {
+		if (mysql_errno(mysql_conn->db_conn) == ER_NO_SUCH_TABLE)
+			goto fini;
+		result = mysql_use_result(mysql_conn->db_conn);
+		errno = 0;
+		if (!result && mysql_field_count(mysql_conn->db_conn)) {
+			/* should have returned data */
+			error("We should have gotten a result: '%m' '%s'",
+			      mysql_error(mysql_conn->db_conn));
+		}
+	}
+
+fini:
+	slurm_mutex_unlock(&mysql_conn->lock);
+	return result;
+}
+
 extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query)
 {
 	int rc = SLURM_SUCCESS;
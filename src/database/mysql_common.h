@@ -59,6 +59,11 @@ typedef enum {
 } slurm_mysql_plugin_type_t;
 
 typedef struct {
+	bool batch;		/* queue rows in batch_query */
+	char *batch_query;	/* queued rows, written when flushed */
+	uint32_t batch_rows;	/* count of rows in batch_query */
+	int batch_type;		/* what kind of rows are in batch_query */
+	int batch_rc;		/* first error writing batch_query */
 	char *cluster_name;
 	MYSQL *db_conn;
 	uint32_t flags;
@@ -100,6 +105,7 @@ extern int mysql_db_rollback(mysql_conn_t *mysql_conn);
 
 extern MYSQL_RES *mysql_db_query_ret(mysql_conn_t *mysql_conn,
 				     char *query, bool last);
+extern MYSQL_RES *mysql_db_query_use(mysql_conn_t *mysql_conn, char *query);
 extern int mysql_db_query_check_after(mysql_conn_t *mysql_conn, char *query);
 
 extern uint64_t mysql_db_insert_ret_id(mysql_conn_t *mysql_conn, char *query);
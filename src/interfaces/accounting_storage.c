@@ -195,9 +195,13 @@ typedef struct slurm_acct_storage_ops {
 	int  (*job_complete)       (void *db_conn, job_record_t *job_ptr);
 	int  (*step_start)         (void *db_conn, step_record_t *step_ptr);
 	int  (*step_complete)      (void *db_conn, step_record_t *step_ptr);
+	int  (*step_batch)         (void *db_conn, bool enable);
 	int  (*job_suspend)        (void *db_conn, job_record_t *job_ptr);
 	List (*get_jobs_cond)      (void *db_conn, uint32_t uid,
 				    slurmdb_job_cond_t *job_cond);
+	int  (*get_jobs_cond_parts)(void *db_conn, uint32_t uid,
+				    slurmdb_job_cond_t *job_cond,
+				    ListForF f, void *arg);
 	int (*archive_dump)        (void *db_conn,
 				    slurmdb_archive_cond_t *arch_cond);
 	int (*archive_load)        (void *db_conn,
@@ -286,8 +290,10 @@ static const char *syms[] = {
 	"jobacct_storage_p_job_complete",
 	"jobacct_storage_p_step_start",
 	"jobacct_storage_p_step_complete",
+	"jobacct_storage_p_step_batch",
 	"jobacct_storage_p_suspend",
 	"jobacct_storage_p_get_jobs_cond",
+	"jobacct_storage_p_get_jobs_cond_parts",
 	"jobacct_storage_p_archive",
 	"jobacct_storage_p_archive_load",
 	"acct_storage_p_update_shares_used",
@@ -1160,6 +1166,21 @@ extern int jobacct_storage_g_step_complete(void *db_conn,
 	return (*(ops.step_complete))(db_conn, step_ptr);
 }
 
+/*
+ * queue job steps given to jobacct_storage_g_step_start() and
+ * jobacct_storage_g_step_complete() and write them in as few queries as
+ * possible
+ */
+extern int jobacct_storage_g_step_batch(void *db_conn, bool enable)
+{
+	xassert(plugin_inited);
+
+	if (plugin_inited == PLUGIN_NOOP)
+		return SLURM_SUCCESS;
+
+	return (*(ops.step_batch))(db_conn, enable);
+}
+
 /*
  * load into the storage a suspension of a job
  */
@@ -1216,6 +1237,25 @@ extern List jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 	return ret_list;
 }
 
+/*
+ * get info from the storage one part at a time
+ * IN:  f - called with each List of slurmdb_job_rec_t * as it is read, the
+ *      List is freed when f returns. A negative return stops the query.
+ * RET: SLURM_SUCCESS on success, else error code with errno set
+ */
+extern int jobacct_storage_g_get_jobs_cond_parts(void *db_conn, uint32_t uid,
+						 slurmdb_job_cond_t *job_cond,
+						 ListForF f, void *arg)
+{
+	xassert(plugin_inited);
+	xassert(f);
+
+	if (plugin_inited == PLUGIN_NOOP)
+		return SLURM_SUCCESS;
+
+	return (*(ops.get_jobs_cond_parts))(db_conn, uid, job_cond, f, arg);
+}
+
 /*
  * expire old info from the storage
  */
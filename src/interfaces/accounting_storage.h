@@ -673,6 +673,17 @@ extern int jobacct_storage_g_step_start(void *db_conn,
 extern int jobacct_storage_g_step_complete(void *db_conn,
 					   step_record_t *step_ptr);
 
+/*
+ * queue job steps given to jobacct_storage_g_step_start() and
+ * jobacct_storage_g_step_complete() and write them in as few queries as
+ * possible
+ * IN enable - true to start queueing, false to write out anything queued
+ *             and stop queueing
+ * RET: SLURM_SUCCESS on success, error code otherwise. On error none of the
+ *      queued steps can be assumed written.
+ */
+extern int jobacct_storage_g_step_batch(void *db_conn, bool enable);
+
 /*
  * load into the storage a suspension of a job
  */
@@ -687,6 +698,16 @@ extern int jobacct_storage_g_job_suspend(void *db_conn,
 extern List jobacct_storage_g_get_jobs_cond(void *db_conn, uint32_t uid,
 					    slurmdb_job_cond_t *job_cond);
 
+/*
+ * get info from the storage one part at a time
+ * IN:  f - called with each List of slurmdb_job_rec_t * as it is read, the
+ *      List is freed when f returns. A negative return stops the query.
+ * RET: SLURM_SUCCESS on success, else error code with errno set
+ */
+extern int jobacct_storage_g_get_jobs_cond_parts(void *db_conn, uint32_t uid,
+						 slurmdb_job_cond_t *job_cond,
+						 ListForF f, void *arg);
+
 /*
  * expire old info from the storage
  */
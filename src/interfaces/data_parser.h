@@ -206,6 +206,8 @@ typedef enum {
 	DATA_PARSER_STATS_MSG_BF_ACTIVE, /* stats_info_response_msg_t-> computed bool */
 	DATA_PARSER_STATS_MSG_RPCS_BY_TYPE, /* stats_info_response_msg_t-> computed bool */
 	DATA_PARSER_STATS_MSG_RPCS_BY_USER, /* stats_info_response_msg_t-> computed bool */
+	DATA_PARSER_STATS_MSG_FWD_BY_TYPE, /* stats_info_response_msg_t-> computed array */
+	DATA_PARSER_STATS_MSG_AGENT_BY_TYPE, /* stats_info_response_msg_t-> computed array */
 	DATA_PARSER_CONTROLLER_PING, /* controller_ping_t */
 	DATA_PARSER_CONTROLLER_PING_ARRAY, /* controller_ping_t (NULL terminated array) */
 	DATA_PARSER_OPENAPI_PING_ARRAY_RESP, /* openapi_resp_single_t */
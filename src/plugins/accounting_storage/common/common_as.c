@@ -36,12 +36,17 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <arpa/inet.h>
 #include <fcntl.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#if HAVE_LZ4
+#  include <lz4.h>
+#endif
+
 #include "src/common/env.h"
 #include "src/common/slurmdbd_defs.h"
 #include "src/interfaces/auth.h"
@@ -66,6 +71,13 @@ extern char *wckey_month_table;
 extern __thread bool drop_priv;
 #endif
 
+#define ARCHIVE_CHUNK_MAGIC 0x534c4152 /* "SLAR" */
+/* magic, compression, size and size of the data as stored */
+#define ARCHIVE_CHUNK_HEADER_SIZE (sizeof(uint32_t) * 3 + sizeof(uint16_t))
+
+#define ARCHIVE_COMPRESS_NONE 0
+#define ARCHIVE_COMPRESS_LZ4 1
+
 /*
  * We want SLURMDB_MODIFY_ASSOC always to be the last
  */
@@ -884,48 +896,196 @@ static char *_make_archive_name(time_t period_start, time_t period_end,
 	return fullname;
 }
 
-extern int archive_write_file(buf_t *buffer, char *cluster_name,
-			      time_t period_start, time_t period_end,
-			      char *arch_dir, char *arch_type,
-			      uint32_t archive_period)
+struct archive_file {
+	int fd;
+	char *name;
+};
+
+extern archive_file_t *archive_file_create(char *cluster_name,
+					   time_t period_start,
+					   time_t period_end,
+					   char *arch_dir, char *arch_type,
+					   uint32_t archive_period)
 {
-	int fd = 0;
-	int rc = SLURM_SUCCESS;
-	char *new_file = NULL;
+	archive_file_t *arch_file = xmalloc(sizeof(*arch_file));
 	static pthread_mutex_t local_file_lock = PTHREAD_MUTEX_INITIALIZER;
 
-	xassert(buffer);
-
+	/* hold the lock until the file exists so its name stays unique */
 	slurm_mutex_lock(&local_file_lock);
-
-	/* write the buffer to file */
-	new_file = _make_archive_name(period_start, period_end,
-				      cluster_name, arch_dir,
-				      arch_type, archive_period);
+	arch_file->name = _make_archive_name(period_start, period_end,
+					     cluster_name, arch_dir,
+					     arch_type, archive_period);
 
 	debug("Storing %s archive for %s at %s",
-	      arch_type, cluster_name, new_file);
+	      arch_type, cluster_name, arch_file->name);
 
-	fd = creat(new_file, 0600);
-	if (fd < 0) {
-		error("Can't save archive, create file %s error %m", new_file);
+	arch_file->fd = creat(arch_file->name, 0600);
+	slurm_mutex_unlock(&local_file_lock);
+
+	if (arch_file->fd < 0) {
+		error("Can't save archive, create file %s error %m",
+		      arch_file->name);
+		xfree(arch_file->name);
+		xfree(arch_file);
+	}
+
+	return arch_file;
+}
+
+extern int archive_file_write(archive_file_t *arch_file, buf_t *buffer)
+{
+	buf_t *header_buf;
+	char *data = get_buf_data(buffer), *comp_data = NULL;
+	uint32_t size = get_buf_offset(buffer), data_size = size;
+	uint16_t compress = ARCHIVE_COMPRESS_NONE;
+
+	xassert(arch_file);
+
+#if HAVE_LZ4
+	if (size <= LZ4_MAX_INPUT_SIZE) {
+		int bound = LZ4_compressBound(size), comp_size;
+
+		comp_data = xmalloc_nz(bound);
+		comp_size = LZ4_compress_default(data, comp_data, size, bound);
+		/* keep it as is if it doesn't get any smaller */
+		if ((comp_size > 0) && (comp_size < size)) {
+			compress = ARCHIVE_COMPRESS_LZ4;
+			data = comp_data;
+			data_size = comp_size;
+		}
+	}
+#endif
+
+	header_buf = init_buf(ARCHIVE_CHUNK_HEADER_SIZE);
+	pack32(ARCHIVE_CHUNK_MAGIC, header_buf);
+	pack16(compress, header_buf);
+	pack32(size, header_buf);
+	pack32(data_size, header_buf);
+
+	safe_write(arch_file->fd, get_buf_data(header_buf),
+		   get_buf_offset(header_buf));
+	safe_write(arch_file->fd, data, data_size);
+
+	FREE_NULL_BUFFER(header_buf);
+	xfree(comp_data);
+	return SLURM_SUCCESS;
+
+rwfail:
+	error("Error writing file %s, %m", arch_file->name);
+	FREE_NULL_BUFFER(header_buf);
+	xfree(comp_data);
+	return SLURM_ERROR;
+}
+
+extern int archive_file_close(archive_file_t *arch_file, bool keep)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (!arch_file)
+		return rc;
+
+	if (keep && fsync(arch_file->fd)) {
+		error("Error writing file %s, %m", arch_file->name);
 		rc = SLURM_ERROR;
-	} else {
-		safe_write(fd, get_buf_data(buffer), get_buf_offset(buffer));
-		fsync(fd);
-		close(fd);
 	}
+	close(arch_file->fd);
 
-	xfree(new_file);
-	slurm_mutex_unlock(&local_file_lock);
+	if ((!keep || rc) && unlink(arch_file->name))
+		error("Can't remove incomplete archive %s, %m",
+		      arch_file->name);
 
+	xfree(arch_file->name);
+	xfree(arch_file);
 	return rc;
+}
 
-rwfail:
-	error("Error writing file %s, %m", new_file);
-	close(fd);
-	xfree(new_file);
-	slurm_mutex_unlock(&local_file_lock);
+extern bool archive_file_is_chunked(int fd)
+{
+	char header[sizeof(uint32_t)];
+	uint32_t magic;
+
+	if (pread(fd, header, sizeof(header), 0) != sizeof(header))
+		return false;
+
+	memcpy(&magic, header, sizeof(magic));
+	return (ntohl(magic) == ARCHIVE_CHUNK_MAGIC);
+}
+
+extern int archive_file_read(int fd, char **data, uint32_t *size)
+{
+	char *header = xmalloc(ARCHIVE_CHUNK_HEADER_SIZE), *comp_data = NULL;
+	buf_t *header_buf = NULL;
+	uint32_t magic = 0, data_size = 0;
+	uint16_t compress = 0;
+	int len;
+
+	*data = NULL;
+	*size = 0;
+
+	/* a clean end of file may only come between chunks */
+	while ((len = read(fd, header, ARCHIVE_CHUNK_HEADER_SIZE)) < 0) {
+		if ((errno != EINTR) && (errno != EAGAIN))
+			goto rwfail;
+	}
+	if (!len) {
+		xfree(header);
+		return SLURM_SUCCESS;
+	} else if (len < ARCHIVE_CHUNK_HEADER_SIZE) {
+		safe_read(fd, header + len, ARCHIVE_CHUNK_HEADER_SIZE - len);
+	}
 
+	header_buf = create_buf(header, ARCHIVE_CHUNK_HEADER_SIZE);
+	header = NULL; /* owned by header_buf now */
+	safe_unpack32(&magic, header_buf);
+	safe_unpack16(&compress, header_buf);
+	safe_unpack32(size, header_buf);
+	safe_unpack32(&data_size, header_buf);
+	FREE_NULL_BUFFER(header_buf);
+
+	if ((magic != ARCHIVE_CHUNK_MAGIC) || (*size > MAX_BUF_SIZE) ||
+	    (data_size > MAX_BUF_SIZE) ||
+	    ((compress == ARCHIVE_COMPRESS_NONE) && (data_size != *size))) {
+		error("%s: invalid archive chunk", __func__);
+		return SLURM_ERROR;
+	}
+
+	switch (compress) {
+	case ARCHIVE_COMPRESS_NONE:
+		*data = xmalloc_nz(*size);
+		safe_read(fd, *data, *size);
+		break;
+#if HAVE_LZ4
+	case ARCHIVE_COMPRESS_LZ4:
+		comp_data = xmalloc_nz(data_size);
+		safe_read(fd, comp_data, data_size);
+		*data = xmalloc_nz(*size);
+		if (LZ4_decompress_safe(comp_data, *data, data_size,
+					*size) != *size) {
+			error("%s: lz4 decompression error", __func__);
+			xfree(comp_data);
+			xfree(*data);
+			return SLURM_ERROR;
+		}
+		xfree(comp_data);
+		break;
+#endif
+	default:
+		error("%s: archive chunk compressed with unsupported type %hu",
+		      __func__, compress);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+
+unpack_error:
+	FREE_NULL_BUFFER(header_buf);
+	error("%s: invalid archive chunk", __func__);
+	return SLURM_ERROR;
+rwfail:
+	error("%s: error reading archive, %m", __func__);
+	FREE_NULL_BUFFER(header_buf);
+	xfree(header);
+	xfree(comp_data);
+	xfree(*data);
 	return SLURM_ERROR;
 }
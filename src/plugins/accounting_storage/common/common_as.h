@@ -75,9 +75,38 @@ extern char* acct_get_db_name(void);
 extern time_t archive_setup_end_time(time_t last_submit, uint32_t purge);
 extern int archive_run_script(slurmdb_archive_cond_t *arch_cond,
 			      char *cluster_name, time_t last_submit);
-extern int archive_write_file(buf_t *buffer, char *cluster_name,
-			      time_t period_start, time_t period_end,
-			      char *arch_dir, char *arch_type,
-			      uint32_t archive_period);
+
+/*
+ * Archive files are a series of chunks, each one a complete archive buffer
+ * (header and records) compressed with lz4 when available, so they can be
+ * written and loaded a bounded number of records at a time.
+ */
+typedef struct archive_file archive_file_t;
+
+/* Create a new archive file named after the period and type archived */
+extern archive_file_t *archive_file_create(char *cluster_name,
+					   time_t period_start,
+					   time_t period_end,
+					   char *arch_dir, char *arch_type,
+					   uint32_t archive_period);
+
+/* Append the archive buffer to the file as a new chunk */
+extern int archive_file_write(archive_file_t *arch_file, buf_t *buffer);
+
+/*
+ * Sync and close the file, removing it unless keep is set.
+ * RET SLURM_SUCCESS or SLURM_ERROR if the file could not be synced
+ */
+extern int archive_file_close(archive_file_t *arch_file, bool keep);
+
+/* RET true if the file open on fd is a chunked archive file */
+extern bool archive_file_is_chunked(int fd);
+
+/*
+ * Read the next chunk of a chunked archive file open on fd.
+ * OUT data - xmalloc'ed uncompressed archive buffer, NULL at the end of file
+ * OUT size - size of data
+ */
+extern int archive_file_read(int fd, char **data, uint32_t *size);
 
 #endif
@@ -3670,6 +3670,14 @@ extern int jobacct_storage_p_step_complete(mysql_conn_t *mysql_conn,
 	return as_mysql_step_complete(mysql_conn, step_ptr);
 }
 
+/*
+ * queue job steps and write them in as few queries as possible
+ */
+extern int jobacct_storage_p_step_batch(mysql_conn_t *mysql_conn, bool enable)
+{
+	return as_mysql_step_batch(mysql_conn, enable);
+}
+
 /*
  * load into the storage a suspension of a job
  */
@@ -3698,6 +3706,21 @@ extern List jobacct_storage_p_get_jobs_cond(mysql_conn_t *mysql_conn,
 	return job_list;
 }
 
+/*
+ * get info from the storage one part at a time
+ */
+extern int jobacct_storage_p_get_jobs_cond_parts(mysql_conn_t *mysql_conn,
+						 uid_t uid,
+						 slurmdb_job_cond_t *job_cond,
+						 ListForF f, void *arg)
+{
+	if (check_connection(mysql_conn) != SLURM_SUCCESS)
+		return ESLURM_DB_CONNECTION;
+
+	return as_mysql_jobacct_process_get_jobs_parts(mysql_conn, uid,
+						       job_cond, f, arg);
+}
+
 /*
  * expire old info from the storage
  */
@@ -72,6 +72,11 @@
 					       this then archive by month to
 					       handle large datasets. */
 
+#define ARCHIVE_CHUNK_LIMIT 5000 /* Number of records archived per chunk of
+				    the archive file. */
+#define MAX_PURGE_BATCH 5000 /* Number of records deleted per transaction
+				when purging. */
+
 #ifndef RECORDS_PER_PASS
 #define RECORDS_PER_PASS 1000	/* Records per single sql statement. */
 #endif /* RECORDS_PER_PASS */
@@ -3283,12 +3288,39 @@ static char *_get_archive_columns(purge_type_t type)
 }
 
 
+/*
+ * Fetch the next row to archive, unless max rows were fetched already, and
+ * count it in rec_cnt.
+ */
+static MYSQL_ROW _fetch_archive_row(MYSQL_RES *result, uint32_t *rec_cnt,
+				    uint32_t max)
+{
+	MYSQL_ROW row;
+
+	if ((*rec_cnt >= max) || !(row = mysql_fetch_row(result)))
+		return NULL;
+
+	(*rec_cnt)++;
+	return row;
+}
+
+/* Set the record count packed at offset to the number of rows packed */
+static void _pack_archive_cnt(buf_t *buffer, uint32_t offset, uint32_t cnt)
+{
+	uint32_t end = get_buf_offset(buffer);
+
+	set_buf_offset(buffer, offset);
+	pack32(cnt, buffer);
+	set_buf_offset(buffer, end);
+}
+
 static buf_t *_pack_archive_events(MYSQL_RES *result, char *cluster_name,
-				   uint32_t cnt, uint32_t usage_info,
+				   uint32_t *cnt, uint32_t usage_info,
 				   time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_event_t event;
 
 	buffer = init_buf(high_buffer_size);
@@ -3296,9 +3328,10 @@ static buf_t *_pack_archive_events(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_EVENTS, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[EVENT_REQ_START]);
 
@@ -3316,6 +3349,9 @@ static buf_t *_pack_archive_events(MYSQL_RES *result, char *cluster_name,
 		_pack_local_event(&event, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -3371,11 +3407,12 @@ static char *_load_events(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_jobs(MYSQL_RES *result, char *cluster_name,
-				 uint32_t cnt, uint32_t usage_info,
+				 uint32_t *cnt, uint32_t usage_info,
 				 time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_job_t job;
 
 	buffer = init_buf(high_buffer_size);
@@ -3383,9 +3420,10 @@ static buf_t *_pack_archive_jobs(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_JOBS, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[JOB_REQ_SUBMIT]);
 
@@ -3450,6 +3488,9 @@ static buf_t *_pack_archive_jobs(MYSQL_RES *result, char *cluster_name,
 		_pack_local_job(&job, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -3699,11 +3740,12 @@ static char *_load_jobs(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_job_env(MYSQL_RES *result, char *cluster_name,
-				    uint32_t cnt, uint32_t usage_info,
+				    uint32_t *cnt, uint32_t usage_info,
 				    time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_job_env_t job;
 
 	buffer = init_buf(high_buffer_size);
@@ -3711,9 +3753,10 @@ static buf_t *_pack_archive_job_env(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_JOB_ENV, buffer); // FIXME
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			error("period_start should already be set");
 
@@ -3727,6 +3770,9 @@ static buf_t *_pack_archive_job_env(MYSQL_RES *result, char *cluster_name,
 		_pack_local_job_env(&job, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -3807,11 +3853,12 @@ static char *_load_job_env(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_job_script(MYSQL_RES *result, char *cluster_name,
-				       uint32_t cnt, uint32_t usage_info,
+				       uint32_t *cnt, uint32_t usage_info,
 				       time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_job_script_t job;
 
 	buffer = init_buf(high_buffer_size);
@@ -3819,9 +3866,10 @@ static buf_t *_pack_archive_job_script(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_JOB_SCRIPT, buffer); //FIXME
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			error("period_start should already be set");
 
@@ -3835,6 +3883,9 @@ static buf_t *_pack_archive_job_script(MYSQL_RES *result, char *cluster_name,
 		_pack_local_job_script(&job, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -3917,11 +3968,12 @@ static char *_load_job_script(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_resvs(MYSQL_RES *result, char *cluster_name,
-				  uint32_t cnt, uint32_t usage_info,
+				  uint32_t *cnt, uint32_t usage_info,
 				  time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_resv_t resv;
 
 	buffer = init_buf(high_buffer_size);
@@ -3929,9 +3981,10 @@ static buf_t *_pack_archive_resvs(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_RESVS, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[RESV_REQ_START]);
 
@@ -3953,6 +4006,9 @@ static buf_t *_pack_archive_resvs(MYSQL_RES *result, char *cluster_name,
 		_pack_local_resv(&resv, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -4050,11 +4106,12 @@ static char *_load_resvs(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_steps(MYSQL_RES *result, char *cluster_name,
-				  uint32_t cnt, uint32_t usage_info,
+				  uint32_t *cnt, uint32_t usage_info,
 				  time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_step_t step;
 
 	buffer = init_buf(high_buffer_size);
@@ -4062,9 +4119,10 @@ static buf_t *_pack_archive_steps(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_STEP_START, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[STEP_REQ_START]);
 
@@ -4126,6 +4184,9 @@ static buf_t *_pack_archive_steps(MYSQL_RES *result, char *cluster_name,
 		_pack_local_step(&step, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -4301,11 +4362,12 @@ static char *_load_steps(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_suspends(MYSQL_RES *result, char *cluster_name,
-				     uint32_t cnt, uint32_t usage_info,
+				     uint32_t *cnt, uint32_t usage_info,
 				     time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_suspend_t suspend;
 
 	buffer = init_buf(high_buffer_size);
@@ -4313,9 +4375,10 @@ static buf_t *_pack_archive_suspends(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_JOB_SUSPEND, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[SUSPEND_REQ_START]);
 
@@ -4329,6 +4392,9 @@ static buf_t *_pack_archive_suspends(MYSQL_RES *result, char *cluster_name,
 		_pack_local_suspend(&suspend, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -4380,11 +4446,12 @@ static char *_load_suspend(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_txns(MYSQL_RES *result, char *cluster_name,
-				 uint32_t cnt, uint32_t usage_info,
+				 uint32_t *cnt, uint32_t usage_info,
 				 time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_txn_t txn;
 
 	buffer = init_buf(high_buffer_size);
@@ -4392,9 +4459,10 @@ static buf_t *_pack_archive_txns(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_TXN, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[TXN_REQ_TS]);
 
@@ -4411,6 +4479,9 @@ static buf_t *_pack_archive_txns(MYSQL_RES *result, char *cluster_name,
 		_pack_local_txn(&txn, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -4492,11 +4563,12 @@ static char *_load_txn(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_usage(MYSQL_RES *result, char *cluster_name,
-				  uint32_t cnt, uint32_t usage_info,
+				  uint32_t *cnt, uint32_t usage_info,
 				  time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_usage_t usage;
 	uint16_t type = usage_info & 0x0000ffff;
 	uint16_t period = usage_info >> 16;
@@ -4506,10 +4578,11 @@ static buf_t *_pack_archive_usage(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(type, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 	pack16(period, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[USAGE_START]);
 
@@ -4526,6 +4599,9 @@ static buf_t *_pack_archive_usage(MYSQL_RES *result, char *cluster_name,
 		_pack_local_usage(&usage, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -4620,11 +4696,12 @@ static char *_load_usage(uint16_t rpc_version, buf_t *buffer,
 }
 
 static buf_t *_pack_archive_cluster_usage(MYSQL_RES *result, char *cluster_name,
-					  uint32_t cnt, uint32_t usage_info,
+					  uint32_t *cnt, uint32_t usage_info,
 					  time_t *period_start)
 {
 	MYSQL_ROW row;
 	buf_t *buffer;
+	uint32_t cnt_offset, rec_cnt = 0;
 	local_cluster_usage_t usage;
 	uint16_t period = usage_info >> 16;
 
@@ -4633,10 +4710,11 @@ static buf_t *_pack_archive_cluster_usage(MYSQL_RES *result, char *cluster_name,
 	pack_time(time(NULL), buffer);
 	pack16(DBD_GOT_CLUSTER_USAGE, buffer);
 	packstr(cluster_name, buffer);
-	pack32(cnt, buffer);
+	cnt_offset = get_buf_offset(buffer);
+	pack32(*cnt, buffer);
 	pack16(period, buffer);
 
-	while ((row = mysql_fetch_row(result))) {
+	while ((row = _fetch_archive_row(result, &rec_cnt, *cnt))) {
 		if (period_start && !*period_start)
 			*period_start = slurm_atoul(row[CLUSTER_START]);
 
@@ -4658,6 +4736,9 @@ static buf_t *_pack_archive_cluster_usage(MYSQL_RES *result, char *cluster_name,
 		_pack_local_cluster_usage(&usage, buffer);
 	}
 
+	_pack_archive_cnt(buffer, cnt_offset, rec_cnt);
+	*cnt = rec_cnt;
+
 	return buffer;
 }
 
@@ -4742,11 +4823,12 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 	MYSQL_RES *result = NULL;
 	char *cols = NULL, *query = NULL, *parent_table = NULL,
 		*hash_col = NULL;
-	uint32_t cnt = 0;
+	uint32_t cnt = 0, rec_cnt;
 	buf_t *buffer;
-	int error_code = 0;
+	archive_file_t *arch_file = NULL;
+	int error_code = SLURM_SUCCESS;
 	buf_t *(*pack_func)(MYSQL_RES *result, char *cluster_name,
-			    uint32_t cnt, uint32_t usage_info,
+			    uint32_t *cnt, uint32_t usage_info,
 			    time_t *period_start);
 
 	cols = _get_archive_columns(type);
@@ -4832,26 +4914,58 @@ static uint32_t _archive_table(purge_type_t type, mysql_conn_t *mysql_conn,
 	xfree(cols);
 
 	DB_DEBUG(DB_ARCHIVE, mysql_conn->conn, "query\n%s", query);
-	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
+	if (!(result = mysql_db_query_use(mysql_conn, query))) {
 		xfree(query);
 		return SLURM_ERROR;
 	}
 	xfree(query);
 
-	if (!(cnt = mysql_num_rows(result))) {
-		mysql_free_result(result);
-		return 0;
-	}
+	/*
+	 * Stream the rows from the server into the file in chunks of
+	 * ARCHIVE_CHUNK_LIMIT records so only one chunk is ever in memory.
+	 */
+	do {
+		rec_cnt = ARCHIVE_CHUNK_LIMIT;
+		buffer = (*pack_func)(result, cluster_name, &rec_cnt,
+				      usage_info, period_start);
+		/*
+		 * With mysql_use_result() a NULL row is also how a lost
+		 * connection or server error shows up, the chunk is cut short
+		 * then and must not be taken as the end of the records.
+		 */
+		if ((rec_cnt < ARCHIVE_CHUNK_LIMIT) &&
+		    mysql_errno(mysql_conn->db_conn)) {
+			error("Couldn't read %s_%s records to archive: %d %s",
+			      cluster_name, sql_table,
+			      mysql_errno(mysql_conn->db_conn),
+			      mysql_error(mysql_conn->db_conn));
+			FREE_NULL_BUFFER(buffer);
+			error_code = SLURM_ERROR;
+			break;
+		}
+		if (!rec_cnt) {
+			FREE_NULL_BUFFER(buffer);
+			break;
+		}
+
+		/* period_start is set from the first record packed */
+		if (!arch_file &&
+		    !(arch_file = archive_file_create(cluster_name,
+						      *period_start, period_end,
+						      arch_dir, sql_table,
+						      archive_period)))
+			error_code = SLURM_ERROR;
+		else
+			error_code = archive_file_write(arch_file, buffer);
+		FREE_NULL_BUFFER(buffer);
+
+		cnt += rec_cnt;
+	} while (!error_code && (rec_cnt == ARCHIVE_CHUNK_LIMIT));
 
-	buffer = (*pack_func)(result, cluster_name, cnt, usage_info,
-			      period_start);
 	mysql_free_result(result);
 
-	error_code = archive_write_file(buffer, cluster_name,
-					*period_start, period_end,
-					arch_dir, sql_table,
-					archive_period);
-	FREE_NULL_BUFFER(buffer);
+	if (archive_file_close(arch_file, !error_code))
+		error_code = SLURM_ERROR;
 
 	if (error_code != SLURM_SUCCESS)
 		return error_code;
@@ -4971,6 +5085,39 @@ static int _purge_hash_table(mysql_conn_t *mysql_conn, char *cluster_name,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * The purge query should have the same where clause as the archive query. The
+ * order by is very important so we get records in the same order as we do when
+ * archiving, since we only want to delete records that have been archived (if
+ * archiving is enabled).
+ */
+static char *_make_purge_query(purge_type_t purge_type, char *cluster_name,
+			       char *sql_table, char *col_name, time_t end,
+			       uint32_t limit)
+{
+	switch (purge_type) {
+	case PURGE_TXN:
+		return xstrdup_printf(
+			"delete from \"%s\" where "
+			"%s <= %ld && cluster='%s' order by %s asc LIMIT %u",
+			sql_table, col_name, end, cluster_name,
+			col_name, limit);
+	case PURGE_USAGE:
+	case PURGE_CLUSTER_USAGE:
+		return xstrdup_printf(
+			"delete from \"%s_%s\" where "
+			"%s <= %ld order by %s asc LIMIT %u",
+			cluster_name, sql_table, col_name,
+			end, col_name, limit);
+	default:
+		return xstrdup_printf(
+			"delete from \"%s_%s\" where "
+			"%s <= %ld && time_end != 0 order by %s asc LIMIT %u",
+			cluster_name, sql_table, col_name,
+			end, col_name, limit);
+	}
+}
+
 /* Archive and purge a table.
  *
  * Returns SLURM_ERROR on error and SLURM_SUCCESS on success.
@@ -4986,7 +5133,7 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 	time_t   curr_end    = 0, tmp_end = 0, record_start = 0;
 	char    *query = NULL, *sql_table = NULL,
 		*col_name = NULL;
-	uint32_t tmp_archive_period;
+	uint32_t tmp_archive_period, purged, purge_limit;
 
 	switch (purge_type) {
 	case PURGE_EVENT:
@@ -5122,6 +5269,8 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 		log_flag(DB_ARCHIVE, "Purging %s_%s before %ld",
 			 cluster_name, sql_table, tmp_end);
 
+		purge_limit = MAX_PURGE_LIMIT;
+
 		/* Do archive */
 		if (SLURMDB_PURGE_ARCHIVE_SET(purge_attr)) {
 			time_t start = 0;
@@ -5137,6 +5286,13 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 			} else if (rc == SLURM_ERROR)
 				return rc;
 
+			/*
+			 * Records can show up in the range while it is
+			 * archived, only delete as many as were archived.
+			 * Both queries select the oldest records first.
+			 */
+			purge_limit = rc;
+
 			if (purge_type == PURGE_JOB) {
 				/* Archive associated data from hash tables */
 				rc = _archive_table(PURGE_JOB_ENV,
@@ -5160,63 +5316,37 @@ static int _archive_purge_table(purge_type_t purge_type, uint32_t usage_info,
 		}
 
 		/*
-		 * The purge query should have the same where clause as the
-		 * archive query. The order by is very important so we get
-		 * records in the same order as we do when archiving, since we
-		 * only want to delete records that have been archived (if
-		 * archiving is enabled).
-		 */
-		switch (purge_type) {
-		case PURGE_TXN:
-			query = xstrdup_printf(
-				"delete from \"%s\" where "
-				"%s <= %ld && cluster='%s' order by %s asc LIMIT %d",
-				sql_table, col_name, tmp_end, cluster_name,
-				col_name, MAX_PURGE_LIMIT);
-			break;
-		case PURGE_USAGE:
-		case PURGE_CLUSTER_USAGE:
-			query = xstrdup_printf(
-				"delete from \"%s_%s\" where "
-				"%s <= %ld order by %s asc LIMIT %d",
-				cluster_name, sql_table, col_name,
-				tmp_end, col_name, MAX_PURGE_LIMIT);
-			break;
-		default:
-			query = xstrdup_printf(
-				"delete from \"%s_%s\" where "
-				"%s <= %ld && time_end != 0 order by %s asc LIMIT %d",
-				cluster_name, sql_table, col_name,
-				tmp_end, col_name, MAX_PURGE_LIMIT);
-			break;
-		}
-		DB_DEBUG(DB_ARCHIVE, mysql_conn->conn, "query\n%s", query);
-
-		/*
-		 * Don't loop this query, just do it once, since we are only
-		 * archiving and purging MAX_PURGE_LIMIT rows at a time.
-		 * mysql_db_delete_affected_rows will return < 0 on failure or
-		 * 0 if no records are affected.
+		 * Delete what was just archived in batches of MAX_PURGE_BATCH
+		 * records, committing each one, so the table locks are only
+		 * held for a short time even when purging a lot of records.
 		 */
-		if ((rc = mysql_db_delete_affected_rows(
-				mysql_conn, query)) > 0) {
-			/* Commit here every time since this could create a huge
-			 * transaction.
+		for (purged = 0; purged < purge_limit; purged += rc) {
+			uint32_t limit = MIN(MAX_PURGE_BATCH,
+					     purge_limit - purged);
+
+			query = _make_purge_query(purge_type, cluster_name,
+						  sql_table, col_name, tmp_end,
+						  limit);
+			DB_DEBUG(DB_ARCHIVE, mysql_conn->conn, "query\n%s",
+				 query);
+
+			/*
+			 * mysql_db_delete_affected_rows will return < 0 on
+			 * failure or 0 if no records are affected.
 			 */
-			if ((rc = mysql_db_commit(mysql_conn)))
+			rc = mysql_db_delete_affected_rows(mysql_conn, query);
+			xfree(query);
+			if (rc < 0) {
+				error("Couldn't remove old data from %s table",
+				      sql_table);
+				return SLURM_ERROR;
+			} else if (mysql_db_commit(mysql_conn)) {
 				error("Couldn't commit cluster (%s) purge",
 				      cluster_name);
-		}
-
-		xfree(query);
-		if (rc != SLURM_SUCCESS) {
-			error("Couldn't remove old data from %s table",
-			      sql_table);
-			return SLURM_ERROR;
-		} else if (mysql_db_commit(mysql_conn)) {
-			error("Couldn't commit cluster (%s) purge",
-			      cluster_name);
-			break;
+				return SLURM_ERROR;
+			} else if (rc < limit) {
+				break;
+			}
 		}
 	}
 
@@ -5500,6 +5630,23 @@ unpack_error:
 	goto cleanup;
 }
 
+/* Load a chunked archive file one chunk at a time */
+static int _load_archive_chunks(int fd, mysql_conn_t *mysql_conn)
+{
+	char *data = NULL;
+	uint32_t data_size = 0;
+	int error_code;
+
+	while (!(error_code = archive_file_read(fd, &data, &data_size)) &&
+	       data) {
+		if ((error_code = _process_archive_data(&data, data_size,
+							mysql_conn)))
+			break;
+	}
+
+	return error_code;
+}
+
 extern int as_mysql_jobacct_process_archive_load(
 	mysql_conn_t *mysql_conn, slurmdb_archive_rec_t *arch_rec)
 {
@@ -5524,6 +5671,10 @@ extern int as_mysql_jobacct_process_archive_load(
 			info("Could not open archive file `%s`: %m",
 			     arch_rec->archive_file);
 			error_code = errno;
+		} else if (archive_file_is_chunked(state_fd)) {
+			error_code = _load_archive_chunks(state_fd, mysql_conn);
+			close(state_fd);
+			goto end_it;
 		} else {
 			data_allocated = BUF_SIZE + 1;
 			data = xmalloc_nz(data_allocated);
@@ -5582,6 +5733,7 @@ extern int as_mysql_jobacct_process_archive_load(
 	}
 	data = NULL; /* Free'd by above functions. */
 
+end_it:
 	if (error_code)
 		error("%s: failure loading archive: %s", __func__,
 		      slurm_strerror(error_code));
@@ -50,12 +50,131 @@
 
 #define MAX_FLUSH_JOBS 500
 
+/* Flush a step batch once it holds this many rows or bytes */
+#define MAX_BATCH_ROWS 500
+#define MAX_BATCH_SIZE (1024 * 1024)
+
+enum {
+	BATCH_NONE,
+	BATCH_STEP_START,
+	BATCH_STEP_COMPLETE,
+};
+
 typedef struct {
 	char *cluster;
 	uint32_t new;
 	uint32_t old;
 } id_switch_t;
 
+/*
+ * A step start is inserted with one row per step so several of them can share
+ * one insert. Columns not always known are inserted as NULL and left alone on
+ * update.
+ */
+static char *step_start_cols =
+	"job_db_inx, id_step, step_het_comp, time_start, step_name, state, "
+	"tres_alloc, nodes_alloc, task_cnt, nodelist, node_inx, task_dist, "
+	"req_cpufreq, req_cpufreq_min, req_cpufreq_gov, submit_line, container";
+static char *step_start_dup =
+	"nodes_alloc=VALUES(nodes_alloc), task_cnt=VALUES(task_cnt), "
+	"time_end=0, state=VALUES(state), nodelist=VALUES(nodelist), "
+	"node_inx=VALUES(node_inx), task_dist=VALUES(task_dist), "
+	"req_cpufreq=VALUES(req_cpufreq), "
+	"req_cpufreq_min=VALUES(req_cpufreq_min), "
+	"req_cpufreq_gov=VALUES(req_cpufreq_gov), "
+	"tres_alloc=VALUES(tres_alloc), "
+	"submit_line=ifnull(VALUES(submit_line), submit_line), "
+	"container=ifnull(VALUES(container), container)";
+
+/* Add row to query, starting the query if it is empty */
+static void _batch_append(mysql_conn_t *mysql_conn, char **query, int type,
+			  char *row)
+{
+	if (type == BATCH_STEP_START) {
+		if (!*query)
+			xstrfmtcat(*query, "insert into \"%s_%s\" (%s) values ",
+				   mysql_conn->cluster_name, step_table,
+				   step_start_cols);
+		else
+			xstrcat(*query, ", ");
+	} else if (*query) {
+		/* step completions are separate statements */
+		xstrcat(*query, "; ");
+	}
+
+	xstrcat(*query, row);
+}
+
+static int _batch_run(mysql_conn_t *mysql_conn, char **query, int type,
+		      uint32_t rows)
+{
+	int rc;
+
+	if (type == BATCH_STEP_START)
+		xstrfmtcat(*query, " on duplicate key update %s",
+			   step_start_dup);
+
+	DB_DEBUG(DB_STEP, mysql_conn->conn, "query (%u rows)\n%s",
+		 rows, *query);
+	rc = mysql_db_query(mysql_conn, *query);
+	xfree(*query);
+
+	return rc;
+}
+
+static int _batch_flush(mysql_conn_t *mysql_conn)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (mysql_conn->batch_query)
+		rc = _batch_run(mysql_conn, &mysql_conn->batch_query,
+				mysql_conn->batch_type,
+				mysql_conn->batch_rows);
+
+	mysql_conn->batch_rows = 0;
+	mysql_conn->batch_type = BATCH_NONE;
+
+	/* Rows queued before this flush are gone too, remember it */
+	if (rc && !mysql_conn->batch_rc)
+		mysql_conn->batch_rc = rc;
+
+	return rc;
+}
+
+/*
+ * Write a step row now, or queue it to be written with the rows after it if
+ * the connection is batching.
+ */
+static int _step_row(mysql_conn_t *mysql_conn, int type, char *row)
+{
+	char *query = NULL;
+	int rc;
+
+	if (!mysql_conn->batch) {
+		_batch_append(mysql_conn, &query, type, row);
+		return _batch_run(mysql_conn, &query, type, 1);
+	}
+
+	/* Don't queue more rows behind a failed flush */
+	if (mysql_conn->batch_rc)
+		return mysql_conn->batch_rc;
+
+	/* Keep rows in order, a different type ends the current batch */
+	if ((mysql_conn->batch_type != type) &&
+	    (rc = _batch_flush(mysql_conn)))
+		return rc;
+
+	_batch_append(mysql_conn, &mysql_conn->batch_query, type, row);
+	mysql_conn->batch_type = type;
+	mysql_conn->batch_rows++;
+
+	if ((mysql_conn->batch_rows >= MAX_BATCH_ROWS) ||
+	    (strlen(mysql_conn->batch_query) >= MAX_BATCH_SIZE))
+		return _batch_flush(mysql_conn);
+
+	return SLURM_SUCCESS;
+}
+
 static int _find_id_switch(void *x, void *key)
 {
 	id_switch_t *id_switch = (id_switch_t *)x;
@@ -1259,7 +1378,7 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 	char *node_list = NULL;
 	char *node_inx = NULL;
 	time_t start_time, submit_time;
-	char *query = NULL;
+	char *row = NULL;
 
 	if (!step_ptr->job_ptr->db_index
 	    && ((!step_ptr->job_ptr->details
@@ -1358,58 +1477,30 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 		}
 	}
 
-	/* we want to print a -1 for the requid so leave it a
-	   %d */
 	/* The stepid could be negative so use %d not %u */
-	query = xstrdup_printf(
-		"insert into \"%s_%s\" (job_db_inx, id_step, step_het_comp, "
-		"time_start, step_name, state, tres_alloc, "
-		"nodes_alloc, task_cnt, nodelist, node_inx, "
-		"task_dist, req_cpufreq, req_cpufreq_min, req_cpufreq_gov",
-		mysql_conn->cluster_name, step_table);
-
-	if (step_ptr->submit_line)
-		xstrcat(query, ", submit_line");
-	if (step_ptr->container)
-		xstrcat(query, ", container");
-
-	xstrfmtcat(query,
-		   ") values (%"PRIu64", %d, %u, %d, '%s', %d, '%s', %d, %d, "
-		   "'%s', '%s', %d, %u, %u, %u",
-		   step_ptr->job_ptr->db_index,
-		   step_ptr->step_id.step_id,
-		   step_ptr->step_id.step_het_comp,
-		   (int)start_time, step_ptr->name,
-		   JOB_RUNNING, step_ptr->tres_alloc_str,
-		   nodes, tasks, node_list, node_inx, task_dist,
-		   step_ptr->cpu_freq_max, step_ptr->cpu_freq_min,
-		   step_ptr->cpu_freq_gov);
+	row = xstrdup_printf(
+		"(%"PRIu64", %d, %u, %d, '%s', %d, '%s', %d, %d, "
+		"'%s', '%s', %d, %u, %u, %u",
+		step_ptr->job_ptr->db_index,
+		step_ptr->step_id.step_id,
+		step_ptr->step_id.step_het_comp,
+		(int)start_time, step_ptr->name,
+		JOB_RUNNING, step_ptr->tres_alloc_str,
+		nodes, tasks, node_list, node_inx, task_dist,
+		step_ptr->cpu_freq_max, step_ptr->cpu_freq_min,
+		step_ptr->cpu_freq_gov);
 
 	if (step_ptr->submit_line)
-		xstrfmtcat(query, ", '%s'", step_ptr->submit_line);
-	if (step_ptr->container)
-		xstrfmtcat(query, ", '%s'", step_ptr->container);
-
-	xstrfmtcat(query,
-		   ") on duplicate key update "
-		   "nodes_alloc=%d, task_cnt=%d, time_end=0, state=%d, "
-		   "nodelist='%s', node_inx='%s', task_dist=%d, "
-		   "req_cpufreq=%u, req_cpufreq_min=%u, req_cpufreq_gov=%u,"
-		   "tres_alloc='%s'",
-		   nodes, tasks, JOB_RUNNING,
-		   node_list, node_inx, task_dist, step_ptr->cpu_freq_max,
-		   step_ptr->cpu_freq_min, step_ptr->cpu_freq_gov,
-		   step_ptr->tres_alloc_str);
-
-	if (step_ptr->submit_line)
-		xstrfmtcat(query, ", submit_line='%s'", step_ptr->submit_line);
-
+		xstrfmtcat(row, ", '%s'", step_ptr->submit_line);
+	else
+		xstrcat(row, ", NULL");
 	if (step_ptr->container)
-		xstrfmtcat(query, ", container='%s'", step_ptr->container);
+		xstrfmtcat(row, ", '%s')", step_ptr->container);
+	else
+		xstrcat(row, ", NULL)");
 
-	DB_DEBUG(DB_STEP, mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
-	xfree(query);
+	rc = _step_row(mysql_conn, BATCH_STEP_START, row);
+	xfree(row);
 
 	return rc;
 }
@@ -1659,22 +1750,43 @@ extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 		   " where job_db_inx=%"PRIu64" and id_step=%d and step_het_comp=%u",
 		   step_ptr->job_ptr->db_index, step_ptr->step_id.step_id,
 		   step_ptr->step_id.step_het_comp);
-	DB_DEBUG(DB_STEP, mysql_conn->conn, "query\n%s", query);
-	rc = mysql_db_query(mysql_conn, query);
-	xfree(query);
 
 	/* set the energy for the entire job. */
-	if (step_ptr->job_ptr->tres_alloc_str) {
-		query = xstrdup_printf(
-			"update \"%s_%s\" set tres_alloc='%s' where "
-			"job_db_inx=%"PRIu64,
-			mysql_conn->cluster_name, job_table,
-			step_ptr->job_ptr->tres_alloc_str,
-			step_ptr->job_ptr->db_index);
-		DB_DEBUG(DB_STEP, mysql_conn->conn, "query\n%s", query);
-		rc = mysql_db_query(mysql_conn, query);
-		xfree(query);
+	if (step_ptr->job_ptr->tres_alloc_str)
+		xstrfmtcat(query,
+			   "; update \"%s_%s\" set tres_alloc='%s' where "
+			   "job_db_inx=%"PRIu64,
+			   mysql_conn->cluster_name, job_table,
+			   step_ptr->job_ptr->tres_alloc_str,
+			   step_ptr->job_ptr->db_index);
+
+	rc = _step_row(mysql_conn, BATCH_STEP_COMPLETE, query);
+	xfree(query);
+
+	return rc;
+}
+
+/*
+ * Start or stop queueing step rows on this connection. Stopping writes out
+ * whatever is queued, and fails if any flush since the start failed.
+ */
+extern int as_mysql_step_batch(mysql_conn_t *mysql_conn, bool enable)
+{
+	int rc = SLURM_SUCCESS;
+
+	if (!enable) {
+		if (mysql_conn->batch_query &&
+		    (check_connection(mysql_conn) != SLURM_SUCCESS)) {
+			xfree(mysql_conn->batch_query);
+			rc = ESLURM_DB_CONNECTION;
+		}
+		/* A failed flush is remembered in batch_rc */
+		(void) _batch_flush(mysql_conn);
+		if (!rc && mysql_conn->batch_rc)
+			rc = SLURM_ERROR;
 	}
+	mysql_conn->batch = enable;
+	mysql_conn->batch_rc = SLURM_SUCCESS;
 
 	return rc;
 }
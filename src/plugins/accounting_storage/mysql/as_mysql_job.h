@@ -58,6 +58,8 @@ extern int as_mysql_step_start(mysql_conn_t *mysql_conn,
 extern int as_mysql_step_complete(mysql_conn_t *mysql_conn,
 			          step_record_t *step_ptr);
 
+extern int as_mysql_step_batch(mysql_conn_t *mysql_conn, bool enable);
+
 extern int as_mysql_suspend(mysql_conn_t *mysql_conn, uint64_t old_db_inx,
 			    job_record_t *job_ptr);
 
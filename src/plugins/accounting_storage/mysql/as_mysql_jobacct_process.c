@@ -43,6 +43,9 @@
 
 #include "as_mysql_jobacct_process.h"
 
+/* Jobs read per query when sending jobs back in parts */
+#define JOB_PART_SIZE 1000
+
 typedef struct {
 	hostlist_t *hl;
 	time_t start;
@@ -476,9 +479,10 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			     char *cluster_name,
 			     char *job_fields, char *step_fields,
 			     char *sent_extra,
-			     bool is_admin, int only_pending, List sent_list)
+			     bool is_admin, int only_pending, List sent_list,
+			     ListForF f, void *arg)
 {
-	char *query = NULL;
+	char *query = NULL, *part_query = NULL;
 	char *extra = xstrdup(sent_extra);
 	slurm_selected_step_t *selected_step = NULL;
 	MYSQL_RES *result = NULL, *step_result = NULL;
@@ -493,7 +497,14 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	char *prefix="t2";
 	int rc = SLURM_SUCCESS;
 	int last_id = -1, curr_id = -1;
+	uint32_t part_start_id = 0, part_end_id = 0;
+	uint64_t part_size = JOB_PART_SIZE;
+	bool have_where, part_more = false;
 	local_cluster_t *curr_cluster = NULL;
+	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
+				   READ_LOCK, NO_LOCK, NO_LOCK };
+
+	assoc_mgr_lock(&locks);
 
 	/* This is here to make sure we are looking at only this user
 	 * if this flag is set.  We also include any accounts they may be
@@ -562,16 +573,35 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 			xstrcat(extra, " where (t1.time_end=0)");
 	}
 
+	have_where = (extra != NULL);
 	if (extra) {
 		xstrcat(query, extra);
 		xfree(extra);
 	}
 
+	/*
+	 * When the jobs are sent back in parts read them a page at a time,
+	 * each page starting at the job id the last one stopped at, so the
+	 * whole result is never held at once.
+	 */
+	if (f) {
+		part_query = query;
+		query = NULL;
+	}
+
+next_part:
+	if (f)
+		query = xstrdup_printf("%s %s (t1.id_job >= %u)",
+				       part_query, have_where ? "&&" : "where",
+				       part_start_id);
+
 	/* Here we want to order them this way in such a way so it is
 	   easy to look for duplicates, it is also easy to sort the
 	   resized jobs.
 	*/
 	xstrcat(query, " order by id_job, time_submit desc");
+	if (f)
+		xstrfmtcat(query, " limit %"PRIu64, part_size);
 
 	DB_DEBUG(DB_JOB, mysql_conn->conn, "query\n%s", query);
 	if (!(result = mysql_db_query_ret(mysql_conn, query, 0))) {
@@ -581,6 +611,27 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	}
 	xfree(query);
 
+	part_more = false;
+	if (f && (mysql_num_rows(result) == part_size)) {
+		/*
+		 * The records of the last job id on a full page may continue
+		 * on the next one, leave them all for the next page. If the
+		 * page holds nothing but that job id read a bigger page.
+		 */
+		mysql_data_seek(result, part_size - 1);
+		row = mysql_fetch_row(result);
+		part_end_id = slurm_atoul(row[JOB_REQ_JOBID]);
+		mysql_data_seek(result, 0);
+		row = mysql_fetch_row(result);
+		if (slurm_atoul(row[JOB_REQ_JOBID]) == part_end_id) {
+			mysql_free_result(result);
+			part_size *= 2;
+			goto next_part;
+		}
+		mysql_data_seek(result, 0);
+		part_more = true;
+	}
+
 
 	/* Here we set up environment to check used nodes of jobs.
 	   Since we store the bitmap of the entire cluster we can use
@@ -588,7 +639,7 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	   things work.  This should go before the setup of conds
 	   since we could update the start/end time.
 	*/
-	if (job_cond && job_cond->used_nodes) {
+	if (job_cond && job_cond->used_nodes && !local_cluster_list) {
 		local_cluster_list = setup_cluster_list_with_inx(
 			mysql_conn, job_cond, (void **)&curr_cluster);
 		if (!local_cluster_list) {
@@ -605,6 +656,9 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 
 		curr_id = slurm_atoul(row[JOB_REQ_JOBID]);
 
+		if (part_more && (curr_id == part_end_id))
+			break;
+
 		if (job_cond && !(job_cond->flags & JOBCOND_FLAG_DUP)
 		    && (curr_id == last_id)
 		    && (slurm_atoul(row[JOB_REQ_STATE]) != JOB_RESIZING))
@@ -1115,13 +1169,33 @@ static int _cluster_get_jobs(mysql_conn_t *mysql_conn,
 	}
 	mysql_free_result(result);
 
+	if (f) {
+		/* f may block on the client, don't hold the locks over it */
+		assoc_mgr_unlock(&locks);
+		if (list_count(job_list) && (f(job_list, arg) < 0)) {
+			rc = SLURM_ERROR;
+			goto end_unlocked;
+		}
+		list_flush(job_list);
+		if (part_more) {
+			part_start_id = part_end_id;
+			part_size = JOB_PART_SIZE;
+			assoc_mgr_lock(&locks);
+			goto next_part;
+		}
+		goto end_unlocked;
+	}
+
 end_it:
+	assoc_mgr_unlock(&locks);
+end_unlocked:
 	if (itr2)
 		list_iterator_destroy(itr2);
 
 	FREE_NULL_LIST(local_cluster_list);
+	xfree(part_query);
 
-	if (rc == SLURM_SUCCESS)
+	if ((rc == SLURM_SUCCESS) && sent_list)
 		list_transfer(sent_list, job_list);
 
 	FREE_NULL_LIST(job_list);
@@ -1690,23 +1764,24 @@ extern int setup_job_cond_limits(slurmdb_job_cond_t *job_cond,
 	return set;
 }
 
-extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
-					      uid_t uid,
-					      slurmdb_job_cond_t *job_cond)
+/*
+ * Get the jobs matching job_cond either appended to job_list, or handed to f
+ * one part at a time when f is set.
+ */
+static int _get_jobs(mysql_conn_t *mysql_conn, uid_t uid,
+		     slurmdb_job_cond_t *job_cond, List job_list,
+		     ListForF f, void *arg)
 {
 	char *extra = NULL;
 	char *tmp = NULL, *tmp2 = NULL;
 	ListIterator itr = NULL;
 	int is_admin=1;
-	int i;
-	List job_list = NULL;
+	int i, rc = SLURM_SUCCESS;
 	slurmdb_user_rec_t user;
 	int only_pending = 0;
 	List use_cluster_list = NULL;
 	char *cluster_name;
-	bool locked = false;
-	assoc_mgr_lock_t locks = { NO_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
-				   READ_LOCK, NO_LOCK, NO_LOCK };
+	bool copied = false;
 
 	memset(&user, 0, sizeof(slurmdb_user_rec_t));
 	user.uid = uid;
@@ -1729,7 +1804,7 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 		if (!is_admin && !user.name) {
 			debug("User %u has no associations, and is not admin, "
 			      "so not returning any jobs.", user.uid);
-			return NULL;
+			return SLURM_ERROR;
 		}
 	}
 
@@ -1751,7 +1826,7 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 		if (reason) {
 			error("User %u is requesting %s, but no job requested, this is not allowed",
 			      user.uid, reason);
-			return NULL;
+			return SLURM_ERROR;
 		}
 	}
 
@@ -1780,37 +1855,65 @@ extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
 	    && job_cond->cluster_list && list_count(job_cond->cluster_list))
 		use_cluster_list = job_cond->cluster_list;
 	else {
+		/*
+		 * Copy the names so the lock isn't held while the jobs are
+		 * read, that may wait on the client when sending them in parts.
+		 */
 		slurm_rwlock_rdlock(&as_mysql_cluster_list_lock);
-		use_cluster_list = list_shallow_copy(as_mysql_cluster_list);
-		locked = true;
+		use_cluster_list = slurm_copy_char_list(as_mysql_cluster_list);
+		slurm_rwlock_unlock(&as_mysql_cluster_list_lock);
+		copied = true;
 	}
 
-	assoc_mgr_lock(&locks);
+	if (!use_cluster_list)
+		goto end_it;
 
-	job_list = list_create(slurmdb_destroy_job_rec);
 	itr = list_iterator_create(use_cluster_list);
 	while ((cluster_name = list_next(itr))) {
-		int rc;
 		_setup_job_cond_selected_steps(job_cond, cluster_name, &extra);
-		if ((rc = _cluster_get_jobs(mysql_conn, &user, job_cond,
-					    cluster_name, tmp, tmp2, extra,
-					    is_admin, only_pending, job_list))
-		    != SLURM_SUCCESS)
+		if (_cluster_get_jobs(mysql_conn, &user, job_cond,
+				      cluster_name, tmp, tmp2, extra,
+				      is_admin, only_pending, job_list,
+				      f, arg) != SLURM_SUCCESS) {
 			error("Problem getting jobs for cluster %s",
 			      cluster_name);
+			/* Parts already sent can't be taken back */
+			if (f) {
+				rc = SLURM_ERROR;
+				break;
+			}
+		}
 	}
 	list_iterator_destroy(itr);
 
-	assoc_mgr_unlock(&locks);
-
-	if (locked) {
+end_it:
+	if (copied)
 		FREE_NULL_LIST(use_cluster_list);
-		slurm_rwlock_unlock(&as_mysql_cluster_list_lock);
-	}
 
 	xfree(tmp);
 	xfree(tmp2);
 	xfree(extra);
 
+	return rc;
+}
+
+extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn,
+					      uid_t uid,
+					      slurmdb_job_cond_t *job_cond)
+{
+	List job_list = list_create(slurmdb_destroy_job_rec);
+
+	if (_get_jobs(mysql_conn, uid, job_cond, job_list, NULL, NULL) !=
+	    SLURM_SUCCESS)
+		FREE_NULL_LIST(job_list);
+
 	return job_list;
 }
+
+extern int as_mysql_jobacct_process_get_jobs_parts(mysql_conn_t *mysql_conn,
+						   uid_t uid,
+						   slurmdb_job_cond_t *job_cond,
+						   ListForF f, void *arg)
+{
+	return _get_jobs(mysql_conn, uid, job_cond, NULL, f, arg);
+}
@@ -60,4 +60,10 @@ extern int setup_job_cond_limits(slurmdb_job_cond_t *job_cond,
 extern List as_mysql_jobacct_process_get_jobs(mysql_conn_t *mysql_conn, uid_t uid,
 					   slurmdb_job_cond_t *job_cond);
 
+/* Like as_mysql_jobacct_process_get_jobs() but hand the jobs to f in parts */
+extern int as_mysql_jobacct_process_get_jobs_parts(mysql_conn_t *mysql_conn,
+						   uid_t uid,
+						   slurmdb_job_cond_t *job_cond,
+						   ListForF f, void *arg);
+
 #endif
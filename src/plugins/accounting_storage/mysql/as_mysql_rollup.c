@@ -40,9 +40,23 @@
 
 #include "as_mysql_rollup.h"
 #include "as_mysql_archive.h"
+#include "as_mysql_rollup_usage.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_time.h"
 
+/*
+ * Most time windows one cluster's rollup of a period type is split into. Each
+ * window is rolled up at the same time on its own database connection.
+ */
+#define MAX_ROLLUP_WINDOWS 4
+
+/* Fewest hours, days or months worth a window of their own */
+static const int rollup_window_min[DBD_ROLLUP_COUNT] = { 24, 7, 3 };
+
+static const char *rollup_type_str[DBD_ROLLUP_COUNT] = {
+	"hourly", "daily", "monthly"
+};
+
 enum {
 	TIME_ALLOC,
 	TIME_DOWN,
@@ -67,11 +81,6 @@ typedef struct {
 	uint64_t total_time;
 } local_tres_usage_t;
 
-typedef struct {
-	int id;
-	List loc_tres;
-} local_id_usage_t;
-
 typedef struct {
 	time_t end;
 	int id; /*only needed for reservations */
@@ -84,14 +93,41 @@ typedef struct {
 	uint32_t flags;
 	int id;
 	hostlist_t *hl;
-	List local_assocs; /* list of assocs to spread unused time
-			      over of type local_id_usage_t */
+	List local_assocs; /* list of assocs (char *) to spread unused
+			      time over */
 	List loc_tres;
 	time_t orig_start;
 	time_t start;
 	double unused_wall;
+	struct resv_carry *carry;
 } local_resv_usage_t;
 
+/*
+ * Unused wall of a reservation that started before the window being rolled
+ * up. The window can't know the unused wall it starts with until the windows
+ * before it are done, so it keeps what it did to it instead:
+ *   unused wall = MAX(unused_min, unused wall at window start + unused_add)
+ * unused_min < 0 means there is no minimum yet.
+ */
+typedef struct resv_carry {
+	uint32_t id;
+	time_t orig_start;
+	double unused_add;
+	double unused_min;
+} resv_carry_t;
+
+typedef struct {
+	char *cluster_name;
+	int conn_id;
+	time_t end;
+	int rc;
+	List resv_carry; /* list of resv_carry_t, for hour windows */
+	time_t start;
+	pthread_t tid;
+	int type; /* DBD_ROLLUP_* */
+	uint64_t usec;
+} rollup_window_t;
+
 static void _destroy_local_tres_usage(void *object)
 {
 	local_tres_usage_t *a_usage = (local_tres_usage_t *)object;
@@ -100,15 +136,6 @@ static void _destroy_local_tres_usage(void *object)
 	}
 }
 
-static void _destroy_local_id_usage(void *object)
-{
-	local_id_usage_t *a_usage = (local_id_usage_t *)object;
-	if (a_usage) {
-		FREE_NULL_LIST(a_usage->loc_tres);
-		xfree(a_usage);
-	}
-}
-
 static void _destroy_local_cluster_usage(void *object)
 {
 	local_cluster_usage_t *c_usage = (local_cluster_usage_t *)object;
@@ -139,16 +166,6 @@ static int _find_loc_tres(void *x, void *key)
 	return 0;
 }
 
-static int _find_id_usage(void *x, void *key)
-{
-	local_id_usage_t *loc = (local_id_usage_t *)x;
-	uint32_t id = *(uint32_t *)key;
-
-	if (loc->id == id)
-		return 1;
-	return 0;
-}
-
 static void _remove_job_tres_time_from_cluster(List c_tres, List j_tres,
 					       int seconds)
 {
@@ -175,6 +192,35 @@ static void _remove_job_tres_time_from_cluster(List c_tres, List j_tres,
 	list_iterator_destroy(c_itr);
 }
 
+static void _remove_job_time_from_cluster(List c_tres,
+					  local_job_tres_t *j_tres,
+					  rollup_tres_pos_t *tres_pos,
+					  int seconds)
+{
+	ListIterator c_itr;
+	local_tres_usage_t *loc_c_tres;
+	uint64_t time;
+	int pos;
+
+	if ((seconds <= 0) || !c_tres || !j_tres->used_cnt ||
+	    !list_count(c_tres))
+		return;
+
+	c_itr = list_iterator_create(c_tres);
+	while ((loc_c_tres = list_next(c_itr))) {
+		if ((pos = rollup_job_tres_find(j_tres, tres_pos,
+						loc_c_tres->id)) < 0)
+			continue;
+		time = seconds * j_tres->count[pos];
+
+		if (time >= loc_c_tres->total_time)
+			loc_c_tres->total_time = 0;
+		else
+			loc_c_tres->total_time -= time;
+	}
+	list_iterator_destroy(c_itr);
+}
+
 
 static local_tres_usage_t *_add_time_tres(List tres_list, int type, uint32_t id,
 					  uint64_t time, bool times_count)
@@ -247,14 +293,14 @@ static void _add_time_tres_list(List tres_list_out, List tres_list_in, int type,
  * Job usage is a ratio of its tres to the reservation's tres:
  * Unused wall = unused wall - job_seconds * job_tres / resv_tres
  */
-static int _update_unused_wall(local_resv_usage_t *r_usage, List job_tres,
-			       int job_seconds)
+static int _update_unused_wall(local_resv_usage_t *r_usage,
+			       local_job_tres_t *job_tres,
+			       rollup_tres_pos_t *tres_pos, int job_seconds)
 {
 	ListIterator resv_itr;
 	local_tres_usage_t *loc_tres;
-	uint32_t resv_tres_id;
-	uint64_t resv_tres_count;
 	double tres_ratio = 0.0;
+	int pos;
 
 	/* Get TRES counts. Make sure the TRES types match. */
 	resv_itr = list_iterator_create(r_usage->loc_tres);
@@ -262,13 +308,10 @@ static int _update_unused_wall(local_resv_usage_t *r_usage, List job_tres,
 		/* Avoid dividing by zero. */
 		if (!loc_tres->count)
 			continue;
-		resv_tres_id = loc_tres->id;
-		resv_tres_count = loc_tres->count;
-		if ((loc_tres = list_find_first(job_tres,
-						_find_loc_tres,
-						&resv_tres_id))) {
-			tres_ratio = (double)loc_tres->count /
-				(double)resv_tres_count;
+		if ((pos = rollup_job_tres_find(job_tres, tres_pos,
+						loc_tres->id)) >= 0) {
+			tres_ratio = (double)job_tres->count[pos] /
+				(double)loc_tres->count;
 			break;
 		}
 	}
@@ -278,6 +321,18 @@ static int _update_unused_wall(local_resv_usage_t *r_usage, List job_tres,
 	 * Here we are converting TRES seconds to wall seconds.  This is needed
 	 * to determine how much time is actually idle in the reservation.
 	 */
+	if (r_usage->carry) {
+		resv_carry_t *carry = r_usage->carry;
+		double used = (double)job_seconds * tres_ratio;
+
+		carry->unused_add -= used;
+		if (carry->unused_min < used)
+			carry->unused_min = 0;
+		else
+			carry->unused_min -= used;
+		return SLURM_SUCCESS;
+	}
+
 	r_usage->unused_wall -=	(double)job_seconds * tres_ratio;
 
 	if (r_usage->unused_wall < 0) {
@@ -292,20 +347,44 @@ static int _update_unused_wall(local_resv_usage_t *r_usage, List job_tres,
 	return SLURM_SUCCESS;
 }
 
-static void _add_job_alloc_time_to_cluster(List c_tres_list, List j_tres)
+static void _add_job_alloc_time_to_cluster(List c_tres_list,
+					   local_job_tres_t *j_tres,
+					   rollup_tres_pos_t *tres_pos)
 {
 	ListIterator c_itr = list_iterator_create(c_tres_list);
-	local_tres_usage_t *loc_c_tres, *loc_j_tres;
+	local_tres_usage_t *loc_c_tres;
+	int pos;
 
 	while ((loc_c_tres = list_next(c_itr))) {
-		if (!(loc_j_tres = list_find_first(
-			      j_tres, _find_loc_tres, &loc_c_tres->id)))
+		if ((pos = rollup_job_tres_find(j_tres, tres_pos,
+						loc_c_tres->id)) < 0)
 			continue;
-		loc_c_tres->time_alloc += loc_j_tres->time_alloc;
+		loc_c_tres->time_alloc += j_tres->time_alloc[pos];
 	}
 	list_iterator_destroy(c_itr);
 }
 
+/*
+ * Add seconds worth of the reservation's TRES counts to the reservation for
+ * every TRES the job used in it.
+ */
+static void _add_job_time_to_resv(List r_tres_list, local_job_tres_t *j_tres,
+				  rollup_tres_pos_t *tres_pos, int seconds)
+{
+	ListIterator r_itr = list_iterator_create(r_tres_list);
+	local_tres_usage_t *loc_r_tres;
+
+	while ((loc_r_tres = list_next(r_itr))) {
+		if (!loc_r_tres->count ||
+		    (rollup_job_tres_find(j_tres, tres_pos,
+					  loc_r_tres->id) < 0))
+			continue;
+		loc_r_tres->time_alloc += (uint64_t) seconds *
+			loc_r_tres->count;
+	}
+	list_iterator_destroy(r_itr);
+}
+
 static void _setup_cluster_tres(List tres_list, uint32_t id,
 				uint64_t count, int seconds)
 {
@@ -364,48 +443,6 @@ static void _add_tres_2_list(List tres_list, char *tres_str, int seconds)
 	return;
 }
 
-static void _add_job_alloc_time_to_assoc(List a_tres_list, List j_tres_list)
-{
-	local_tres_usage_t *loc_a_tres, *loc_j_tres;
-
-	/*
-	 * NOTE: You have to use slurm_list_pop here, since
-	 * mysql is exporting something of the same type as a
-	 * macro, which messes everything up
-	 * (my_list.h is the bad boy).
-	 */
-	while ((loc_j_tres = slurm_list_pop(j_tres_list))) {
-		if (!(loc_a_tres = list_find_first(
-			      a_tres_list, _find_loc_tres, &loc_j_tres->id))) {
-			/*
-			 * New TRES we haven't seen before in this association
-			 * just transfer it over.
-			 */
-			list_append(a_tres_list, loc_j_tres);
-			continue;
-		}
-		loc_a_tres->time_alloc += loc_j_tres->time_alloc;
-		_destroy_local_tres_usage(loc_j_tres);
-	}
-}
-
-/* This will destroy the *loc_tres given after it is transfered */
-static void _transfer_loc_tres(List *loc_tres, local_id_usage_t *usage)
-{
-	if (!usage || !*loc_tres) {
-		FREE_NULL_LIST(*loc_tres);
-		return;
-	}
-
-	if (!usage->loc_tres) {
-		usage->loc_tres = *loc_tres;
-		*loc_tres = NULL;
-	} else {
-		_add_job_alloc_time_to_assoc(usage->loc_tres, *loc_tres);
-		FREE_NULL_LIST(*loc_tres);
-	}
-}
-
 static void _add_tres_time_2_list(List tres_list, char *tres_str,
 				  int type, int seconds, int suspend_seconds,
 				  bool times_count)
@@ -466,6 +503,34 @@ static void _add_tres_time_2_list(List tres_list, char *tres_str,
 	return;
 }
 
+static int _find_resv_carry(void *x, void *key)
+{
+	resv_carry_t *carry = x;
+	local_resv_usage_t *r_usage = key;
+
+	if ((carry->id == r_usage->id) &&
+	    (carry->orig_start == r_usage->orig_start))
+		return 1;
+	return 0;
+}
+
+static resv_carry_t *_get_resv_carry(List resv_carry,
+				     local_resv_usage_t *r_usage)
+{
+	resv_carry_t *carry;
+
+	if (!(carry = list_find_first(resv_carry, _find_resv_carry,
+				      r_usage))) {
+		carry = xmalloc(sizeof(*carry));
+		carry->id = r_usage->id;
+		carry->orig_start = r_usage->orig_start;
+		carry->unused_min = -1;
+		list_append(resv_carry, carry);
+	}
+
+	return carry;
+}
+
 static int _process_purge(mysql_conn_t *mysql_conn,
 			  char *cluster_name,
 			  uint16_t archive_data,
@@ -737,10 +802,9 @@ static int _process_cluster_usage(mysql_conn_t *mysql_conn,
 static void _create_id_usage_insert(char *cluster_name, int type,
 				    time_t curr_start, time_t now,
 				    local_id_usage_t *id_usage,
+				    rollup_tres_pos_t *tres_pos,
 				    char **query)
 {
-	local_tres_usage_t *loc_tres;
-	ListIterator itr;
 	bool first;
 	char *table = NULL, *id_name = NULL;
 
@@ -761,20 +825,17 @@ static void _create_id_usage_insert(char *cluster_name, int type,
 		break;
 	}
 
-	if (!id_usage->loc_tres || !list_count(id_usage->loc_tres)) {
-		error("%s %d doesn't have any tres", id_name, id_usage->id);
-		return;
-	}
-
 	first = 1;
-	itr = list_iterator_create(id_usage->loc_tres);
-	while ((loc_tres = list_next(itr))) {
+	for (int pos = 0; pos < id_usage->tres_cnt; pos++) {
+		if (!id_usage->time_alloc[pos])
+			continue;
 		if (!first) {
 			xstrfmtcat(*query,
 				   ", (%ld, %ld, %u, %ld, %u, %"PRIu64")",
 				   now, now,
-				   id_usage->id, curr_start, loc_tres->id,
-				   loc_tres->time_alloc);
+				   id_usage->id, curr_start,
+				   tres_pos->id[pos],
+				   id_usage->time_alloc[pos]);
 		} else {
 			xstrfmtcat(*query,
 				   "insert into \"%s_%s\" "
@@ -782,12 +843,18 @@ static void _create_id_usage_insert(char *cluster_name, int type,
 				   "time_start, id_tres, alloc_secs) "
 				   "values (%ld, %ld, %u, %ld, %u, %"PRIu64")",
 				   cluster_name, table, now, now,
-				   id_usage->id, curr_start, loc_tres->id,
-				   loc_tres->time_alloc);
+				   id_usage->id, curr_start,
+				   tres_pos->id[pos],
+				   id_usage->time_alloc[pos]);
 			first = 0;
 		}
 	}
-	list_iterator_destroy(itr);
+
+	if (first) {
+		error("%s %d doesn't have any tres", id_name, id_usage->id);
+		return;
+	}
+
 	xstrfmtcat(*query,
 		   " on duplicate key update mod_time=%ld, "
 		   "alloc_secs=VALUES(alloc_secs);", now);
@@ -1090,7 +1157,9 @@ static int _setup_resv_usage(mysql_conn_t *mysql_conn,
 			     time_t curr_start,
 			     time_t curr_end,
 			     List resv_usage_list,
-			     int dims)
+			     int dims,
+			     List resv_carry,
+			     time_t window_start)
 {
 	MYSQL_RES *result = NULL;
 	MYSQL_ROW row;
@@ -1211,7 +1280,13 @@ static int _setup_resv_usage(mysql_conn_t *mysql_conn,
 		r_usage->orig_start = orig_start;
 		r_usage->start = row_start;
 		r_usage->end = row_end;
-		r_usage->unused_wall = unused + resv_seconds;
+		if (resv_carry && (orig_start < window_start)) {
+			r_usage->carry = _get_resv_carry(resv_carry, r_usage);
+			r_usage->carry->unused_add += resv_seconds;
+			if (r_usage->carry->unused_min >= 0)
+				r_usage->carry->unused_min += resv_seconds;
+		} else
+			r_usage->unused_wall = unused + resv_seconds;
 		r_usage->hl = hostlist_create_dims(row[RESV_REQ_NODES], dims);
 		list_append(resv_usage_list, r_usage);
 	}
@@ -1249,10 +1324,16 @@ static void _add_planned_time(local_cluster_usage_t *c_usage, time_t job_start,
 		       loc_seconds * (uint64_t) row_rcpu, 0);
 }
 
-extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
-				  char *cluster_name,
-				  time_t start, time_t end,
-				  uint16_t archive_data)
+/*
+ * Roll up the hours from start to end. With resv_carry set this is one of
+ * several windows rolled up at once: each hour is committed on its own and the
+ * unused wall of reservations started before the window is kept in resv_carry
+ * instead of the database. Committing early is safe to redo: usage rows are
+ * replaced, and the unused wall of a reservation started in the window is
+ * reset at its first hour.
+ */
+static int _hourly_rollup(mysql_conn_t *mysql_conn, char *cluster_name,
+			  time_t start, time_t end, List resv_carry)
 {
 	int rc = SLURM_SUCCESS;
 	int add_sec = 3600;
@@ -1267,10 +1348,12 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 	ListIterator c_itr = NULL;
 	ListIterator w_itr = NULL;
 	ListIterator r_itr = NULL;
-	List assoc_usage_list = list_create(_destroy_local_id_usage);
+	local_id_table_t assoc_usage = { 0 };
 	List cluster_down_list = list_create(_destroy_local_cluster_usage);
-	List wckey_usage_list = list_create(_destroy_local_id_usage);
+	local_id_table_t wckey_usage = { 0 };
 	List resv_usage_list = list_create(_destroy_local_resv_usage);
+	rollup_tres_pos_t tres_pos = { 0 };
+	local_job_tres_t job_tres = { 0 };
 	uint16_t track_wckey = slurm_get_track_wckey();
 	local_cluster_usage_t *loc_c_usage = NULL;
 	local_cluster_usage_t *c_usage = NULL;
@@ -1359,9 +1442,7 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 /* 	info("begin start %s", slurm_ctime2(&curr_start)); */
 /* 	info("begin end %s", slurm_ctime2(&curr_end)); */
-	a_itr = list_iterator_create(assoc_usage_list);
 	c_itr = list_iterator_create(cluster_down_list);
-	w_itr = list_iterator_create(wckey_usage_list);
 	r_itr = list_iterator_create(resv_usage_list);
 	while (curr_start < end) {
 		int last_id = -1;
@@ -1375,7 +1456,8 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 		if ((rc = _setup_resv_usage(mysql_conn, cluster_name,
 					    curr_start, curr_end,
-					    resv_usage_list, dims))
+					    resv_usage_list, dims,
+					    resv_carry, start))
 		    != SLURM_SUCCESS)
 			goto end_it;
 
@@ -1419,7 +1501,6 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			time_t row_start = slurm_atoul(row[JOB_REQ_START]);
 			time_t row_end = slurm_atoul(row[JOB_REQ_END]);
 			uint32_t row_rcpu = slurm_atoul(row[JOB_REQ_RCPU]);
-			List loc_tres = NULL;
 			int loc_seconds = 0;
 			int seconds = 0, suspend_seconds = 0;
 
@@ -1485,13 +1566,9 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			}
 
 			if (last_id != assoc_id) {
-				a_usage = xmalloc(sizeof(local_id_usage_t));
-				a_usage->id = assoc_id;
-				list_append(assoc_usage_list, a_usage);
+				a_usage = rollup_id_table_get(&assoc_usage,
+							      assoc_id);
 				last_id = assoc_id;
-				/* a_usage->loc_tres is made later,
-				   don't do it here.
-				*/
 			}
 
 			/* Short circuit this so so we don't get a pointer. */
@@ -1500,20 +1577,8 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 			/* do the wckey calculation */
 			if (last_wckeyid != wckey_id) {
-				list_iterator_reset(w_itr);
-				while ((w_usage = list_next(w_itr)))
-					if (w_usage->id == wckey_id)
-						break;
-
-				if (!w_usage) {
-					w_usage = xmalloc(
-						sizeof(local_id_usage_t));
-					w_usage->id = wckey_id;
-					list_append(wckey_usage_list,
-						    w_usage);
-					w_usage->loc_tres = list_create(
-						_destroy_local_tres_usage);
-				}
+				w_usage = rollup_id_table_get(&wckey_usage,
+							      wckey_id);
 				last_wckeyid = wckey_id;
 			}
 
@@ -1524,16 +1589,11 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			 * We need to have this clean for each job
 			 * since we add the time to the cluster individually.
 			 */
-			loc_tres = list_create(_destroy_local_tres_usage);
-
-			_add_tres_time_2_list(loc_tres, row[JOB_REQ_TRES],
-					      TIME_ALLOC, seconds,
-					      suspend_seconds, 0);
+			rollup_job_tres_set(&job_tres, &tres_pos,
+					    row[JOB_REQ_TRES], seconds,
+					    suspend_seconds);
 			if (w_usage)
-				_add_tres_time_2_list(w_usage->loc_tres,
-						      row[JOB_REQ_TRES],
-						      TIME_ALLOC, seconds,
-						      suspend_seconds, 0);
+				rollup_id_usage_add_job(w_usage, &job_tres);
 
 			/*
 			 * Now figure out there was a disconnected
@@ -1551,9 +1611,9 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 				if (loc_seconds < 1)
 					continue;
 
-				_remove_job_tres_time_from_cluster(
+				_remove_job_time_from_cluster(
 					loc_c_usage->loc_tres,
-					loc_tres,
+					&job_tres, &tres_pos,
 					loc_seconds);
 				/* info("Job %u was running for " */
 				/*      "%d seconds while " */
@@ -1632,19 +1692,21 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 							loc_seconds,
 							0, 0);
 
-					_add_time_tres_list(
+					_add_job_time_to_resv(
 						r_usage->loc_tres,
-						loc_tres, TIME_ALLOC,
-						loc_seconds, 1);
+						&job_tres, &tres_pos,
+						loc_seconds);
 					if ((rc = _update_unused_wall(
 						     r_usage,
-						     loc_tres,
+						     &job_tres, &tres_pos,
 						     loc_seconds))
 					    != SLURM_SUCCESS)
 						goto end_it;
 				}
 
-				_transfer_loc_tres(&loc_tres, a_usage);
+				if (a_usage)
+					rollup_id_usage_add_job(a_usage,
+								&job_tres);
 				continue;
 			}
 
@@ -1662,14 +1724,12 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 
 				_add_job_alloc_time_to_cluster(
 					c_usage->loc_tres,
-					loc_tres);
+					&job_tres, &tres_pos);
 			}
 
-			/*
-			 * The loc_tres isn't needed after this so transfer to
-			 * the association and go on our merry way.
-			 */
-			_transfer_loc_tres(&loc_tres, a_usage);
+			/* Add the job to the association and go on our way. */
+			if (a_usage)
+				rollup_id_usage_add_job(a_usage, &job_tres);
 
 			_add_planned_time(c_usage, row_start, row_eligible,
 					  array_pending, row_rcpu);
@@ -1685,10 +1745,11 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			ListIterator t_itr;
 			local_tres_usage_t *loc_tres;
 
-			xstrfmtcat(query, "update \"%s_%s\" set unused_wall=%f where id_resv=%u and time_start=%ld;",
-				   cluster_name, resv_table,
-				   r_usage->unused_wall, r_usage->id,
-				   r_usage->orig_start);
+			if (!r_usage->carry)
+				xstrfmtcat(query, "update \"%s_%s\" set unused_wall=%f where id_resv=%u and time_start=%ld;",
+					   cluster_name, resv_table,
+					   r_usage->unused_wall, r_usage->id,
+					   r_usage->orig_start);
 
 			if (!r_usage->loc_tres ||
 			    !list_count(r_usage->loc_tres))
@@ -1722,24 +1783,14 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 					r_usage->local_assocs);
 				while ((assoc = list_next(tmp_itr))) {
 					uint32_t associd = slurm_atoul(assoc);
-					if ((last_id != associd) &&
-					    !(a_usage = list_find_first(
-						      assoc_usage_list,
-						      _find_id_usage,
-						      &associd))) {
-						a_usage = xmalloc(
-							sizeof(local_id_usage_t));
-						a_usage->id = associd;
-						list_append(assoc_usage_list,
-							    a_usage);
-						a_usage->loc_tres = list_create(
-							_destroy_local_tres_usage);
-					}
+					if (last_id != associd)
+						a_usage = rollup_id_table_get(
+							&assoc_usage, associd);
 					last_id = associd;
 
-					_add_time_tres(a_usage->loc_tres,
-						       TIME_ALLOC, loc_tres->id,
-						       resv_unused_secs, 0);
+					rollup_id_usage_add(a_usage, &tres_pos,
+							    loc_tres->id,
+							    resv_unused_secs);
 				}
 				list_iterator_destroy(tmp_itr);
 			}
@@ -1781,11 +1832,17 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 			}
 		}
 
-		list_iterator_reset(a_itr);
-		while ((a_usage = list_next(a_itr)))
-			_create_id_usage_insert(cluster_name, ASSOC_TABLES,
-						curr_start, now,
-						a_usage, &query);
+		if (assoc_usage.list) {
+			a_itr = list_iterator_create(assoc_usage.list);
+			while ((a_usage = list_next(a_itr)))
+				_create_id_usage_insert(cluster_name,
+							ASSOC_TABLES,
+							curr_start, now,
+							a_usage, &tres_pos,
+							&query);
+			list_iterator_destroy(a_itr);
+			a_itr = NULL;
+		}
 		if (query) {
 			DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s",
 			         query);
@@ -1800,11 +1857,17 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		if (!track_wckey)
 			goto end_loop;
 
-		list_iterator_reset(w_itr);
-		while ((w_usage = list_next(w_itr)))
-			_create_id_usage_insert(cluster_name, WCKEY_TABLES,
-						curr_start, now,
-						w_usage, &query);
+		if (wckey_usage.list) {
+			w_itr = list_iterator_create(wckey_usage.list);
+			while ((w_usage = list_next(w_itr)))
+				_create_id_usage_insert(cluster_name,
+							WCKEY_TABLES,
+							curr_start, now,
+							w_usage, &tres_pos,
+							&query);
+			list_iterator_destroy(w_itr);
+			w_itr = NULL;
+		}
 		if (query) {
 			DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s",
 			         query);
@@ -1824,10 +1887,22 @@ extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 		a_usage     = NULL;
 		w_usage     = NULL;
 
-		list_flush(assoc_usage_list);
+		rollup_id_table_flush(&assoc_usage);
 		list_flush(cluster_down_list);
-		list_flush(wckey_usage_list);
+		rollup_id_table_flush(&wckey_usage);
 		list_flush(resv_usage_list);
+
+		if (resv_carry && mysql_db_commit(mysql_conn)) {
+			char start_str[25], end_str[25];
+			error("Couldn't commit cluster (%s) "
+			      "hour rollup for %s - %s",
+			      cluster_name,
+			      slurm_ctime2_r(&curr_start, start_str),
+			      slurm_ctime2_r(&curr_end, end_str));
+			rc = SLURM_ERROR;
+			goto end_it;
+		}
+
 		curr_start = curr_end;
 		curr_end = curr_start + add_sec;
 	}
@@ -1846,36 +1921,21 @@ end_it:
 	if (r_itr)
 		list_iterator_destroy(r_itr);
 
-	FREE_NULL_LIST(assoc_usage_list);
+	rollup_id_table_free(&assoc_usage);
 	FREE_NULL_LIST(cluster_down_list);
-	FREE_NULL_LIST(wckey_usage_list);
+	rollup_id_table_free(&wckey_usage);
 	FREE_NULL_LIST(resv_usage_list);
+	rollup_job_tres_free(&job_tres);
+	rollup_tres_pos_free(&tres_pos);
 
 /* 	info("stop start %s", slurm_ctime2(&curr_start)); */
 /* 	info("stop end %s", slurm_ctime2(&curr_end)); */
 
-	/* go check to see if we archive and purge */
-
-	if (rc == SLURM_SUCCESS) {
-		if (mysql_db_commit(mysql_conn)) {
-			char start[25], end[25];
-			error("Couldn't commit cluster (%s) "
-			      "hour rollup for %s - %s",
-			      cluster_name, slurm_ctime2_r(&curr_start, start),
-			      slurm_ctime2_r(&curr_end, end));
-			rc = SLURM_ERROR;
-		} else
-			rc = _process_purge(mysql_conn, cluster_name,
-					    archive_data, SLURMDB_PURGE_HOURS);
-	}
-
 	return rc;
 }
-extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
-				   bool run_month,
-				   char *cluster_name,
-				   time_t start, time_t end,
-				   uint16_t archive_data)
+
+static int _nonhour_rollup(mysql_conn_t *mysql_conn, bool run_month,
+			   char *cluster_name, time_t start, time_t end)
 {
 	/* can't just add 86400 since daylight savings starts and ends every
 	 * once in a while
@@ -1994,9 +2054,293 @@ extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
 /* 	info("stop start %s", slurm_ctime2(&curr_start)); */
 /* 	info("stop end %s", slurm_ctime2(&curr_end)); */
 
+	return rc;
+}
+
+/* Return the start of the period after the one starting at curr_start */
+static time_t _next_period(time_t curr_start, int type)
+{
+	struct tm start_tm;
+
+	if (type == DBD_ROLLUP_HOUR)
+		return curr_start + 3600;
+
+	if (!localtime_r(&curr_start, &start_tm)) {
+		error("Couldn't get localtime from start %ld", curr_start);
+		return 0;
+	}
+	start_tm.tm_sec = 0;
+	start_tm.tm_min = 0;
+	start_tm.tm_hour = 0;
+
+	if (type == DBD_ROLLUP_MONTH) {
+		start_tm.tm_mday = 1;
+		start_tm.tm_mon++;
+	} else
+		start_tm.tm_mday++;
+
+	return slurm_mktime(&start_tm);
+}
+
+/*
+ * Split start to end into windows of whole periods, as many as there are
+ * rollup_window_min[type] periods for, up to MAX_ROLLUP_WINDOWS.
+ */
+static rollup_window_t *_setup_windows(mysql_conn_t *mysql_conn, int type,
+				       char *cluster_name, time_t start,
+				       time_t end, int *window_cnt)
+{
+	rollup_window_t *windows;
+	int i, cnt, periods = 0, period = 0;
+	time_t curr_start;
+
+	for (curr_start = start; curr_start && (curr_start < end);
+	     curr_start = _next_period(curr_start, type))
+		periods++;
+
+	cnt = periods / rollup_window_min[type];
+	cnt = MIN(cnt, MAX_ROLLUP_WINDOWS);
+	if (!curr_start || (cnt < 1))
+		cnt = 1;
+
+	windows = xcalloc(cnt, sizeof(*windows));
+	curr_start = start;
+	for (i = 0; i < cnt; i++) {
+		int last_period = ((i + 1) * periods) / cnt;
+
+		windows[i].cluster_name = cluster_name;
+		windows[i].conn_id = mysql_conn->conn;
+		windows[i].type = type;
+		windows[i].start = curr_start;
+		for (; period < last_period; period++)
+			curr_start = _next_period(curr_start, type);
+		windows[i].end = (i == (cnt - 1)) ? end : curr_start;
+	}
+
+	*window_cnt = cnt;
+	return windows;
+}
+
+static int _roll_window(mysql_conn_t *mysql_conn, rollup_window_t *window)
+{
+	if (window->type == DBD_ROLLUP_HOUR)
+		return _hourly_rollup(mysql_conn, window->cluster_name,
+				      window->start, window->end,
+				      window->resv_carry);
+
+	return _nonhour_rollup(mysql_conn, (window->type == DBD_ROLLUP_MONTH),
+			       window->cluster_name, window->start,
+			       window->end);
+}
+
+static void *_rollup_window(void *arg)
+{
+	rollup_window_t *window = arg;
+	mysql_conn_t mysql_conn;
+	char start[25], end[25];
+	DEF_TIMERS;
+
+	START_TIMER;
+
+	/* Each window needs its own connection */
+	memset(&mysql_conn, 0, sizeof(mysql_conn_t));
+	mysql_conn.flags |= DB_CONN_FLAG_ROLLBACK;
+	mysql_conn.conn = window->conn_id;
+	slurm_mutex_init(&mysql_conn.lock);
+
+	if ((window->rc = check_connection(&mysql_conn)) == SLURM_SUCCESS)
+		window->rc = _roll_window(&mysql_conn, window);
+
+	if (window->rc == SLURM_SUCCESS) {
+		if (mysql_db_commit(&mysql_conn))
+			window->rc = SLURM_ERROR;
+	} else if (mysql_db_rollback(&mysql_conn))
+		error("rollback failed");
+
+	mysql_db_close_db_connection(&mysql_conn);
+	slurm_mutex_destroy(&mysql_conn.lock);
+
+	END_TIMER;
+	window->usec = DELTA_TIMER;
+
+	slurm_ctime2_r(&window->start, start);
+	slurm_ctime2_r(&window->end, end);
+	if (window->rc != SLURM_SUCCESS)
+		error("Cluster %s %s rollup of %s - %s failed",
+		      window->cluster_name, rollup_type_str[window->type],
+		      start, end);
+	else
+		debug("Cluster %s %s rollup of %s - %s done in %s",
+		      window->cluster_name, rollup_type_str[window->type],
+		      start, end, TIME_STR);
+
+	return NULL;
+}
+
+/*
+ * Give the reservations that ran into a window the unused wall the window
+ * recorded for them, once the windows before it are done.
+ */
+static int _apply_resv_carry(mysql_conn_t *mysql_conn,
+			     rollup_window_t *window)
+{
+	resv_carry_t *carry;
+	ListIterator itr;
+	char *query = NULL;
+	int rc = SLURM_SUCCESS;
+
+	itr = list_iterator_create(window->resv_carry);
+	while ((carry = list_next(itr))) {
+		if (carry->unused_min < 0)
+			xstrfmtcat(query, "update \"%s_%s\" set unused_wall=unused_wall+%f where id_resv=%u and time_start=%ld;",
+				   window->cluster_name, resv_table,
+				   carry->unused_add, carry->id,
+				   carry->orig_start);
+		else
+			xstrfmtcat(query, "update \"%s_%s\" set unused_wall=greatest(%f, unused_wall+%f) where id_resv=%u and time_start=%ld;",
+				   window->cluster_name, resv_table,
+				   carry->unused_min, carry->unused_add,
+				   carry->id, carry->orig_start);
+	}
+	list_iterator_destroy(itr);
+
+	if (query) {
+		DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+		if (rc != SLURM_SUCCESS)
+			error("couldn't update reservations with unused time");
+	}
+
+	return rc;
+}
+
+/*
+ * Roll up start to end. Long spans are split into windows rolled up at the
+ * same time on their own connections, each committing as it goes.
+ * Everything else is done on mysql_conn and left for the caller to commit.
+ */
+static int _rollup_windows(mysql_conn_t *mysql_conn, int type,
+			   char *cluster_name, time_t start, time_t end,
+			   slurmdb_rollup_stats_t *rollup_stats)
+{
+	rollup_window_t *windows;
+	int i, cnt, rc = SLURM_SUCCESS;
+	uint64_t usec_max = 0;
+	DEF_TIMERS;
+
+	windows = _setup_windows(mysql_conn, type, cluster_name, start, end,
+				 &cnt);
+
+	if (cnt == 1) {
+		START_TIMER;
+		rc = _roll_window(mysql_conn, windows);
+		END_TIMER;
+		usec_max = DELTA_TIMER;
+		goto end_it;
+	}
+
+	debug("Cluster %s %s rollup split into %d windows",
+	      cluster_name, rollup_type_str[type], cnt);
+
+	for (i = 0; i < cnt; i++) {
+		if (type == DBD_ROLLUP_HOUR)
+			windows[i].resv_carry = list_create(xfree_ptr);
+		slurm_thread_create(&windows[i].tid, _rollup_window,
+				    &windows[i]);
+	}
+
+	for (i = 0; i < cnt; i++) {
+		pthread_join(windows[i].tid, NULL);
+		usec_max = MAX(usec_max, windows[i].usec);
+		if (windows[i].rc != SLURM_SUCCESS)
+			rc = windows[i].rc;
+	}
+
+	/*
+	 * In order, as each window starts with the unused wall the one before
+	 * it left.
+	 */
+	for (i = 0; (rc == SLURM_SUCCESS) && (i < cnt); i++) {
+		if (windows[i].resv_carry)
+			rc = _apply_resv_carry(mysql_conn, &windows[i]);
+	}
+
+end_it:
+	if (rollup_stats) {
+		rollup_stats->windows[type] = cnt;
+		rollup_stats->time_window_max[type] = usec_max;
+	}
+
+	for (i = 0; i < cnt; i++)
+		FREE_NULL_LIST(windows[i].resv_carry);
+	xfree(windows);
+
+	return rc;
+}
+
+extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
+				  char *cluster_name,
+				  time_t start, time_t end,
+				  uint16_t archive_data,
+				  bool set_last_ran,
+				  slurmdb_rollup_stats_t *rollup_stats)
+{
+	char *query;
+	int rc;
+
+	rc = _rollup_windows(mysql_conn, DBD_ROLLUP_HOUR, cluster_name,
+			     start, end, rollup_stats);
+
+	/*
+	 * The unused wall of reservations running before start was read from
+	 * and written back to the reservation table. Move the last ran time in
+	 * the same transaction so these hours are never rolled up on top of it
+	 * again.
+	 */
+	if ((rc == SLURM_SUCCESS) && set_last_ran) {
+		query = xstrdup_printf("update \"%s_%s\" set hourly_rollup=%ld",
+				       cluster_name, last_ran_table, end);
+		DB_DEBUG(DB_USAGE, mysql_conn->conn, "query\n%s", query);
+		rc = mysql_db_query(mysql_conn, query);
+		xfree(query);
+	}
+
 	/* go check to see if we archive and purge */
-	rc = _process_purge(mysql_conn, cluster_name, archive_data,
-			    run_month ? SLURMDB_PURGE_MONTHS :
-			    SLURMDB_PURGE_DAYS);
+
+	if (rc == SLURM_SUCCESS) {
+		if (mysql_db_commit(mysql_conn)) {
+			char start_str[25], end_str[25];
+			error("Couldn't commit cluster (%s) "
+			      "hour rollup for %s - %s",
+			      cluster_name, slurm_ctime2_r(&start, start_str),
+			      slurm_ctime2_r(&end, end_str));
+			rc = SLURM_ERROR;
+		} else
+			rc = _process_purge(mysql_conn, cluster_name,
+					    archive_data, SLURMDB_PURGE_HOURS);
+	}
+
 	return rc;
 }
+
+extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
+				   bool run_month,
+				   char *cluster_name,
+				   time_t start, time_t end,
+				   uint16_t archive_data,
+				   slurmdb_rollup_stats_t *rollup_stats)
+{
+	int rc;
+
+	if ((rc = _rollup_windows(mysql_conn,
+				  run_month ? DBD_ROLLUP_MONTH : DBD_ROLLUP_DAY,
+				  cluster_name, start, end, rollup_stats))
+	    != SLURM_SUCCESS)
+		return rc;
+
+	/* go check to see if we archive and purge */
+	return _process_purge(mysql_conn, cluster_name, archive_data,
+			      run_month ? SLURMDB_PURGE_MONTHS :
+			      SLURMDB_PURGE_DAYS);
+}
@@ -43,15 +43,23 @@
 
 #include "accounting_storage_mysql.h"
 
+/*
+ * The hourly rollup is committed here, before any purge. With set_last_ran the
+ * cluster's hourly_rollup time is moved to end in the same commit, so a rerun
+ * never applies the reservation unused wall of these hours twice.
+ */
 extern int as_mysql_hourly_rollup(mysql_conn_t *mysql_conn,
 				  char *cluster_name,
 				  time_t start,
 				  time_t end,
-				  uint16_t archive_data);
+				  uint16_t archive_data,
+				  bool set_last_ran,
+				  slurmdb_rollup_stats_t *rollup_stats);
 extern int as_mysql_nonhour_rollup(mysql_conn_t *mysql_conn,
 				   bool run_month,
 				   char *cluster_name,
 				   time_t start,
 				   time_t end,
-				   uint16_t archive_data);
+				   uint16_t archive_data,
+				   slurmdb_rollup_stats_t *rollup_stats);
 #endif
@@ -0,0 +1,286 @@
+/*****************************************************************************\
+ *  as_mysql_rollup_usage.c - in memory accumulation of the hourly rollup
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "as_mysql_rollup_usage.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/slurmdb_defs.h"
+#include "src/common/xmalloc.h"
+
+static void _destroy_local_id_usage(void *object)
+{
+	local_id_usage_t *usage = object;
+
+	if (usage) {
+		xfree(usage->time_alloc);
+		xfree(usage);
+	}
+}
+
+extern int rollup_tres_pos_get(rollup_tres_pos_t *tres_pos, uint32_t id)
+{
+	int pos;
+
+	if ((pos = rollup_tres_pos_find(tres_pos, id)) >= 0)
+		return pos;
+
+	if (id >= tres_pos->pos_size) {
+		uint32_t size = MAX(id + 1, tres_pos->pos_size * 2);
+
+		xrecalloc(tres_pos->pos, size, sizeof(*tres_pos->pos));
+		tres_pos->pos_size = size;
+	}
+	if (tres_pos->cnt >= tres_pos->id_size) {
+		tres_pos->id_size = MAX(16, tres_pos->id_size * 2);
+		xrecalloc(tres_pos->id, tres_pos->id_size,
+			  sizeof(*tres_pos->id));
+	}
+
+	pos = tres_pos->cnt++;
+	tres_pos->id[pos] = id;
+	tres_pos->pos[id] = pos + 1;
+
+	return pos;
+}
+
+extern int rollup_tres_pos_find(rollup_tres_pos_t *tres_pos, uint32_t id)
+{
+	if (id >= tres_pos->pos_size)
+		return -1;
+	return tres_pos->pos[id] - 1;
+}
+
+extern void rollup_tres_pos_free(rollup_tres_pos_t *tres_pos)
+{
+	xfree(tres_pos->id);
+	xfree(tres_pos->pos);
+	memset(tres_pos, 0, sizeof(*tres_pos));
+}
+
+static void _job_tres_clear(local_job_tres_t *job_tres)
+{
+	for (int i = 0; i < job_tres->used_cnt; i++) {
+		job_tres->count[job_tres->used[i]] = 0;
+		job_tres->time_alloc[job_tres->used[i]] = 0;
+	}
+	job_tres->used_cnt = 0;
+}
+
+static void _job_tres_add(local_job_tres_t *job_tres,
+			  rollup_tres_pos_t *tres_pos, uint32_t id,
+			  uint64_t count, uint64_t time)
+{
+	int pos;
+
+	/*
+	 * Energy TRES could have a NO_VAL64, we want to skip those as it is
+	 * the same as a 0 since nothing was gathered.
+	 */
+	if (!time || (time == NO_VAL64))
+		return;
+
+	pos = rollup_tres_pos_get(tres_pos, id);
+	if (pos >= job_tres->size) {
+		int size = MAX(tres_pos->cnt, job_tres->size * 2);
+
+		xrecalloc(job_tres->count, size, sizeof(*job_tres->count));
+		xrecalloc(job_tres->time_alloc, size,
+			  sizeof(*job_tres->time_alloc));
+		xrecalloc(job_tres->used, size, sizeof(*job_tres->used));
+		job_tres->size = size;
+	}
+
+	if (!job_tres->time_alloc[pos]) {
+		job_tres->used[job_tres->used_cnt++] = pos;
+		job_tres->count[pos] = count;
+	}
+	job_tres->time_alloc[pos] += time;
+}
+
+extern void rollup_job_tres_set(local_job_tres_t *job_tres,
+				rollup_tres_pos_t *tres_pos, char *tres_str,
+				int seconds, int suspend_seconds)
+{
+	char *tmp_str = tres_str;
+	int id;
+	uint64_t time, count;
+
+	_job_tres_clear(job_tres);
+
+	if (!tres_str || !tres_str[0])
+		return;
+
+	while (tmp_str) {
+		int loc_seconds = seconds;
+
+		id = atoi(tmp_str);
+		if (id < 1) {
+			error("%s: no id found at %s", __func__, tmp_str);
+			break;
+		}
+		if (!(tmp_str = strchr(tmp_str, '='))) {
+			error("%s: no value found for id %d '%s'",
+			      __func__, id, tres_str);
+			xassert(0);
+			break;
+		}
+
+		/*
+		 * Take away suspended time from TRES that are idle when the
+		 * job was suspended, currently only CPU's fill that bill.
+		 */
+		if (suspend_seconds && (id == TRES_CPU)) {
+			loc_seconds -= suspend_seconds;
+			if (loc_seconds < 1)
+				loc_seconds = 0;
+		}
+
+		time = count = slurm_atoull(++tmp_str);
+		/*
+		 * ENERGY is already totalled for the entire job so don't
+		 * multiple with time.
+		 */
+		if (id != TRES_ENERGY)
+			time *= loc_seconds;
+
+		_job_tres_add(job_tres, tres_pos, id, count, time);
+
+		if (!(tmp_str = strchr(tmp_str, ',')))
+			break;
+		tmp_str++;
+	}
+}
+
+extern int rollup_job_tres_find(local_job_tres_t *job_tres,
+				rollup_tres_pos_t *tres_pos, uint32_t id)
+{
+	int pos = rollup_tres_pos_find(tres_pos, id);
+
+	if ((pos < 0) || (pos >= job_tres->size) ||
+	    !job_tres->time_alloc[pos])
+		return -1;
+	return pos;
+}
+
+extern void rollup_job_tres_free(local_job_tres_t *job_tres)
+{
+	xfree(job_tres->count);
+	xfree(job_tres->time_alloc);
+	xfree(job_tres->used);
+	memset(job_tres, 0, sizeof(*job_tres));
+}
+
+static void _id_usage_grow(local_id_usage_t *usage, int cnt)
+{
+	if (cnt <= usage->tres_cnt)
+		return;
+	xrecalloc(usage->time_alloc, cnt, sizeof(*usage->time_alloc));
+	usage->tres_cnt = cnt;
+}
+
+extern void rollup_id_usage_add(local_id_usage_t *usage,
+				rollup_tres_pos_t *tres_pos, uint32_t id,
+				uint64_t time)
+{
+	int pos;
+
+	if (!time || (time == NO_VAL64))
+		return;
+
+	pos = rollup_tres_pos_get(tres_pos, id);
+	_id_usage_grow(usage, tres_pos->cnt);
+	usage->time_alloc[pos] += time;
+}
+
+extern void rollup_id_usage_add_job(local_id_usage_t *usage,
+				    local_job_tres_t *job_tres)
+{
+	if (!job_tres->used_cnt)
+		return;
+
+	/* Every position the job uses is below its size */
+	_id_usage_grow(usage, job_tres->size);
+	for (int i = 0; i < job_tres->used_cnt; i++) {
+		int pos = job_tres->used[i];
+
+		usage->time_alloc[pos] += job_tres->time_alloc[pos];
+	}
+}
+
+extern local_id_usage_t *rollup_id_table_get(local_id_table_t *table,
+					     uint32_t id)
+{
+	local_id_usage_t *usage;
+
+	if (!table->hash)
+		table->hash = id_hash_create(0);
+	if (!table->list)
+		table->list = list_create(_destroy_local_id_usage);
+
+	if ((usage = id_hash_find(table->hash, id)))
+		return usage;
+
+	usage = xmalloc(sizeof(*usage));
+	usage->id = id;
+	id_hash_add(table->hash, id, usage);
+	list_append(table->list, usage);
+
+	return usage;
+}
+
+extern void rollup_id_table_flush(local_id_table_t *table)
+{
+	/* Start the next hour sized for what was in this one */
+	if (table->hash) {
+		uint32_t cnt = id_hash_count(table->hash);
+
+		id_hash_destroy(table->hash);
+		table->hash = id_hash_create(cnt);
+	}
+	if (table->list)
+		list_flush(table->list);
+}
+
+extern void rollup_id_table_free(local_id_table_t *table)
+{
+	if (table->hash) {
+		id_hash_destroy(table->hash);
+		table->hash = NULL;
+	}
+	FREE_NULL_LIST(table->list);
+}
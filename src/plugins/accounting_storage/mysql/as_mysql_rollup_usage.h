@@ -0,0 +1,127 @@
+/*****************************************************************************\
+ *  as_mysql_rollup_usage.h - in memory accumulation of the hourly rollup
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _HAVE_MYSQL_ROLLUP_USAGE_H
+#define _HAVE_MYSQL_ROLLUP_USAGE_H
+
+#include <inttypes.h>
+
+#include "src/common/id_hash.h"
+#include "src/common/list.h"
+
+/*
+ * Nothing in here talks to the database so it can be exercised on its own.
+ * None of it is thread safe, each rollup keeps its own.
+ */
+
+/*
+ * TRES ids are sparse (the dynamic ones start at TRES_OFFSET) so each id seen
+ * is handed a dense position, usage is then kept in arrays indexed by it.
+ */
+typedef struct {
+	int cnt;		/* positions handed out */
+	uint32_t *id;		/* TRES id of each position */
+	int id_size;		/* size of id */
+	int *pos;		/* position + 1 of each TRES id, 0 if unseen */
+	uint32_t pos_size;	/* size of pos */
+} rollup_tres_pos_t;
+
+/*
+ * TRES of the job being rolled up. A position is only used if it has time,
+ * those positions are listed in used so clearing doesn't cost every TRES.
+ */
+typedef struct {
+	uint64_t *count;	/* indexed by TRES position */
+	int size;		/* size of the arrays */
+	uint64_t *time_alloc;	/* indexed by TRES position */
+	int *used;		/* positions with time */
+	int used_cnt;
+} local_job_tres_t;
+
+/* Allocated time of an association or wckey, indexed by TRES position */
+typedef struct {
+	uint32_t id;
+	uint64_t *time_alloc;
+	int tres_cnt;		/* size of time_alloc */
+} local_id_usage_t;
+
+/* Associations or wckeys with usage in the hour being rolled up */
+typedef struct {
+	id_hash_t *hash;	/* local_id_usage_t by id */
+	List list;		/* local_id_usage_t in the order added */
+} local_id_table_t;
+
+/* RET position of TRES id, handing it a new one if not seen before */
+extern int rollup_tres_pos_get(rollup_tres_pos_t *tres_pos, uint32_t id);
+
+/* RET position of TRES id or -1 if not seen before */
+extern int rollup_tres_pos_find(rollup_tres_pos_t *tres_pos, uint32_t id);
+
+extern void rollup_tres_pos_free(rollup_tres_pos_t *tres_pos);
+
+/*
+ * Set job_tres from a job's tres_alloc string ("id=count,...") that ran
+ * seconds, suspend_seconds of which only take CPU time away.
+ * Energy is already a total for the job so it isn't multiplied by seconds.
+ */
+extern void rollup_job_tres_set(local_job_tres_t *job_tres,
+				rollup_tres_pos_t *tres_pos, char *tres_str,
+				int seconds, int suspend_seconds);
+
+/* RET position of TRES id in job_tres or -1 if the job has no time for it */
+extern int rollup_job_tres_find(local_job_tres_t *job_tres,
+				rollup_tres_pos_t *tres_pos, uint32_t id);
+
+extern void rollup_job_tres_free(local_job_tres_t *job_tres);
+
+/* Add time to TRES id of usage, NO_VAL64 is taken as no time */
+extern void rollup_id_usage_add(local_id_usage_t *usage,
+				rollup_tres_pos_t *tres_pos, uint32_t id,
+				uint64_t time);
+
+/* Add the allocated time of job_tres to usage */
+extern void rollup_id_usage_add_job(local_id_usage_t *usage,
+				    local_job_tres_t *job_tres);
+
+/* RET usage of id in table, adding it if not there already */
+extern local_id_usage_t *rollup_id_table_get(local_id_table_t *table,
+					     uint32_t id);
+
+/* Remove all the usage in table, keeping it ready for the next hour */
+extern void rollup_id_table_flush(local_id_table_t *table);
+
+extern void rollup_id_table_free(local_id_table_t *table);
+
+#endif
@@ -300,7 +300,9 @@ static void *_cluster_rollup_usage(void *arg)
 					    local_rollup->cluster_name,
 					    hour_start,
 					    hour_end,
-					    local_rollup->archive_data);
+					    local_rollup->archive_data,
+					    !local_rollup->sent_end,
+					    rollup_stats);
 		snprintf(timer_str, sizeof(timer_str),
 			 "hourly_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
@@ -316,7 +318,8 @@ static void *_cluster_rollup_usage(void *arg)
 					     local_rollup->cluster_name,
 					     day_start,
 					     day_end,
-					     local_rollup->archive_data);
+					     local_rollup->archive_data,
+					     rollup_stats);
 		snprintf(timer_str, sizeof(timer_str),
 			 "daily_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
@@ -332,7 +335,8 @@ static void *_cluster_rollup_usage(void *arg)
 					     local_rollup->cluster_name,
 					     month_start,
 					     month_end,
-					     local_rollup->archive_data);
+					     local_rollup->archive_data,
+					     rollup_stats);
 		snprintf(timer_str, sizeof(timer_str),
 			 "monthly_rollup for %s", local_rollup->cluster_name);
 		END_TIMER3(timer_str, 5000000);
@@ -342,14 +346,11 @@ static void *_cluster_rollup_usage(void *arg)
 			goto end_it;
 	}
 
-	if ((hour_end - hour_start) > 0) {
-		/* If we have a sent_end do not update the last_run_table */
-		if (!local_rollup->sent_end)
-			query = xstrdup_printf(
-				"update \"%s_%s\" set hourly_rollup=%ld",
-				local_rollup->cluster_name,
-				last_ran_table, hour_end);
-	} else
+	/*
+	 * If we have a sent_end do not update the last_run_table. The hourly
+	 * rollup time was already set when the hours were committed.
+	 */
+	if ((hour_end - hour_start) <= 0)
 		debug2("No need to roll cluster %s this hour %ld <= %ld",
 		       local_rollup->cluster_name, hour_end, hour_start);
 
@@ -3191,6 +3191,14 @@ extern int jobacct_storage_p_step_complete(void *db_conn,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Steps are already sent in batches through the slurmdbd agent queue.
+ */
+extern int jobacct_storage_p_step_batch(void *db_conn, bool enable)
+{
+	return SLURM_SUCCESS;
+}
+
 /*
  * load into the storage a suspension of a job
  */
@@ -3274,6 +3282,90 @@ extern List jobacct_storage_p_get_jobs_cond(void *db_conn, uid_t uid,
 	return my_job_list;
 }
 
+/*
+ * get info from the storage one part at a time
+ */
+extern int jobacct_storage_p_get_jobs_cond_parts(void *db_conn, uid_t uid,
+						 slurmdb_job_cond_t *job_cond,
+						 ListForF f, void *arg)
+{
+	persist_msg_t req = {0}, resp = {0};
+	dbd_cond_msg_t get_msg = { .cond = job_cond };
+	dbd_list_msg_t *got_msg;
+	uint32_t flags = job_cond->flags;
+	bool last = false, stop = false;
+	int rc;
+
+	/* The agent only handles single replies, get the jobs in one part */
+	if (running_in_slurmctld() &&
+	    (!db_conn || (db_conn == slurmdbd_conn))) {
+		List job_list = jobacct_storage_p_get_jobs_cond(db_conn, uid,
+								job_cond);
+		if (!job_list)
+			return SLURM_ERROR;
+		if (list_count(job_list))
+			(void) f(job_list, arg);
+		FREE_NULL_LIST(job_list);
+		return SLURM_SUCCESS;
+	}
+
+	req.msg_type = DBD_GET_JOBS_COND;
+	req.conn = db_conn;
+	req.data = &get_msg;
+
+	job_cond->flags |= JOBCOND_FLAG_STREAM;
+	rc = dbd_conn_send_recv_direct(SLURM_PROTOCOL_VERSION, &req, &resp);
+	job_cond->flags = flags;
+
+	/*
+	 * A SlurmDBD that does not send parts answers with just DBD_GOT_JOBS.
+	 * Every part is read even after f asked to stop so the connection
+	 * stays in step with the replies.
+	 */
+	while ((rc == SLURM_SUCCESS) && !last) {
+		if (resp.msg_type == PERSIST_RC) {
+			persist_rc_msg_t *msg = resp.data;
+			if ((rc = msg->rc) == SLURM_SUCCESS) {
+				info("%s", msg->comment);
+			} else {
+				slurm_seterrno(msg->rc);
+				error("%s", msg->comment);
+			}
+			slurm_persist_free_rc_msg(msg);
+			break;
+		} else if ((resp.msg_type != DBD_GOT_JOBS_PART) &&
+			   (resp.msg_type != DBD_GOT_JOBS)) {
+			error("response type not DBD_GOT_JOBS: %u",
+			      resp.msg_type);
+			rc = SLURM_ERROR;
+			break;
+		}
+
+		last = (resp.msg_type == DBD_GOT_JOBS);
+		got_msg = resp.data;
+		if (!got_msg->my_list) {
+			slurm_seterrno(got_msg->return_code);
+			error("%s", slurm_strerror(got_msg->return_code));
+			rc = SLURM_ERROR;
+		} else if (!stop && list_count(got_msg->my_list) &&
+			   (f(got_msg->my_list, arg) < 0)) {
+			stop = true;
+		}
+		slurmdbd_free_list_msg(got_msg);
+
+		if (!last && (rc == SLURM_SUCCESS)) {
+			memset(&resp, 0, sizeof(resp));
+			rc = dbd_conn_recv_direct(SLURM_PROTOCOL_VERSION,
+						  db_conn, &resp);
+		}
+	}
+
+	if (rc != SLURM_SUCCESS)
+		error("DBD_GET_JOBS_COND failure: %s", slurm_strerror(rc));
+
+	return rc;
+}
+
 /*
  * Expire old info from the storage
  * Not applicable for any database
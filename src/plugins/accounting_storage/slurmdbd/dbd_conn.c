@@ -309,6 +309,30 @@ end_it:
 	return rc;
 }
 
+extern int dbd_conn_recv_direct(uint16_t rpc_version,
+				slurm_persist_conn_t *pc,
+				persist_msg_t *resp)
+{
+	int rc;
+	buf_t *buffer;
+
+	xassert(pc);
+	xassert(resp);
+
+	if (!(buffer = slurm_persist_recv_msg(pc))) {
+		error("Getting next part of response");
+		return SLURM_ERROR;
+	}
+
+	rc = unpack_slurmdbd_msg(resp, rpc_version, buffer);
+	FREE_NULL_BUFFER(buffer);
+
+	log_flag(PROTOCOL, "protocol_version:%hu return_code:%d response_msg_type:%s",
+		 rpc_version, rc, slurmdbd_msg_type_2_str(resp->msg_type, 1));
+
+	return rc;
+}
+
 extern int dbd_conn_send_recv_rc_comment_msg(uint16_t rpc_version,
 					     persist_msg_t *req,
 					     int *resp_code,
@@ -0,0 +1,657 @@
+/****************************************************************************\
+ *  dbd_spool.c - on disk queue of messages pending for the SlurmDBD
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/common/slurm_xlator.h"
+#include "src/common/slurmdbd_pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "dbd_spool.h"
+
+#define SPOOL_SEG_SIZE	(16 * 1024 * 1024)
+
+typedef struct {
+	char *addr;		/* NULL if not mapped */
+	uint32_t head;		/* offset of the oldest message maybe unsent */
+	uint32_t pending;	/* messages not sent */
+	uint32_t seq;		/* file name */
+	uint32_t size;		/* of the file */
+	uint32_t used;		/* offset the next message goes at */
+} spool_seg_t;
+
+static uint32_t crc_table[256];
+static uint32_t inflight_cnt = 0;
+static uint32_t next_seq = 0;
+static uint32_t pending_cnt = 0;
+static List seg_list = NULL;		/* spool_seg_t, oldest first */
+static char *spool_dir = NULL;
+static spool_seg_t *tail_seg = NULL;	/* taking new messages */
+
+static void _crc_init(void)
+{
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+
+		for (int k = 0; k < 8; k++)
+			c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+		crc_table[i] = c;
+	}
+}
+
+static uint32_t _crc32(const char *data, uint32_t size)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (uint32_t i = 0; i < size; i++)
+		crc = crc_table[(crc ^ (uint8_t) data[i]) & 0xFF] ^ (crc >> 8);
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+static char *_seg_path(uint32_t seq)
+{
+	return xstrdup_printf("%s/%010u.seg", spool_dir, seq);
+}
+
+static int _seg_map(spool_seg_t *seg)
+{
+	char *path;
+	int fd;
+
+	if (seg->addr)
+		return SLURM_SUCCESS;
+
+	path = _seg_path(seg->seq);
+	if ((fd = open(path, O_RDWR | O_CLOEXEC)) < 0) {
+		error("%s: open(%s): %m", __func__, path);
+		xfree(path);
+		return SLURM_ERROR;
+	}
+	seg->addr = mmap(NULL, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 fd, 0);
+	if (seg->addr == MAP_FAILED) {
+		error("%s: mmap(%s): %m", __func__, path);
+		seg->addr = NULL;
+	}
+	(void) close(fd);
+	xfree(path);
+
+	return seg->addr ? SLURM_SUCCESS : SLURM_ERROR;
+}
+
+static void _seg_unmap(spool_seg_t *seg)
+{
+	if (!seg->addr)
+		return;
+	(void) munmap(seg->addr, seg->size);
+	seg->addr = NULL;
+}
+
+static void _seg_destroy(void *x)
+{
+	spool_seg_t *seg = x;
+
+	_seg_unmap(seg);
+	xfree(seg);
+}
+
+/* Unlink seg and remove it from the spool */
+static void _seg_remove(spool_seg_t *seg)
+{
+	char *path = _seg_path(seg->seq);
+
+	if (unlink(path) && (errno != ENOENT))
+		error("%s: unlink(%s): %m", __func__, path);
+	xfree(path);
+
+	if (seg == tail_seg)
+		tail_seg = NULL;
+	list_delete_ptr(seg_list, seg);
+}
+
+static spool_rec_t *_seg_rec(spool_seg_t *seg, uint32_t offset)
+{
+	return (spool_rec_t *) (seg->addr + offset);
+}
+
+/* Move the head of seg past the messages already sent */
+static void _seg_skip_sent(spool_seg_t *seg)
+{
+	while (seg->head < seg->used) {
+		spool_rec_t *rec = _seg_rec(seg, seg->head);
+
+		if (!(rec->flags & SPOOL_REC_SENT))
+			break;
+		seg->head += SPOOL_REC_LEN(rec->size);
+	}
+}
+
+/*
+ * Find the messages of a segment left by the last slurmctld. The first
+ * message that isn't whole ends the segment, it was being written when the
+ * slurmctld died.
+ */
+static int _seg_scan(spool_seg_t *seg)
+{
+	uint32_t offset = 0;
+
+	if (_seg_map(seg))
+		return SLURM_ERROR;
+
+	seg->head = UINT32_MAX;
+	while ((offset + sizeof(spool_rec_t)) <= seg->size) {
+		spool_rec_t *rec = _seg_rec(seg, offset);
+
+		if (rec->magic != SPOOL_REC_MAGIC) {
+			if (rec->magic)
+				error("%s: bad record at %u in segment %u, ignoring the rest of it",
+				      __func__, offset, seg->seq);
+			break;
+		}
+		if ((rec->size > seg->size) ||
+		    ((offset + SPOOL_REC_LEN(rec->size)) > seg->size) ||
+		    (_crc32((char *) (rec + 1), rec->size) != rec->crc)) {
+			error("%s: corrupt record at %u in segment %u, ignoring the rest of it",
+			      __func__, offset, seg->seq);
+			break;
+		}
+
+		if (!(rec->flags & SPOOL_REC_SENT)) {
+			if (seg->head == UINT32_MAX)
+				seg->head = offset;
+			seg->pending++;
+		}
+		offset += SPOOL_REC_LEN(rec->size);
+	}
+	seg->used = offset;
+	if (seg->head == UINT32_MAX)
+		seg->head = offset;
+
+	return SLURM_SUCCESS;
+}
+
+/* Unmap the segments that are neither the oldest nor taking new messages */
+static void _unmap_middle(void)
+{
+	list_itr_t *itr = list_iterator_create(seg_list);
+	spool_seg_t *seg, *head_seg = list_peek(seg_list);
+
+	while ((seg = list_next(itr))) {
+		if ((seg != head_seg) && (seg != tail_seg))
+			_seg_unmap(seg);
+	}
+	list_iterator_destroy(itr);
+}
+
+/* Remove the segments with nothing left to send, except the tail */
+static void _remove_sent_segs(void)
+{
+	list_itr_t *itr = list_iterator_create(seg_list);
+	spool_seg_t *seg;
+
+	while ((seg = list_next(itr))) {
+		if (seg->pending || (seg == tail_seg))
+			continue;
+		char *path = _seg_path(seg->seq);
+		if (unlink(path) && (errno != ENOENT))
+			error("%s: unlink(%s): %m", __func__, path);
+		xfree(path);
+		list_delete_item(itr);
+	}
+	list_iterator_destroy(itr);
+}
+
+static spool_seg_t *_seg_create(uint32_t min_size)
+{
+	spool_seg_t *seg;
+	char *path;
+	int fd, rc;
+
+	seg = xmalloc(sizeof(*seg));
+	seg->seq = next_seq++;
+	seg->size = MAX(SPOOL_SEG_SIZE, min_size);
+
+	path = _seg_path(seg->seq);
+	if ((fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600)) < 0) {
+		error("%s: open(%s): %m", __func__, path);
+		goto fail;
+	}
+	/* Allocate it all now, running out of disk through a mapping is fatal */
+	if ((rc = posix_fallocate(fd, 0, seg->size))) {
+		errno = rc;
+		error("%s: posix_fallocate(%s): %m", __func__, path);
+		(void) close(fd);
+		(void) unlink(path);
+		goto fail;
+	}
+	(void) close(fd);
+	if (_seg_map(seg)) {
+		(void) unlink(path);
+		goto fail;
+	}
+	xfree(path);
+
+	/* The old tail only stays mapped if it is still being sent */
+	if (tail_seg && (tail_seg != list_peek(seg_list)))
+		_seg_unmap(tail_seg);
+	list_append(seg_list, seg);
+	tail_seg = seg;
+
+	return seg;
+
+fail:
+	xfree(path);
+	xfree(seg);
+	return NULL;
+}
+
+static int _cmp_seq(const void *a, const void *b)
+{
+	uint32_t x = *(uint32_t *) a, y = *(uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+/* Recover the segments found in spool_dir, oldest first */
+static int _load_segs(void)
+{
+	DIR *dp;
+	struct dirent *ent;
+	uint32_t *seqs = NULL;
+	int seq_cnt = 0, seq_size = 0;
+
+	if (!(dp = opendir(spool_dir))) {
+		error("%s: opendir(%s): %m", __func__, spool_dir);
+		return SLURM_ERROR;
+	}
+	while ((ent = readdir(dp))) {
+		uint32_t seq;
+		char end[5];
+
+		if ((sscanf(ent->d_name, "%10u%4s", &seq, end) != 2) ||
+		    xstrcmp(end, ".seg"))
+			continue;
+		if (seq_cnt >= seq_size) {
+			seq_size = MAX(16, seq_size * 2);
+			xrecalloc(seqs, seq_size, sizeof(*seqs));
+		}
+		seqs[seq_cnt++] = seq;
+	}
+	closedir(dp);
+
+	if (seq_cnt)
+		qsort(seqs, seq_cnt, sizeof(*seqs), _cmp_seq);
+
+	for (int i = 0; i < seq_cnt; i++) {
+		spool_seg_t *seg = xmalloc(sizeof(*seg));
+		char *path;
+		struct stat st;
+
+		seg->seq = seqs[i];
+		next_seq = seg->seq + 1;
+		path = _seg_path(seg->seq);
+		if (stat(path, &st) || (st.st_size < sizeof(spool_rec_t)) ||
+		    (st.st_size > UINT32_MAX) ||
+		    (seg->size = st.st_size, _seg_scan(seg))) {
+			error("%s: unable to recover %s, leaving it alone",
+			      __func__, path);
+			xfree(path);
+			_seg_destroy(seg);
+			continue;
+		}
+
+		if (!seg->pending) {
+			(void) unlink(path);
+			_seg_destroy(seg);
+		} else {
+			pending_cnt += seg->pending;
+			list_append(seg_list, seg);
+			if (seg != list_peek(seg_list))
+				_seg_unmap(seg);
+		}
+		xfree(path);
+	}
+	xfree(seqs);
+
+	return SLURM_SUCCESS;
+}
+
+extern int dbd_spool_init(const char *dir, bool create)
+{
+	struct stat st;
+
+	if (seg_list)
+		return SLURM_SUCCESS;
+
+	if (stat(dir, &st)) {
+		if (errno != ENOENT) {
+			error("%s: stat(%s): %m", __func__, dir);
+			return SLURM_ERROR;
+		}
+		if (!create)
+			return SLURM_ERROR;
+		if (mkdir(dir, 0700) && (errno != EEXIST)) {
+			error("%s: mkdir(%s): %m", __func__, dir);
+			return SLURM_ERROR;
+		}
+	}
+
+	_crc_init();
+	spool_dir = xstrdup(dir);
+	seg_list = list_create(_seg_destroy);
+	pending_cnt = inflight_cnt = next_seq = 0;
+	tail_seg = NULL;
+
+	if (_load_segs()) {
+		FREE_NULL_LIST(seg_list);
+		xfree(spool_dir);
+		return SLURM_ERROR;
+	}
+
+	verbose("recovered %u pending RPCs from %s", pending_cnt, spool_dir);
+
+	return SLURM_SUCCESS;
+}
+
+extern void dbd_spool_fini(void)
+{
+	list_itr_t *itr;
+	spool_seg_t *seg;
+
+	if (!seg_list)
+		return;
+
+	itr = list_iterator_create(seg_list);
+	while ((seg = list_next(itr))) {
+		if (seg->addr && msync(seg->addr, seg->size, MS_SYNC))
+			error("%s: msync segment %u: %m", __func__, seg->seq);
+	}
+	list_iterator_destroy(itr);
+
+	if (tail_seg && !tail_seg->pending)
+		_seg_remove(tail_seg);
+	tail_seg = NULL;
+	FREE_NULL_LIST(seg_list);
+
+	if (rmdir(spool_dir) && (errno != ENOTEMPTY) && (errno != EEXIST))
+		error("%s: rmdir(%s): %m", __func__, spool_dir);
+	verbose("left %u pending RPCs in %s", pending_cnt, spool_dir);
+	xfree(spool_dir);
+	pending_cnt = inflight_cnt = 0;
+}
+
+extern int dbd_spool_append(buf_t *buffer, uint16_t rpc_version)
+{
+	uint32_t size = get_buf_offset(buffer);
+	uint32_t len = SPOOL_REC_LEN(size);
+	spool_rec_t *rec;
+	uint16_t msg_type;
+
+	xassert(seg_list);
+
+	if (size < sizeof(msg_type))
+		return SLURM_ERROR;
+
+	if ((!tail_seg || ((tail_seg->used + len) > tail_seg->size)) &&
+	    !_seg_create(len))
+		return SLURM_ERROR;
+
+	memcpy(&msg_type, get_buf_data(buffer), sizeof(msg_type));
+
+	rec = _seg_rec(tail_seg, tail_seg->used);
+	memcpy(rec + 1, get_buf_data(buffer), size);
+	rec->size = size;
+	rec->crc = _crc32(get_buf_data(buffer), size);
+	rec->msg_type = ntohs(msg_type);
+	rec->rpc_version = rpc_version;
+	rec->flags = 0;
+	/* Last, so a message cut short by a crash is never taken as whole */
+	__atomic_store_n(&rec->magic, SPOOL_REC_MAGIC, __ATOMIC_RELEASE);
+
+	tail_seg->used += len;
+	tail_seg->pending++;
+	pending_cnt++;
+
+	return SLURM_SUCCESS;
+}
+
+extern uint32_t dbd_spool_count(void)
+{
+	return pending_cnt;
+}
+
+extern uint32_t dbd_spool_inflight(void)
+{
+	return inflight_cnt;
+}
+
+static buf_t *_rec_2_buf(spool_rec_t *rec, uint16_t rpc_version)
+{
+	buf_t *buffer = init_buf(rec->size);
+	persist_msg_t msg = { 0 };
+	int rc;
+
+	memcpy(get_buf_data(buffer), rec + 1, rec->size);
+	set_buf_offset(buffer, rec->size);
+	if (rec->rpc_version == rpc_version)
+		return buffer;
+
+	/* Spooled by another version, repack it for this one */
+	set_buf_offset(buffer, 0);
+	rc = unpack_slurmdbd_msg(&msg, rec->rpc_version, buffer);
+	FREE_NULL_BUFFER(buffer);
+	if (rc != SLURM_SUCCESS)
+		return NULL;
+	buffer = pack_slurmdbd_msg(&msg, rpc_version);
+	slurmdbd_free_msg(&msg);
+
+	return buffer;
+}
+
+extern int dbd_spool_peek(List list, int max_cnt, uint32_t max_size,
+			  uint16_t rpc_version)
+{
+	list_itr_t *itr;
+	spool_seg_t *seg;
+	uint32_t total = 0, skip = inflight_cnt;
+	int cnt = 0;
+
+	xassert(seg_list);
+
+	itr = list_iterator_create(seg_list);
+	while ((cnt < max_cnt) && (seg = list_next(itr))) {
+		uint32_t offset;
+
+		if (!seg->pending)
+			continue;
+		if (_seg_map(seg))
+			break;
+
+		_seg_skip_sent(seg);
+		for (offset = seg->head; (offset < seg->used) &&
+			     (cnt < max_cnt);
+		     offset += SPOOL_REC_LEN(_seg_rec(seg, offset)->size)) {
+			spool_rec_t *rec = _seg_rec(seg, offset);
+			buf_t *buffer;
+
+			if (rec->flags & SPOOL_REC_SENT)
+				continue;
+			if (skip) {
+				skip--;
+				continue;
+			}
+			if (cnt && ((total + rec->size) > max_size)) {
+				max_cnt = cnt;
+				break;
+			}
+			if (!(buffer = _rec_2_buf(rec, rpc_version))) {
+				error("%s: unable to repack %s from protocol version %hu, discarding it",
+				      __func__,
+				      slurmdbd_msg_type_2_str(rec->msg_type, 1),
+				      rec->rpc_version);
+				rec->flags |= SPOOL_REC_SENT;
+				seg->pending--;
+				pending_cnt--;
+				continue;
+			}
+			total += size_buf(buffer);
+			list_append(list, buffer);
+			cnt++;
+		}
+	}
+	list_iterator_destroy(itr);
+
+	inflight_cnt += cnt;
+	_remove_sent_segs();
+	_unmap_middle();
+
+	return cnt;
+}
+
+extern void dbd_spool_pop(void)
+{
+	spool_seg_t *seg;
+
+	xassert(seg_list);
+
+	if (!inflight_cnt)
+		return;
+
+	while ((seg = list_peek(seg_list))) {
+		spool_rec_t *rec;
+
+		if (!seg->pending) {
+			if (seg == tail_seg)
+				return;
+			_seg_remove(seg);
+			continue;
+		}
+		if (_seg_map(seg))
+			return;
+
+		_seg_skip_sent(seg);
+		rec = _seg_rec(seg, seg->head);
+		rec->flags |= SPOOL_REC_SENT;
+		seg->pending--;
+		pending_cnt--;
+		inflight_cnt--;
+		_seg_skip_sent(seg);
+
+		if (!seg->pending && (seg != tail_seg))
+			_seg_remove(seg);
+		return;
+	}
+}
+
+extern void dbd_spool_unpeek(void)
+{
+	inflight_cnt = 0;
+}
+
+extern int dbd_spool_purge(bool (*f)(uint16_t msg_type, void *arg),
+			   void *arg)
+{
+	list_itr_t *itr;
+	spool_seg_t *seg;
+	uint32_t skip = inflight_cnt;
+	int purged = 0;
+
+	xassert(seg_list);
+
+	itr = list_iterator_create(seg_list);
+	while ((seg = list_next(itr))) {
+		if (!seg->pending || _seg_map(seg))
+			continue;
+
+		for (uint32_t offset = seg->head; offset < seg->used;
+		     offset += SPOOL_REC_LEN(_seg_rec(seg, offset)->size)) {
+			spool_rec_t *rec = _seg_rec(seg, offset);
+
+			if (rec->flags & SPOOL_REC_SENT)
+				continue;
+			if (skip) {
+				skip--;
+				continue;
+			}
+			if (!f(rec->msg_type, arg))
+				continue;
+			rec->flags |= SPOOL_REC_SENT;
+			seg->pending--;
+			pending_cnt--;
+			purged++;
+		}
+		_seg_skip_sent(seg);
+	}
+	list_iterator_destroy(itr);
+
+	_remove_sent_segs();
+	_unmap_middle();
+
+	return purged;
+}
+
+extern void dbd_spool_for_each_type(bool (*f)(uint16_t msg_type, void *arg),
+				    void *arg)
+{
+	list_itr_t *itr;
+	spool_seg_t *seg;
+	bool more = true;
+
+	xassert(seg_list);
+
+	itr = list_iterator_create(seg_list);
+	while (more && (seg = list_next(itr))) {
+		if (!seg->pending || _seg_map(seg))
+			continue;
+
+		for (uint32_t offset = seg->head; more && (offset < seg->used);
+		     offset += SPOOL_REC_LEN(_seg_rec(seg, offset)->size)) {
+			spool_rec_t *rec = _seg_rec(seg, offset);
+
+			if (!(rec->flags & SPOOL_REC_SENT))
+				more = f(rec->msg_type, arg);
+		}
+	}
+	list_iterator_destroy(itr);
+
+	_unmap_middle();
+}
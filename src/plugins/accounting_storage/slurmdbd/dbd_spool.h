@@ -0,0 +1,123 @@
+/****************************************************************************\
+ *  dbd_spool.h - on disk queue of messages pending for the SlurmDBD
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _DBD_SPOOL_H
+#define _DBD_SPOOL_H
+
+#include "src/common/pack.h"
+#include "src/common/list.h"
+
+/*
+ * The spool is a directory of fixed size segment files that packed messages
+ * are appended to through a shared mapping, so they survive a slurmctld crash
+ * as soon as they are queued. Messages are marked sent in place and a segment
+ * is removed once all of its messages are. Only the oldest and newest segment
+ * are kept mapped.
+ *
+ * There is no locking in here, the agent serializes all calls with its
+ * agent_lock.
+ */
+
+#define SPOOL_REC_MAGIC	0xDBD5B001
+#define SPOOL_REC_SENT	0x0001
+
+/* Space a message of size takes in a segment, records stay 8 byte aligned */
+#define SPOOL_REC_LEN(size) \
+	(sizeof(spool_rec_t) + (((size) + 7) & ~((uint32_t) 7)))
+
+/*
+ * Header of each message in a segment file, the packed message follows it.
+ * This is the on disk format, it must not change between releases.
+ */
+typedef struct {
+	uint32_t magic;		/* SPOOL_REC_MAGIC, written last */
+	uint32_t size;		/* of the message following the header */
+	uint32_t crc;		/* crc32 of the message */
+	uint16_t msg_type;
+	uint16_t rpc_version;
+	uint32_t flags;		/* SPOOL_REC_* */
+	uint32_t reserved;
+} spool_rec_t;
+
+/*
+ * Open the spool in dir and recover the messages left in it.
+ * IN create - create dir if it does not exist, otherwise a missing dir just
+ *	       returns SLURM_ERROR quietly
+ */
+extern int dbd_spool_init(const char *dir, bool create);
+
+/* Sync and close the spool, removing dir if nothing is left in it */
+extern void dbd_spool_fini(void);
+
+/* Append a packed message (msg_type first) packed for rpc_version */
+extern int dbd_spool_append(buf_t *buffer, uint16_t rpc_version);
+
+/* RET number of messages not sent yet */
+extern uint32_t dbd_spool_count(void);
+
+/* RET number of messages peeked and not popped or given back yet */
+extern uint32_t dbd_spool_inflight(void);
+
+/*
+ * Append copies of the oldest messages not sent nor in flight yet to list, up
+ * to max_cnt messages or until their size passes max_size, and add them to
+ * the ones in flight.
+ * Messages are repacked for rpc_version if they were spooled for another one.
+ * RET number of messages appended
+ */
+extern int dbd_spool_peek(List list, int max_cnt, uint32_t max_size,
+			  uint16_t rpc_version);
+
+/* Mark the oldest message in flight as sent */
+extern void dbd_spool_pop(void);
+
+/* Give back all the messages in flight after they could not be sent */
+extern void dbd_spool_unpeek(void);
+
+/*
+ * Mark the messages not sent nor in flight for which f returns true as sent.
+ * RET number of messages purged
+ */
+extern int dbd_spool_purge(bool (*f)(uint16_t msg_type, void *arg),
+			   void *arg);
+
+/*
+ * Call f on the type of the messages not sent yet, oldest first, until
+ * it returns false.
+ */
+extern void dbd_spool_for_each_type(bool (*f)(uint16_t msg_type, void *arg),
+				    void *arg);
+
+#endif
@@ -37,12 +37,15 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
 \*****************************************************************************/
 
+#include <limits.h>
+
 #include "src/common/slurm_xlator.h"
 
 #include "src/common/fd.h"
 #include "src/common/slurmdbd_pack.h"
 #include "src/common/xstring.h"
 
+#include "dbd_spool.h"
 #include "slurmdbd_agent.h"
 
 enum {
@@ -56,6 +59,9 @@ slurm_persist_conn_t *slurmdbd_conn = NULL;
 #define DBD_MAGIC		0xDEAD3219
 #define DEBUG_PRINT_MAX_MSG_TYPES 10
 #define MAX_DBD_DEFAULT_ACTION MAX_DBD_ACTION_DISCARD
+#define DBD_PIPELINE_DEPTH_DEFAULT 4
+#define DBD_PIPELINE_DEPTH_MAX 64
+#define DBD_MULT_MSG_MAX 1001
 
 static pthread_mutex_t agent_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cond = PTHREAD_COND_INITIALIZER;
@@ -70,6 +76,61 @@ static pthread_mutex_t slurmdbd_lock = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  slurmdbd_cond = PTHREAD_COND_INITIALIZER;
 
 static int max_dbd_msg_action = MAX_DBD_DEFAULT_ACTION;
+static int dbd_pipeline_depth = DBD_PIPELINE_DEPTH_DEFAULT;
+static uint32_t agent_inflight = 0;	/* head of agent_list being sent */
+
+typedef struct {
+	int cnt;		/* messages in it */
+	uint32_t seq;		/* sequence number of the first one */
+} agent_batch_t;
+
+typedef struct {
+	uint16_t purge_type;
+	uint32_t skip;		/* messages in flight at the head */
+} purge_args_t;
+
+/*
+ * With SlurmctldParameters=dbd_spool pending messages go to dbd_spool instead
+ * of agent_list, agent_list is still created as the sign the agent is set up.
+ */
+static bool use_dbd_spool = false;
+static bool dbd_spool_active = false;
+
+/* RET number of messages waiting for the slurmdbd, agent_lock must be held */
+static uint32_t _agent_count(void)
+{
+	if (dbd_spool_active)
+		return dbd_spool_count();
+	return list_count(agent_list);
+}
+
+/* Remove the oldest message once the slurmdbd has it */
+static bool _agent_pop(void)
+{
+	buf_t *buffer;
+
+	if (dbd_spool_active) {
+		if (!dbd_spool_count())
+			return false;
+		dbd_spool_pop();
+		return true;
+	}
+
+	if (!(buffer = list_dequeue(agent_list)))
+		return false;
+	FREE_NULL_BUFFER(buffer);
+	if (agent_inflight)
+		agent_inflight--;
+	return true;
+}
+
+/* Send the messages in flight again, the slurmdbd didn't take them */
+static void _agent_unpeek(void)
+{
+	if (dbd_spool_active)
+		dbd_spool_unpeek();
+	agent_inflight = 0;
+}
 
 static int _unpack_return_code(uint16_t rpc_version, buf_t *buffer)
 {
@@ -153,7 +214,17 @@ static int _get_return_code(void)
 	return rc;
 }
 
-static int _handle_mult_rc_ret(void)
+/*
+ * Read the reply to a DBD_SEND_MULT_MSG and remove the messages it
+ * acknowledges from the queue.
+ * IN seq - sequence number the DBD_SEND_MULT_MSG was sent with
+ * IN pop - remove acknowledged messages, false to only read the reply
+ * OUT acked - messages acknowledged, may be NULL
+ * RET SLURM_SUCCESS if all acknowledged messages succeeded,
+ *     SLURM_COMMUNICATIONS_RECEIVE_ERROR if the connection can't be trusted
+ *     anymore to reply in order
+ */
+static int _handle_mult_rc_ret(uint32_t seq, bool pop, int *acked)
 {
 	buf_t *buffer;
 	uint16_t msg_type;
@@ -162,9 +233,12 @@ static int _handle_mult_rc_ret(void)
 	int rc = SLURM_ERROR;
 	buf_t *out_buf = NULL;
 
+	if (acked)
+		*acked = 0;
+
 	buffer = slurm_persist_recv_msg(slurmdbd_conn);
 	if (buffer == NULL)
-		return rc;
+		return SLURM_COMMUNICATIONS_RECEIVE_ERROR;
 
 	safe_unpack16(&msg_type, buffer);
 	switch (msg_type) {
@@ -176,24 +250,29 @@ static int _handle_mult_rc_ret(void)
 			error("unpack message error");
 			break;
 		}
+		if (list_msg->seq != seq) {
+			error("DBD_GOT_MULT_MSG for seq %u, expected %u",
+			      list_msg->seq, seq);
+			slurmdbd_free_list_msg(list_msg);
+			rc = SLURM_COMMUNICATIONS_RECEIVE_ERROR;
+			break;
+		}
 
 		slurm_mutex_lock(&agent_lock);
-		if (agent_list) {
+		if (agent_list && pop) {
 			ListIterator itr =
 				list_iterator_create(list_msg->my_list);
 			while ((out_buf = list_next(itr))) {
-				buf_t *b;
 				if ((rc = _unpack_return_code(
 					     slurmdbd_conn->version, out_buf))
 				    != SLURM_SUCCESS)
 					break;
 
-				if ((b = list_dequeue(agent_list))) {
-					FREE_NULL_BUFFER(b);
-				} else {
+				if (!_agent_pop())
 					error("DBD_GOT_MULT_MSG "
 					      "unpack message error");
-				}
+				else if (acked)
+					(*acked)++;
 			}
 			list_iterator_destroy(itr);
 		}
@@ -294,6 +373,81 @@ static buf_t *_load_dbd_rec(int fd)
 	return buffer;
 }
 
+static char *_dbd_spool_dir(void)
+{
+	return xstrdup_printf("%s/dbd_spool", slurm_conf.state_save_location);
+}
+
+/* Start using the spool, keeping messages in memory if it can't be used */
+static void _open_dbd_spool(void)
+{
+	char *dir;
+
+	if (!use_dbd_spool || dbd_spool_active)
+		return;
+
+	dir = _dbd_spool_dir();
+	if (dbd_spool_init(dir, true) == SLURM_SUCCESS)
+		dbd_spool_active = true;
+	else
+		error("unable to use %s, keeping pending RPCs in memory", dir);
+	xfree(dir);
+}
+
+/* Take back into agent_list what a spool left behind when it is not used */
+static void _drain_dbd_spool(void)
+{
+	char *dir = _dbd_spool_dir();
+	int cnt;
+
+	if (dbd_spool_init(dir, false) != SLURM_SUCCESS) {
+		xfree(dir);
+		return;
+	}
+	cnt = dbd_spool_peek(agent_list, INT_MAX, UINT32_MAX,
+			     SLURM_PROTOCOL_VERSION);
+	for (int i = 0; i < cnt; i++)
+		dbd_spool_pop();
+	dbd_spool_fini();
+	verbose("recovered %d pending RPCs from %s", cnt, dir);
+	xfree(dir);
+}
+
+/*
+ * Stop using the spool after it failed, moving what is in it to agent_list.
+ * The messages in flight stay at the head of agent_list.
+ */
+static void _close_dbd_spool(void)
+{
+	uint32_t inflight = dbd_spool_inflight();
+	int cnt;
+
+	dbd_spool_unpeek();
+	cnt = dbd_spool_peek(agent_list, INT_MAX, UINT32_MAX,
+			     slurmdbd_conn->version);
+	for (int i = 0; i < cnt; i++)
+		dbd_spool_pop();
+	dbd_spool_fini();
+	dbd_spool_active = false;
+	agent_inflight = MIN(inflight, cnt);
+
+	error("unable to use the spool anymore, keeping %d pending RPCs in memory",
+	      cnt);
+}
+
+/* Move what is in agent_list to the spool */
+static void _spool_agent_list(void)
+{
+	buf_t *buffer;
+
+	while ((buffer = list_dequeue(agent_list))) {
+		if (dbd_spool_append(buffer, SLURM_PROTOCOL_VERSION) !=
+		    SLURM_SUCCESS)
+			error("unable to spool pending RPC, discarding it");
+		FREE_NULL_BUFFER(buffer);
+	}
+}
+
 static void _load_dbd_state(void)
 {
 	char *dbd_fname = NULL;
@@ -301,6 +455,9 @@ static void _load_dbd_state(void)
 	int fd, recovered = 0;
 	uint16_t rpc_version = 0;
 
+	if (!dbd_spool_active)
+		_drain_dbd_spool();
+
 	xstrfmtcat(dbd_fname, "%s/dbd.messages", slurm_conf.state_save_location);
 	fd = open(dbd_fname, O_RDONLY);
 	if (fd < 0) {
@@ -370,6 +527,12 @@ static void _load_dbd_state(void)
 	end_it:
 		verbose("recovered %d pending RPCs", recovered);
 		(void) close(fd);
+
+		/* The spool has them now, don't recover them again */
+		if (dbd_spool_active) {
+			_spool_agent_list();
+			(void) unlink(dbd_fname);
+		}
 	}
 	xfree(dbd_fname);
 }
@@ -412,6 +575,11 @@ static int _save_dbd_rec(int fd, buf_t *buffer)
 	return SLURM_SUCCESS;
 }
 
+static bool _is_register_ctld(uint16_t msg_type, void *arg)
+{
+	return (msg_type == DBD_REGISTER_CTLD);
+}
+
 static void _save_dbd_state(void)
 {
 	char *dbd_fname = NULL;
@@ -420,6 +588,18 @@ static void _save_dbd_state(void)
 	uint16_t msg_type;
 	uint32_t offset;
 
+	if (dbd_spool_active) {
+		/*
+		 * Everything is on disk already, only registration messages
+		 * are dropped for the same reason as below.
+		 */
+		dbd_spool_unpeek();
+		(void) dbd_spool_purge(_is_register_ctld, NULL);
+		dbd_spool_fini();
+		dbd_spool_active = false;
+		return;
+	}
+
 	xstrfmtcat(dbd_fname, "%s/dbd.messages", slurm_conf.state_save_location);
 	(void) unlink(dbd_fname);	/* clear save state */
 	fd = open(dbd_fname, O_WRONLY | O_CREAT | O_TRUNC, 0600);
@@ -477,19 +657,10 @@ end_it:
 /*
  * Purge queued records from the agent queue
  */
-static int _purge_agent_list_req(void *x, void *arg)
+static bool _purge_msg_type(uint16_t msg_type, void *arg)
 {
-	uint16_t msg_type;
-	uint32_t offset;
-	buf_t *buffer = x;
 	uint16_t purge_type = *(uint16_t *)arg;
 
-	offset = get_buf_offset(buffer);
-	if (offset < 2)
-		return 0;
-	set_buf_offset(buffer, 0);
-	(void) unpack16(&msg_type, buffer);	/* checked by offset */
-	set_buf_offset(buffer, offset);
 	switch (purge_type) {
 	case DBD_STEP_START:
 		if ((msg_type == DBD_STEP_START) ||
@@ -508,6 +679,41 @@ static int _purge_agent_list_req(void *x, void *arg)
 	return 0;
 }
 
+static int _purge_agent_list_req(void *x, void *arg)
+{
+	uint16_t msg_type;
+	uint32_t offset;
+	buf_t *buffer = x;
+	purge_args_t *args = arg;
+
+	/* Leave alone what is being sent */
+	if (args->skip) {
+		args->skip--;
+		return 0;
+	}
+
+	offset = get_buf_offset(buffer);
+	if (offset < 2)
+		return 0;
+	set_buf_offset(buffer, 0);
+	(void) unpack16(&msg_type, buffer);	/* checked by offset */
+	set_buf_offset(buffer, offset);
+
+	return _purge_msg_type(msg_type, &args->purge_type);
+}
+
+static int _purge_agent(uint16_t purge_type)
+{
+	purge_args_t args = {
+		.purge_type = purge_type,
+		.skip = agent_inflight,
+	};
+
+	if (dbd_spool_active)
+		return dbd_spool_purge(_purge_msg_type, &purge_type);
+	return list_delete_all(agent_list, _purge_agent_list_req, &args);
+}
+
 static void _max_dbd_msg_action(uint32_t *msg_cnt)
 {
 	int purged = 0;
@@ -522,16 +728,12 @@ static void _max_dbd_msg_action(uint32_t *msg_cnt)
 
 	/* MAX_DBD_ACTION_DISCARD */
 	if (*msg_cnt >= (slurm_conf.max_dbd_msgs - 1)) {
-		uint16_t purge_type = DBD_STEP_START;
-		purged = list_delete_all(agent_list, _purge_agent_list_req,
-					 &purge_type);
+		purged = _purge_agent(DBD_STEP_START);
 		*msg_cnt -= purged;
 		info("purge %d step records", purged);
 	}
 	if (*msg_cnt >= (slurm_conf.max_dbd_msgs - 1)) {
-		uint16_t purge_type = DBD_JOB_START;
-		purged = list_delete_all(agent_list, _purge_agent_list_req,
-					 &purge_type);
+		purged = _purge_agent(DBD_JOB_START);
 		*msg_cnt -= purged;
 		info("purge %d job start records", purged);
 	}
@@ -556,6 +758,25 @@ static int _print_agent_list_msg_type(void *x, void *arg)
 	return SLURM_SUCCESS;
 }
 
+typedef struct {
+	char *mlist;
+	int processed;
+} print_spool_args_t;
+
+static bool _print_spool_msg_type(uint16_t msg_type, void *arg)
+{
+	print_spool_args_t *args = arg;
+
+	if (args->processed >= DEBUG_PRINT_MAX_MSG_TYPES)
+		return false;
+
+	xstrfmtcat(args->mlist, "%s%s", (args->mlist[0] ? ", " : ""),
+		   slurmdbd_msg_type_2_str(msg_type, 1));
+	args->processed++;
+
+	return true;
+}
+
 /*
  * Prints an info line listing msg types of the dbd agent list
  */
@@ -565,9 +786,16 @@ static void _print_agent_list_msg_types(void)
 	char *mlist = xmalloc(2048);
 	int processed, max_msgs = DEBUG_PRINT_MAX_MSG_TYPES;
 
-	if ((processed = list_for_each_max(agent_list, &max_msgs,
-					   _print_agent_list_msg_type,
-					   mlist, true, true)) < 0) {
+	if (dbd_spool_active) {
+		print_spool_args_t args = { .mlist = mlist };
+
+		dbd_spool_for_each_type(_print_spool_msg_type, &args);
+		mlist = args.mlist;
+		processed = args.processed;
+		max_msgs = dbd_spool_count() - processed;
+	} else if ((processed = list_for_each_max(agent_list, &max_msgs,
+						  _print_agent_list_msg_type,
+						  mlist, true, true)) < 0) {
 		error("unable to create msg type list");
 		xfree(mlist);
 		return;
@@ -583,11 +811,144 @@ static void _print_agent_list_msg_types(void)
 	xfree(mlist);
 }
 
+/*
+ * Pack the oldest messages not in flight yet into a DBD_SEND_MULT_MSG and
+ * add them to the ones in flight. agent_lock must be held.
+ * OUT cnt - messages in it
+ * RET packed message or NULL if there is nothing left to send
+ */
+static buf_t *_pack_next_batch(persist_msg_t *list_req, uint32_t seq, int *cnt)
+{
+	dbd_list_msg_t *list_msg = list_req->data;
+	uint32_t msg_size = sizeof(*list_req);
+	buf_t *buffer;
+
+	*cnt = 0;
+	if (dbd_spool_active) {
+		list_msg->my_list = list_create(slurmdbd_free_buffer);
+		*cnt = dbd_spool_peek(list_msg->my_list, DBD_MULT_MSG_MAX,
+				      MAX_MSG_SIZE - msg_size,
+				      slurmdbd_conn->version);
+	} else {
+		ListIterator itr = list_iterator_create(agent_list);
+		uint32_t skip = agent_inflight;
+
+		list_msg->my_list = list_create(NULL);
+		while ((buffer = list_next(itr))) {
+			if (skip) {
+				skip--;
+				continue;
+			}
+			msg_size += size_buf(buffer);
+			if (*cnt && (msg_size > MAX_MSG_SIZE))
+				break;
+			list_enqueue(list_msg->my_list, buffer);
+			if (++(*cnt) >= DBD_MULT_MSG_MAX)
+				break;
+		}
+		list_iterator_destroy(itr);
+		agent_inflight += *cnt;
+	}
+
+	buffer = NULL;
+	if (*cnt) {
+		list_msg->seq = seq;
+		buffer = pack_slurmdbd_msg(list_req, slurmdbd_conn->version);
+	}
+	FREE_NULL_LIST(list_msg->my_list);
+	list_msg->seq = 0;
+
+	return buffer;
+}
+
+/*
+ * Keep up to dbd_pipeline_depth sequenced DBD_SEND_MULT_MSG in flight,
+ * sending the next one as soon as the oldest is acknowledged, until the
+ * queue is empty or the agent is halted. Once a message fails the slurmdbd
+ * refuses the ones sent after it, so their replies are only drained and the
+ * next call starts over from the failed message.
+ *
+ * slurmdbd_lock must be held, nothing else may use the connection while
+ * replies are pending.
+ */
+static int _send_pipelined(persist_msg_t *list_req)
+{
+	agent_batch_t window[DBD_PIPELINE_DEPTH_MAX], *batch;
+	int head = 0, inflight = 0, acked, rc = SLURM_SUCCESS, rc2;
+	uint32_t next_seq = 1;
+	bool refill = true;
+	buf_t *buffer;
+
+	while (true) {
+		if (refill && (inflight < dbd_pipeline_depth) &&
+		    !halt_agent && !*slurmdbd_conn->shutdown) {
+			batch = &window[(head + inflight) % dbd_pipeline_depth];
+			slurm_mutex_lock(&agent_lock);
+			buffer = _pack_next_batch(list_req, next_seq,
+						  &batch->cnt);
+			slurm_mutex_unlock(&agent_lock);
+
+			if (buffer) {
+				rc = slurm_persist_send_msg(slurmdbd_conn,
+							    buffer);
+				FREE_NULL_BUFFER(buffer);
+				if (rc != SLURM_SUCCESS) {
+					error("Failure sending message: %d: %m",
+					      rc);
+					break;
+				}
+				batch->seq = next_seq;
+				next_seq += batch->cnt;
+				inflight++;
+				log_flag(AGENT, "slurmdbd agent sent seq %u with %d messages, %d in flight",
+					 batch->seq, batch->cnt, inflight);
+				continue;
+			}
+		}
+		if (!inflight)
+			break;
+
+		batch = &window[head];
+		head = (head + 1) % dbd_pipeline_depth;
+		inflight--;
+
+		rc2 = _handle_mult_rc_ret(batch->seq, refill, &acked);
+		if (rc2 == SLURM_COMMUNICATIONS_RECEIVE_ERROR) {
+			rc = rc2;
+			break;
+		}
+		if (refill && ((rc2 != SLURM_SUCCESS) ||
+			       (acked < batch->cnt))) {
+			log_flag(AGENT, "slurmdbd agent seq %u acknowledged %d of %d messages, draining %d in flight",
+				 batch->seq, acked, batch->cnt, inflight);
+			rc = (rc2 != SLURM_SUCCESS) ? rc2 : SLURM_ERROR;
+			refill = false;
+		}
+	}
+
+	/*
+	 * Replies still pending would be taken as replies to whatever is sent
+	 * next, start over on a new connection.
+	 */
+	if (inflight) {
+		error("slurmdbd agent lost track of %d DBD_SEND_MULT_MSG in flight, reconnecting",
+		      inflight);
+		slurm_persist_conn_close(slurmdbd_conn);
+	}
+
+	slurm_mutex_lock(&agent_lock);
+	_agent_unpeek();
+	slurm_mutex_unlock(&agent_lock);
+
+	return rc;
+}
+
 static void *_agent(void *x)
 {
 	int rc;
 	uint32_t cnt;
 	buf_t *buffer;
+	bool spooled;
 	struct timespec abs_time;
 	static time_t fail_time = 0;
 	persist_msg_t list_req = {0};
@@ -604,14 +965,14 @@ static void *_agent(void *x)
 	memset(&list_msg, 0, sizeof(dbd_list_msg_t));
 
 	log_flag(AGENT, "slurmdbd agent_count=%d with msg_type=%s",
-		 list_count(agent_list),
+		 _agent_count(),
 		 slurmdbd_msg_type_2_str(list_req.msg_type, 1));
 
 	while (*slurmdbd_conn->shutdown == 0) {
 		slurm_mutex_lock(&slurmdbd_lock);
 		if (halt_agent) {
 			log_flag(AGENT, "slurmdbd agent halt with agent_count=%d",
-				 list_count(agent_list));
+				 _agent_count());
 
 			slurm_cond_wait(&slurmdbd_cond, &slurmdbd_lock);
 		}
@@ -625,19 +986,19 @@ static void *_agent(void *x)
 				fail_time = time(NULL);
 
 				log_flag(AGENT, "slurmdbd disconnected with agent_count=%d",
-					 list_count(agent_list));
+					 _agent_count());
 			}
 		}
 
 		slurm_mutex_lock(&agent_lock);
-		cnt = list_count(agent_list);
+		cnt = _agent_count();
 		if ((cnt == 0) || (slurmdbd_conn->fd < 0) ||
 		    (fail_time && (difftime(time(NULL), fail_time) < 10))) {
 			slurm_mutex_unlock(&slurmdbd_lock);
 			_max_dbd_msg_action(&cnt);
 			END_TIMER2("slurmdbd agent: sleep");
 			log_flag(AGENT, "slurmdbd agent sleeping with agent_count=%d",
-				 list_count(agent_list));
+				 _agent_count());
 			abs_time.tv_sec  = time(NULL) + 10;
 			abs_time.tv_nsec = 0;
 			slurm_cond_timedwait(&agent_cond, &agent_lock,
@@ -647,8 +1008,55 @@ static void *_agent(void *x)
 		} else if (((cnt > 0) && ((cnt % 100) == 0)) ||
 		           (slurm_conf.debug_flags & DEBUG_FLAG_AGENT))
 			info("agent_count:%d", cnt);
+
+		if ((cnt > 1) && (dbd_pipeline_depth > 1) &&
+		    (slurmdbd_conn->version >= SLURM_23_11_PROTOCOL_VERSION)) {
+			slurm_mutex_unlock(&agent_lock);
+			rc = _send_pipelined(&list_req);
+			slurm_mutex_unlock(&slurmdbd_lock);
+
+			slurm_mutex_lock(&assoc_cache_mutex);
+			if (slurmdbd_conn->fd >= 0 &&
+			    (running_cache != RUNNING_CACHE_STATE_NOTRUNNING))
+				slurm_cond_signal(&assoc_cache_cond);
+			slurm_mutex_unlock(&assoc_cache_mutex);
+
+			slurm_mutex_lock(&agent_lock);
+			if (rc == SLURM_SUCCESS) {
+				fail_time = 0;
+			} else {
+				fail_time = time(NULL);
+				if (slurm_conf.debug_flags & DEBUG_FLAG_AGENT) {
+					info("slurmdbd agent failed with rc:%d",
+					     rc);
+					_print_agent_list_msg_types();
+				}
+			}
+			slurm_mutex_unlock(&agent_lock);
+			END_TIMER2("slurmdbd agent: pipelined");
+			continue;
+		}
+
 		/* Leave item on the queue until processing complete */
-		if (agent_list) {
+		/* The spool may fail and be closed while this is sent */
+		spooled = dbd_spool_active;
+		if (spooled) {
+			/* Send copies, the spool keeps them until done */
+			list_msg.my_list = list_create(slurmdbd_free_buffer);
+			if (!dbd_spool_peek(list_msg.my_list,
+					    (cnt > 1) ? DBD_MULT_MSG_MAX : 1,
+					    MAX_MSG_SIZE - sizeof(list_req),
+					    slurmdbd_conn->version)) {
+				FREE_NULL_LIST(list_msg.my_list);
+				buffer = NULL;
+			} else if (cnt > 1) {
+				buffer = pack_slurmdbd_msg(
+					&list_req, slurmdbd_conn->version);
+			} else {
+				buffer = list_pop(list_msg.my_list);
+				FREE_NULL_LIST(list_msg.my_list);
+			}
+		} else if (agent_list) {
 			uint32_t msg_size = sizeof(list_req);
 			if (cnt > 1) {
 				int agent_count = 0;
@@ -666,7 +1074,7 @@ static void *_agent(void *x)
 				}
 				list_iterator_destroy(agent_itr);
 				buffer = pack_slurmdbd_msg(
-					&list_req, SLURM_PROTOCOL_VERSION);
+					&list_req, slurmdbd_conn->version);
 			} else
 				buffer = list_peek(agent_list);
 		} else
@@ -697,7 +1105,7 @@ static void *_agent(void *x)
 			}
 			error("Failure sending message: %d: %m", rc);
 		} else if (list_msg.my_list) {
-			rc = _handle_mult_rc_ret();
+			rc = _handle_mult_rc_ret(0, true, NULL);
 		} else {
 			rc = _get_return_code();
 			if (rc == EAGAIN) {
@@ -728,6 +1136,13 @@ static void *_agent(void *x)
 				if (list_msg.my_list != agent_list)
 					FREE_NULL_LIST(list_msg.my_list);
 				list_msg.my_list = NULL;
+			} else if (spooled) {
+				/*
+				 * Free the copy, the original is in agent_list
+				 * if the spool was closed since it was taken.
+				 */
+				FREE_NULL_BUFFER(buffer);
+				(void) _agent_pop();
 			} else
 				buffer = list_dequeue(agent_list);
 
@@ -740,7 +1155,8 @@ static void *_agent(void *x)
 					FREE_NULL_LIST(list_msg.my_list);
 				list_msg.my_list = NULL;
 				FREE_NULL_BUFFER(buffer);
-			}
+			} else if (spooled)
+				FREE_NULL_BUFFER(buffer);
 
 			fail_time = time(NULL);
 
@@ -750,6 +1166,9 @@ static void *_agent(void *x)
 				_print_agent_list_msg_types();
 			}
 		}
+		/* What the slurmdbd did not take is sent again next time */
+		if (dbd_spool_active)
+			dbd_spool_unpeek();
 		slurm_mutex_unlock(&agent_lock);
 		END_TIMER2("slurmdbd agent: full loop");
 	}
@@ -758,7 +1177,7 @@ static void *_agent(void *x)
 	_save_dbd_state();
 
 	log_flag(AGENT, "slurmdbd agent ending with agent_count=%d",
-		 list_count(agent_list));
+		 _agent_count());
 
 	FREE_NULL_LIST(agent_list);
 	agent_running = false;
@@ -776,6 +1195,7 @@ static void _create_agent(void)
 
 	if (agent_list == NULL) {
 		agent_list = list_create(slurmdbd_free_buffer);
+		_open_dbd_spool();
 		_load_dbd_state();
 	}
 
@@ -910,7 +1330,7 @@ extern int slurmdbd_agent_send(uint16_t rpc_version, persist_msg_t *req)
 
 	log_flag(PROTOCOL, "msg_type:%s protocol_version:%hu agent_count:%d",
 		 slurmdbd_msg_type_2_str(req->msg_type, 1),
-		 rpc_version, list_count(agent_list));
+		 rpc_version, _agent_count());
 
 	buffer = slurm_persist_msg_pack(
 		slurmdbd_conn, (persist_msg_t *)req);
@@ -926,7 +1346,7 @@ extern int slurmdbd_agent_send(uint16_t rpc_version, persist_msg_t *req)
 			return SLURM_ERROR;
 		}
 	}
-	cnt = list_count(agent_list);
+	cnt = _agent_count();
 	if ((cnt >= (slurm_conf.max_dbd_msgs / 2)) &&
 	    (difftime(time(NULL), syslog_time) > 120)) {
 		/* Record critical error every 120 seconds */
@@ -940,9 +1360,7 @@ extern int slurmdbd_agent_send(uint16_t rpc_version, persist_msg_t *req)
 	/* Handle action */
 	_max_dbd_msg_action(&cnt);
 
-	if (cnt < slurm_conf.max_dbd_msgs) {
-		list_enqueue(agent_list, buffer);
-	} else {
+	if (cnt >= slurm_conf.max_dbd_msgs) {
 		error("agent queue is full (%u), discarding %s:%u request",
 		      cnt,
 		      slurmdbd_msg_type_2_str(req->msg_type, 1),
@@ -950,6 +1368,18 @@ extern int slurmdbd_agent_send(uint16_t rpc_version, persist_msg_t *req)
 		(slurmdbd_conn->trigger_callbacks.acct_full)();
 		FREE_NULL_BUFFER(buffer);
 		rc = SLURM_ERROR;
+	} else if (!dbd_spool_active) {
+		list_enqueue(agent_list, buffer);
+	} else if (dbd_spool_append(buffer, slurmdbd_conn->version) ==
+		   SLURM_SUCCESS) {
+		FREE_NULL_BUFFER(buffer);
+	} else {
+		/* Don't lose it, MaxDBDMsgs still bounds the memory used */
+		error("unable to spool %s:%u request",
+		      slurmdbd_msg_type_2_str(req->msg_type, 1),
+		      req->msg_type);
+		_close_dbd_spool();
+		list_enqueue(agent_list, buffer);
 	}
 
 	slurm_cond_broadcast(&agent_cond);
@@ -968,7 +1398,25 @@ extern bool slurmdbd_conn_active(void)
 
 extern int slurmdbd_agent_queue_count(void)
 {
-	return list_count(agent_list);
+	return _agent_count();
+}
+
+/* Return true if param is one of the SlurmctldParameters, exactly */
+static bool _have_slurmctld_param(const char *param)
+{
+	char *tmp, *tok, *save_ptr = NULL;
+	bool found = false;
+
+	if (!slurm_conf.slurmctld_params)
+		return false;
+
+	tmp = xstrdup(slurm_conf.slurmctld_params);
+	for (tok = strtok_r(tmp, ",", &save_ptr); tok && !found;
+	     tok = strtok_r(NULL, ",", &save_ptr))
+		found = !xstrcasecmp(tok, param);
+	xfree(tmp);
+
+	return found;
 }
 
 extern void slurmdbd_agent_config_setup(void)
@@ -984,6 +1432,19 @@ extern void slurmdbd_agent_config_setup(void)
 			    ((slurm_conf.max_job_cnt * 2) +
 			     (node_record_count * 4)));
 
+	use_dbd_spool = _have_slurmctld_param("dbd_spool");
+
+	/*                          0123456789012345678 */
+	if ((tmp_ptr = xstrcasestr(slurm_conf.slurmctld_params,
+				   "dbd_pipeline_depth="))) {
+		dbd_pipeline_depth = atoi(tmp_ptr + 19);
+		if ((dbd_pipeline_depth < 1) ||
+		    (dbd_pipeline_depth > DBD_PIPELINE_DEPTH_MAX))
+			fatal("Invalid SlurmctldParameters dbd_pipeline_depth=%d, it must be between 1 and %d",
+			      dbd_pipeline_depth, DBD_PIPELINE_DEPTH_MAX);
+	} else
+		dbd_pipeline_depth = DBD_PIPELINE_DEPTH_DEFAULT;
+
 	/*                          0123456789012345678 */
 	if ((tmp_ptr = xstrcasestr(slurm_conf.slurmctld_params,
 	                           "max_dbd_msg_action="))) {
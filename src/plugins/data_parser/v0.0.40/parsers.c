@@ -3066,6 +3066,96 @@ void SPEC_FUNC(STATS_MSG_RPCS_BY_USER)(const parser_t *const parser,
 			  "Total time spent processing RPC in seconds");
 }
 
+static void _dump_msg_type_stats(data_t *dst, uint32_t size, uint16_t *id,
+				 uint32_t *cnt, uint64_t *time, uint64_t *max)
+{
+	data_set_list(dst);
+
+	for (int i = 0; i < size; i++) {
+		data_t *r = data_set_dict(data_list_append(dst));
+		data_set_string(data_key_set(r, "message_type"),
+				rpc_num2string(id[i]));
+		data_set_int(data_key_set(r, "type_id"), id[i]);
+		data_set_int(data_key_set(r, "count"), cnt[i]);
+		data_set_int(data_key_set(r, "average_time"),
+			     (cnt[i] ? (time[i] / cnt[i]) : 0));
+		data_set_int(data_key_set(r, "max_time"), max[i]);
+		data_set_int(data_key_set(r, "total_time"), time[i]);
+	}
+}
+
+static void _spec_msg_type_stats(data_t *dst, const char *desc,
+				 const char *item, const char *count)
+{
+	data_t *items = set_openapi_props(dst, OPENAPI_FORMAT_ARRAY, desc);
+	data_t *props = set_openapi_props(items, OPENAPI_FORMAT_OBJECT, item);
+	set_openapi_props(data_key_set(props, "message_type"),
+			  OPENAPI_FORMAT_STRING, "Message type as string");
+	set_openapi_props(data_key_set(props, "type_id"), OPENAPI_FORMAT_INT32,
+			  "Message type as integer");
+	set_openapi_props(data_key_set(props, "count"), OPENAPI_FORMAT_INT64,
+			  count);
+	set_openapi_props(data_key_set(props, "average_time"),
+			  OPENAPI_FORMAT_INT64,
+			  "Average completion time in microseconds");
+	set_openapi_props(data_key_set(props, "max_time"),
+			  OPENAPI_FORMAT_INT64,
+			  "Maximum completion time in microseconds");
+	set_openapi_props(data_key_set(props, "total_time"),
+			  OPENAPI_FORMAT_INT64,
+			  "Total completion time in microseconds");
+}
+
+PARSE_DISABLED(STATS_MSG_FWD_BY_TYPE)
+
+static int DUMP_FUNC(STATS_MSG_FWD_BY_TYPE)(const parser_t *const parser,
+					    void *obj, data_t *dst,
+					    args_t *args)
+{
+	stats_info_response_msg_t *stats = obj;
+
+	xassert(args->magic == MAGIC_ARGS);
+	xassert(data_get_type(dst) == DATA_TYPE_NULL);
+
+	_dump_msg_type_stats(dst, stats->fwd_type_size, stats->fwd_type_id,
+			     stats->fwd_type_cnt, stats->fwd_type_time,
+			     stats->fwd_type_max);
+
+	return SLURM_SUCCESS;
+}
+
+void SPEC_FUNC(STATS_MSG_FWD_BY_TYPE)(const parser_t *const parser,
+				      args_t *args, data_t *spec, data_t *dst)
+{
+	_spec_msg_type_stats(dst, "Message trees by message type",
+			     "Message tree", "Number of message trees sent");
+}
+
+PARSE_DISABLED(STATS_MSG_AGENT_BY_TYPE)
+
+static int DUMP_FUNC(STATS_MSG_AGENT_BY_TYPE)(const parser_t *const parser,
+					      void *obj, data_t *dst,
+					      args_t *args)
+{
+	stats_info_response_msg_t *stats = obj;
+
+	xassert(args->magic == MAGIC_ARGS);
+	xassert(data_get_type(dst) == DATA_TYPE_NULL);
+
+	_dump_msg_type_stats(dst, stats->agent_type_size, stats->agent_type_id,
+			     stats->agent_type_cnt, stats->agent_type_time,
+			     stats->agent_type_max);
+
+	return SLURM_SUCCESS;
+}
+
+void SPEC_FUNC(STATS_MSG_AGENT_BY_TYPE)(const parser_t *const parser,
+					args_t *args, data_t *spec, data_t *dst)
+{
+	_spec_msg_type_stats(dst, "Agent RPCs by message type", "Agent RPC",
+			     "Number of agent RPCs sent");
+}
+
 static data_for_each_cmd_t _parse_foreach_CSV_STRING_list(data_t *data,
 							  void *arg)
 {
@@ -6037,6 +6127,8 @@ static const parser_t PARSER_ARRAY(STATS_RPC)[] = {
 	add_parse(UINT32, cnt, "count", NULL),
 	add_parse(UINT64, time_ave, "time/average", NULL),
 	add_parse(UINT64, time, "time/total", NULL),
+	add_parse(UINT32, batch_cnt, "batch/count", NULL),
+	add_parse(UINT32, batch_rows, "batch/rows", NULL),
 };
 #undef add_parse
 
@@ -6192,6 +6284,14 @@ static const parser_t PARSER_ARRAY(STATS_MSG)[] = {
 	add_cparse(STATS_MSG_BF_QUEUE_LEN_MEAN, "bf_table_size_mean", NULL),
 	add_parse(TIMESTAMP_NO_VAL, bf_when_last_cycle, "bf_when_last_cycle", NULL),
 	add_cparse(STATS_MSG_BF_ACTIVE, "bf_active", NULL),
+	add_parse(UINT32, intern_strings, "intern_strings", NULL),
+	add_parse(UINT64, intern_refs, "intern_refs", NULL),
+	add_parse(UINT64, intern_bytes, "intern_bytes", NULL),
+	add_parse(UINT64, intern_bytes_saved, "intern_bytes_saved", NULL),
+	add_parse(UINT32, agent_workers, "agent_workers", NULL),
+	add_parse(UINT32, agent_workers_busy, "agent_workers_busy", NULL),
+	add_parse(UINT32, agent_work_queue, "agent_work_queue", NULL),
+	add_parse(UINT32, agent_work_queue_max, "agent_work_queue_max", NULL),
 	add_skip(rpc_type_size),
 	add_cparse(STATS_MSG_RPCS_BY_TYPE, "rpcs_by_message_type", NULL),
 	add_skip(rpc_type_id), /* handled by STATS_MSG_RPCS_BY_TYPE */
@@ -6208,6 +6308,18 @@ static const parser_t PARSER_ARRAY(STATS_MSG)[] = {
 	add_skip(rpc_dump_count), /* TODO: implement */
 	add_skip(rpc_dump_types), /* TODO: implement */
 	add_skip(rpc_dump_hostlist), /* TODO: implement */
+	add_cparse(STATS_MSG_FWD_BY_TYPE, "message_trees_by_message_type", NULL),
+	add_skip(fwd_type_size), /* handled by STATS_MSG_FWD_BY_TYPE */
+	add_skip(fwd_type_id), /* handled by STATS_MSG_FWD_BY_TYPE */
+	add_skip(fwd_type_cnt), /* handled by STATS_MSG_FWD_BY_TYPE */
+	add_skip(fwd_type_time), /* handled by STATS_MSG_FWD_BY_TYPE */
+	add_skip(fwd_type_max), /* handled by STATS_MSG_FWD_BY_TYPE */
+	add_cparse(STATS_MSG_AGENT_BY_TYPE, "agent_rpcs_by_message_type", NULL),
+	add_skip(agent_type_size), /* handled by STATS_MSG_AGENT_BY_TYPE */
+	add_skip(agent_type_id), /* handled by STATS_MSG_AGENT_BY_TYPE */
+	add_skip(agent_type_cnt), /* handled by STATS_MSG_AGENT_BY_TYPE */
+	add_skip(agent_type_time), /* handled by STATS_MSG_AGENT_BY_TYPE */
+	add_skip(agent_type_max), /* handled by STATS_MSG_AGENT_BY_TYPE */
 };
 #undef add_parse
 #undef add_cparse
@@ -7914,6 +8026,8 @@ static const parser_t parsers[] = {
 	addpc(STATS_MSG_BF_ACTIVE, stats_info_response_msg_t, NEED_NONE, BOOL, NULL),
 	addpcs(STATS_MSG_RPCS_BY_TYPE, stats_info_response_msg_t, NEED_NONE, ARRAY, NULL),
 	addpcs(STATS_MSG_RPCS_BY_USER, stats_info_response_msg_t, NEED_NONE, ARRAY, NULL),
+	addpcs(STATS_MSG_FWD_BY_TYPE, stats_info_response_msg_t, NEED_NONE, ARRAY, NULL),
+	addpcs(STATS_MSG_AGENT_BY_TYPE, stats_info_response_msg_t, NEED_NONE, ARRAY, NULL),
 	addpc(NODE_SELECT_ALLOC_MEMORY, node_info_t, NEED_NONE, INT64, NULL),
 	addpc(NODE_SELECT_ALLOC_CPUS, node_info_t, NEED_NONE, INT32, NULL),
 	addpc(NODE_SELECT_ALLOC_IDLE_CPUS, node_info_t, NEED_NONE, INT32, NULL),
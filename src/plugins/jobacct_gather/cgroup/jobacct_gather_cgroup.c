@@ -84,17 +84,8 @@ const uint32_t plugin_version = SLURM_VERSION_NUMBER;
 
 static bool is_first_task = true;
 
-static void _prec_extra(jag_prec_t *prec, uint32_t taskid)
+static void _set_cgroup_data(jag_prec_t *prec, cgroup_acct_t *cgroup_acct_data)
 {
-	cgroup_acct_t *cgroup_acct_data;
-
-	cgroup_acct_data = cgroup_g_task_get_acct_data(taskid);
-
-	if (!cgroup_acct_data) {
-		error("Cannot get cgroup accounting data for %d", taskid);
-		return;
-	}
-
 	/* We discard the data if some value was incorrect */
 	if (cgroup_acct_data->usec == NO_VAL64 &&
 	    cgroup_acct_data->ssec == NO_VAL64) {
@@ -139,10 +130,59 @@ static void _prec_extra(jag_prec_t *prec, uint32_t taskid)
 
 	}
 
-	xfree(cgroup_acct_data);
 	return;
 }
 
+/*
+ * Only the pid of each task is looked at in jag_common_poll_data(), and its
+ * usage is taken from the task's cgroup which holds all of its processes.
+ * So instead of reading /proc for every pid in the container, only read it
+ * for the pid of each task, and only for what the cgroup did not give us.
+ *
+ * Disk usage always comes from /proc/<pid>/io. The io.stat of cgroup/v2 only
+ * counts block devices, so it would miss network file systems.
+ */
+static List _get_precs(List task_list, uint64_t cont_id,
+		       jag_callbacks_t *callbacks)
+{
+	cgroup_acct_t *cgroup_acct_data;
+	struct jobacctinfo *jobacct;
+	ListIterator itr;
+	jag_prec_t *prec;
+	uint16_t flags;
+	int found = 0;
+
+	xassert(task_list);
+
+	itr = list_iterator_create(task_list);
+	while ((jobacct = list_next(itr))) {
+		if (!(cgroup_acct_data =
+		      cgroup_g_task_get_acct_data(jobacct->id.taskid)))
+			error("Cannot get cgroup accounting data for %d",
+			      jobacct->id.taskid);
+
+		flags = JAG_PROC_IO;
+		if (!cgroup_acct_data ||
+		    (cgroup_acct_data->total_rss == NO_VAL64))
+			flags |= JAG_PROC_MEM;
+
+		if ((prec = jag_common_get_prec(jobacct->pid,
+						jobacct->tres_count, flags))) {
+			if (cgroup_acct_data)
+				_set_cgroup_data(prec, cgroup_acct_data);
+			found++;
+		}
+
+		xfree(cgroup_acct_data);
+	}
+	list_iterator_destroy(itr);
+
+	if (!found)
+		jag_common_no_pids(list_peek(task_list), cont_id);
+
+	return NULL;
+}
+
 /*
  * init() is called when the plugin is loaded, before any other functions
  * are called.  Put global initialization here.
@@ -222,7 +262,7 @@ extern void jobacct_gather_p_poll_data(List task_list, uint64_t cont_id,
 	if (first) {
 		memset(&callbacks, 0, sizeof(jag_callbacks_t));
 		first = 0;
-		callbacks.prec_extra = _prec_extra;
+		callbacks.get_precs = _get_precs;
 	}
 
 	jag_common_poll_data(task_list, cont_id, &callbacks, profile);
@@ -41,12 +41,14 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <sys/resource.h>
 #include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
 
 #include "src/common/slurm_xlator.h"
 #include "src/common/assoc_mgr.h"
+#include "src/common/id_hash.h"
 #include "src/interfaces/gpu.h"
 #include "src/interfaces/jobacct_gather.h"
 #include "src/common/slurm_protocol_api.h"
@@ -79,6 +81,37 @@ List prec_list = NULL;
 static int my_pagesize = 0;
 static int energy_profile = ENERGY_DATA_NODE_ENERGY_UP;
 
+/* Files of /proc/<pid> which are kept open across polls */
+enum {
+	JAG_FD_STAT,
+	JAG_FD_STATM,
+	JAG_FD_SMAPS,
+	JAG_FD_IO,
+	JAG_FD_CNT
+};
+
+static const char *jag_fd_files[] = {
+	[JAG_FD_STAT] = "stat",
+	[JAG_FD_STATM] = "statm",
+	[JAG_FD_SMAPS] = "smaps_rollup",
+	[JAG_FD_IO] = "io",
+};
+
+typedef struct {
+	int fd[JAG_FD_CNT];
+	int lwp;		/* _is_a_lwp() of pid, -2 until checked */
+	pid_t pid;
+	uint32_t poll_cnt;	/* last poll the pid was read in */
+	jag_prec_t *prec;	/* record of pid in prec_list */
+} jag_pid_t;
+
+static id_hash_t *pid_hash = NULL;	/* jag_pid_t by pid */
+static uint32_t poll_cnt = 0;
+static int cached_fds = 0;
+static int max_cached_fds = 0;
+/* All /proc files but smaps are read here, only one at a time */
+static char proc_buf[4096];
+
 static int _find_prec(void *x, void *key)
 {
 	jag_prec_t *prec = (jag_prec_t *) x;
@@ -90,6 +123,116 @@ static int _find_prec(void *x, void *key)
 	return 0;
 }
 
+static void _close_pid_fds(jag_pid_t *jag_pid)
+{
+	for (int i = 0; i < JAG_FD_CNT; i++) {
+		if (jag_pid->fd[i] < 0)
+			continue;
+		close(jag_pid->fd[i]);
+		jag_pid->fd[i] = -1;
+		cached_fds--;
+	}
+	jag_pid->lwp = -2;
+}
+
+static void _destroy_jag_pid(jag_pid_t *jag_pid)
+{
+	_close_pid_fds(jag_pid);
+	xfree(jag_pid);
+}
+
+/* Get the entry of pid, creating it if needed, and mark it seen in this poll */
+static jag_pid_t *_get_jag_pid(pid_t pid)
+{
+	jag_pid_t *jag_pid;
+
+	if (!(jag_pid = id_hash_find(pid_hash, pid))) {
+		jag_pid = xmalloc(sizeof(*jag_pid));
+		jag_pid->pid = pid;
+		jag_pid->lwp = -2;
+		for (int i = 0; i < JAG_FD_CNT; i++)
+			jag_pid->fd[i] = -1;
+		/* The pid may have been read before, keep updating its prec */
+		jag_pid->prec = list_find_first(prec_list, _find_prec, &pid);
+		id_hash_add(pid_hash, pid, jag_pid);
+	}
+	jag_pid->poll_cnt = poll_cnt;
+
+	return jag_pid;
+}
+
+/*
+ * Read /proc/<pid>/<file> into proc_buf. The file is read from offset 0 of a
+ * descriptor kept open across polls, as long as we are not over
+ * max_cached_fds.
+ * RET number of bytes read, -1 if the process went away
+ */
+static int _read_pid_file(jag_pid_t *jag_pid, int type)
+{
+	char path[64];
+	ssize_t n;
+	bool fresh = false;
+
+again:
+	if (jag_pid->fd[type] < 0) {
+		snprintf(path, sizeof(path), "/proc/%d/%s",
+			 jag_pid->pid, jag_fd_files[type]);
+		if ((jag_pid->fd[type] = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+			return -1;  /* Assume the process went away */
+		cached_fds++;
+		fresh = true;
+	}
+
+	do {
+		n = pread(jag_pid->fd[type], proc_buf, sizeof(proc_buf) - 1, 0);
+	} while ((n < 0) && (errno == EINTR));
+
+	if (n <= 0) {
+		/*
+		 * An fd left open on a process which ended does not see a new
+		 * process reusing its pid, so start over from a fresh open.
+		 */
+		_close_pid_fds(jag_pid);
+		if (!fresh)
+			goto again;
+		return -1;
+	}
+	proc_buf[n] = '\0';
+
+	if (cached_fds > max_cached_fds) {
+		close(jag_pid->fd[type]);
+		jag_pid->fd[type] = -1;
+		cached_fds--;
+	}
+
+	return n;
+}
+
+static int _sweep_jag_pid(uint64_t key, void *item, void *arg)
+{
+	jag_pid_t *jag_pid = item;
+	List gone = arg;
+
+	if (jag_pid->poll_cnt != poll_cnt)
+		list_append(gone, jag_pid);
+
+	return 0;
+}
+
+/* Close the files of the pids which were not read in the last poll */
+static void _sweep_jag_pids(void)
+{
+	List gone = list_create(NULL);
+	jag_pid_t *jag_pid;
+
+	(void) id_hash_for_each(pid_hash, _sweep_jag_pid, gone);
+	while ((jag_pid = list_pop(gone))) {
+		id_hash_remove(pid_hash, jag_pid->pid, jag_pid);
+		_destroy_jag_pid(jag_pid);
+	}
+	FREE_NULL_LIST(gone);
+}
+
 /* return weighted frequency in mhz */
 static uint32_t _update_weighted_freq(struct jobacctinfo *jobacct,
 				      char * sbuf)
@@ -142,66 +285,79 @@ inline static bool _get_freq(char *str)
 	return true;
 }
 
-/*
- * collects the Pss value from /proc/<pid>/smaps
- */
-static int _get_pss(char *proc_smaps_file, jag_prec_t *prec)
+/* RET the Pss value in KB of an smaps line, 0 if it is not a Pss line */
+static uint64_t _get_pss_line(char *line)
 {
-        uint64_t pss;
 	uint64_t p;
-        char line[128];
-        FILE *fp;
-	int i;
 
-	fp = fopen(proc_smaps_file, "r");
-        if (!fp) {
-                return -1;
-        }
+	if (xstrncmp(line, "Pss:", 4))
+		return 0;
+
+	for (int i = 4; line[i]; i++) {
+		if (!isdigit(line[i]))
+			continue;
+		if (sscanf(&line[i], "%"PRIu64"", &p) == 1)
+			return p;
+		break;
+	}
 
-	if (fcntl(fileno(fp), F_SETFD, FD_CLOEXEC) == -1)
-		error("%s: fcntl(%s): %m", __func__, proc_smaps_file);
-	pss = 0;
+	return 0;
+}
 
-        while (fgets(line,sizeof(line),fp)) {
+/*
+ * collects the Pss value from /proc/<pid>/smaps_rollup, or /proc/<pid>/smaps
+ * if the kernel is too old to have it.
+ */
+static int _get_pss(jag_pid_t *jag_pid, jag_prec_t *prec)
+{
+	static int use_smaps_rollup = -1;
+	uint64_t pss = 0;
+	char line[128], *save_ptr = NULL, *tok;
+	FILE *fp;
 
-                if (xstrncmp(line, "Pss:", 4) != 0) {
-                        continue;
-                }
+	if (use_smaps_rollup == -1) {
+		snprintf(line, sizeof(line), "/proc/%d/smaps_rollup",
+			 jag_pid->pid);
+		use_smaps_rollup = access(line, R_OK) ? 0 : 1;
+	}
 
-                for (i = 4; i < sizeof(line); i++) {
+	if (use_smaps_rollup) {
+		/* smaps_rollup is small enough to be read in one go */
+		if (_read_pid_file(jag_pid, JAG_FD_SMAPS) < 0)
+			return -1;
+		tok = strtok_r(proc_buf, "\n", &save_ptr);
+		while (tok) {
+			pss += _get_pss_line(tok);
+			tok = strtok_r(NULL, "\n", &save_ptr);
+		}
+	} else {
+		snprintf(line, sizeof(line), "/proc/%d/smaps", jag_pid->pid);
+		if (!(fp = fopen(line, "re")))
+			return -1;
 
-                        if (!isdigit(line[i])) {
-                                continue;
-                        }
-                        if (sscanf(&line[i],"%"PRIu64"", &p) == 1) {
-                                pss += p;
-                        }
-                        break;
-                }
-        }
+		while (fgets(line, sizeof(line), fp))
+			pss += _get_pss_line(line);
 
-	/* Check for error
-	 */
-	if (ferror(fp)) {
+		/* Check for error */
+		if (ferror(fp)) {
+			fclose(fp);
+			return -1;
+		}
 		fclose(fp);
-		return -1;
 	}
 
-        fclose(fp);
-        /* Sanity checks */
-
-        if (pss > 0) {
+	/* Sanity checks */
+	if (pss > 0) {
 		pss *= 1024; /* Scale KB to B */
 		if (prec->tres_data[TRES_ARRAY_MEM].size_read > pss)
 			prec->tres_data[TRES_ARRAY_MEM].size_read = pss;
-        }
+	}
 
-	log_flag(JAG, "%s read pss %"PRIu64" for process %s",
-		 __func__, pss, proc_smaps_file);
+	log_flag(JAG, "%s read pss %"PRIu64" for process %d",
+		 __func__, pss, jag_pid->pid);
 
-        return 0;
+	return 0;
 }
-
 static int _get_sys_interface_freq_line(uint32_t cpu, char *filename,
 					char * sbuf)
 {
@@ -303,7 +459,7 @@ again:
 
 /* _get_process_data_line() - get line of data from /proc/<pid>/stat
  *
- * IN:	in - input file descriptor
+ * IN:	sbuf - contents of the file
  * OUT:	prec - the destination for the data
  *
  * RETVAL:	==0 - no valid data
@@ -314,9 +470,9 @@ again:
  * embedded ')'s. Such names confuse %s (see scanf(3)), so the string is split
  * and %39c is used instead. (except for embedded ')' "(%[^)]c)" would work.
  */
-static int _get_process_data_line(int in, jag_prec_t *prec) {
-	char sbuf[512], *tmp;
-	int num_read, nvals;
+static int _get_process_data_line(char *sbuf, jag_prec_t *prec) {
+	char *tmp;
+	int nvals;
 	char cmd[40], state[1];
 	int ppid, pgrp, session, tty_nr, tpgid;
 	long unsigned flags, minflt, cminflt, majflt, cmajflt;
@@ -325,11 +481,6 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	long unsigned f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13;
 	int exit_signal, last_cpu;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
 	/*
 	 * split into "PID (cmd" and "<rest>" replace trailing ')' with NULL
 	 */
@@ -361,14 +512,6 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 	if ((nvals < 37) || (rss < 0))
 		return 0;
 
-	/*
-	 * If current pid corresponds to a Light Weight Process (Thread POSIX)
-	 * or there was an error, skip it, we will only account the original
-	 * process (pid==tgid).
-	 */
-	if (_is_a_lwp(prec->pid))
-		return 0;
-
 	/* Copy the values that slurm records into our data structure */
 	prec->ppid  = ppid;
 
@@ -388,7 +531,7 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
 
 /* _get_process_memory_line() - get line of data from /proc/<pid>/statm
  *
- * IN:	in - input file descriptor
+ * IN:	sbuf - contents of the file
  * OUT:	prec - the destination for the data
  *
  * RETVAL:	==0 - no valid data
@@ -399,17 +542,11 @@ static int _get_process_data_line(int in, jag_prec_t *prec) {
  * and return the updated struct.
  *
  */
-static int _get_process_memory_line(int in, jag_prec_t *prec)
+static int _get_process_memory_line(char *sbuf, jag_prec_t *prec)
 {
-	char sbuf[256];
-	int num_read, nvals;
+	int nvals;
 	long int size, rss, share, text, lib, data, dt;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
 	nvals = sscanf(sbuf,
 		       "%ld %ld %ld %ld %ld %ld %ld",
 		       &size, &rss, &share, &text, &lib, &data, &dt);
@@ -430,24 +567,9 @@ static int _get_process_memory_line(int in, jag_prec_t *prec)
 	return 1;
 }
 
-static int _remove_share_data(char *proc_statm_file, jag_prec_t *prec)
-{
-	FILE *statm_fp = NULL;
-	int rc = 0, fd;
-
-	if (!(statm_fp = fopen(proc_statm_file, "r")))
-		return rc;  /* Assume the process went away */
-	fd = fileno(statm_fp);
-	if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
-		error("%s: fcntl(%s): %m", __func__, proc_statm_file);
-	rc = _get_process_memory_line(fd, prec);
-	fclose(statm_fp);
-	return rc;
-}
-
 /* _get_process_io_data_line() - get line of data from /proc/<pid>/io
  *
- * IN:	in - input file descriptor
+ * IN:	sbuf - contents of the file
  * OUT:	prec - the destination for the data
  *
  * RETVAL:	==0 - no valid data
@@ -458,25 +580,16 @@ static int _remove_share_data(char *proc_statm_file, jag_prec_t *prec)
  * wrchar: <# of characters written>
  *   . . .
  */
-static int _get_process_io_data_line(int in, jag_prec_t *prec) {
-	char sbuf[256];
+static int _get_process_io_data_line(char *sbuf, jag_prec_t *prec) {
 	char f1[7], f3[7];
-	int num_read, nvals;
+	int nvals;
 	uint64_t rchar, wchar;
 
-	num_read = read(in, sbuf, (sizeof(sbuf) - 1));
-	if (num_read <= 0)
-		return 0;
-	sbuf[num_read] = '\0';
-
-	nvals = sscanf(sbuf, "%s %"PRIu64" %s %"PRIu64"",
+	nvals = sscanf(sbuf, "%6s %"PRIu64" %6s %"PRIu64"",
 		       f1, &rchar, f3, &wchar);
 	if (nvals < 4)
 		return 0;
 
-	if (_is_a_lwp(prec->pid))
-		return 0;
-
 	/* keep real value here since we aren't doubles */
 	prec->tres_data[TRES_ARRAY_FS_DISK].size_read = rchar;
 	prec->tres_data[TRES_ARRAY_FS_DISK].size_write = wchar;
@@ -498,36 +611,16 @@ static int _init_tres(jag_prec_t *prec, void *empty)
 	return SLURM_SUCCESS;
 }
 
-void _set_smaps_file(char **proc_smaps_file, pid_t pid)
-{
-	static int use_smaps_rollup = -1;
-
-	if (use_smaps_rollup == -1) {
-		xstrfmtcat(*proc_smaps_file, "/proc/%d/smaps_rollup", pid);
-		FILE *fd = fopen(*proc_smaps_file, "r");
-		if (fd) {
-			fclose(fd);
-			use_smaps_rollup = 1;
-			return;
-		}
-		use_smaps_rollup = 0;
-	}
-
-	if (use_smaps_rollup)
-		xstrfmtcat(*proc_smaps_file, "/proc/%d/smaps_rollup", pid);
-	else
-		xstrfmtcat(*proc_smaps_file, "/proc/%d/smaps", pid);
-}
-
-static void _handle_stats(pid_t pid, jag_callbacks_t *callbacks, int tres_count)
+extern jag_prec_t *jag_common_get_prec(pid_t pid, int tres_count,
+				       uint16_t flags)
 {
 	static int no_share_data = -1;
 	static int use_pss = -1;
-	char *proc_file = NULL;
-	FILE *stat_fp = NULL;
-	FILE *io_fp = NULL;
-	int fd, fd2;
-	jag_prec_t *prec = NULL;
+	static acct_gather_data_t *tres_data = NULL;
+	static int tres_data_cnt = 0;
+	jag_pid_t *jag_pid;
+	jag_prec_t prec = { 0 }, *rec;
+	int lwp;
 
 	if (no_share_data == -1) {
 		if (xstrcasestr(slurm_conf.job_acct_gather_params, "NoShare"))
@@ -541,24 +634,28 @@ static void _handle_stats(pid_t pid, jag_callbacks_t *callbacks, int tres_count)
 			use_pss = 0;
 	}
 
-	xstrfmtcat(proc_file, "/proc/%u/stat", pid);
-	if (!(stat_fp = fopen(proc_file, "r")))
-		return;  /* Assume the process went away */
+	jag_pid = _get_jag_pid(pid);
+
 	/*
-	 * Close the file on exec() of user tasks.
-	 *
-	 * NOTE: If we fork() slurmstepd after the
-	 * fopen() above and before the fcntl() below,
-	 * then the user task may have this extra file
-	 * open, which can cause problems for
-	 * checkpoint/restart, but this should be a very rare
-	 * problem in practice.
+	 * Threads known as such are skipped before reading anything. Their
+	 * entry goes away once the pid misses a poll.
 	 */
-	fd = fileno(stat_fp);
-	if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
-		error("%s: fcntl(%s): %m", __func__, proc_file);
+	if (jag_pid->lwp > 0)
+		return NULL;
 
-	prec = xmalloc(sizeof(*prec));
+	if (_read_pid_file(jag_pid, JAG_FD_STAT) < 0)
+		return NULL;  /* Assume the process went away */
+
+	/*
+	 * If current pid corresponds to a Light Weight Process (Thread POSIX)
+	 * or there was an error, skip it, we will only account the original
+	 * process (pid==tgid). A pid stays one or the other while its files
+	 * are open, so only check once.
+	 */
+	if (((lwp = jag_pid->lwp) == -2) && ((lwp = _is_a_lwp(pid)) >= 0))
+		jag_pid->lwp = lwp;
+	if (lwp)
+		return NULL;
 
 	if (!tres_count) {
 		assoc_mgr_lock_t locks = {
@@ -569,59 +666,70 @@ static void _handle_stats(pid_t pid, jag_callbacks_t *callbacks, int tres_count)
 		assoc_mgr_unlock(&locks);
 	}
 
-	prec->tres_count = tres_count;
-	prec->tres_data = xcalloc(prec->tres_count,
-				  sizeof(acct_gather_data_t));
-
-	(void)_init_tres(prec, NULL);
-
-	if (!_get_process_data_line(fd, prec)) {
-		fclose(stat_fp);
-		goto bail_out;
+	/*
+	 * Gather into a scratch record so the last good record of the pid is
+	 * left alone if anything fails below.
+	 */
+	if (tres_data_cnt < tres_count) {
+		xrecalloc(tres_data, tres_count, sizeof(*tres_data));
+		tres_data_cnt = tres_count;
 	}
+	prec.tres_count = tres_count;
+	prec.tres_data = tres_data;
+	(void)_init_tres(&prec, NULL);
 
-	fclose(stat_fp);
+	if (!_get_process_data_line(proc_buf, &prec))
+		return NULL;
 
-	gpu_g_usage_read(pid, prec->tres_data);
+	gpu_g_usage_read(pid, prec.tres_data);
 
 	/* Remove shared data from rss */
-	if (no_share_data) {
-		xfree(proc_file);
-		xstrfmtcat(proc_file, "/proc/%u/statm", pid);
-		if (!_remove_share_data(proc_file, prec))
-			goto bail_out;
-	}
+	if (no_share_data && (flags & JAG_PROC_MEM) &&
+	    ((_read_pid_file(jag_pid, JAG_FD_STATM) < 0) ||
+	     !_get_process_memory_line(proc_buf, &prec)))
+		return NULL;
 
 	/* Use PSS instead if RSS */
-	if (use_pss) {
-		xfree(proc_file);
-		_set_smaps_file(&proc_file, pid);
-		if (_get_pss(proc_file, prec) == -1)
-			goto bail_out;
+	if (use_pss && (flags & JAG_PROC_MEM) &&
+	    (_get_pss(jag_pid, &prec) == -1))
+		return NULL;
+
+	if ((flags & JAG_PROC_IO) &&
+	    (_read_pid_file(jag_pid, JAG_FD_IO) >= 0) &&
+	    !_get_process_io_data_line(proc_buf, &prec))
+		return NULL;
+
+	/* Update the record of the pid in place */
+	if (!(rec = jag_pid->prec)) {
+		rec = jag_pid->prec = xmalloc(sizeof(*rec));
+		list_append(prec_list, rec);
 	}
-
-	xfree(proc_file);
-	xstrfmtcat(proc_file, "/proc/%u/io", pid);
-	if ((io_fp = fopen(proc_file, "r"))) {
-		fd2 = fileno(io_fp);
-		if (fcntl(fd2, F_SETFD, FD_CLOEXEC) == -1)
-			error("%s: fcntl: %m", __func__);
-		if (!_get_process_io_data_line(fd2, prec)) {
-			fclose(io_fp);
-			goto bail_out;
-		}
-		fclose(io_fp);
+	if (rec->tres_count != tres_count) {
+		xfree(rec->tres_data);
+		rec->tres_data = xcalloc(tres_count, sizeof(*tres_data));
 	}
+	prec.tres_data = rec->tres_data;
+	memcpy(prec.tres_data, tres_data, tres_count * sizeof(*tres_data));
+	*rec = prec;
 
-	destroy_jag_prec(list_remove_first(prec_list, _find_prec, &prec->pid));
-	list_append(prec_list, prec);
-	xfree(proc_file);
-	return;
+	return rec;
+}
 
-bail_out:
-	xfree(prec->tres_data);
-	xfree(prec);
-	return;
+extern void jag_common_no_pids(struct jobacctinfo *jobacct, uint64_t cont_id)
+{
+	/* update consumed energy even if pids do not exist */
+	if (jobacct) {
+		acct_gather_energy_g_get_sum(energy_profile,
+					     &jobacct->energy);
+		jobacct->tres_usage_in_tot[TRES_ARRAY_ENERGY] =
+			jobacct->energy.consumed_energy;
+		jobacct->tres_usage_out_tot[TRES_ARRAY_ENERGY] =
+			jobacct->energy.current_watts;
+		log_flag(JAG, "energy = %"PRIu64" watts = %u",
+			 jobacct->energy.consumed_energy,
+			 jobacct->energy.current_watts);
+	}
+	log_flag(JAG, "no pids in this container %"PRIu64, cont_id);
 }
 
 static List _get_precs(List task_list, uint64_t cont_id,
@@ -639,25 +747,13 @@ static List _get_precs(List task_list, uint64_t cont_id,
 	proctrack_g_get_pids(cont_id, &pids, &npids);
 	if (npids) {
 		for (int i = 0; i < npids; i++) {
-			_handle_stats(pids[i], callbacks,
-				      jobacct ? jobacct->tres_count : 0);
+			jag_common_get_prec(pids[i],
+					    jobacct ? jobacct->tres_count : 0,
+					    JAG_PROC_MEM | JAG_PROC_IO);
 		}
 		xfree(pids);
-	} else {
-		/* update consumed energy even if pids do not exist */
-		if (jobacct) {
-			acct_gather_energy_g_get_sum(energy_profile,
-						     &jobacct->energy);
-			jobacct->tres_usage_in_tot[TRES_ARRAY_ENERGY] =
-				jobacct->energy.consumed_energy;
-			jobacct->tres_usage_out_tot[TRES_ARRAY_ENERGY] =
-				jobacct->energy.current_watts;
-			log_flag(JAG, "energy = %"PRIu64" watts = %u",
-				 jobacct->energy.consumed_energy,
-				 jobacct->energy.current_watts);
-		}
-		log_flag(JAG, "no pids in this container %"PRIu64, cont_id);
-	}
+	} else
+		jag_common_no_pids(jobacct, cont_id);
 
 	return prec_list;
 }
@@ -800,7 +896,16 @@ extern void jag_common_init(long plugin_units)
 {
 	uint32_t profile_opt;
 
+	struct rlimit rlim;
+
 	prec_list = list_create(destroy_jag_prec);
+	pid_hash = id_hash_create(0);
+
+	/* Leave most of the fds to the rest of the slurmstepd */
+	if (!getrlimit(RLIMIT_NOFILE, &rlim) && (rlim.rlim_cur != RLIM_INFINITY))
+		max_cached_fds = rlim.rlim_cur / 4;
+	else
+		max_cached_fds = 1024;
 
 	acct_gather_profile_g_get(ACCT_GATHER_PROFILE_RUNNING,
 				  &profile_opt);
@@ -819,8 +924,19 @@ extern void jag_common_init(long plugin_units)
 	my_pagesize = getpagesize();
 }
 
+static int _destroy_jag_pid_hash(uint64_t key, void *item, void *arg)
+{
+	_destroy_jag_pid(item);
+	return 0;
+}
+
 extern void jag_common_fini(void)
 {
+	if (pid_hash) {
+		(void) id_hash_for_each(pid_hash, _destroy_jag_pid_hash, NULL);
+		id_hash_destroy(pid_hash);
+		pid_hash = NULL;
+	}
 	FREE_NULL_LIST(prec_list);
 }
 
@@ -869,7 +985,6 @@ extern void jag_common_poll_data(List task_list, uint64_t cont_id,
 {
 	/* Update the data */
 	uint64_t total_job_mem = 0, total_job_vsize = 0;
-	uint32_t last_taskid = NO_VAL;
 	ListIterator itr;
 	jag_prec_t *prec = NULL, tmp_prec;
 	struct jobacctinfo *jobacct = NULL;
@@ -898,7 +1013,9 @@ extern void jag_common_poll_data(List task_list, uint64_t cont_id,
 	ct = time(NULL);
 
 	(void)list_for_each(prec_list, (ListForF)_init_tres, NULL);
+	poll_cnt++;
 	(*(callbacks->get_precs))(task_list, cont_id, callbacks);
+	_sweep_jag_pids();
 
 	if (!list_count(prec_list) || !task_list || !list_count(task_list))
 		goto finished;	/* We have no business being here! */
@@ -926,27 +1043,6 @@ extern void jag_common_poll_data(List task_list, uint64_t cont_id,
 			log_flag(JAG, "problem retrieving interconnect data");
 		}
 
-		/*
-		 * Only jobacct_gather/cgroup uses prec_extra, and we want to
-		 * make sure we call it once per task, so call it here as we
-		 * iterate through the tasks instead of in get_precs.
-		 */
-		if (callbacks->prec_extra) {
-			if (last_taskid == jobacct->id.taskid) {
-				log_flag(JAG, "skipping prec_extra() call against nodeid:%u taskid:%u",
-					 jobacct->id.nodeid,
-					 jobacct->id.taskid);
-				continue;
-			} else {
-				log_flag(JAG, "calling prec_extra() call against nodeid:%u taskid:%u",
-					 jobacct->id.nodeid,
-					 jobacct->id.taskid);
-			}
-
-			last_taskid = jobacct->id.taskid;
-			(*(callbacks->prec_extra))(prec, jobacct->id.taskid);
-		}
-
 		log_flag(JAG, "pid:%u ppid:%u %s:%" PRIu64 " B",
 			 prec->pid, prec->ppid,
 			 (xstrcasestr(slurm_conf.job_acct_gather_params,
@@ -43,6 +43,10 @@
 
 #include "src/common/list.h"
 
+/* Flags for jag_common_get_prec() */
+#define JAG_PROC_MEM	0x0001	/* apply NoShare/UsePss to the memory used */
+#define JAG_PROC_IO	0x0002	/* read /proc/<pid>/io */
+
 typedef struct jag_prec {	/* process record */
 	bool	visited;
 	int	act_cpufreq;	/* actual average cpu frequency */
@@ -57,7 +61,6 @@ typedef struct jag_prec {	/* process record */
 } jag_prec_t;
 
 typedef struct jag_callbacks {
-	void (*prec_extra) (jag_prec_t *prec, uint32_t taskid);
 	List (*get_precs) (List task_list, uint64_t cont_id,
 			   struct jag_callbacks *callbacks);
 	void (*get_offspring_data) (List prec_list,
@@ -68,6 +71,19 @@ extern void jag_common_init(long in_hertz);
 extern void jag_common_fini(void);
 extern void destroy_jag_prec(void *object);
 
+/*
+ * Read /proc/<pid>/stat (and more depending on flags) and add a record of the
+ * process to the list of processes tracked. Used directly by plugins with a
+ * get_precs() callback that only need some processes to be read.
+ * IN flags - JAG_PROC_* flags
+ * RET the record added, NULL if the process went away
+ */
+extern jag_prec_t *jag_common_get_prec(pid_t pid, int tres_count,
+				       uint16_t flags);
+
+/* Update the energy of jobacct when no process could be found to gather */
+extern void jag_common_no_pids(struct jobacctinfo *jobacct, uint64_t cont_id);
+
 extern void jag_common_poll_data(List task_list, uint64_t cont_id,
 				 jag_callbacks_t *callbacks, bool profile);
 
@@ -68,6 +68,7 @@ extern void fair_tree_decay(List jobs, time_t start)
 
 	/* assign job priorities */
 	lock_slurmctld(job_write_lock);
+	priority_cache_fs_update();
 	list_for_each(jobs, (ListForF) decay_apply_weighted_factors, &start);
 	unlock_slurmctld(job_write_lock);
 }
@@ -84,6 +84,7 @@ extern void *acct_db_conn  __attribute__((weak_import));
 extern uint32_t cluster_cpus __attribute__((weak_import));
 extern List job_list  __attribute__((weak_import));
 extern time_t last_job_update __attribute__((weak_import));
+extern time_t last_part_update __attribute__((weak_import));
 extern slurm_conf_t slurm_conf __attribute__((weak_import));
 extern int slurmctld_tres_cnt __attribute__((weak_import));
 extern uint16_t accounting_enforce __attribute__((weak_import));
@@ -93,6 +94,7 @@ void *acct_db_conn = NULL;
 uint32_t cluster_cpus = NO_VAL;
 List job_list = NULL;
 time_t last_job_update = (time_t) 0;
+time_t last_part_update = (time_t) 0;
 slurm_conf_t slurm_conf;
 int slurmctld_tres_cnt = 0;
 uint16_t accounting_enforce = 0;
@@ -148,6 +150,8 @@ static double  *weight_tres; /* tres weights */
 static uint32_t flags;       /* Priority Flags */
 static time_t g_last_ran = 0; /* when the last poll ran */
 static double decay_factor = 1; /* The decay factor when decaying time. */
+static uint32_t conf_gen = 1; /* generation of the config, never 0 */
+static uint32_t fs_gen = 1; /* generation of fairshare values, never 0 */
 
 /* variables defined in priority_multifactor.h */
 
@@ -429,25 +433,21 @@ static int _set_children_usage_efctv(List children_list)
 
 
 /* job_ptr should already have the partition priority and such added here
- * before had we will be adding to it
+ * before had we will be adding to it.
+ * Call with assoc_mgr assoc read lock held.
  */
 static double _get_fairshare_priority(job_record_t *job_ptr)
 {
 	slurmdb_assoc_rec_t *job_assoc;
 	slurmdb_assoc_rec_t *fs_assoc = NULL;
 	double priority_fs = 0.0;
-	assoc_mgr_lock_t locks = { READ_LOCK, NO_LOCK, NO_LOCK, NO_LOCK,
-				   NO_LOCK, NO_LOCK, NO_LOCK };
 
 	if (!calc_fairshare)
 		return 0;
 
-	assoc_mgr_lock(&locks);
-
 	job_assoc = job_ptr->assoc_ptr;
 
 	if (!job_assoc) {
-		assoc_mgr_unlock(&locks);
 		error("Job %u has no association.  Unable to "
 		      "compute fairshare.", job_ptr->job_id);
 		return 0;
@@ -477,7 +477,6 @@ static double _get_fairshare_priority(job_record_t *job_ptr)
 			 fs_assoc->usage->usage_efctv,
 			 fs_assoc->usage->shares_norm, priority_fs);
 	}
-	assoc_mgr_unlock(&locks);
 
 	return priority_fs;
 }
@@ -528,6 +527,117 @@ static double _get_tres_prio_weighted(double *tres_factors)
 	return tmp_tres;
 }
 
+/* Advance a cache generation counter, skipping 0 (invalid) on wrap */
+static void _next_gen(uint32_t *gen)
+{
+	if (!++(*gen))
+		*gen = 1;
+}
+
+/* Compare a cached copy of a job's TRES count array with the current one */
+static bool _tres_cnt_match(uint64_t *cached, uint64_t *tres_cnt)
+{
+	if (!cached || !tres_cnt)
+		return (cached == tres_cnt);
+
+	return !memcmp(cached, tres_cnt, sizeof(uint64_t) * slurmctld_tres_cnt);
+}
+
+/* Set *cached to a copy of a job's TRES count array, NULL if it has none */
+static void _tres_cnt_copy(uint64_t **cached, uint64_t *tres_cnt)
+{
+	if (!tres_cnt) {
+		xfree(*cached);
+		return;
+	}
+
+	if (!*cached)
+		*cached = xcalloc(slurmctld_tres_cnt, sizeof(uint64_t));
+	memcpy(*cached, tres_cnt, sizeof(uint64_t) * slurmctld_tres_cnt);
+}
+
+/*
+ * Return the job's priority factor cache, resetting it first if the config,
+ * partitions, cluster size, the job's partition, request or allocation
+ * changed since it was set.
+ * Fairshare based factors are additionally checked against fs_gen by callers.
+ */
+static job_prio_cache_t *_get_prio_cache(job_record_t *job_ptr)
+{
+	job_prio_cache_t *cache = job_ptr->prio_cache;
+
+	if (!cache)
+		cache = job_ptr->prio_cache = xmalloc(sizeof(*cache));
+
+	if ((cache->conf_gen == conf_gen) &&
+	    (cache->tres_cnt == slurmctld_tres_cnt) &&
+	    (cache->part_update == last_part_update) &&
+	    (cache->cluster_cpus == cluster_cpus) &&
+	    (cache->node_cnt == active_node_record_count) &&
+	    (cache->total_cpus == job_ptr->total_cpus) &&
+	    (cache->part_ptr == job_ptr->part_ptr) &&
+	    _tres_cnt_match(cache->tres_alloc_cnt, job_ptr->tres_alloc_cnt) &&
+	    _tres_cnt_match(cache->tres_req_cnt, job_ptr->tres_req_cnt))
+		return cache;
+
+	if (cache->tres_cnt != slurmctld_tres_cnt) {
+		xfree(cache->priority_tres);
+		xfree(cache->tres_alloc_cnt);
+		xfree(cache->tres_req_cnt);
+		xfree(cache->part_ptrs);
+		xfree(cache->part_tres);
+		cache->part_cnt = 0;
+		cache->tres_cnt = slurmctld_tres_cnt;
+	}
+
+	cache->conf_gen = conf_gen;
+	cache->fs_gen = 0;
+	cache->part_update = last_part_update;
+	cache->cluster_cpus = cluster_cpus;
+	cache->node_cnt = active_node_record_count;
+	cache->total_cpus = job_ptr->total_cpus;
+	cache->part_ptr = job_ptr->part_ptr;
+	_tres_cnt_copy(&cache->tres_alloc_cnt, job_ptr->tres_alloc_cnt);
+	_tres_cnt_copy(&cache->tres_req_cnt, job_ptr->tres_req_cnt);
+	cache->size_set = false;
+	if (cache->part_ptrs)
+		memset(cache->part_ptrs, 0,
+		       sizeof(part_record_t *) * cache->part_cnt);
+
+	return cache;
+}
+
+/*
+ * Return the weighted TRES factors of one partition of a multi-partition
+ * job, computing them only if not already cached in slot part_inx.
+ */
+static double *_get_part_tres_factors(job_record_t *job_ptr,
+				      part_record_t *part_ptr, int part_inx)
+{
+	job_prio_cache_t *cache = _get_prio_cache(job_ptr);
+	double *part_tres;
+	int part_cnt = list_count(job_ptr->part_ptr_list);
+
+	if (cache->part_cnt != part_cnt) {
+		xfree(cache->part_ptrs);
+		xfree(cache->part_tres);
+		cache->part_cnt = part_cnt;
+		cache->part_ptrs = xcalloc(part_cnt, sizeof(part_record_t *));
+		cache->part_tres = xcalloc(part_cnt * cache->tres_cnt,
+					   sizeof(double));
+	}
+
+	part_tres = cache->part_tres + (part_inx * cache->tres_cnt);
+	if (cache->part_ptrs[part_inx] != part_ptr) {
+		memset(part_tres, 0, sizeof(double) * cache->tres_cnt);
+		_get_tres_factors(job_ptr, part_ptr, part_tres);
+		(void) _get_tres_prio_weighted(part_tres);
+		cache->part_ptrs[part_inx] = part_ptr;
+	}
+
+	return part_tres;
+}
+
 /* Returns the priority after applying the weight factors */
 static uint32_t _get_priority_internal(time_t start_time,
 				       job_record_t *job_ptr)
@@ -631,13 +741,11 @@ static uint32_t _get_priority_internal(time_t start_time,
 			double part_tres = 0.0;
 
 			if (weight_tres) {
-				double part_tres_factors[slurmctld_tres_cnt];
-				memset(part_tres_factors, 0,
-				       sizeof(double) * slurmctld_tres_cnt);
-				_get_tres_factors(job_ptr, part_ptr,
-						  part_tres_factors);
-				part_tres = _get_tres_prio_weighted(
-							part_tres_factors);
+				double *part_tres_factors =
+					_get_part_tres_factors(job_ptr,
+							       part_ptr, i);
+				for (int t = 0; t < slurmctld_tres_cnt; t++)
+					part_tres += part_tres_factors[t];
 			}
 
 			priority_part =
@@ -1375,6 +1483,10 @@ static void *_decay_thread(void *no_data)
 
 		lock_slurmctld(job_write_lock);
 
+		/* Usage was just recalculated, fairshare may have changed */
+		if (!(flags & PRIORITY_FLAGS_FAIR_TREE))
+			priority_cache_fs_update();
+
 		/*
 		 * Give the site_factor plugin a chance to update the
 		 * site_factor value if desired.
@@ -1412,6 +1524,34 @@ static void *_decay_thread(void *no_data)
 	return NULL;
 }
 
+/*
+ * Fill tres_factors with the weighted TRES factors of job_part_ptr, reusing
+ * the values cached by the last priority calculation when available.
+ */
+static void _copy_part_tres_factors(job_record_t *job_ptr,
+				    part_record_t *job_part_ptr,
+				    double *tres_factors)
+{
+	job_prio_cache_t *cache = job_ptr->prio_cache;
+
+	if (cache && cache->conf_gen && cache->part_ptrs &&
+	    (cache->tres_cnt == slurmctld_tres_cnt) &&
+	    (cache->part_update == last_part_update)) {
+		for (int i = 0; i < cache->part_cnt; i++) {
+			if (cache->part_ptrs[i] != job_part_ptr)
+				continue;
+			memcpy(tres_factors,
+			       cache->part_tres + (i * cache->tres_cnt),
+			       sizeof(double) * cache->tres_cnt);
+			return;
+		}
+	}
+
+	memset(tres_factors, 0, sizeof(double) * slurmctld_tres_cnt);
+	_get_tres_factors(job_ptr, job_part_ptr, tres_factors);
+	_get_tres_prio_weighted(tres_factors);
+}
+
 static priority_factors_object_t *_create_prio_factors_obj(
 	job_record_t *job_ptr, part_record_t *job_part_ptr)
 {
@@ -1443,13 +1583,10 @@ static priority_factors_object_t *_create_prio_factors_obj(
 				 job_part_ptr->priority_job_factor :
 				 job_part_ptr->norm_priority) *
 				(double)weight_part;
-			if (obj->prio_factors->priority_tres) {
-				_get_tres_factors(
+			if (obj->prio_factors->priority_tres)
+				_copy_part_tres_factors(
 					job_ptr, job_part_ptr,
 					obj->prio_factors->priority_tres);
-				_get_tres_prio_weighted(
-					obj->prio_factors->priority_tres);
-			}
 		}
 	}
 
@@ -1830,6 +1967,10 @@ extern uint32_t priority_p_set(uint32_t last_prio, job_record_t *job_ptr)
 	 */
 	site_factor_g_set(job_ptr);
 
+	/* The job may have changed, so don't trust any cached factors */
+	if (job_ptr->prio_cache)
+		job_ptr->prio_cache->conf_gen = 0;
+
 	priority = _get_priority_internal(time(NULL), job_ptr);
 
 	debug2("initial priority for job %u is %u", job_ptr->job_id, priority);
@@ -1844,6 +1985,7 @@ extern void priority_p_reconfig(bool assoc_clear)
 
 	reconfig = 1;
 	_internal_setup();
+	_next_gen(&conf_gen);
 
 	/* Since Fair Tree uses a different shares calculation method, we
 	 * must reassign shares at reconfigure if the algorithm was switched to
@@ -2120,9 +2262,84 @@ extern uint32_t priority_p_recover(uint32_t prio_boost)
 	return 0;
 }
 
+/* FIXME: this should work off the product of TRESBillingWeights */
+static double _get_job_size_factor(job_record_t *job_ptr)
+{
+	uint32_t cpu_cnt = 0, min_nodes = 1;
+	int node_count = active_node_record_count;
+	double priority_js;
+
+	/* On the initial run of this we don't have total_cpus
+	   so go off the requesting.  After the first shot
+	   total_cpus should be filled in.
+	*/
+	if (job_ptr->total_cpus)
+		cpu_cnt = job_ptr->total_cpus;
+	else if (job_ptr->details
+		 && (job_ptr->details->max_cpus != NO_VAL))
+		cpu_cnt = job_ptr->details->max_cpus;
+	else if (job_ptr->details && job_ptr->details->min_cpus)
+		cpu_cnt = job_ptr->details->min_cpus;
+	if (job_ptr->details)
+		min_nodes = job_ptr->details->min_nodes;
+
+	if (flags & PRIORITY_FLAGS_SIZE_RELATIVE) {
+		uint32_t time_limit = 1;
+		/* Job size in CPUs (based upon average CPUs/Node */
+		priority_js = (double)min_nodes * (double)cluster_cpus /
+			      (double)node_count;
+		if (cpu_cnt > priority_js)
+			priority_js = (double)cpu_cnt;
+		/* Divide by job time limit */
+		if (job_ptr->time_limit != NO_VAL)
+			time_limit = job_ptr->time_limit;
+		else if (job_ptr->part_ptr)
+			time_limit = job_ptr->part_ptr->max_time;
+		priority_js /= time_limit;
+		/* Normalize to max value of 1.0 */
+		priority_js /= cluster_cpus;
+		if (slurm_conf.priority_favor_small)
+			priority_js = (double) 1.0 - priority_js;
+	} else if (slurm_conf.priority_favor_small) {
+		if (node_count > min_nodes)
+			priority_js = (double) (node_count - min_nodes) /
+				      (double) node_count;
+		else
+			priority_js = 0;
+		if (cpu_cnt) {
+			priority_js += (double)(cluster_cpus - cpu_cnt) /
+				       (double)cluster_cpus;
+			priority_js /= 2;
+		}
+	} else {	/* favor large */
+		priority_js = (double) min_nodes / (double) node_count;
+		if (cpu_cnt) {
+			priority_js += (double)cpu_cnt / (double)cluster_cpus;
+			priority_js /= 2;
+		}
+	}
+	if (priority_js < .0)
+		priority_js = 0.0;
+	else if (priority_js > 1.0)
+		priority_js = 1.0;
+
+	return priority_js;
+}
+
+/*
+ * Fill in job_ptr->prio_factors with the unweighted priority factors.
+ *
+ * Factors that can only change when the job is modified, the configuration
+ * is changed or partitions and nodes change (job size and TRES) are kept in
+ * job_ptr->prio_cache across calls. Fairshare, association and QOS factors
+ * only change when the decay thread recalculates usage, so they are cached
+ * per fs_gen. The age factor is always computed since it advances with time.
+ */
 extern void set_priority_factors(time_t start_time, job_record_t *job_ptr)
 {
 	assoc_mgr_lock_t locks = { .assoc = READ_LOCK, .qos = READ_LOCK };
+	job_prio_cache_t *cache;
+	double *priority_tres = NULL, *tres_weights = NULL;
 
 	xassert(job_ptr);
 
@@ -2130,11 +2347,20 @@ extern void set_priority_factors(time_t start_time, job_record_t *job_ptr)
 		job_ptr->prio_factors =
 			xmalloc(sizeof(priority_factors_t));
 	} else {
-		xfree(job_ptr->prio_factors->tres_weights);
-		xfree(job_ptr->prio_factors->priority_tres);
+		/* Reuse the TRES arrays rather than reallocating each time */
+		if (weight_tres &&
+		    (job_ptr->prio_factors->tres_cnt == slurmctld_tres_cnt)) {
+			priority_tres = job_ptr->prio_factors->priority_tres;
+			tres_weights = job_ptr->prio_factors->tres_weights;
+		} else {
+			xfree(job_ptr->prio_factors->tres_weights);
+			xfree(job_ptr->prio_factors->priority_tres);
+		}
 		memset(job_ptr->prio_factors, 0, sizeof(priority_factors_t));
 	}
 
+	cache = _get_prio_cache(job_ptr);
+
 	if (weight_age && job_ptr->details->accrue_time) {
 		uint32_t diff = 0;
 
@@ -2152,82 +2378,58 @@ extern void set_priority_factors(time_t start_time, job_record_t *job_ptr)
 			job_ptr->prio_factors->priority_age = 1.0;
 	}
 
-	if (job_ptr->assoc_ptr && weight_fs) {
-		job_ptr->prio_factors->priority_fs =
-			_get_fairshare_priority(job_ptr);
+	if (cache->fs_gen != fs_gen) {
+		cache->priority_fs = 0.0;
+		cache->priority_assoc = 0.0;
+		cache->priority_qos = 0.0;
+
+		assoc_mgr_lock(&locks);
+		if (job_ptr->assoc_ptr && weight_fs)
+			cache->priority_fs = _get_fairshare_priority(job_ptr);
+
+		if (job_ptr->assoc_ptr && weight_assoc)
+			cache->priority_assoc =
+				(flags & PRIORITY_FLAGS_NO_NORMAL_ASSOC) ?
+				job_ptr->assoc_ptr->priority :
+				job_ptr->assoc_ptr->usage->priority_norm;
+
+		if (job_ptr->qos_ptr && job_ptr->qos_ptr->priority &&
+		    weight_qos) {
+			cache->priority_qos =
+				(flags & PRIORITY_FLAGS_NO_NORMAL_QOS) ?
+				job_ptr->qos_ptr->priority :
+				job_ptr->qos_ptr->usage->norm_priority;
+		}
+		assoc_mgr_unlock(&locks);
+
+		cache->fs_gen = fs_gen;
 	}
 
-	/* FIXME: this should work off the product of TRESBillingWeights */
-	if (weight_js && active_node_record_count && cluster_cpus) {
-		uint32_t cpu_cnt = 0, min_nodes = 1;
-		int node_count = active_node_record_count;
+	if (!cache->size_set) {
+		cache->priority_js = 0.0;
+		if (weight_js && active_node_record_count && cluster_cpus)
+			cache->priority_js = _get_job_size_factor(job_ptr);
 
-		/* On the initial run of this we don't have total_cpus
-		   so go off the requesting.  After the first shot
-		   total_cpus should be filled in.
-		*/
-		if (job_ptr->total_cpus)
-			cpu_cnt = job_ptr->total_cpus;
-		else if (job_ptr->details
-			 && (job_ptr->details->max_cpus != NO_VAL))
-			cpu_cnt = job_ptr->details->max_cpus;
-		else if (job_ptr->details && job_ptr->details->min_cpus)
-			cpu_cnt = job_ptr->details->min_cpus;
-		if (job_ptr->details)
-			min_nodes = job_ptr->details->min_nodes;
-
-		if (flags & PRIORITY_FLAGS_SIZE_RELATIVE) {
-			uint32_t time_limit = 1;
-			/* Job size in CPUs (based upon average CPUs/Node */
-			job_ptr->prio_factors->priority_js =
-				(double)min_nodes *
-				(double)cluster_cpus /
-				(double)node_count;
-			if (cpu_cnt > job_ptr->prio_factors->priority_js) {
-				job_ptr->prio_factors->priority_js =
-					(double)cpu_cnt;
-			}
-			/* Divide by job time limit */
-			if (job_ptr->time_limit != NO_VAL)
-				time_limit = job_ptr->time_limit;
-			else if (job_ptr->part_ptr)
-				time_limit = job_ptr->part_ptr->max_time;
-			job_ptr->prio_factors->priority_js /= time_limit;
-			/* Normalize to max value of 1.0 */
-			job_ptr->prio_factors->priority_js /= cluster_cpus;
-			if (slurm_conf.priority_favor_small) {
-				job_ptr->prio_factors->priority_js =
-					(double) 1.0 -
-					job_ptr->prio_factors->priority_js;
-			}
-		} else if (slurm_conf.priority_favor_small) {
-			if (node_count > min_nodes)
-				job_ptr->prio_factors->priority_js =
-					(double) (node_count - min_nodes) /
-					(double) node_count;
+		if (weight_tres) {
+			if (!cache->priority_tres)
+				cache->priority_tres =
+					xcalloc(cache->tres_cnt,
+						sizeof(double));
 			else
-				job_ptr->prio_factors->priority_js = 0;
-			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
-					(double)(cluster_cpus - cpu_cnt)
-					/ (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
-			}
-		} else {	/* favor large */
-			job_ptr->prio_factors->priority_js =
-				(double) min_nodes / (double) node_count;
-			if (cpu_cnt) {
-				job_ptr->prio_factors->priority_js +=
-					(double)cpu_cnt / (double)cluster_cpus;
-				job_ptr->prio_factors->priority_js /= 2;
-			}
+				memset(cache->priority_tres, 0,
+				       sizeof(double) * cache->tres_cnt);
+			_get_tres_factors(job_ptr, job_ptr->part_ptr,
+					  cache->priority_tres);
 		}
-		if (job_ptr->prio_factors->priority_js < .0)
-			job_ptr->prio_factors->priority_js = 0.0;
-		else if (job_ptr->prio_factors->priority_js > 1.0)
-			job_ptr->prio_factors->priority_js = 1.0;
+
+		cache->size_set = true;
 	}
 
+	job_ptr->prio_factors->priority_fs = cache->priority_fs;
+	job_ptr->prio_factors->priority_assoc = cache->priority_assoc;
+	job_ptr->prio_factors->priority_qos = cache->priority_qos;
+	job_ptr->prio_factors->priority_js = cache->priority_js;
+
 	if (job_ptr->part_ptr && job_ptr->part_ptr->priority_job_factor &&
 	    weight_part) {
 		job_ptr->prio_factors->priority_part =
@@ -2238,42 +2440,38 @@ extern void set_priority_factors(time_t start_time, job_record_t *job_ptr)
 
 	job_ptr->prio_factors->priority_site = job_ptr->site_factor;
 
-	assoc_mgr_lock(&locks);
-	if (job_ptr->assoc_ptr && weight_assoc)
-		job_ptr->prio_factors->priority_assoc =
-			(flags & PRIORITY_FLAGS_NO_NORMAL_ASSOC) ?
-			job_ptr->assoc_ptr->priority :
-			job_ptr->assoc_ptr->usage->priority_norm;
-
-	if (job_ptr->qos_ptr && job_ptr->qos_ptr->priority && weight_qos) {
-		job_ptr->prio_factors->priority_qos =
-			(flags & PRIORITY_FLAGS_NO_NORMAL_QOS) ?
-			job_ptr->qos_ptr->priority :
-			job_ptr->qos_ptr->usage->norm_priority;
-	}
-	assoc_mgr_unlock(&locks);
-
 	if (job_ptr->details)
 		job_ptr->prio_factors->nice = job_ptr->details->nice;
 	else
 		job_ptr->prio_factors->nice = NICE_OFFSET;
 
 	if (weight_tres) {
-		if (!job_ptr->prio_factors->priority_tres) {
-			job_ptr->prio_factors->priority_tres =
-				xcalloc(slurmctld_tres_cnt, sizeof(double));
-			job_ptr->prio_factors->tres_weights =
-				xcalloc(slurmctld_tres_cnt, sizeof(double));
-			memcpy(job_ptr->prio_factors->tres_weights, weight_tres,
-			       sizeof(double) * slurmctld_tres_cnt);
-			job_ptr->prio_factors->tres_cnt = slurmctld_tres_cnt;
+		if (!priority_tres) {
+			priority_tres = xcalloc(slurmctld_tres_cnt,
+						sizeof(double));
+			tres_weights = xcalloc(slurmctld_tres_cnt,
+					       sizeof(double));
 		}
-
-		_get_tres_factors(job_ptr, job_ptr->part_ptr,
-				  job_ptr->prio_factors->priority_tres);
+		memcpy(tres_weights, weight_tres,
+		       sizeof(double) * slurmctld_tres_cnt);
+		memcpy(priority_tres, cache->priority_tres,
+		       sizeof(double) * slurmctld_tres_cnt);
+		job_ptr->prio_factors->priority_tres = priority_tres;
+		job_ptr->prio_factors->tres_weights = tres_weights;
+		job_ptr->prio_factors->tres_cnt = slurmctld_tres_cnt;
 	}
 }
 
+/*
+ * Start a new fairshare generation after the decay thread recalculated
+ * usage, so cached fairshare, association and QOS factors get refreshed.
+ * Call with the slurmctld job write lock held.
+ */
+extern void priority_cache_fs_update(void)
+{
+	_next_gen(&fs_gen);
+}
+
 
 /* Set usage_efctv based on algorithm-specific code. Fair Tree sets this
  * elsewhere.
@@ -58,5 +58,6 @@ extern int decay_apply_weighted_factors(job_record_t *job_ptr,
 					time_t *start_time_ptr);
 extern void set_assoc_usage_norm(slurmdb_assoc_rec_t *assoc);
 extern void set_priority_factors(time_t start_time, job_record_t *job_ptr);
+extern void priority_cache_fs_update(void);
 
 #endif
@@ -503,37 +503,81 @@ static void _remove_duplicate_fed_jobs(List jobs)
 	xfree(hash_job);
 }
 
-extern int get_data(void)
+/* Return true if the specified job id is local to a cluster
+ * (not a federated job) */
+static bool _test_local_job(uint32_t job_id)
+{
+	if ((job_id & (~MAX_JOB_ID)) == 0)
+		return true;
+	return false;
+}
+
+static void _print_script(slurmdb_job_rec_t *job)
+{
+	char *id = slurmdb_get_job_id_str(job);
+
+	printf("Batch Script for %s\n--------------------------------------------------------------------------------\n%s\n",
+	       id, job->script ? job->script : "NONE\n");
+	xfree(id);
+	return;
+}
+
+static void _print_env(slurmdb_job_rec_t *job)
+{
+	char *id = slurmdb_get_job_id_str(job);
+
+	printf("Environment used for %s (must be batch to display)\n--------------------------------------------------------------------------------\n%s\n",
+	       id, job->env ? job->env : "NONE\n");
+	xfree(id);
+	return;
+}
+
+static void _print_jobs(List jobs)
 {
-	slurmdb_job_rec_t *job = NULL;
-	slurmdb_step_rec_t *step = NULL;
 	ListIterator itr = NULL;
 	ListIterator itr_step = NULL;
+	slurmdb_job_rec_t *job = NULL;
+	slurmdb_step_rec_t *step = NULL;
 	slurmdb_job_cond_t *job_cond = params.job_cond;
-	int cnt;
 
-	if (params.opt_completion) {
-		jobs = slurmdb_jobcomp_jobs_get(job_cond);
-		return SLURM_SUCCESS;
-	} else {
-		jobs = slurmdb_jobs_get(acct_db_conn, job_cond);
-	}
+	itr = list_iterator_create(jobs);
+	while ((job = list_next(itr))) {
+		if ((params.cluster_name) &&
+		    _test_local_job(job->jobid) &&
+		    xstrcmp(params.cluster_name, job->cluster))
+			continue;
 
-	if (!jobs)
-		return SLURM_ERROR;
+		if (job_cond->flags & JOBCOND_FLAG_SCRIPT) {
+			_print_script(job);
+			continue;
+		} else if (job_cond->flags & JOBCOND_FLAG_ENV) {
+			_print_env(job);
+			continue;
+		}
 
-	/*
-	 * Remove duplicate federated jobs. The db will remove duplicates for
-	 * one cluster but not when jobs for multiple clusters are requested.
-	 * Remove the current job if there were jobs with the same id submitted
-	 * in the future.
-	 * Else sort the jobs to order the jobs so the last task of arrays don't
-	 * appear to run before any of the other tasks.
-	 */
-	if (params.cluster_name && !(job_cond->flags & JOBCOND_FLAG_DUP))
-		_remove_duplicate_fed_jobs(jobs);
-	else
-		list_sort(jobs, _sort_desc_submit_time);
+		if (job->show_full)
+			print_fields(JOB, job);
+
+		if (!(job_cond->flags & JOBCOND_FLAG_NO_STEP)) {
+			itr_step = list_iterator_create(job->steps);
+			while ((step = list_next(itr_step))) {
+				if (step->end == 0)
+					step->end = job->end;
+				print_fields(JOBSTEP, step);
+			}
+			list_iterator_destroy(itr_step);
+		}
+	}
+	list_iterator_destroy(itr);
+}
+
+static void _aggregate_steps(List jobs)
+{
+	slurmdb_job_rec_t *job = NULL;
+	slurmdb_step_rec_t *step = NULL;
+	ListIterator itr = NULL;
+	ListIterator itr_step = NULL;
+	int cnt;
 
 	itr = list_iterator_create(jobs);
 	while ((job = list_next(itr))) {
@@ -561,6 +605,77 @@ extern int get_data(void)
 		list_iterator_destroy(itr_step);
 	}
 	list_iterator_destroy(itr);
+}
+
+/*
+ * Jobs can be printed as they come back unless they all need to be seen
+ * first, to dump them, to remove duplicate federated jobs or to sort the jobs
+ * of several clusters together.
+ */
+static bool _print_parts(void)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+
+	if (params.mimetype)
+		return false;
+	if (params.cluster_name && !(job_cond->flags & JOBCOND_FLAG_DUP))
+		return false;
+	if (job_cond->cluster_list && (list_count(job_cond->cluster_list) > 1))
+		return false;
+
+	return true;
+}
+
+static int _print_jobs_part(void *x, void *arg)
+{
+	List part = x;
+
+	list_sort(part, _sort_desc_submit_time);
+	_aggregate_steps(part);
+	_print_jobs(part);
+
+	return 0;
+}
+
+extern int get_data(void)
+{
+	slurmdb_job_cond_t *job_cond = params.job_cond;
+
+	if (params.opt_completion) {
+		jobs = slurmdb_jobcomp_jobs_get(job_cond);
+		return SLURM_SUCCESS;
+	} else if (_print_parts()) {
+		/*
+		 * Print each part of the jobs as it is received instead of
+		 * holding on to all of them, jobs is left NULL for do_list().
+		 * Parts come back in job id order, each sorted on its own.
+		 */
+		if (slurmdb_jobs_get_parts(acct_db_conn, job_cond,
+					   _print_jobs_part, NULL) !=
+		    SLURM_SUCCESS)
+			return SLURM_ERROR;
+		return SLURM_SUCCESS;
+	} else {
+		jobs = slurmdb_jobs_get(acct_db_conn, job_cond);
+	}
+
+	if (!jobs)
+		return SLURM_ERROR;
+
+	/*
+	 * Remove duplicate federated jobs. The db will remove duplicates for
+	 * one cluster but not when jobs for multiple clusters are requested.
+	 * Remove the current job if there were jobs with the same id submitted
+	 * in the future.
+	 * Else sort the jobs to order the jobs so the last task of arrays don't
+	 * appear to run before any of the other tasks.
+	 */
+	if (params.cluster_name && !(job_cond->flags & JOBCOND_FLAG_DUP))
+		_remove_duplicate_fed_jobs(jobs);
+	else
+		list_sort(jobs, _sort_desc_submit_time);
+
+	_aggregate_steps(jobs);
 
 	return SLURM_SUCCESS;
 }
@@ -1369,35 +1484,6 @@ extern void do_help(void)
 	}
 }
 
-/* Return true if the specified job id is local to a cluster
- * (not a federated job) */
-static bool _test_local_job(uint32_t job_id)
-{
-	if ((job_id & (~MAX_JOB_ID)) == 0)
-		return true;
-	return false;
-}
-
-static void _print_script(slurmdb_job_rec_t *job)
-{
-	char *id = slurmdb_get_job_id_str(job);
-
-	printf("Batch Script for %s\n--------------------------------------------------------------------------------\n%s\n",
-	       id, job->script ? job->script : "NONE\n");
-	xfree(id);
-	return;
-}
-
-static void _print_env(slurmdb_job_rec_t *job)
-{
-	char *id = slurmdb_get_job_id_str(job);
-
-	printf("Environment used for %s (must be batch to display)\n--------------------------------------------------------------------------------\n%s\n",
-	       id, job->env ? job->env : "NONE\n");
-	xfree(id);
-	return;
-}
-
 /* do_list() -- List the assembled data
  *
  * In:	Nothing explicit.
@@ -1408,12 +1494,6 @@ static void _print_env(slurmdb_job_rec_t *job)
  */
 extern void do_list(int argc, char **argv)
 {
-	ListIterator itr = NULL;
-	ListIterator itr_step = NULL;
-	slurmdb_job_rec_t *job = NULL;
-	slurmdb_step_rec_t *step = NULL;
-	slurmdb_job_cond_t *job_cond = params.job_cond;
-
 	if (params.mimetype) {
 		errno = DATA_DUMP_CLI(JOB_LIST, jobs, "jobs", argc, argv,
 				      acct_db_conn, params.mimetype,
@@ -1424,35 +1504,7 @@ extern void do_list(int argc, char **argv)
 	if (!jobs)
 		return;
 
-	itr = list_iterator_create(jobs);
-	while ((job = list_next(itr))) {
-		if ((params.cluster_name) &&
-		    _test_local_job(job->jobid) &&
-		    xstrcmp(params.cluster_name, job->cluster))
-			continue;
-
-		if (job_cond->flags & JOBCOND_FLAG_SCRIPT) {
-			_print_script(job);
-			continue;
-		} else if (job_cond->flags & JOBCOND_FLAG_ENV) {
-			_print_env(job);
-			continue;
-		}
-
-		if (job->show_full)
-			print_fields(JOB, job);
-
-		if (!(job_cond->flags & JOBCOND_FLAG_NO_STEP)) {
-			itr_step = list_iterator_create(job->steps);
-			while ((step = list_next(itr_step))) {
-				if (step->end == 0)
-					step->end = job->end;
-				print_fields(JOBSTEP, step);
-			}
-			list_iterator_destroy(itr_step);
-		}
-	}
-	list_iterator_destroy(itr);
+	_print_jobs(jobs);
 }
 
 /* do_list_completion() -- List the assembled data
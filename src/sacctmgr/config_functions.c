@@ -147,6 +147,11 @@ static void _print_rollup_stats(slurmdb_rollup_stats_t *rollup_stats, int i)
 
 
 	printf("\tMean cycle:   %"PRIu64"\n", roll_ave);
+
+	if (rollup_stats->windows[i] > 1)
+		printf("\tLast windows: %u (longest %"PRIu64")\n",
+		       rollup_stats->windows[i],
+		       rollup_stats->time_window_max[i]);
 }
 
 static int _sort_rpc_obj_by_id(void *void1, void *void2)
@@ -214,10 +219,16 @@ static int _print_rpc_obj(void *x, void *arg)
 		       uid_to_string_cached((uid_t)rpc_obj->id),
 		       rpc_obj->id);
 
-	printf(" count:%-6u ave_time:%-6"PRIu64" total_time:%"PRIu64"\n",
+	printf(" count:%-6u ave_time:%-6"PRIu64" total_time:%"PRIu64,
 	       rpc_obj->cnt,
 	       rpc_obj->time_ave, rpc_obj->time);
 
+	if (rpc_obj->batch_cnt)
+		printf(" batches:%-6u batched:%u",
+		       rpc_obj->batch_cnt, rpc_obj->batch_rows);
+
+	printf("\n");
+
 	return 0;
 }
 
@@ -60,6 +60,7 @@
 #define OPT_LONG_USAGE     0x102
 #define OPT_LONG_SEND_LIBS 0x103
 #define OPT_LONG_AUTOCOMP  0x104
+#define OPT_LONG_PIPELINE  0x105
 
 
 /* getopt_long options, integers but not characters */
@@ -85,6 +86,7 @@ extern void parse_command_line(int argc, char **argv)
 		{"fanout",    required_argument, 0, 'F'},
 		{"force",     no_argument,       0, 'f'},
 		{"jobid",     required_argument, 0, 'j'},
+		{"pipeline",  required_argument, 0, OPT_LONG_PIPELINE},
 		{"send-libs", optional_argument, 0, OPT_LONG_SEND_LIBS},
 		{"preserve",  no_argument,       0, 'p'},
 		{"size",      required_argument, 0, 's'},
@@ -119,6 +121,8 @@ extern void parse_command_line(int argc, char **argv)
 		params.fanout = atoi(env_val);
 	if (getenv("SBCAST_FORCE"))
 		params.flags |= BCAST_FLAG_FORCE;
+	if ((env_val = getenv("SBCAST_PIPELINE")))
+		params.pipeline = atoi(env_val);
 
 	if (getenv("SBCAST_PRESERVE"))
 		params.flags |= BCAST_FLAG_PRESERVE;
@@ -172,6 +176,9 @@ extern void parse_command_line(int argc, char **argv)
 		case (int)'p':
 			params.flags |= BCAST_FLAG_PRESERVE;
 			break;
+		case (int) OPT_LONG_PIPELINE:
+			params.pipeline = atoi(optarg);
+			break;
 		case (int) OPT_LONG_SEND_LIBS:
 			ret = parse_send_libs(optarg);
 			if (ret == -1)
@@ -292,6 +299,7 @@ static void _print_options( void )
 	info("force      = %s",
 	     (params.flags & BCAST_FLAG_FORCE) ? "true" : "false");
 	info("fanout     = %d", params.fanout);
+	info("pipeline   = %d", params.pipeline);
 	info("preserve   = %s",
 	     (params.flags & BCAST_FLAG_PRESERVE) ? "true" : "false");
 	info("send_libs  = %s",
@@ -319,6 +327,7 @@ Usage: sbcast [OPTIONS] SOURCE DEST\n\
   -F, --fanout=num      specify message fanout\n\
   -j, --jobid=#[+#][.#] specify job ID with optional hetjob offset and/or step ID\n\
   -p, --preserve        preserve modes and times of source file\n\
+  --pipeline=num        number of file blocks in flight at one time\n\
   --send-libs[=yes|no]  autodetect and broadcast executable's shared objects\n\
   -s, --size=num        block size in bytes (rounded off)\n\
   -t, --timeout=secs    specify message timeout (seconds)\n\
@@ -125,6 +125,10 @@ static int _print_stats(void)
 	printf("Agent queue size:     %d\n", buf->agent_queue_size);
 	printf("Agent count:          %d\n", buf->agent_count);
 	printf("Agent thread count:   %d\n", buf->agent_thread_count);
+	printf("Agent workers busy:   %u/%u\n", buf->agent_workers_busy,
+	       buf->agent_workers);
+	printf("Agent work queue:     %u (max %u)\n", buf->agent_work_queue,
+	       buf->agent_work_queue_max);
 	printf("DBD Agent queue size: %d\n\n", buf->dbd_agent_queue_size);
 
 	printf("Jobs submitted: %d\n", buf->jobs_submitted);
@@ -203,6 +207,12 @@ static int _print_stats(void)
 	printf("\nLatency for 1000 calls to gettimeofday(): %d microseconds\n",
 	       buf->gettimeofday_latency);
 
+	printf("\nShared string statistics\n");
+	printf("\tStrings:      %u\n", buf->intern_strings);
+	printf("\tReferences:   %"PRIu64"\n", buf->intern_refs);
+	printf("\tBytes used:   %"PRIu64"\n", buf->intern_bytes);
+	printf("\tBytes saved:  %"PRIu64"\n", buf->intern_bytes_saved);
+
 	printf("\nRemote Procedure Call statistics by message type\n");
 	for (i = 0; i < buf->rpc_type_size; i++) {
 		printf("\t%-40s(%5u) count:%-6u "
@@ -226,6 +236,28 @@ static int _print_stats(void)
 		xfree(user);
 	}
 
+	if (buf->fwd_type_size)
+		printf("\nMessage tree statistics by message type\n");
+	for (i = 0; i < buf->fwd_type_size; i++) {
+		printf("\t%-40s(%5u) count:%-6u "
+		       "ave_time:%-6"PRIu64" max_time:%"PRIu64"\n",
+		       rpc_num2string(buf->fwd_type_id[i]),
+		       buf->fwd_type_id[i], buf->fwd_type_cnt[i],
+		       buf->fwd_type_time[i] / buf->fwd_type_cnt[i],
+		       buf->fwd_type_max[i]);
+	}
+
+	if (buf->agent_type_size)
+		printf("\nAgent RPC statistics by message type\n");
+	for (i = 0; i < buf->agent_type_size; i++) {
+		printf("\t%-40s(%5u) count:%-6u "
+		       "ave_time:%-6"PRIu64" max_time:%"PRIu64"\n",
+		       rpc_num2string(buf->agent_type_id[i]),
+		       buf->agent_type_id[i], buf->agent_type_cnt[i],
+		       buf->agent_type_time[i] / buf->agent_type_cnt[i],
+		       buf->agent_type_max[i]);
+	}
+
 	printf("\nPending RPC statistics\n");
 	if (buf->rpc_queue_type_count == 0)
 		printf("\tNo pending RPCs\n");
@@ -531,6 +531,22 @@ static int _get_tres_state_reason(int tres_pos, int unk_reason)
 	return unk_reason;
 }
 
+/*
+ * Remember the GrpTRES limit of an association or QOS that held the job, see
+ * acct_policy_job_limit_blocked(). Node and billing counts depend on the nodes
+ * selected so they can't be checked ahead of the selection.
+ */
+static void _set_limit_block(job_record_t *job_ptr, uint32_t id, bool qos,
+			     int tres_pos)
+{
+	if ((tres_pos == TRES_ARRAY_NODE) || (tres_pos == TRES_ARRAY_BILLING))
+		return;
+
+	job_ptr->limit_block_id = id;
+	job_ptr->limit_block_pos = tres_pos + 1;
+	job_ptr->limit_block_qos = qos;
+}
+
 static int _find_used_limits_for_acct(void *x, void *key)
 {
 	slurmdb_used_limits_t *used_limits = (slurmdb_used_limits_t *)x;
@@ -1109,6 +1125,22 @@ static void _qos_alter_job(job_record_t *job_ptr,
 	}
 }
 
+/*
+ * Return true if any TRES limit in the array is set. There is no early exit so
+ * the loop vectorizes, most of the arrays a job is checked against have no
+ * limit at all and are skipped without walking them one TRES at a time.
+ */
+static bool _tres_limits_set(uint64_t *tres_limit_array)
+{
+	uint64_t set = 0;
+	int i;
+
+	for (i = 0; i < g_tres_count; i++)
+		set |= ~tres_limit_array[i]; /* 0 when INFINITE64 */
+
+	return set;
+}
+
 /*
  * _validate_tres_limits_for_assoc - validate the tres requested against limits
  * of an association as well as qos skipping any limit an admin set
@@ -1140,7 +1172,7 @@ static bool _validate_tres_limits_for_assoc(
 	int i;
 	uint64_t job_tres;
 
-	if (!strict_checking)
+	if (!strict_checking || !_tres_limits_set(assoc_tres_array))
 		return true;
 
 	for (i = 0; i < g_tres_count; i++) {
@@ -1207,6 +1239,10 @@ static bool _validate_tres_limits_for_qos(
 	if (!strict_checking)
 		return true;
 
+	if (!_tres_limits_set(max_tres_array) &&
+	    (!grp_tres_array || !_tres_limits_set(grp_tres_array)))
+		return true;
+
 	for (i = 0; i < g_tres_count; i++) {
 		(*tres_pos) = i;
 		if (grp_tres_array) {
@@ -1337,7 +1373,8 @@ static bool _validate_tres_time_limits(
 	int i;
 //	uint32_t max_time_limit;
 
-	if (!strict_checking || (*limit_set_time) == ADMIN_SET_LIMIT)
+	if (!strict_checking || (*limit_set_time) == ADMIN_SET_LIMIT ||
+	    !_tres_limits_set(max_tres_array))
 		return true;
 
 	for (i = 0; i < g_tres_count; i++) {
@@ -1433,6 +1470,9 @@ static acct_policy_tres_usage_t _validate_tres_usage_limits(
 	xassert(tres_limit_array);
 	xassert(tres_req_cnt);
 
+	if (!_tres_limits_set(tres_limit_array))
+		return TRES_USAGE_OKAY;
+
 	for (i = 0; i < g_tres_count; i++) {
 		(*tres_pos) = i;
 
@@ -2268,6 +2308,7 @@ static int _qos_job_runnable_post_select(job_record_t *job_ptr,
 		       assoc_mgr_tres_name_array[tres_pos],
 		       tres_req_cnt[tres_pos],
 		       qos_ptr->grp_tres_ctld[tres_pos]);
+		_set_limit_block(job_ptr, qos_ptr->id, true, tres_pos);
 		rc = false;
 		goto end_it;
 		break;
@@ -2281,6 +2322,7 @@ static int _qos_job_runnable_post_select(job_record_t *job_ptr,
 		       qos_ptr->grp_tres_ctld[tres_pos],
 		       qos_ptr->usage->grp_used_tres[tres_pos],
 		       tres_req_cnt[tres_pos]);
+		_set_limit_block(job_ptr, qos_ptr->id, true, tres_pos);
 		rc = false;
 		goto end_it;
 	case TRES_USAGE_OKAY:
@@ -3749,6 +3791,7 @@ extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
 	}
 
 	job_ptr->qos_blocking_ptr = NULL;
+	job_ptr->limit_block_pos = 0;
 
 	/* clang needs this memset to avoid a warning */
 	memset(tres_run_mins, 0, sizeof(tres_run_mins));
@@ -3921,6 +3964,8 @@ extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
 			       assoc_mgr_tres_name_array[tres_pos],
 			       tres_req_cnt[tres_pos],
 			       grp_tres_ctld[tres_pos]);
+			_set_limit_block(job_ptr, assoc_ptr->id, false,
+					 tres_pos);
 			rc = false;
 			goto end_it;
 			break;
@@ -3935,6 +3980,8 @@ extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
 			       grp_tres_ctld[tres_pos],
 			       assoc_ptr->usage->grp_used_tres[tres_pos],
 			       tres_req_cnt[tres_pos]);
+			_set_limit_block(job_ptr, assoc_ptr->id, false,
+					 tres_pos);
 			rc = false;
 			goto end_it;
 		case TRES_USAGE_OKAY:
@@ -4074,6 +4121,108 @@ end_it:
 	return rc;
 }
 
+extern bool acct_policy_job_limit_blocked(job_record_t *job_ptr)
+{
+	slurmdb_qos_rec_t *qos_ptr_1, *qos_ptr_2, *qos_ptr = NULL;
+	slurmdb_assoc_rec_t *assoc_ptr = NULL;
+	uint64_t limit, used, req;
+	double limit_factor = -1.0;
+	int tres_pos;
+	bool rc = false;
+	assoc_mgr_lock_t locks =
+		{ .assoc = READ_LOCK, .qos = READ_LOCK, .tres = READ_LOCK };
+
+	if (!job_ptr->limit_block_pos || !job_ptr->tres_req_cnt ||
+	    !(accounting_enforce & ACCOUNTING_ENFORCE_LIMITS))
+		return false;
+
+	tres_pos = job_ptr->limit_block_pos - 1;
+
+	assoc_mgr_lock(&locks);
+
+	if ((tres_pos >= g_tres_count) ||
+	    (job_ptr->limit_set.tres[tres_pos] == ADMIN_SET_LIMIT))
+		goto end_it;
+
+	acct_policy_set_qos_order(job_ptr, &qos_ptr_1, &qos_ptr_2);
+
+	/*
+	 * Only look at the limit if it is still the one that would be checked,
+	 * a QOS limit on the same TRES overrides the ones after it.
+	 */
+	if (job_ptr->limit_block_qos) {
+		if (qos_ptr_1 && (qos_ptr_1->id == job_ptr->limit_block_id))
+			qos_ptr = qos_ptr_1;
+		else if (qos_ptr_2 &&
+			 (qos_ptr_2->id == job_ptr->limit_block_id) &&
+			 (!qos_ptr_1 ||
+			  (qos_ptr_1->grp_tres_ctld[tres_pos] == INFINITE64)))
+			qos_ptr = qos_ptr_2;
+		if (!qos_ptr)
+			goto end_it;
+
+		limit = qos_ptr->grp_tres_ctld[tres_pos];
+		used = qos_ptr->usage->grp_used_tres[tres_pos];
+	} else {
+		if ((qos_ptr_1 &&
+		     (qos_ptr_1->grp_tres_ctld[tres_pos] != INFINITE64)) ||
+		    (qos_ptr_2 &&
+		     (qos_ptr_2->grp_tres_ctld[tres_pos] != INFINITE64)))
+			goto end_it;
+
+		assoc_ptr = job_ptr->assoc_ptr;
+		while (assoc_ptr && (assoc_ptr->id != job_ptr->limit_block_id))
+			assoc_ptr = assoc_ptr->usage->parent_assoc_ptr;
+		if (!assoc_ptr)
+			goto end_it;
+
+		if (qos_ptr_1 &&
+		    !fuzzy_equal(qos_ptr_1->limit_factor, INFINITE))
+			limit_factor = qos_ptr_1->limit_factor;
+		else if (qos_ptr_2 &&
+			 !fuzzy_equal(qos_ptr_2->limit_factor, INFINITE))
+			limit_factor = qos_ptr_2->limit_factor;
+
+		limit = assoc_ptr->grp_tres_ctld[tres_pos];
+		_apply_limit_factor(&limit, limit_factor);
+		used = assoc_ptr->usage->grp_used_tres[tres_pos];
+	}
+
+	/*
+	 * The job's own request is the least the nodes selected for it can
+	 * add up to, if that does not fit the job is still held.
+	 */
+	req = job_ptr->tres_req_cnt[tres_pos];
+	if ((limit == INFINITE64) || !req || ((req + used) <= limit))
+		goto end_it;
+
+	xfree(job_ptr->state_desc);
+	if (qos_ptr) {
+		job_ptr->state_reason = _get_tres_state_reason(
+			tres_pos, WAIT_QOS_GRP_UNK);
+		debug2("%pJ is still being held, QOS %s group max tres(%s) limit %"PRIu64" with already used %"PRIu64" + requested %"PRIu64,
+		       job_ptr, qos_ptr->name,
+		       assoc_mgr_tres_name_array[tres_pos],
+		       limit, used, req);
+	} else {
+		job_ptr->state_reason = _get_tres_state_reason(
+			tres_pos, WAIT_ASSOC_GRP_UNK);
+		debug2("%pJ is still being held, assoc %u(%s/%s/%s) group max tres(%s) limit %"PRIu64" with already used %"PRIu64" + requested %"PRIu64,
+		       job_ptr, assoc_ptr->id, assoc_ptr->acct,
+		       assoc_ptr->user, assoc_ptr->partition,
+		       assoc_mgr_tres_name_array[tres_pos],
+		       limit, used, req);
+	}
+	rc = true;
+
+end_it:
+	if (!rc)
+		job_ptr->limit_block_pos = 0;
+	assoc_mgr_unlock(&locks);
+
+	return rc;
+}
+
 extern uint32_t acct_policy_get_max_nodes(job_record_t *job_ptr,
 					  uint32_t *wait_reason)
 {
@@ -117,6 +117,14 @@ extern bool acct_policy_validate_het_job(List submit_job_list);
  *	policy (e.g. running job limit for this association). If the
  *	association limits prevent the job from ever running (lowered
  *	limits since job submission), then cancel the job.
+ *
+ * This and acct_policy_job_runnable_post_select() read the association and
+ * QOS records under the assoc_mgr read locks, not from a snapshot. The usage
+ * they check is updated in place by acct_policy_job_begin() as each job of a
+ * scheduling pass starts, and a snapshot taken for the pass would let later
+ * jobs of it pass limits the earlier ones already filled. assoc_mgr fetches
+ * lists from the slurmdbd before taking the write locks, so the read locks
+ * only wait on the slurmdbd when an update raced such a fetch.
  */
 extern bool acct_policy_job_runnable_pre_select(job_record_t *job_ptr,
 						bool assoc_mgr_locked);
@@ -129,6 +137,15 @@ extern bool acct_policy_job_runnable_post_select(job_record_t *job_ptr,
 						 uint64_t *tres_req_cnt,
 						 bool assoc_mgr_locked);
 
+/*
+ * acct_policy_job_limit_blocked - Check if the GrpTRES limit that held the
+ *	job at its last acct_policy_job_runnable_post_select() still does with
+ *	the job's minimum request, so it can be held again without selecting
+ *	nodes for it first.
+ * RET true if still held, with the job's state_reason set
+ */
+extern bool acct_policy_job_limit_blocked(job_record_t *job_ptr);
+
 /*
  * Determine of the specified job can execute right now or is currently
  * blocked by an association or QOS limit. Does not re-validate job state.
@@ -51,15 +51,19 @@
  *  be possible to execute the agent as an pthread, process, or even a daemon
  *  on some other computer.
  *
- *  The main agent thread creates a separate thread for each node to be
- *  communicated with up to AGENT_THREAD_COUNT. A special watchdog thread
- *  sends SIGLARM to any threads that have been active (in DSH_ACTIVE state)
+ *  The main agent thread hands the communication with each node to a pool of
+ *  AGENT_WORKER_COUNT worker threads shared by all agents, with up to
+ *  AGENT_THREAD_COUNT of them in flight per agent. The agents are admitted
+ *  while their RPCs in flight fit within AGENT_WORKER_COUNT, so the pool
+ *  caps the RPCs in flight and there is always a worker free for them.
+ *  While its RPCs are in flight, the agent thread acts as their watchdog and
+ *  sends SIGUSR1 to any worker that has been active (in DSH_ACTIVE state)
  *  for more than MessageTimeout seconds.
  *  The agent responds to slurmctld via a function call or an RPC as required.
  *  For example, informing slurmctld that some node is not responding.
  *
- *  All the state for each thread is maintained in thd_t struct, which is
- *  used by the watchdog thread as well as the communication threads.
+ *  All the state for each node is maintained in thd_t struct, which is
+ *  used by the agent thread as well as the worker threads.
 \*****************************************************************************/
 
 #include "config.h"
@@ -89,6 +93,7 @@
 #include "src/common/slurm_protocol_api.h"
 #include "src/common/slurm_protocol_interface.h"
 #include "src/common/uid.h"
+#include "src/common/workq.h"
 #include "src/common/xsignal.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
@@ -112,6 +117,7 @@
 #define DUMP_RPC_COUNT 		25
 #define HOSTLIST_MAX_SIZE 	80
 #define MAIL_PROG_TIMEOUT 120 /* Timeout in seconds */
+#define SEND_STATS_SIZE		100	/* message types with send statistics */
 
 typedef enum {
 	DSH_NEW,        /* Request not yet started */
@@ -132,7 +138,7 @@ typedef struct thd_complete {
 } thd_complete_t;
 
 typedef struct thd {
-	pthread_t thread;		/* thread ID */
+	pthread_t thread;		/* ID of the worker sending it */
 	state_t state;			/* thread state */
 	time_t start_time;		/* start time */
 	time_t end_time;		/* end time or delta time
@@ -170,6 +176,7 @@ typedef struct task_info {
 	slurm_msg_type_t msg_type;	/* RPC to be issued */
 	void *msg_args_ptr;		/* ptr to RPC data to be used */
 	uint16_t protocol_version;	/* if set, use this version */
+	struct timeval queued;		/* when handed to the workers */
 } task_info_t;
 
 typedef struct queued_request {
@@ -192,6 +199,7 @@ static void _reboot_from_ctld(agent_arg_t *agent_arg_ptr);
 static int  _signal_defer(queued_request_t *queued_req_ptr);
 static inline int _comm_err(char *node_name, slurm_msg_type_t msg_type);
 static void _list_delete_retry(void *retry_entry);
+static agent_arg_t *_merge_batch_launch(agent_arg_t *agent_arg_ptr);
 static agent_info_t *_make_agent_info(agent_arg_t *agent_arg_ptr);
 static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx);
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr);
@@ -202,9 +210,11 @@ static void _queue_agent_retry(agent_info_t * agent_info_ptr, int count);
 static int  _setup_requeue(agent_arg_t *agent_arg_ptr, thd_t *thread_ptr,
 			   int *count, int *spot);
 static void _sig_handler(int dummy);
-static void *_thread_per_group_rpc(void *args);
+static void _send_group_rpc(void *args);
+static void _timespec_add_usec(struct timespec *ts, unsigned long usec);
 static int   _valid_agent_arg(agent_arg_t *agent_arg_ptr);
-static void *_wdog(void *args);
+static bool _wdog(agent_info_t *agent_ptr, thd_complete_t *thd_comp);
+static void _wdog_fini(agent_info_t *agent_ptr, thd_complete_t *thd_comp);
 
 static mail_info_t *_mail_alloc(void);
 static void  _mail_free(void *arg);
@@ -225,6 +235,8 @@ static pthread_mutex_t agent_cnt_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t  agent_cnt_cond  = PTHREAD_COND_INITIALIZER;
 static int agent_cnt = 0;
 static int agent_thread_cnt = 0;
+static int agent_rpc_cnt = 0;		/* RPCs admitted agents may have in
+					 * flight, up to AGENT_WORKER_COUNT */
 static int mail_thread_cnt = 0;
 static uint16_t message_timeout = NO_VAL16;
 
@@ -244,6 +256,16 @@ static uint32_t *rpc_type_list;
 static char **rpc_host_list = NULL;
 static time_t cache_build_time = 0;
 
+static workq_t *agent_workq = NULL;	/* protected by agent_cnt_mutex */
+
+static pthread_mutex_t send_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t send_queued = 0;	/* waiting for a worker */
+static uint32_t send_queued_max = 0;
+static uint16_t send_stats_type[SEND_STATS_SIZE];
+static uint32_t send_stats_cnt[SEND_STATS_SIZE];
+static uint64_t send_stats_time[SEND_STATS_SIZE];
+static uint64_t send_stats_max[SEND_STATS_SIZE];
+
 /*
  * agent - party responsible for transmitting an common RPC in parallel
  *	across a set of nodes. Use agent_queue_request() if immediate
@@ -254,15 +276,17 @@ static time_t cache_build_time = 0;
  */
 void *agent(void *args)
 {
-	int i, delay;
-	pthread_t thread_wdog = 0;
+	int i = 0, delay;
 	agent_arg_t *agent_arg_ptr = args;
 	agent_info_t *agent_info_ptr = NULL;
-	thd_t *thread_ptr;
 	task_info_t *task_specific_ptr;
+	thd_complete_t thd_comp = { .max_delay = 0 };
+	struct timespec wdog_ts, now_ts;
+	unsigned long usec = 5000;
 	time_t begin_time;
 	bool spawn_retry_agent = false;
-	int rpc_thread_cnt;
+	int rpc_cnt;
+	workq_t *workq = NULL;
 	static time_t sched_update = 0;
 	static bool reboot_from_ctld = false;
 
@@ -291,12 +315,19 @@ void *agent(void *args)
 		sched_update = slurm_conf.last_update;
 	}
 
-	rpc_thread_cnt = 2 + MIN(agent_arg_ptr->node_count, AGENT_THREAD_COUNT);
+	/*
+	 * Hold a worker of agent_workq per RPC this may have in flight. The
+	 * agents only hold as many as agent_workq has, so the pool caps the
+	 * RPCs in flight and an agent never waits on the workers of another.
+	 */
+	rpc_cnt = MIN(agent_arg_ptr->node_count, AGENT_THREAD_COUNT);
 	while (1) {
 		if (slurmctld_config.shutdown_time ||
-		    ((agent_thread_cnt+rpc_thread_cnt) <= MAX_SERVER_THREADS)) {
+		    ((agent_rpc_cnt + rpc_cnt) <= AGENT_WORKER_COUNT)) {
 			agent_cnt++;
-			agent_thread_cnt += rpc_thread_cnt;
+			agent_rpc_cnt += rpc_cnt;
+			agent_thread_cnt += 1 + rpc_cnt;
+			workq = agent_workq;
 			break;
 		} else {	/* wait for state change and retry */
 			slurm_cond_wait(&agent_cnt_cond, &agent_cnt_mutex);
@@ -319,10 +350,6 @@ void *agent(void *args)
 
 	/* initialize the agent data structures */
 	agent_info_ptr = _make_agent_info(agent_arg_ptr);
-	thread_ptr = agent_info_ptr->thread_struct;
-
-	/* start the watchdog thread */
-	slurm_thread_create(&thread_wdog, _wdog, agent_info_ptr);
 
 	log_flag(AGENT, "%s: New agent thread_count:%d threads_active:%d retry:%c get_reply:%c r_uid:%u msg_type:%s protocol_version:%hu",
 		 __func__, agent_info_ptr->thread_count,
@@ -333,44 +360,70 @@ void *agent(void *args)
 		 rpc_num2string(agent_arg_ptr->msg_type),
 		 agent_info_ptr->protocol_version);
 
-	/* start all the other threads (up to AGENT_THREAD_COUNT active) */
-	for (i = 0; i < agent_info_ptr->thread_count; i++) {
-		/* wait until "room" for another thread */
-		slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-		while (agent_info_ptr->threads_active >=
-		       AGENT_THREAD_COUNT) {
-			slurm_cond_wait(&agent_info_ptr->thread_cond,
-					&agent_info_ptr->thread_mutex);
+	/*
+	 * Queue all the RPCs (up to AGENT_THREAD_COUNT active) and watch over
+	 * them until all are complete. Sleep between watchdog passes with
+	 * exponential times (from 0.005 to 1.0 second).
+	 */
+	clock_gettime(CLOCK_REALTIME, &wdog_ts);
+	_timespec_add_usec(&wdog_ts, usec);
+	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
+	while (1) {
+		while ((i < agent_info_ptr->thread_count) &&
+		       (agent_info_ptr->threads_active < AGENT_THREAD_COUNT)) {
+			/*
+			 * create thread specific data,
+			 * NOTE: freed from _send_group_rpc()
+			 */
+			task_specific_ptr = _make_task_data(agent_info_ptr, i++);
+			agent_info_ptr->threads_active++;
+			slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+
+			slurm_mutex_lock(&send_stats_mutex);
+			send_queued++;
+			send_queued_max = MAX(send_queued, send_queued_max);
+			slurm_mutex_unlock(&send_stats_mutex);
+
+			/*
+			 * Send it from here if the workers are gone, the RPCs
+			 * in flight stay within AGENT_WORKER_COUNT either way
+			 */
+			if (!workq || workq_add_work(workq, _send_group_rpc,
+						     task_specific_ptr,
+						     "agent"))
+				_send_group_rpc(task_specific_ptr);
+
+			slurm_mutex_lock(&agent_info_ptr->thread_mutex);
 		}
 
-		/*
-		 * create thread specific data,
-		 * NOTE: freed from _thread_per_group_rpc()
-		 */
-		task_specific_ptr = _make_task_data(agent_info_ptr, i);
+		if ((i >= agent_info_ptr->thread_count) &&
+		    !agent_info_ptr->threads_active) {
+			(void) _wdog(agent_info_ptr, &thd_comp);
+			break;
+		}
+
+		clock_gettime(CLOCK_REALTIME, &now_ts);
+		if ((now_ts.tv_sec > wdog_ts.tv_sec) ||
+		    ((now_ts.tv_sec == wdog_ts.tv_sec) &&
+		     (now_ts.tv_nsec >= wdog_ts.tv_nsec))) {
+			(void) _wdog(agent_info_ptr, &thd_comp);
+			usec = MIN((usec * 2), 1000000);
+			wdog_ts = now_ts;
+			_timespec_add_usec(&wdog_ts, usec);
+		}
 
-		slurm_thread_create(&thread_ptr[i].thread,
-				    _thread_per_group_rpc,
-				    task_specific_ptr);
-		agent_info_ptr->threads_active++;
-		slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
+		/* woken up as RPCs complete to queue the next ones */
+		slurm_cond_timedwait(&agent_info_ptr->thread_cond,
+				     &agent_info_ptr->thread_mutex, &wdog_ts);
 	}
+	_wdog_fini(agent_info_ptr, &thd_comp);
+	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
 
-	/* Wait for termination of remaining threads */
-	pthread_join(thread_wdog, NULL);
 	delay = (int) difftime(time(NULL), begin_time);
 	if (delay > (slurm_conf.msg_timeout * 2)) {
 		info("agent msg_type=%s ran for %d seconds",
 		     rpc_num2string(agent_arg_ptr->msg_type),  delay);
 	}
-	slurm_mutex_lock(&agent_info_ptr->thread_mutex);
-	while (agent_info_ptr->threads_active != 0) {
-		slurm_cond_wait(&agent_info_ptr->thread_cond,
-				&agent_info_ptr->thread_mutex);
-	}
-	for (i = 0; i < agent_info_ptr->thread_count; i++)
-		pthread_join(thread_ptr[i].thread, NULL);
-	slurm_mutex_unlock(&agent_info_ptr->thread_mutex);
 
 	log_flag(AGENT, "%s: end agent thread_count:%d threads_active:%d retry:%c get_reply:%c msg_type:%s protocol_version:%hu",
 		 __func__, agent_info_ptr->thread_count,
@@ -395,14 +448,20 @@ cleanup:
 		error("agent_cnt underflow");
 		agent_cnt = 0;
 	}
-	if (agent_thread_cnt >= rpc_thread_cnt) {
-		agent_thread_cnt -= rpc_thread_cnt;
+	if (agent_rpc_cnt >= rpc_cnt) {
+		agent_rpc_cnt -= rpc_cnt;
+	} else {
+		error("agent_rpc_cnt underflow");
+		agent_rpc_cnt = 0;
+	}
+	if (agent_thread_cnt >= (1 + rpc_cnt)) {
+		agent_thread_cnt -= 1 + rpc_cnt;
 	} else {
 		error("agent_thread_cnt underflow");
 		agent_thread_cnt = 0;
 	}
 
-	if ((agent_thread_cnt + AGENT_THREAD_COUNT + 2) < MAX_SERVER_THREADS)
+	if ((agent_rpc_cnt + AGENT_THREAD_COUNT) <= AGENT_WORKER_COUNT)
 		spawn_retry_agent = true;
 
 	slurm_cond_broadcast(&agent_cnt_cond);
@@ -558,6 +617,7 @@ static task_info_t *_make_task_data(agent_info_t *agent_info_ptr, int inx)
 	task_info_ptr->msg_type          = agent_info_ptr->msg_type;
 	task_info_ptr->msg_args_ptr      = *agent_info_ptr->msg_args_pptr;
 	task_info_ptr->protocol_version  = agent_info_ptr->protocol_version;
+	gettimeofday(&task_info_ptr->queued, NULL);
 
 	return task_info_ptr;
 }
@@ -570,7 +630,7 @@ static void _update_wdog_state(thd_t *thread_ptr,
 	case DSH_ACTIVE:
 		thd_comp->work_done = false;
 		if (thread_ptr->end_time <= thd_comp->now) {
-			log_flag(AGENT, "%s: agent thread %lu timed out",
+			log_flag(AGENT, "%s: agent worker %lu timed out",
 				 __func__, (unsigned long) thread_ptr->thread);
 			(void) pthread_kill(thread_ptr->thread, SIGUSR1);
 			thread_ptr->end_time += message_timeout;
@@ -595,22 +655,56 @@ static void _update_wdog_state(thd_t *thread_ptr,
 }
 
 /*
- * _wdog - Watchdog thread. Send SIGUSR1 to threads which have been active
- *	for too long.
- * IN args - pointer to agent_info_t with info on threads to watch
- * Sleep between polls with exponential times (from 0.005 to 1.0 second)
+ * _wdog - Watchdog pass over the RPCs of an agent. Send SIGUSR1 to workers
+ *	which have been active for too long.
+ * IN agent_ptr - agent whose RPCs to watch, thread_mutex locked
+ * IN/OUT thd_comp - state of the RPCs
+ * RET true once all the RPCs are complete
  */
-static void *_wdog(void *args)
+static bool _wdog(agent_info_t *agent_ptr, thd_complete_t *thd_comp)
 {
-	bool srun_agent = false;
 	int i;
-	agent_info_t *agent_ptr = (agent_info_t *) args;
 	thd_t *thread_ptr = agent_ptr->thread_struct;
-	unsigned long usec = 5000;
 	ListIterator itr;
-	thd_complete_t thd_comp;
 	ret_data_info_t *ret_data_info = NULL;
 
+	thd_comp->work_done   = true;/* assume all threads complete */
+	thd_comp->fail_cnt    = 0;   /* assume no threads failures */
+	thd_comp->no_resp_cnt = 0;   /* assume all threads respond */
+	thd_comp->retry_cnt   = 0;   /* assume no required retries */
+	thd_comp->now         = time(NULL);
+
+	for (i = 0; i < agent_ptr->thread_count; i++) {
+		//info("thread name %s",thread_ptr[i].node_name);
+		if (!thread_ptr[i].ret_list) {
+			_update_wdog_state(&thread_ptr[i],
+					   &thread_ptr[i].state,
+					   thd_comp);
+		} else {
+			itr = list_iterator_create(thread_ptr[i].ret_list);
+			while ((ret_data_info = list_next(itr))) {
+				_update_wdog_state(&thread_ptr[i],
+						   &ret_data_info->err,
+						   thd_comp);
+			}
+			list_iterator_destroy(itr);
+		}
+	}
+
+	return thd_comp->work_done;
+}
+
+/*
+ * _wdog_fini - Notify slurmctld of the outcome of the RPCs of an agent once
+ *	all are complete and free their results.
+ * IN agent_ptr - agent whose RPCs completed, thread_mutex locked
+ * IN thd_comp - state of the RPCs from the last _wdog() pass
+ */
+static void _wdog_fini(agent_info_t *agent_ptr, thd_complete_t *thd_comp)
+{
+	int i;
+	thd_t *thread_ptr = agent_ptr->thread_struct;
+
 	if ( (agent_ptr->msg_type == SRUN_JOB_COMPLETE)			||
 	     (agent_ptr->msg_type == SRUN_REQUEST_SUSPEND)		||
 	     (agent_ptr->msg_type == SRUN_STEP_MISSING)			||
@@ -620,51 +714,12 @@ static void *_wdog(void *args)
 	     (agent_ptr->msg_type == SRUN_TIMEOUT)			||
 	     (agent_ptr->msg_type == SRUN_USER_MSG)			||
 	     (agent_ptr->msg_type == RESPONSE_RESOURCE_ALLOCATION)	||
-	     (agent_ptr->msg_type == RESPONSE_HET_JOB_ALLOCATION) )
-		srun_agent = true;
-
-	thd_comp.max_delay = 0;
-
-	while (1) {
-		thd_comp.work_done   = true;/* assume all threads complete */
-		thd_comp.fail_cnt    = 0;   /* assume no threads failures */
-		thd_comp.no_resp_cnt = 0;   /* assume all threads respond */
-		thd_comp.retry_cnt   = 0;   /* assume no required retries */
-		thd_comp.now         = time(NULL);
-
-		usleep(usec);
-		usec = MIN((usec * 2), 1000000);
-
-		slurm_mutex_lock(&agent_ptr->thread_mutex);
-		for (i = 0; i < agent_ptr->thread_count; i++) {
-			//info("thread name %s",thread_ptr[i].node_name);
-			if (!thread_ptr[i].ret_list) {
-				_update_wdog_state(&thread_ptr[i],
-						   &thread_ptr[i].state,
-						   &thd_comp);
-			} else {
-				itr = list_iterator_create(
-					thread_ptr[i].ret_list);
-				while ((ret_data_info = list_next(itr))) {
-					_update_wdog_state(&thread_ptr[i],
-							   &ret_data_info->err,
-							   &thd_comp);
-				}
-				list_iterator_destroy(itr);
-			}
-		}
-		if (thd_comp.work_done)
-			break;
-
-		slurm_mutex_unlock(&agent_ptr->thread_mutex);
-	}
-
-	if (srun_agent) {
+	     (agent_ptr->msg_type == RESPONSE_HET_JOB_ALLOCATION) ) {
 		_notify_slurmctld_jobs(agent_ptr);
 	} else {
 		_notify_slurmctld_nodes(agent_ptr,
-					thd_comp.no_resp_cnt,
-					thd_comp.retry_cnt);
+					thd_comp->no_resp_cnt,
+					thd_comp->retry_cnt);
 	}
 
 	for (i = 0; i < agent_ptr->thread_count; i++) {
@@ -672,12 +727,20 @@ static void *_wdog(void *args)
 		xfree(thread_ptr[i].nodename);
 	}
 
-	if (thd_comp.max_delay)
+	if (thd_comp->max_delay)
 		log_flag(AGENT, "%s: agent maximum delay %d seconds",
-			 __func__, thd_comp.max_delay);
+			 __func__, thd_comp->max_delay);
+}
 
-	slurm_mutex_unlock(&agent_ptr->thread_mutex);
-	return (void *) NULL;
+/* Add usec microseconds to ts */
+static void _timespec_add_usec(struct timespec *ts, unsigned long usec)
+{
+	ts->tv_sec += usec / 1000000;
+	ts->tv_nsec += (usec % 1000000) * 1000;
+	if (ts->tv_nsec >= 1000000000) {
+		ts->tv_sec++;
+		ts->tv_nsec -= 1000000000;
+	}
 }
 
 static void _notify_slurmctld_jobs(agent_info_t *agent_ptr)
@@ -760,6 +823,22 @@ static void _notify_slurmctld_nodes(agent_info_t *agent_ptr,
 			job_complete(job_id, slurm_conf.slurm_user_id,
 				     true, false, 0);
 			unlock_slurmctld(job_write_lock);
+		} else if (agent_ptr->msg_type ==
+			   REQUEST_BATCH_JOB_LAUNCH_MULTI) {
+			/* Requeue all of the batched requests */
+			batch_job_launch_multi_msg_t *multi_msg =
+					*agent_ptr->msg_args_pptr;
+			slurmctld_lock_t job_write_lock =
+				{ .job  = WRITE_LOCK,
+				  .node = WRITE_LOCK,
+				  .fed  = READ_LOCK };
+
+			lock_slurmctld(job_write_lock);
+			for (i = 0; i < multi_msg->job_cnt; i++)
+				job_complete(multi_msg->launch_msgs[i]->job_id,
+					     slurm_conf.slurm_user_id,
+					     true, false, 0);
+			unlock_slurmctld(job_write_lock);
 		}
 	}
 	if (retry_cnt && agent_ptr->retry)
@@ -876,21 +955,100 @@ static int _wif_status(void)
 }
 
 /*
- * _thread_per_group_rpc - thread to issue an RPC for a group of nodes
- *                         sending message out to one and forwarding it to
- *                         others if necessary.
+ * Handle the reply to a REQUEST_BATCH_JOB_LAUNCH_MULTI as a reply to each of
+ * the REQUEST_BATCH_JOB_LAUNCH it carries.
+ * IN rc - return code of the reply, used for every job unless it is a
+ *	   RESPONSE_BATCH_JOB_LAUNCH_MULTI with one return code per job
+ * RET thread state for the node
+ */
+static state_t _batch_launch_multi_reply(batch_job_launch_multi_msg_t *multi_msg,
+					 ret_data_info_t *ret_data_info,
+					 int rc)
+{
+	batch_job_launch_multi_resp_msg_t *resp_msg = NULL;
+	/* Locks: Write job, write node, read federation */
+	slurmctld_lock_t job_write_lock =
+		{ .job = WRITE_LOCK, .node = WRITE_LOCK, .fed = READ_LOCK };
+	state_t state = DSH_DONE;
+
+	if (ret_data_info->type == RESPONSE_BATCH_JOB_LAUNCH_MULTI)
+		resp_msg = ret_data_info->data;
+
+	lock_slurmctld(job_write_lock);
+	for (int i = 0; i < multi_msg->job_cnt; i++) {
+		uint32_t job_id = multi_msg->launch_msgs[i]->job_id;
+		int job_rc = rc;
+
+		if (resp_msg) {
+			job_rc = SLURM_ERROR;	/* missing from the reply */
+			for (int j = 0; j < resp_msg->job_cnt; j++) {
+				if (resp_msg->job_ids[j] == job_id) {
+					job_rc = resp_msg->return_codes[j];
+					break;
+				}
+			}
+		}
+
+		if (job_rc == SLURM_SUCCESS)
+			continue;
+		if (job_rc == ESLURMD_PROLOG_FAILED) {
+			if (state == DSH_DONE)
+				state = DSH_FAILED;
+			continue;
+		}
+		if (job_rc == ESLURM_DUPLICATE_JOB_ID) {
+			if (state == DSH_DONE)
+				state = DSH_DUP_JOBID;
+			continue;
+		}
+		info("Killing non-startable batch JobId=%u: %s",
+		     job_id, slurm_strerror(job_rc));
+		job_complete(job_id, slurm_conf.slurm_user_id,
+			     false, false, _wif_status());
+	}
+	unlock_slurmctld(job_write_lock);
+
+	return state;
+}
+
+/* Account for the time an RPC took from being queued to completion */
+static void _send_stats_add(slurm_msg_type_t msg_type, struct timeval *queued)
+{
+	struct timeval now;
+	uint64_t usec;
+	int i;
+
+	gettimeofday(&now, NULL);
+	usec = ((now.tv_sec - queued->tv_sec) * USEC_IN_SEC) +
+	       (now.tv_usec - queued->tv_usec);
+
+	slurm_mutex_lock(&send_stats_mutex);
+	for (i = 0; i < SEND_STATS_SIZE; i++) {
+		if ((send_stats_type[i] == msg_type) ||
+		    (send_stats_type[i] == 0)) {
+			send_stats_type[i] = msg_type;
+			send_stats_cnt[i]++;
+			send_stats_time[i] += usec;
+			send_stats_max[i] = MAX(send_stats_max[i], usec);
+			break;
+		}
+	}
+	slurm_mutex_unlock(&send_stats_mutex);
+}
+
+/*
+ * _send_group_rpc - issue an RPC for a group of nodes from an agent worker,
+ *                   sending message out to one and forwarding it to
+ *                   others if necessary.
  * IN/OUT args - pointer to task_info_t, xfree'd on completion
  */
-static void *_thread_per_group_rpc(void *args)
+static void _send_group_rpc(void *args)
 {
 	int rc = SLURM_SUCCESS;
 	slurm_msg_t msg;
 	task_info_t *task_ptr = (task_info_t *) args;
 	/* we cache some pointers from task_info_t because we need
-	 * to xfree args before being finished with their use. xfree
-	 * is required for timely termination of this pthread because
-	 * xfree could lock it at the end, preventing a timely
-	 * thread_exit */
+	 * to xfree args before being finished with their use. */
 	pthread_mutex_t *thread_mutex_ptr   = task_ptr->thread_mutex_ptr;
 	pthread_cond_t  *thread_cond_ptr    = task_ptr->thread_cond_ptr;
 	uint32_t        *threads_active_ptr = task_ptr->threads_active_ptr;
@@ -916,6 +1074,10 @@ static void *_thread_per_group_rpc(void *args)
 	xassert(args != NULL);
 	xsignal(SIGUSR1, _sig_handler);
 	xsignal_unblock(sig_array);
+
+	slurm_mutex_lock(&send_stats_mutex);
+	send_queued--;
+	slurm_mutex_unlock(&send_stats_mutex);
 	is_kill_msg = (	(msg_type == REQUEST_KILL_TIMELIMIT)	||
 			(msg_type == REQUEST_KILL_PREEMPTED)	||
 			(msg_type == REQUEST_TERMINATE_JOB) );
@@ -931,6 +1093,7 @@ static void *_thread_per_group_rpc(void *args)
 	thread_ptr->start_time = time(NULL);
 
 	slurm_mutex_lock(thread_mutex_ptr);
+	thread_ptr->thread = pthread_self();
 	thread_ptr->state = DSH_ACTIVE;
 	thread_ptr->end_time = thread_ptr->start_time + message_timeout;
 	slurm_mutex_unlock(thread_mutex_ptr);
@@ -1062,7 +1225,15 @@ static void *_thread_per_group_rpc(void *args)
 
 		/* SPECIAL CASE: Requeue/hold non-startable batch job,
 		 * Requeue job prolog failure or duplicate job ID */
-		if ((msg_type == REQUEST_BATCH_JOB_LAUNCH) &&
+		if ((msg_type == REQUEST_BATCH_JOB_LAUNCH_MULTI) &&
+		    (ret_data_info->type != RESPONSE_FORWARD_FAILED) &&
+		    ((ret_data_info->type == RESPONSE_BATCH_JOB_LAUNCH_MULTI) ||
+		     (rc != SLURM_SUCCESS))) {
+			thread_state = _batch_launch_multi_reply(
+				task_ptr->msg_args_ptr, ret_data_info, rc);
+			ret_data_info->err = thread_state;
+			continue;
+		} else if ((msg_type == REQUEST_BATCH_JOB_LAUNCH) &&
 		    (rc != SLURM_SUCCESS) && (rc != ESLURMD_PROLOG_FAILED) &&
 		    (rc != ESLURM_DUPLICATE_JOB_ID) &&
 		    (ret_data_info->type != RESPONSE_FORWARD_FAILED)) {
@@ -1231,6 +1402,7 @@ cleanup:
 			unlock_slurmctld(job_write_lock);
 		}
 	}
+	_send_stats_add(msg_type, &task_ptr->queued);
 	xfree(args);
 	/* handled at end of thread just in case resend is needed */
 	destroy_forward(&msg.forward);
@@ -1239,11 +1411,10 @@ cleanup:
 	thread_ptr->state = thread_state;
 	thread_ptr->end_time = (time_t) difftime(time(NULL),
 						 thread_ptr->start_time);
-	/* Signal completion so another thread can replace us */
+	/* Signal completion so the agent can queue another RPC */
 	(*threads_active_ptr)--;
 	slurm_cond_signal(thread_cond_ptr);
 	slurm_mutex_unlock(thread_mutex_ptr);
-	return (void *) NULL;
 }
 
 /*
@@ -1454,6 +1625,11 @@ static void *_agent_init(void *arg)
 
 extern void agent_init(void)
 {
+	slurm_mutex_lock(&agent_cnt_mutex);
+	if (!agent_workq)
+		agent_workq = new_workq(AGENT_WORKER_COUNT);
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
 	slurm_mutex_lock(&pending_mutex);
 	if (pending_thread_running) {
 		error("%s: thread already running", __func__);
@@ -1645,6 +1821,7 @@ static void _agent_retry(int min_wait, bool mail_too)
 	agent_arg_t *agent_arg_ptr = NULL;
 	mail_info_t *mi = NULL;
 	int list_size = 0, agent_started = 0;
+	bool busy;
 
 next:
 	slurm_mutex_lock(&retry_mutex);
@@ -1677,8 +1854,10 @@ next:
 		}
 	}
 
-	if (get_agent_thread_count() + AGENT_THREAD_COUNT + 2 >
-	    MAX_SERVER_THREADS) {
+	slurm_mutex_lock(&agent_cnt_mutex);
+	busy = ((agent_rpc_cnt + AGENT_THREAD_COUNT) > AGENT_WORKER_COUNT);
+	slurm_mutex_unlock(&agent_cnt_mutex);
+	if (busy) {
 		/* too much work already */
 		slurm_mutex_unlock(&retry_mutex);
 		return;
@@ -1705,6 +1884,9 @@ next:
 	if (queued_req_ptr) {
 		agent_arg_ptr = queued_req_ptr->agent_arg_ptr;
 		xfree(queued_req_ptr);
+		if (agent_arg_ptr &&
+		    (agent_arg_ptr->msg_type == REQUEST_BATCH_JOB_LAUNCH))
+			agent_arg_ptr = _merge_batch_launch(agent_arg_ptr);
 		if (agent_arg_ptr) {
 			debug2("Spawning RPC agent for msg_type %s",
 			       rpc_num2string(agent_arg_ptr->msg_type));
@@ -1738,6 +1920,69 @@ next:
 	return;
 }
 
+/*
+ * Move the other never tried batch job launch requests for the same node out
+ * of the retry list and into a single REQUEST_BATCH_JOB_LAUNCH_MULTI, so that
+ * many small jobs starting on one node cost one RPC instead of one each.
+ * IN/OUT agent_arg_ptr - REQUEST_BATCH_JOB_LAUNCH already removed from the
+ *	retry list, turned into the batched request if anything was merged
+ * RET agent_arg_ptr
+ */
+static agent_arg_t *_merge_batch_launch(agent_arg_t *agent_arg_ptr)
+{
+	batch_job_launch_multi_msg_t *multi_msg;
+	queued_request_t *queued_req_ptr;
+	agent_arg_t *merge_arg_ptr;
+	list_itr_t *iter;
+	char *node_name;
+
+	if ((agent_arg_ptr->protocol_version == NO_VAL16) ||
+	    (agent_arg_ptr->protocol_version < SLURM_23_11_PROTOCOL_VERSION) ||
+	    agent_arg_ptr->addr || (agent_arg_ptr->node_count != 1))
+		return agent_arg_ptr;
+
+	multi_msg = xmalloc(sizeof(*multi_msg));
+	multi_msg->launch_msgs = xcalloc(BATCH_LAUNCH_MAX_JOBS,
+					 sizeof(batch_job_launch_msg_t *));
+	multi_msg->launch_msgs[multi_msg->job_cnt++] = agent_arg_ptr->msg_args;
+	node_name = hostlist_nth(agent_arg_ptr->hostlist, 0);
+
+	slurm_mutex_lock(&retry_mutex);
+	iter = list_iterator_create(retry_list);
+	while ((multi_msg->job_cnt < BATCH_LAUNCH_MAX_JOBS) &&
+	       (queued_req_ptr = list_next(iter))) {
+		merge_arg_ptr = queued_req_ptr->agent_arg_ptr;
+		if (queued_req_ptr->last_attempt || !merge_arg_ptr ||
+		    (merge_arg_ptr->msg_type != REQUEST_BATCH_JOB_LAUNCH) ||
+		    (merge_arg_ptr->protocol_version !=
+		     agent_arg_ptr->protocol_version) ||
+		    (merge_arg_ptr->r_uid != agent_arg_ptr->r_uid) ||
+		    merge_arg_ptr->addr || (merge_arg_ptr->node_count != 1) ||
+		    (hostlist_find(merge_arg_ptr->hostlist, node_name) < 0))
+			continue;
+		multi_msg->launch_msgs[multi_msg->job_cnt++] =
+			merge_arg_ptr->msg_args;
+		merge_arg_ptr->msg_args = NULL;
+		list_delete_item(iter);
+	}
+	list_iterator_destroy(iter);
+	slurm_mutex_unlock(&retry_mutex);
+
+	if (multi_msg->job_cnt == 1) {
+		/* Nothing to merge with, keep sending it alone */
+		xfree(multi_msg->launch_msgs);
+		xfree(multi_msg);
+	} else {
+		log_flag(AGENT, "%s: launching %u batch jobs on %s with one RPC",
+			 __func__, multi_msg->job_cnt, node_name);
+		agent_arg_ptr->msg_type = REQUEST_BATCH_JOB_LAUNCH_MULTI;
+		agent_arg_ptr->msg_args = multi_msg;
+	}
+	free(node_name);
+
+	return agent_arg_ptr;
+}
+
 /*
  * agent_queue_request - put a new request on the queue for execution or
  * 	execute now if not too busy
@@ -1747,8 +1992,8 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 {
 	queued_request_t *queued_req_ptr = NULL;
 
-	if ((AGENT_THREAD_COUNT + 2) >= MAX_SERVER_THREADS)
-		fatal("AGENT_THREAD_COUNT value is too high relative to MAX_SERVER_THREADS");
+	if (AGENT_THREAD_COUNT > AGENT_WORKER_COUNT)
+		fatal("AGENT_THREAD_COUNT value is too high relative to AGENT_WORKER_COUNT");
 
 	if (message_timeout == NO_VAL16) {
 		message_timeout = MAX(slurm_conf.msg_timeout, 30);
@@ -1791,6 +2036,15 @@ void agent_queue_request(agent_arg_t *agent_arg_ptr)
 extern void agent_purge(void)
 {
 	int i;
+	workq_t *workq = NULL;
+
+	slurm_mutex_lock(&agent_cnt_mutex);
+	if (!agent_cnt) {
+		workq = agent_workq;
+		agent_workq = NULL;
+	}
+	slurm_mutex_unlock(&agent_cnt_mutex);
+	FREE_NULL_WORKQ(workq);
 
 	if (retry_list) {
 		slurm_mutex_lock(&retry_mutex);
@@ -1840,6 +2094,47 @@ extern int get_agent_thread_count(void)
 	return cnt;
 }
 
+extern void agent_get_worker_stats(uint32_t *workers, uint32_t *busy,
+				   uint32_t *queued, uint32_t *queued_max)
+{
+	slurm_mutex_lock(&agent_cnt_mutex);
+	*workers = agent_workq ? AGENT_WORKER_COUNT : 0;
+	*busy = agent_workq ? workq_get_active(agent_workq) : 0;
+	slurm_mutex_unlock(&agent_cnt_mutex);
+
+	slurm_mutex_lock(&send_stats_mutex);
+	*queued = send_queued;
+	*queued_max = send_queued_max;
+	slurm_mutex_unlock(&send_stats_mutex);
+}
+
+extern void agent_pack_send_stats(buf_t *buffer)
+{
+	uint32_t count;
+
+	slurm_mutex_lock(&send_stats_mutex);
+	for (count = 0; count < SEND_STATS_SIZE; count++) {
+		if (!send_stats_type[count])
+			break;
+	}
+	pack16_array(send_stats_type, count, buffer);
+	pack32_array(send_stats_cnt, count, buffer);
+	pack64_array(send_stats_time, count, buffer);
+	pack64_array(send_stats_max, count, buffer);
+	slurm_mutex_unlock(&send_stats_mutex);
+}
+
+extern void agent_reset_send_stats(void)
+{
+	slurm_mutex_lock(&send_stats_mutex);
+	send_queued_max = send_queued;
+	memset(send_stats_type, 0, sizeof(send_stats_type));
+	memset(send_stats_cnt, 0, sizeof(send_stats_cnt));
+	memset(send_stats_time, 0, sizeof(send_stats_time));
+	memset(send_stats_max, 0, sizeof(send_stats_max));
+	slurm_mutex_unlock(&send_stats_mutex);
+}
+
 static void _purge_agent_args(agent_arg_t *agent_arg_ptr)
 {
 	if (agent_arg_ptr == NULL)
@@ -1850,6 +2145,10 @@ static void _purge_agent_args(agent_arg_t *agent_arg_ptr)
 	if (agent_arg_ptr->msg_args) {
 		if (agent_arg_ptr->msg_type == REQUEST_BATCH_JOB_LAUNCH) {
 			slurm_free_job_launch_msg(agent_arg_ptr->msg_args);
+		} else if (agent_arg_ptr->msg_type ==
+			   REQUEST_BATCH_JOB_LAUNCH_MULTI) {
+			slurm_free_job_launch_multi_msg(
+				agent_arg_ptr->msg_args);
 		} else if (agent_arg_ptr->msg_type ==
 				RESPONSE_RESOURCE_ALLOCATION) {
 			resource_allocation_response_msg_t *alloc_msg =
@@ -44,7 +44,9 @@
 
 #include "src/slurmctld/slurmctld.h"
 
-#define AGENT_THREAD_COUNT	10	/* maximum active threads per agent */
+#define AGENT_THREAD_COUNT	10	/* maximum RPCs in flight per agent */
+#define AGENT_WORKER_COUNT	64	/* threads sending RPCs for all agents,
+					 * caps the agent RPCs in flight */
 
 #define LOTS_OF_AGENTS_CNT 50
 #define LOTS_OF_AGENTS ((get_agent_count() <= LOTS_OF_AGENTS_CNT) ? 0 : 1)
@@ -106,6 +108,17 @@ extern int get_agent_thread_count(void);
 /* agent_pack_pending_rpc_stats - pack counts of pending RPCs into a buffer */
 extern void agent_pack_pending_rpc_stats(buf_t *buffer);
 
+/*
+ * Get the number of agent worker threads, how many are sending an RPC, how
+ * many RPCs are waiting for one and the most that waited since the last reset.
+ */
+extern void agent_get_worker_stats(uint32_t *workers, uint32_t *busy,
+				   uint32_t *queued, uint32_t *queued_max);
+
+/* Pack the per message type count, total and max time to send agent RPCs */
+extern void agent_pack_send_stats(buf_t *buffer);
+extern void agent_reset_send_stats(void);
+
 /*
  * mail_job_info - Send e-mail notice of job state change
  * IN job_ptr - job identification
@@ -61,6 +61,7 @@
 #include "src/common/assoc_mgr.h"
 #include "src/common/daemonize.h"
 #include "src/common/fd.h"
+#include "src/common/forward.h"
 #include "src/common/group_cache.h"
 #include "src/common/hostlist.h"
 #include "src/common/log.h"
@@ -977,6 +978,7 @@ int main(int argc, char **argv)
 	hash_g_fini();
 	switch_fini();
 	route_fini();
+	forward_tree_stats_fini();
 	site_factor_g_fini();
 
 	/* purge remaining data structures */
@@ -66,8 +66,10 @@
 #include "src/common/fd.h"
 #include "src/common/forward.h"
 #include "src/common/hostlist.h"
+#include "src/common/id_hash.h"
 #include "src/common/parse_time.h"
 #include "src/common/slurm_protocol_pack.h"
+#include "src/common/str_intern.h"
 #include "src/common/timers.h"
 #include "src/common/track_script.h"
 #include "src/common/tres_bind.h"
@@ -120,9 +122,10 @@
 #define TOP_PRIORITY 0xffff0000	/* large, but leave headroom for higher */
 #define PURGE_OLD_JOB_IN_SEC 2592000 /* 30 days in seconds */
 
-#define JOB_HASH_INX(_job_id)	(_job_id % hash_table_size)
-#define JOB_ARRAY_HASH_INX(_job_id, _task_id)		\
-	((_job_id + _task_id) % hash_table_size)
+#define JOB_ARRAY_TASK_KEY(_job_id, _task_id)		\
+	((((uint64_t) (_job_id)) << 32) | (_task_id))
+#define HET_JOB_KEY(_het_job_id, _offset)		\
+	((((uint64_t) (_het_job_id)) << 32) | (_offset))
 
 /* No need to change we always pack SLURM_PROTOCOL_VERSION */
 #define JOB_STATE_VERSION     "PROTOCOL_VERSION"
@@ -131,8 +134,16 @@ typedef enum {
 	JOB_HASH_JOB,
 	JOB_HASH_ARRAY_JOB,
 	JOB_HASH_ARRAY_TASK,
+	JOB_HASH_HET_JOB,
 } job_hash_type_t;
 
+/* Job records of the split out tasks of one job array */
+typedef struct {
+	uint32_t cnt;			/* entries used in job_ptrs */
+	uint32_t size;			/* entries allocated in job_ptrs */
+	job_record_t **job_ptrs;
+} job_array_tasks_t;
+
 typedef struct {
 	int resp_array_cnt;
 	int resp_array_size;
@@ -171,12 +182,14 @@ static int      bf_min_age_reserve = 0;
 static uint32_t delay_boot = 0;
 static uint32_t highest_prio = 0;
 static uint32_t lowest_prio  = TOP_PRIORITY;
-static int      hash_table_size = 0;
 static int      job_count = 0;		/* job's in the system */
 static uint32_t job_id_sequence = 0;	/* first job_id to assign new job */
-static struct   job_record **job_hash = NULL;
-static struct   job_record **job_array_hash_j = NULL;
-static struct   job_record **job_array_hash_t = NULL;
+static id_hash_t *job_hash = NULL;	/* job_id -> job_record_t */
+static id_hash_t *job_array_hash_j = NULL; /* array_job_id ->
+					    * job_array_tasks_t */
+static id_hash_t *job_array_hash_t = NULL; /* JOB_ARRAY_TASK_KEY ->
+					    * job_record_t */
+static id_hash_t *het_job_hash = NULL;	/* HET_JOB_KEY -> job_record_t */
 static bool     kill_invalid_dep;
 static time_t   last_file_write_time = (time_t) 0;
 static uint32_t max_array_size = NO_VAL;
@@ -701,7 +714,7 @@ static void _delete_job_details(job_record_t *job_entry)
 	FREE_NULL_BITMAP(job_entry->details->exc_node_bitmap);
 	xfree(job_entry->details->exc_nodes);
 	FREE_NULL_LIST(job_entry->details->feature_list);
-	xfree(job_entry->details->features);
+	xfree_intern(job_entry->details->features);
 	xfree(job_entry->details->cluster_features);
 	FREE_NULL_BITMAP(job_entry->details->job_size_bitmap);
 	xfree(job_entry->details->std_in);
@@ -716,7 +729,7 @@ static void _delete_job_details(job_record_t *job_entry)
 	xfree(job_entry->details->req_nodes);
 	xfree(job_entry->details->script);
 	xfree(job_entry->details->script_hash);
-	xfree(job_entry->details->work_dir);
+	xfree_intern(job_entry->details->work_dir);
 	xfree(job_entry->details->x11_magic_cookie);
 	xfree(job_entry->details->x11_target);
 	xfree(job_entry->details);	/* Must be last */
@@ -1643,6 +1656,8 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 	double billable_tres = (double)NO_VAL;
 	char *tres_alloc_str = NULL, *tres_fmt_alloc_str = NULL,
 		*tres_req_str = NULL, *tres_fmt_req_str = NULL;
+	char *tres_per_job = NULL, *tres_per_node = NULL;
+	char *tres_per_socket = NULL, *tres_per_task = NULL;
 	uint32_t pelog_env_size = 0;
 	char **pelog_env = (char **) NULL;
 	job_fed_details_t *job_fed_details = NULL;
@@ -1879,13 +1894,13 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 				       buffer);
 		safe_unpackstr_xmalloc(&job_ptr->tres_freq, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_job, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_job, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_node, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_node, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_socket, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_socket, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_task, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_task, &name_len,
 				       buffer);
 
 		safe_unpackstr_xmalloc(&job_ptr->selinux_context, &name_len,
@@ -2109,13 +2124,13 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 				       buffer);
 		safe_unpackstr_xmalloc(&job_ptr->tres_freq, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_job, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_job, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_node, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_node, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_socket, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_socket, &name_len,
 				       buffer);
-		safe_unpackstr_xmalloc(&job_ptr->tres_per_task, &name_len,
+		safe_unpackstr_xmalloc(&tres_per_task, &name_len,
 				       buffer);
 
 		safe_unpackstr_xmalloc(&job_ptr->selinux_context, &name_len,
@@ -2181,10 +2196,23 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 	job_ptr->tres_fmt_req_str = tres_fmt_req_str;
 	tres_fmt_req_str = NULL;
 
-	xfree(job_ptr->account);
-	job_ptr->account = account;
-	xstrtolower(job_ptr->account);
-	account          = NULL;  /* reused, nothing left to free */
+	xfree_intern(job_ptr->tres_per_job);
+	job_ptr->tres_per_job = str_intern(tres_per_job);
+	xfree(tres_per_job);
+	xfree_intern(job_ptr->tres_per_node);
+	job_ptr->tres_per_node = str_intern(tres_per_node);
+	xfree(tres_per_node);
+	xfree_intern(job_ptr->tres_per_socket);
+	job_ptr->tres_per_socket = str_intern(tres_per_socket);
+	xfree(tres_per_socket);
+	xfree_intern(job_ptr->tres_per_task);
+	job_ptr->tres_per_task = str_intern(tres_per_task);
+	xfree(tres_per_task);
+
+	xfree_intern(job_ptr->account);
+	xstrtolower(account);
+	job_ptr->account = str_intern(account);
+	xfree(account);
 	xfree(job_ptr->alloc_node);
 	job_ptr->alloc_node   = alloc_node;
 	alloc_node             = NULL;	/* reused, nothing left to free */
@@ -2251,13 +2279,13 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 	xfree(job_ptr->name);		/* in case duplicate record */
 	job_ptr->name         = name;
 	name                  = NULL;	/* reused, nothing left to free */
-	xfree(job_ptr->user_name);
-	job_ptr->user_name    = user_name;
-	user_name             = NULL;   /* reused, nothing left to free */
-	xfree(job_ptr->wckey);		/* in case duplicate record */
-	job_ptr->wckey        = wckey;
-	xstrtolower(job_ptr->wckey);
-	wckey                 = NULL;	/* reused, nothing left to free */
+	xfree_intern(job_ptr->user_name);
+	job_ptr->user_name    = str_intern(user_name);
+	xfree(user_name);
+	xfree_intern(job_ptr->wckey);	/* in case duplicate record */
+	xstrtolower(wckey);
+	job_ptr->wckey        = str_intern(wckey);
+	xfree(wckey);
 	xfree(job_ptr->network);
 	job_ptr->network      = network;
 	network               = NULL;  /* reused, nothing left to free */
@@ -2282,9 +2310,9 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 	job_ptr->het_job_id_set = het_job_id_set;
 	het_job_id_set       = NULL;	/* reused, nothing left to free */
 	job_ptr->het_job_offset = het_job_offset;
-	xfree(job_ptr->partition);
-	job_ptr->partition    = partition;
-	partition             = NULL;	/* reused, nothing left to free */
+	xfree_intern(job_ptr->partition);
+	job_ptr->partition    = str_intern(partition);
+	xfree(partition);
 	job_ptr->part_ptr = part_ptr;
 	job_ptr->part_ptr_list = part_ptr_list;
 	job_ptr->pre_sus_time = pre_sus_time;
@@ -2380,6 +2408,7 @@ static int _load_job_state(buf_t *buffer, uint16_t protocol_version)
 
 	_add_job_hash(job_ptr);
 	_add_job_array_hash(job_ptr);
+	add_het_job_hash(job_ptr);
 
 	memset(&assoc_rec, 0, sizeof(assoc_rec));
 
@@ -2518,6 +2547,10 @@ free_it:
 	xfree(tres_alloc_str);
 	xfree(tres_fmt_alloc_str);
 	xfree(tres_fmt_req_str);
+	xfree(tres_per_job);
+	xfree(tres_per_node);
+	xfree(tres_per_socket);
+	xfree(tres_per_task);
 	xfree(tres_req_str);
 	xfree(user_name);
 	xfree(wckey);
@@ -2831,7 +2864,7 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 		xfree(job_ptr->details->env_sup[i]);
 	xfree(job_ptr->details->env_sup);
 	xfree(job_ptr->details->exc_nodes);
-	xfree(job_ptr->details->features);
+	xfree_intern(job_ptr->details->features);
 	xfree(job_ptr->details->cluster_features);
 	xfree(job_ptr->details->prefer);
 	xfree(job_ptr->details->std_in);
@@ -2840,7 +2873,7 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	xfree(job_ptr->details->std_out);
 	xfree(job_ptr->details->submit_line);
 	xfree(job_ptr->details->req_nodes);
-	xfree(job_ptr->details->work_dir);
+	xfree_intern(job_ptr->details->work_dir);
 
 	/* now put the details into the job record */
 	job_ptr->details->acctg_freq = acctg_freq;
@@ -2868,7 +2901,8 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	job_ptr->details->env_sup = env_sup;
 	job_ptr->details->std_err = err;
 	job_ptr->details->exc_nodes = exc_nodes;
-	job_ptr->details->features = features;
+	job_ptr->details->features = str_intern(features);
+	xfree(features);
 	job_ptr->details->cluster_features = cluster_features;
 	job_ptr->details->prefer = prefer;
 	job_ptr->details->env_hash = env_hash;
@@ -2920,7 +2954,8 @@ static int _load_job_details(job_record_t *job_ptr, buf_t *buffer,
 	job_ptr->details->submit_time = submit_time;
 	job_ptr->details->task_dist = task_dist;
 	job_ptr->details->whole_node = whole_node;
-	job_ptr->details->work_dir = work_dir;
+	job_ptr->details->work_dir = str_intern(work_dir);
+	xfree(work_dir);
 
 	return SLURM_SUCCESS;
 
@@ -2960,11 +2995,12 @@ unpack_error:
  */
 static void _add_job_hash(job_record_t *job_ptr)
 {
-	int inx;
+	job_record_t *old_job_ptr;
 
-	inx = JOB_HASH_INX(job_ptr->job_id);
-	job_ptr->job_next = job_hash[inx];
-	job_hash[inx] = job_ptr;
+	if ((old_job_ptr = id_hash_add(job_hash, job_ptr->job_id, job_ptr)) &&
+	    (old_job_ptr != job_ptr))
+		error("%s: duplicate hash entry for JobId=%u",
+		      __func__, job_ptr->job_id);
 }
 
 /* _remove_job_hash - remove a job hash entry for given job record, job_id must
@@ -2975,80 +3011,62 @@ static void _add_job_hash(job_record_t *job_ptr)
  */
 static void _remove_job_hash(job_record_t *job_entry, job_hash_type_t type)
 {
-	job_record_t *job_ptr, **job_pptr;
+	job_array_tasks_t *array_tasks;
+	int i;
 
 	xassert(job_entry);
 
 	switch (type) {
 	case JOB_HASH_JOB:
-		job_pptr = &job_hash[JOB_HASH_INX(job_entry->job_id)];
+		if (!id_hash_remove(job_hash, job_entry->job_id, job_entry) &&
+		    (job_entry->job_id != NO_VAL))
+			error("%s: Could not find hash entry for JobId=%u",
+			      __func__, job_entry->job_id);
 		break;
 	case JOB_HASH_ARRAY_JOB:
-		job_pptr = &job_array_hash_j[
-			JOB_HASH_INX(job_entry->array_job_id)];
-		break;
-	case JOB_HASH_ARRAY_TASK:
-		job_pptr = &job_array_hash_t[
-			JOB_ARRAY_HASH_INX(job_entry->array_job_id,
-					   job_entry->array_task_id)];
-		break;
-	default:
-		fatal("%s: unknown job_hash_type_t %d", __func__, type);
-		return;
-	}
-
-	while ((job_pptr != NULL) && (*job_pptr != NULL) &&
-	       ((job_ptr = *job_pptr) != job_entry)) {
-		xassert(job_ptr->magic == JOB_MAGIC);
-		switch (type) {
-		case JOB_HASH_JOB:
-			job_pptr = &job_ptr->job_next;
-			break;
-		case JOB_HASH_ARRAY_JOB:
-			job_pptr = &job_ptr->job_array_next_j;
-			break;
-		case JOB_HASH_ARRAY_TASK:
-			job_pptr = &job_ptr->job_array_next_t;
-			break;
+		array_tasks = id_hash_find(job_array_hash_j,
+					   job_entry->array_job_id);
+		for (i = 0; array_tasks && (i < array_tasks->cnt); i++) {
+			if (array_tasks->job_ptrs[i] == job_entry)
+				break;
 		}
-	}
-
-	if (job_pptr == NULL || *job_pptr == NULL) {
-		if (job_entry->job_id == NO_VAL)
-			return;
-
-		switch (type) {
-		case JOB_HASH_JOB:
-			error("%s: Could not find hash entry for JobId=%u",
-			      __func__, job_entry->job_id);
-			break;
-		case JOB_HASH_ARRAY_JOB:
-			error("%s: job array hash error %u", __func__,
-			      job_entry->array_job_id);
-			break;
-		case JOB_HASH_ARRAY_TASK:
-			error("%s: job array, task ID hash error %u_%u",
-			      __func__,
-			      job_entry->array_job_id,
-			      job_entry->array_task_id);
+		if (!array_tasks || (i >= array_tasks->cnt)) {
+			if (job_entry->job_id != NO_VAL)
+				error("%s: job array hash error %u", __func__,
+				      job_entry->array_job_id);
 			break;
 		}
-		return;
-	}
-
-	switch (type) {
-	case JOB_HASH_JOB:
-		*job_pptr = job_entry->job_next;
-		job_entry->job_next = NULL;
-		break;
-	case JOB_HASH_ARRAY_JOB:
-		*job_pptr = job_entry->job_array_next_j;
-		job_entry->job_array_next_j = NULL;
+		array_tasks->job_ptrs[i] =
+			array_tasks->job_ptrs[--array_tasks->cnt];
+		if (!array_tasks->cnt) {
+			id_hash_remove(job_array_hash_j,
+				       job_entry->array_job_id, array_tasks);
+			xfree(array_tasks->job_ptrs);
+			xfree(array_tasks);
+		}
 		break;
 	case JOB_HASH_ARRAY_TASK:
-		*job_pptr = job_entry->job_array_next_t;
-		job_entry->job_array_next_t = NULL;
+		if (!id_hash_remove(job_array_hash_t,
+				    JOB_ARRAY_TASK_KEY(job_entry->array_job_id,
+						       job_entry->array_task_id),
+				    job_entry) &&
+		    (job_entry->job_id != NO_VAL))
+			error("%s: job array, task ID hash error %u_%u",
+			      __func__, job_entry->array_job_id,
+			      job_entry->array_task_id);
+		break;
+	case JOB_HASH_HET_JOB:
+		if (!id_hash_remove(het_job_hash,
+				    HET_JOB_KEY(job_entry->het_job_id,
+						job_entry->het_job_offset),
+				    job_entry) &&
+		    (job_entry->job_id != NO_VAL))
+			error("%s: hetjob hash error %u+%u", __func__,
+			      job_entry->het_job_id,
+			      job_entry->het_job_offset);
 		break;
+	default:
+		fatal("%s: unknown job_hash_type_t %d", __func__, type);
 	}
 }
 
@@ -3059,18 +3077,51 @@ static void _remove_job_hash(job_record_t *job_entry, job_hash_type_t type)
  */
 void _add_job_array_hash(job_record_t *job_ptr)
 {
-	int inx;
+	job_array_tasks_t *array_tasks;
 
 	if (job_ptr->array_task_id == NO_VAL)
 		return;	/* Not a job array */
 
-	inx = JOB_HASH_INX(job_ptr->array_job_id);
-	job_ptr->job_array_next_j = job_array_hash_j[inx];
-	job_array_hash_j[inx] = job_ptr;
+	if (!(array_tasks = id_hash_find(job_array_hash_j,
+					 job_ptr->array_job_id))) {
+		array_tasks = xmalloc(sizeof(*array_tasks));
+		id_hash_add(job_array_hash_j, job_ptr->array_job_id,
+			    array_tasks);
+	}
+	if (array_tasks->cnt >= array_tasks->size) {
+		array_tasks->size = MAX(array_tasks->size * 2, 8);
+		xrecalloc(array_tasks->job_ptrs, array_tasks->size,
+			  sizeof(job_record_t *));
+	}
+	array_tasks->job_ptrs[array_tasks->cnt++] = job_ptr;
+
+	id_hash_add(job_array_hash_t,
+		    JOB_ARRAY_TASK_KEY(job_ptr->array_job_id,
+				       job_ptr->array_task_id),
+		    job_ptr);
+}
+
+/*
+ * Return the job records of the tasks of a job array which have been split
+ * out of the META job record, NULL if none.
+ */
+static job_array_tasks_t *_find_array_tasks(uint32_t array_job_id)
+{
+	return id_hash_find(job_array_hash_j, array_job_id);
+}
+
+/*
+ * add_het_job_hash - add a hetjob hash entry for given job record,
+ *	het_job_id and het_job_offset must already be set
+ */
+extern void add_het_job_hash(job_record_t *job_ptr)
+{
+	if (!job_ptr->het_job_id)
+		return;	/* Not a hetjob */
 
-	inx = JOB_ARRAY_HASH_INX(job_ptr->array_job_id,job_ptr->array_task_id);
-	job_ptr->job_array_next_t = job_array_hash_t[inx];
-	job_array_hash_t[inx] = job_ptr;
+	id_hash_add(het_job_hash,
+		    HET_JOB_KEY(job_ptr->het_job_id, job_ptr->het_job_offset),
+		    job_ptr);
 }
 
 /* For the job array data structure, build the string representation of the
@@ -3114,7 +3165,7 @@ extern void build_array_str(job_record_t *job_ptr)
 extern bool test_job_array_complete(uint32_t array_job_id)
 {
 	job_record_t *job_ptr;
-	int inx;
+	job_array_tasks_t *array_tasks;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -3125,14 +3176,11 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
-	while (job_ptr) {
-		if (job_ptr->array_job_id == array_job_id) {
-			if (!IS_JOB_COMPLETE(job_ptr))
-				return false;
-		}
-		job_ptr = job_ptr->job_array_next_j;
+	if (!(array_tasks = _find_array_tasks(array_job_id)))
+		return true;
+	for (int i = 0; i < array_tasks->cnt; i++) {
+		if (!IS_JOB_COMPLETE(array_tasks->job_ptrs[i]))
+			return false;
 	}
 	return true;
 }
@@ -3141,7 +3189,7 @@ extern bool test_job_array_complete(uint32_t array_job_id)
 extern bool test_job_array_completed(uint32_t array_job_id)
 {
 	job_record_t *job_ptr;
-	int inx;
+	job_array_tasks_t *array_tasks;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -3150,14 +3198,11 @@ extern bool test_job_array_completed(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
-	while (job_ptr) {
-		if (job_ptr->array_job_id == array_job_id) {
-			if (!IS_JOB_COMPLETED(job_ptr))
-				return false;
-		}
-		job_ptr = job_ptr->job_array_next_j;
+	if (!(array_tasks = _find_array_tasks(array_job_id)))
+		return true;
+	for (int i = 0; i < array_tasks->cnt; i++) {
+		if (!IS_JOB_COMPLETED(array_tasks->job_ptrs[i]))
+			return false;
 	}
 	return true;
 }
@@ -3168,8 +3213,8 @@ extern bool test_job_array_completed(uint32_t array_job_id)
  */
 static bool _test_job_array_purged(uint32_t array_job_id)
 {
-	job_record_t *job_ptr, *head_job_ptr;
-	int inx;
+	job_record_t *head_job_ptr;
+	job_array_tasks_t *array_tasks;
 
 	head_job_ptr = find_job_record(array_job_id);
 	if (head_job_ptr) {
@@ -3178,14 +3223,11 @@ static bool _test_job_array_purged(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
-	while (job_ptr) {
-		if ((job_ptr->array_job_id == array_job_id) &&
-		    (job_ptr != head_job_ptr)) {
+	if (!(array_tasks = _find_array_tasks(array_job_id)))
+		return true;
+	for (int i = 0; i < array_tasks->cnt; i++) {
+		if (array_tasks->job_ptrs[i] != head_job_ptr)
 			return false;
-		}
-		job_ptr = job_ptr->job_array_next_j;
 	}
 	return true;
 }
@@ -3194,7 +3236,7 @@ static bool _test_job_array_purged(uint32_t array_job_id)
 extern bool test_job_array_finished(uint32_t array_job_id)
 {
 	job_record_t *job_ptr;
-	int inx;
+	job_array_tasks_t *array_tasks;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -3203,14 +3245,11 @@ extern bool test_job_array_finished(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
-	while (job_ptr) {
-		if (job_ptr->array_job_id == array_job_id) {
-			if (!IS_JOB_FINISHED(job_ptr))
-				return false;
-		}
-		job_ptr = job_ptr->job_array_next_j;
+	if (!(array_tasks = _find_array_tasks(array_job_id)))
+		return true;
+	for (int i = 0; i < array_tasks->cnt; i++) {
+		if (!IS_JOB_FINISHED(array_tasks->job_ptrs[i]))
+			return false;
 	}
 
 	return true;
@@ -3220,7 +3259,7 @@ extern bool test_job_array_finished(uint32_t array_job_id)
 extern bool test_job_array_pending(uint32_t array_job_id)
 {
 	job_record_t *job_ptr;
-	int inx;
+	job_array_tasks_t *array_tasks;
 
 	job_ptr = find_job_record(array_job_id);
 	if (job_ptr) {
@@ -3231,14 +3270,11 @@ extern bool test_job_array_pending(uint32_t array_job_id)
 	}
 
 	/* Need to test individual job array records */
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
-	while (job_ptr) {
-		if (job_ptr->array_job_id == array_job_id) {
-			if (IS_JOB_PENDING(job_ptr))
-				return true;
-		}
-		job_ptr = job_ptr->job_array_next_j;
+	if (!(array_tasks = _find_array_tasks(array_job_id)))
+		return false;
+	for (int i = 0; i < array_tasks->cnt; i++) {
+		if (IS_JOB_PENDING(array_tasks->job_ptrs[i]))
+			return true;
 	}
 	return false;
 }
@@ -3247,16 +3283,14 @@ extern bool test_job_array_pending(uint32_t array_job_id)
  * own separate job_record (do not count tasks in pending META job record) */
 extern int num_pending_job_array_tasks(uint32_t array_job_id)
 {
-	job_record_t *job_ptr;
-	int count = 0, inx;
+	job_array_tasks_t *array_tasks;
+	int count = 0;
 
-	inx = JOB_HASH_INX(array_job_id);
-	job_ptr = job_array_hash_j[inx];
-	while (job_ptr) {
-		if ((job_ptr->array_job_id == array_job_id) &&
-		    IS_JOB_PENDING(job_ptr))
+	if (!(array_tasks = _find_array_tasks(array_job_id)))
+		return 0;
+	for (int i = 0; i < array_tasks->cnt; i++) {
+		if (IS_JOB_PENDING(array_tasks->job_ptrs[i]))
 			count++;
-		job_ptr = job_ptr->job_array_next_j;
 	}
 
 	return count;
@@ -3281,34 +3315,28 @@ extern job_record_t *find_job_array_rec(uint32_t array_job_id,
 		return find_job_record(array_job_id);
 
 	if (array_task_id == INFINITE) {	/* find by job ID */
+		job_array_tasks_t *array_tasks;
+
 		/* Look for job record with all of the pending tasks */
 		job_ptr = find_job_record(array_job_id);
 		if (job_ptr && job_ptr->array_recs &&
 		    (job_ptr->array_job_id == array_job_id))
 			return job_ptr;
 
-		inx = JOB_HASH_INX(array_job_id);
-		job_ptr = job_array_hash_j[inx];
-		while (job_ptr) {
-			if (job_ptr->array_job_id == array_job_id) {
-				match_job_ptr = job_ptr;
-				if (!IS_JOB_FINISHED(job_ptr)) {
-					return job_ptr;
-				}
-			}
-			job_ptr = job_ptr->job_array_next_j;
+		if (!(array_tasks = _find_array_tasks(array_job_id)))
+			return NULL;
+		for (int i = 0; i < array_tasks->cnt; i++) {
+			job_ptr = array_tasks->job_ptrs[i];
+			match_job_ptr = job_ptr;
+			if (!IS_JOB_FINISHED(job_ptr))
+				return job_ptr;
 		}
 		return match_job_ptr;
 	} else {		/* Find specific task ID */
-		inx = JOB_ARRAY_HASH_INX(array_job_id, array_task_id);
-		job_ptr = job_array_hash_t[inx];
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == array_job_id) &&
-			    (job_ptr->array_task_id == array_task_id)) {
-				return job_ptr;
-			}
-			job_ptr = job_ptr->job_array_next_t;
-		}
+		if ((job_ptr = id_hash_find(job_array_hash_t,
+					    JOB_ARRAY_TASK_KEY(array_job_id,
+							       array_task_id))))
+			return job_ptr;
 		/* Look for job record with all of the pending tasks */
 		job_ptr = find_job_record(array_job_id);
 		if (job_ptr && job_ptr->array_recs &&
@@ -3333,35 +3361,19 @@ extern job_record_t *find_job_array_rec(uint32_t array_job_id,
 extern job_record_t *find_het_job_record(uint32_t job_id,
 					 uint32_t het_job_offset)
 {
-	job_record_t *het_job_leader, *het_job;
-	ListIterator iter;
+	job_record_t *het_job_leader;
 
-	het_job_leader = job_hash[JOB_HASH_INX(job_id)];
-	while (het_job_leader) {
-		if (het_job_leader->job_id == job_id)
-			break;
-		het_job_leader = het_job_leader->job_next;
-	}
-	if (!het_job_leader)
+	if (!(het_job_leader = find_job_record(job_id)))
 		return NULL;
 	if (het_job_leader->het_job_offset == het_job_offset)
 		return het_job_leader;
 
 	if (!het_job_leader->het_job_list)
 		return NULL;
-	iter = list_iterator_create(het_job_leader->het_job_list);
-	while ((het_job = list_next(iter))) {
-		if (het_job_leader->het_job_id != het_job->het_job_id) {
-			error("%s: Bad het_job_list for %pJ",
-			      __func__, het_job_leader);
-			continue;
-		}
-		if (het_job->het_job_offset == het_job_offset)
-			break;
-	}
-	list_iterator_destroy(iter);
 
-	return het_job;
+	return id_hash_find(het_job_hash,
+			    HET_JOB_KEY(het_job_leader->het_job_id,
+					het_job_offset));
 }
 
 /*
@@ -3371,16 +3383,7 @@ extern job_record_t *find_het_job_record(uint32_t job_id,
  */
 extern job_record_t *find_job_record(uint32_t job_id)
 {
-	job_record_t *job_ptr;
-
-	job_ptr = job_hash[JOB_HASH_INX(job_id)];
-	while (job_ptr) {
-		if (job_ptr->job_id == job_id)
-			return job_ptr;
-		job_ptr = job_ptr->job_next;
-	}
-
-	return NULL;
+	return id_hash_find(job_hash, job_id);
 }
 
 /* rebuild a job's partition name list based upon the contents of its
@@ -3390,18 +3393,19 @@ static void _rebuild_part_name_list(job_record_t *job_ptr)
 	bool job_active = false, job_pending = false;
 	part_record_t *part_ptr;
 	ListIterator part_iterator;
+	char *partition = NULL;
 
-	xfree(job_ptr->partition);
+	xfree_intern(job_ptr->partition);
 
 	if (!job_ptr->part_ptr_list) {
-		job_ptr->partition = xstrdup(job_ptr->part_ptr->name);
+		job_ptr->partition = str_intern(job_ptr->part_ptr->name);
 		last_job_update = time(NULL);
 		return;
 	}
 
 	if (IS_JOB_RUNNING(job_ptr) || IS_JOB_SUSPENDED(job_ptr)) {
 		job_active = true;
-		job_ptr->partition = xstrdup(job_ptr->part_ptr->name);
+		partition = xstrdup(job_ptr->part_ptr->name);
 	} else if (IS_JOB_PENDING(job_ptr))
 		job_pending = true;
 
@@ -3414,11 +3418,13 @@ static void _rebuild_part_name_list(job_record_t *job_ptr)
 		}
 		if (job_active && (part_ptr == job_ptr->part_ptr))
 			continue;	/* already added */
-		if (job_ptr->partition)
-			xstrcat(job_ptr->partition, ",");
-		xstrcat(job_ptr->partition, part_ptr->name);
+		if (partition)
+			xstrcat(partition, ",");
+		xstrcat(partition, part_ptr->name);
 	}
 	list_iterator_destroy(part_iterator);
+	job_ptr->partition = str_intern(partition);
+	xfree(partition);
 	last_job_update = time(NULL);
 }
 
@@ -4363,20 +4369,15 @@ extern void rehash_jobs(void)
 	xassert(verify_lock(CONF_LOCK, READ_LOCK));
 	xassert(verify_lock(JOB_LOCK, WRITE_LOCK));
 
+	/*
+	 * The tables grow as needed, so MaxJobCount only sets their initial
+	 * size and may be changed without restarting.
+	 */
 	if (job_hash == NULL) {
-		hash_table_size = slurm_conf.max_job_cnt;
-		job_hash = xcalloc(hash_table_size, sizeof(job_record_t *));
-		job_array_hash_j = xcalloc(hash_table_size,
-					   sizeof(job_record_t *));
-		job_array_hash_t = xcalloc(hash_table_size,
-					   sizeof(job_record_t *));
-	} else if (hash_table_size < (slurm_conf.max_job_cnt / 2)) {
-		/* If the MaxJobCount grows by too much, the hash table will
-		 * be ineffective without rebuilding. We don't presently bother
-		 * to rebuild the hash table, but cut MaxJobCount back as
-		 * needed. */
-		error ("MaxJobCount reset too high, restart slurmctld");
-		slurm_conf.max_job_cnt = hash_table_size;
+		job_hash = id_hash_create(slurm_conf.max_job_cnt);
+		job_array_hash_j = id_hash_create(slurm_conf.max_job_cnt);
+		job_array_hash_t = id_hash_create(slurm_conf.max_job_cnt);
+		het_job_hash = id_hash_create(0);
 	}
 }
 
@@ -4425,8 +4426,9 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	job_ptr_pend->prio_factors = save_prio_factors;
 	slurm_copy_priority_factors(job_ptr_pend->prio_factors,
 				    job_ptr->prio_factors);
+	job_ptr_pend->prio_cache = NULL;
 
-	job_ptr_pend->account = xstrdup(job_ptr->account);
+	job_ptr_pend->account = str_intern_ref(job_ptr->account);
 	job_ptr_pend->admin_comment = xstrdup(job_ptr->admin_comment);
 	job_ptr_pend->alias_list = xstrdup(job_ptr->alias_list);
 	job_ptr_pend->alloc_node = xstrdup(job_ptr->alloc_node);
@@ -4490,8 +4492,8 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	memcpy(job_ptr_pend->limit_set.tres, job_ptr->limit_set.tres,
 	       sizeof(uint16_t) * slurmctld_tres_cnt);
 
-	_add_job_hash(job_ptr);		/* Sets job_next */
-	_add_job_hash(job_ptr_pend);	/* Sets job_next */
+	_add_job_hash(job_ptr);
+	_add_job_hash(job_ptr_pend);
 	_add_job_array_hash(job_ptr);
 	job_ptr_pend->job_resrcs = NULL;
 
@@ -4509,7 +4511,7 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	job_ptr_pend->nodes_completing = NULL;
 	job_ptr_pend->nodes_pr = NULL;
 	job_ptr_pend->origin_cluster = xstrdup(job_ptr->origin_cluster);
-	job_ptr_pend->partition = xstrdup(job_ptr->partition);
+	job_ptr_pend->partition = str_intern_ref(job_ptr->partition);
 	job_ptr_pend->part_ptr_list = part_list_copy(job_ptr->part_ptr_list);
 	/* On jobs that are held the priority_array isn't set up yet,
 	 * so check to see if it exists before copying. */
@@ -4555,13 +4557,14 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	job_ptr_pend->mem_per_tres = xstrdup(job_ptr->mem_per_tres);
 	job_ptr_pend->tres_bind = xstrdup(job_ptr->tres_bind);
 	job_ptr_pend->tres_freq = xstrdup(job_ptr->tres_freq);
-	job_ptr_pend->tres_per_job = xstrdup(job_ptr->tres_per_job);
-	job_ptr_pend->tres_per_node = xstrdup(job_ptr->tres_per_node);
-	job_ptr_pend->tres_per_socket = xstrdup(job_ptr->tres_per_socket);
-	job_ptr_pend->tres_per_task = xstrdup(job_ptr->tres_per_task);
-
-	job_ptr_pend->user_name = xstrdup(job_ptr->user_name);
-	job_ptr_pend->wckey = xstrdup(job_ptr->wckey);
+	job_ptr_pend->tres_per_job = str_intern_ref(job_ptr->tres_per_job);
+	job_ptr_pend->tres_per_node = str_intern_ref(job_ptr->tres_per_node);
+	job_ptr_pend->tres_per_socket =
+		str_intern_ref(job_ptr->tres_per_socket);
+	job_ptr_pend->tres_per_task = str_intern_ref(job_ptr->tres_per_task);
+
+	job_ptr_pend->user_name = str_intern_ref(job_ptr->user_name);
+	job_ptr_pend->wckey = str_intern_ref(job_ptr->wckey);
 	job_ptr_pend->deadline = job_ptr->deadline;
 
 	job_details = job_ptr->details;
@@ -4605,7 +4608,7 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	details_new->exc_nodes = xstrdup(job_details->exc_nodes);
 	details_new->feature_list =
 		feature_list_copy(job_details->feature_list);
-	details_new->features = xstrdup(job_details->features);
+	details_new->features = str_intern_ref(job_details->features);
 	details_new->cluster_features = xstrdup(job_details->cluster_features);
 	if (job_details->job_size_bitmap) {
 		details_new->job_size_bitmap =
@@ -4632,7 +4635,7 @@ extern job_record_t *job_array_split(job_record_t *job_ptr)
 	details_new->std_in = xstrdup(job_details->std_in);
 	details_new->std_out = xstrdup(job_details->std_out);
 	details_new->submit_line = xstrdup(job_details->submit_line);
-	details_new->work_dir = xstrdup(job_details->work_dir);
+	details_new->work_dir = str_intern_ref(job_details->work_dir);
 	details_new->x11_magic_cookie = xstrdup(job_details->x11_magic_cookie);
 	details_new->env_hash = xstrdup(job_details->env_hash);
 	details_new->script_hash = xstrdup(job_details->script_hash);
@@ -5676,6 +5679,7 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 			  uid_t uid, bool preempt)
 {
 	job_record_t *job_ptr;
+	job_array_tasks_t *array_tasks;
 	uint32_t job_id;
 	time_t now = time(NULL);
 	char *end_ptr = NULL, *tok, *tmp;
@@ -5813,29 +5817,22 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 		}
 
 		/* Signal all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
-		if (!job_ptr && !job_ptr_done) {
+		array_tasks = _find_array_tasks(job_id);
+		if (!array_tasks && !job_ptr_done) {
 			info("%s(3): invalid JobId=%u", __func__, job_id);
 			return ESLURM_INVALID_JOB_ID;
 		}
-		while (job_ptr) {
-			if (job_ptr->array_job_id == job_id)
-				break;
-			job_ptr = job_ptr->job_array_next_j;
-		}
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == job_id) &&
-			    (job_ptr != job_ptr_done)) {
-				rc2 = job_signal(job_ptr, signal, flags, uid,
-						 preempt);
-				jobs_signaled++;
-				if (rc2 == ESLURM_ALREADY_DONE) {
-					jobs_done++;
-				} else {
-					rc = MAX(rc, rc2);
-				}
+		for (i = 0; array_tasks && (i < array_tasks->cnt); i++) {
+			job_ptr = array_tasks->job_ptrs[i];
+			if (job_ptr == job_ptr_done)
+				continue;
+			rc2 = job_signal(job_ptr, signal, flags, uid, preempt);
+			jobs_signaled++;
+			if (rc2 == ESLURM_ALREADY_DONE) {
+				jobs_done++;
+			} else {
+				rc = MAX(rc, rc2);
 			}
-			job_ptr = job_ptr->job_array_next_j;
 		}
 		if ((rc == SLURM_SUCCESS) && (jobs_done == jobs_signaled))
 			return ESLURM_ALREADY_DONE;
@@ -5865,14 +5862,8 @@ extern int job_str_signal(char *job_id_str, uint16_t signal, uint16_t flags,
 
 	/* Find some job record and validate the user signaling the job */
 	job_ptr = find_job_record(job_id);
-	if (job_ptr == NULL) {
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
-		while (job_ptr) {
-			if (job_ptr->array_job_id == job_id)
-				break;
-			job_ptr = job_ptr->job_array_next_j;
-		}
-	}
+	if ((job_ptr == NULL) && (array_tasks = _find_array_tasks(job_id)))
+		job_ptr = array_tasks->job_ptrs[0];
 	if ((job_ptr == NULL) ||
 	    ((job_ptr->array_task_id == NO_VAL) &&
 	     (job_ptr->array_recs == NULL))) {
@@ -8458,7 +8449,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 	job_ptr = _create_job_record(1);
 
 	*job_rec_ptr = job_ptr;
-	job_ptr->partition = xstrdup(job_desc->partition);
+	job_ptr->partition = str_intern(job_desc->partition);
 	if (job_desc->profile != ACCT_GATHER_PROFILE_NOT_SET)
 		job_ptr->profile = job_desc->profile;
 
@@ -8471,7 +8462,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 	}
 
 	job_ptr->name = xstrdup(job_desc->name);
-	job_ptr->wckey = xstrdup(job_desc->wckey);
+	job_ptr->wckey = str_intern(job_desc->wckey);
 
 	/* Since this is only used in the slurmctld, copy it now. */
 	job_ptr->tres_req_cnt = job_desc->tres_req_cnt;
@@ -8492,7 +8483,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 		job_ptr->time_min = job_desc->time_min;
 	job_ptr->alloc_sid  = job_desc->alloc_sid;
 	job_ptr->alloc_node = xstrdup(job_desc->alloc_node);
-	job_ptr->account    = xstrdup(job_desc->account);
+	job_ptr->account    = str_intern(job_desc->account);
 	job_ptr->batch_features = xstrdup(job_desc->batch_features);
 	job_ptr->burst_buffer = xstrdup(job_desc->burst_buffer);
 	job_ptr->network    = xstrdup(job_desc->network);
@@ -8538,10 +8529,10 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 	job_ptr->mem_per_tres = xstrdup(job_desc->mem_per_tres);
 	job_ptr->tres_bind = xstrdup(job_desc->tres_bind);
 	job_ptr->tres_freq = xstrdup(job_desc->tres_freq);
-	job_ptr->tres_per_job = xstrdup(job_desc->tres_per_job);
-	job_ptr->tres_per_node = xstrdup(job_desc->tres_per_node);
-	job_ptr->tres_per_socket = xstrdup(job_desc->tres_per_socket);
-	job_ptr->tres_per_task = xstrdup(job_desc->tres_per_task);
+	job_ptr->tres_per_job = str_intern(job_desc->tres_per_job);
+	job_ptr->tres_per_node = str_intern(job_desc->tres_per_node);
+	job_ptr->tres_per_socket = str_intern(job_desc->tres_per_socket);
+	job_ptr->tres_per_task = str_intern(job_desc->tres_per_task);
 
 	if (job_desc->wait_all_nodes == NO_VAL16)
 		job_ptr->wait_all_nodes = _default_wait_all_nodes(job_desc);
@@ -8596,7 +8587,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 		detail_ptr->exc_node_bitmap = *exc_bitmap;
 		*exc_bitmap = NULL;	/* Reused nothing left to free */
 	}
-	detail_ptr->features = xstrdup(job_desc->features);
+	detail_ptr->features = str_intern(job_desc->features);
 	detail_ptr->cluster_features = xstrdup(job_desc->cluster_features);
 	detail_ptr->prefer = xstrdup(job_desc->prefer);
 	if (job_desc->fed_siblings_viable) {
@@ -8676,7 +8667,7 @@ static int _copy_job_desc_to_job_record(job_desc_msg_t *job_desc,
 	detail_ptr->std_in = xstrdup(job_desc->std_in);
 	detail_ptr->std_out = xstrdup(job_desc->std_out);
 	detail_ptr->submit_line = xstrdup(job_desc->submit_line);
-	detail_ptr->work_dir = xstrdup(job_desc->work_dir);
+	detail_ptr->work_dir = str_intern(job_desc->work_dir);
 	if (job_desc->begin_time > time(NULL))
 		detail_ptr->begin_time = job_desc->begin_time;
 	job_ptr->select_jobinfo = select_g_select_jobinfo_alloc();
@@ -9829,6 +9820,10 @@ static void _delete_job_common(job_record_t *job_ptr)
 		_remove_job_hash(job_ptr, JOB_HASH_ARRAY_JOB);
 		_remove_job_hash(job_ptr, JOB_HASH_ARRAY_TASK);
 	}
+
+	/* Remove the record from the hetjob hash table, if applicable */
+	if (job_ptr->het_job_id)
+		_remove_job_hash(job_ptr, JOB_HASH_HET_JOB);
 }
 
 /*
@@ -9854,7 +9849,7 @@ static void _list_delete_job(void *job_entry)
 	}
 
 	_delete_job_details(job_ptr);
-	xfree(job_ptr->account);
+	xfree_intern(job_ptr->account);
 	xfree(job_ptr->admin_comment);
 	xfree(job_ptr->alias_list);
 	xfree(job_ptr->alloc_node);
@@ -9906,10 +9901,18 @@ static void _list_delete_job(void *job_entry)
 	}
 	xfree(job_ptr->het_job_id_set);
 	FREE_NULL_LIST(job_ptr->het_job_list);
-	xfree(job_ptr->partition);
+	xfree_intern(job_ptr->partition);
 	FREE_NULL_LIST(job_ptr->part_ptr_list);
 	xfree(job_ptr->priority_array);
 	slurm_destroy_priority_factors(job_ptr->prio_factors);
+	if (job_ptr->prio_cache) {
+		xfree(job_ptr->prio_cache->priority_tres);
+		xfree(job_ptr->prio_cache->tres_alloc_cnt);
+		xfree(job_ptr->prio_cache->tres_req_cnt);
+		xfree(job_ptr->prio_cache->part_ptrs);
+		xfree(job_ptr->prio_cache->part_tres);
+		xfree(job_ptr->prio_cache);
+	}
 	xfree(job_ptr->resp_host);
 	FREE_NULL_LIST(job_ptr->resv_list);
 	xfree(job_ptr->resv_name);
@@ -9925,16 +9928,16 @@ static void _list_delete_job(void *job_entry)
 	xfree(job_ptr->tres_bind);
 	xfree(job_ptr->tres_freq);
 	xfree(job_ptr->tres_fmt_alloc_str);
-	xfree(job_ptr->tres_per_job);
-	xfree(job_ptr->tres_per_node);
-	xfree(job_ptr->tres_per_socket);
-	xfree(job_ptr->tres_per_task);
+	xfree_intern(job_ptr->tres_per_job);
+	xfree_intern(job_ptr->tres_per_node);
+	xfree_intern(job_ptr->tres_per_socket);
+	xfree_intern(job_ptr->tres_per_task);
 	xfree(job_ptr->tres_req_cnt);
 	xfree(job_ptr->tres_req_str);
 	xfree(job_ptr->tres_fmt_req_str);
 	select_g_select_jobinfo_free(job_ptr->select_jobinfo);
-	xfree(job_ptr->user_name);
-	xfree(job_ptr->wckey);
+	xfree_intern(job_ptr->user_name);
+	xfree_intern(job_ptr->wckey);
 	if (job_array_size > job_count) {
 		error("job_count underflow");
 		job_count = 0;
@@ -10355,6 +10358,7 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 		}
 	} else {
 		bool packed_head = false;
+		job_array_tasks_t *array_tasks;
 
 		/* Either the job is not found or it is a job array */
 		if (job_ptr) {
@@ -10366,20 +10370,18 @@ extern int pack_one_job(char **buffer_ptr, int *buffer_size,
 			}
 		}
 
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
-		while (job_ptr) {
+		array_tasks = _find_array_tasks(job_id);
+		for (int i = 0; array_tasks && (i < array_tasks->cnt); i++) {
+			job_ptr = array_tasks->job_ptrs[i];
 			if ((job_ptr->job_id == job_id) && packed_head) {
 				;	/* Already packed */
-			} else if (job_ptr->array_job_id == job_id) {
-				if (valid_operator ||
-				    !_hide_job_user_rec(job_ptr, &user_rec,
-							show_flags)) {
-					pack_job(job_ptr, show_flags, buffer,
-						 protocol_version, uid, true);
-					jobs_packed++;
-				}
+			} else if (valid_operator ||
+				   !_hide_job_user_rec(job_ptr, &user_rec,
+						       show_flags)) {
+				pack_job(job_ptr, show_flags, buffer,
+					 protocol_version, uid, true);
+				jobs_packed++;
 			}
-			job_ptr = job_ptr->job_array_next_j;
 		}
 	}
 
@@ -12904,8 +12906,8 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 
 	if (new_assoc_ptr) {
 		/* Change account/association */
-		xfree(job_ptr->account);
-		job_ptr->account = xstrdup(new_assoc_ptr->acct);
+		xfree_intern(job_ptr->account);
+		job_ptr->account = str_intern(new_assoc_ptr->acct);
 		job_ptr->assoc_id = new_assoc_ptr->id;
 		job_ptr->assoc_ptr = new_assoc_ptr;
 
@@ -13637,14 +13639,14 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 		else if (job_desc->features[0] != '\0') {
 			char *old_features = detail_ptr->features;
 			List old_list = detail_ptr->feature_list;
-			detail_ptr->features = xstrdup(job_desc->features);
+			detail_ptr->features = str_intern(job_desc->features);
 			detail_ptr->feature_list = NULL;
 			if (build_feature_list(job_ptr, false, false)) {
 				sched_info("%s: invalid features(%s) for %pJ",
 					   __func__, job_desc->features,
 					   job_ptr);
 				FREE_NULL_LIST(detail_ptr->feature_list);
-				xfree(detail_ptr->features);
+				xfree_intern(detail_ptr->features);
 				detail_ptr->features = old_features;
 				detail_ptr->feature_list = old_list;
 				error_code = ESLURM_INVALID_FEATURE;
@@ -13653,7 +13655,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 						detail_ptr->feature_list) !=
 				   SLURM_SUCCESS) {
 				FREE_NULL_LIST(detail_ptr->feature_list);
-				xfree(detail_ptr->features);
+				xfree_intern(detail_ptr->features);
 				detail_ptr->features = old_features;
 				detail_ptr->feature_list = old_list;
 				error_code = ESLURM_INVALID_FEATURE;
@@ -13661,7 +13663,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 				sched_info("%s: setting features to %s for %pJ",
 					   __func__, job_desc->features,
 					   job_ptr);
-				xfree(old_features);
+				xfree_intern(old_features);
 				FREE_NULL_LIST(old_list);
 				detail_ptr->features_use = detail_ptr->features;
 				detail_ptr->feature_list_use =
@@ -13670,7 +13672,7 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 		} else {
 			sched_info("%s: cleared features for %pJ", __func__,
 				   job_ptr);
-			xfree(detail_ptr->features);
+			xfree_intern(detail_ptr->features);
 			FREE_NULL_LIST(detail_ptr->feature_list);
 			detail_ptr->features_use = NULL;
 			detail_ptr->feature_list_use = NULL;
@@ -13706,8 +13708,8 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 				   SLURM_SUCCESS) {
 				FREE_NULL_LIST(detail_ptr->prefer_list);
 				xfree(detail_ptr->prefer);
-				detail_ptr->features = old_prefer;
-				detail_ptr->feature_list = old_list;
+				detail_ptr->prefer = old_prefer;
+				detail_ptr->prefer_list = old_list;
 				error_code = ESLURM_INVALID_PREFER;
 			} else {
 				sched_info("%s: setting prefer to %s for %pJ",
@@ -13753,30 +13755,30 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 		if (job_desc->tres_per_job) {
 			xstrfmtcat(tmp, "tres_per_job:%s ",
 				   job_desc->tres_per_job);
-			xfree(job_ptr->tres_per_job);
-			job_ptr->tres_per_job = job_desc->tres_per_job;
-			job_desc->tres_per_job = NULL;
+			xfree_intern(job_ptr->tres_per_job);
+			job_ptr->tres_per_job =
+				str_intern(job_desc->tres_per_job);
 		}
 		if (job_desc->tres_per_node) {
 			xstrfmtcat(tmp, "tres_per_node:%s ",
 				   job_desc->tres_per_node);
-			xfree(job_ptr->tres_per_node);
-			job_ptr->tres_per_node = job_desc->tres_per_node;
-			job_desc->tres_per_node = NULL;
+			xfree_intern(job_ptr->tres_per_node);
+			job_ptr->tres_per_node =
+				str_intern(job_desc->tres_per_node);
 		}
 		if (job_desc->tres_per_socket) {
 			xstrfmtcat(tmp, "tres_per_socket:%s ",
 				   job_desc->tres_per_socket);
-			xfree(job_ptr->tres_per_socket);
-			job_ptr->tres_per_socket = job_desc->tres_per_socket;
-			job_desc->tres_per_socket = NULL;
+			xfree_intern(job_ptr->tres_per_socket);
+			job_ptr->tres_per_socket =
+				str_intern(job_desc->tres_per_socket);
 		}
 		if (job_desc->tres_per_task) {
 			xstrfmtcat(tmp, "tres_per_task:%s ",
 				   job_desc->tres_per_task);
-			xfree(job_ptr->tres_per_task);
-			job_ptr->tres_per_task = job_desc->tres_per_task;
-			job_desc->tres_per_task = NULL;
+			xfree_intern(job_ptr->tres_per_task);
+			job_ptr->tres_per_task =
+				str_intern(job_desc->tres_per_task);
 		}
 		if (job_desc->mem_per_tres) {
 			xstrfmtcat(tmp, "mem_per_tres:%s ",
@@ -13822,8 +13824,8 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 			error_code = ESLURM_JOB_NOT_PENDING;
 			goto fini;
 		} else if (detail_ptr) {
-			xfree(detail_ptr->work_dir);
-			detail_ptr->work_dir = xstrdup(job_desc->work_dir);
+			xfree_intern(detail_ptr->work_dir);
+			detail_ptr->work_dir = str_intern(job_desc->work_dir);
 			sched_info("%s: setting work_dir to %s for %pJ",
 				   __func__, detail_ptr->work_dir, job_ptr);
 			update_accounting = true;
@@ -14376,13 +14378,13 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 			error_code = ESLURM_INVALID_TRES;
 			goto fini;
 		}
-		xfree(job_ptr->tres_per_job);
+		xfree_intern(job_ptr->tres_per_job);
 		if (!strlen(job_desc->tres_per_job)) {
 			sched_info("%s: clearing TresPerJob option for %pJ",
 				   __func__, job_ptr);
 		} else {
 			job_ptr->tres_per_job =
-				xstrdup(job_desc->tres_per_job);
+				str_intern(job_desc->tres_per_job);
 			sched_info("%s: setting TresPerJob to %s for %pJ",
 				   __func__, job_ptr->tres_per_job, job_ptr);
 		}
@@ -14392,13 +14394,13 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 			error_code = ESLURM_INVALID_TRES;
 			goto fini;
 		}
-		xfree(job_ptr->tres_per_node);
+		xfree_intern(job_ptr->tres_per_node);
 		if (!strlen(job_desc->tres_per_node)) {
 			sched_info("%s: clearing TresPerNode option for %pJ",
 				   __func__, job_ptr);
 		} else {
 			job_ptr->tres_per_node =
-				xstrdup(job_desc->tres_per_node);
+				str_intern(job_desc->tres_per_node);
 			sched_info("%s: setting TresPerNode to %s for %pJ",
 				   __func__, job_ptr->tres_per_node, job_ptr);
 		}
@@ -14409,13 +14411,13 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 			error_code = ESLURM_INVALID_TRES;
 			goto fini;
 		}
-		xfree(job_ptr->tres_per_socket);
+		xfree_intern(job_ptr->tres_per_socket);
 		if (!strlen(job_desc->tres_per_socket)) {
 			sched_info("%s: clearing TresPerSocket option for %pJ",
 				   __func__, job_ptr);
 		} else {
 			job_ptr->tres_per_socket =
-				xstrdup(job_desc->tres_per_socket);
+				str_intern(job_desc->tres_per_socket);
 			sched_info("%s: setting TresPerSocket to %s for %pJ",
 				   __func__, job_ptr->tres_per_socket, job_ptr);
 		}
@@ -14426,13 +14428,13 @@ static int _update_job(job_record_t *job_ptr, job_desc_msg_t *job_desc,
 			error_code = ESLURM_INVALID_TRES;
 			goto fini;
 		}
-		xfree(job_ptr->tres_per_task);
+		xfree_intern(job_ptr->tres_per_task);
 		if (!strlen(job_desc->tres_per_task)) {
 			sched_info("%s: clearing TresPerTask option for %pJ",
 				   __func__, job_ptr);
 		} else {
 			job_ptr->tres_per_task =
-				xstrdup(job_desc->tres_per_task);
+				str_intern(job_desc->tres_per_task);
 			sched_info("%s: setting TresPerTask to %s for %pJ",
 				   __func__, job_ptr->tres_per_task, job_ptr);
 		}
@@ -14592,6 +14594,7 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 {
 	job_desc_msg_t *job_desc = (job_desc_msg_t *) msg->data;
 	job_record_t *job_ptr, *new_job_ptr, *het_job;
+	job_array_tasks_t *array_tasks;
 	char *hostname = auth_g_get_host(msg->auth_cred);
 	ListIterator iter;
 	long int long_id;
@@ -14669,26 +14672,23 @@ extern int update_job_str(slurm_msg_t *msg, uid_t uid)
 		}
 
 		/* Update all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
-		if (!job_ptr && !job_ptr_done) {
+		array_tasks = _find_array_tasks(job_id);
+		if (!array_tasks && !job_ptr_done) {
 			info("%s: invalid JobId=%u", __func__, job_id);
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
 		}
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == job_id) &&
-			    (job_ptr != job_ptr_done)) {
-				rc2 = _update_job(job_ptr, job_desc, uid,
-						  &err_msg);
-				if (rc2 == ESLURM_JOB_SETTING_DB_INX) {
-					rc = rc2;
-					goto reply;
-				}
-				_resp_array_add(&resp_array, job_ptr, rc2,
-						err_msg);
-				xfree(err_msg);
+		for (i = 0; array_tasks && (i < array_tasks->cnt); i++) {
+			job_ptr = array_tasks->job_ptrs[i];
+			if (job_ptr == job_ptr_done)
+				continue;
+			rc2 = _update_job(job_ptr, job_desc, uid, &err_msg);
+			if (rc2 == ESLURM_JOB_SETTING_DB_INX) {
+				rc = rc2;
+				goto reply;
 			}
-			job_ptr = job_ptr->job_array_next_j;
+			_resp_array_add(&resp_array, job_ptr, rc2, err_msg);
+			xfree(err_msg);
 		}
 		goto reply;
 	} else if (end_ptr[0] == '+') {	/* Hetjob element */
@@ -15617,7 +15617,7 @@ static void _validate_job_files(List batch_dirs)
 {
 	job_record_t *job_ptr;
 	ListIterator batch_dir_iter;
-	uint32_t *job_id_ptr, array_job_id;
+	uint32_t *job_id_ptr;
 
 	list_for_each(job_list, _clear_state_dir_flag, NULL);
 
@@ -15629,13 +15629,13 @@ static void _validate_job_files(List batch_dirs)
 			list_delete_item(batch_dir_iter);
 		}
 		if (job_ptr && job_ptr->array_recs) { /* Update all tasks */
-			array_job_id = job_ptr->array_job_id;
-			job_ptr = job_array_hash_j[JOB_HASH_INX(array_job_id)];
-			while (job_ptr) {
-				if (job_ptr->array_job_id == array_job_id)
-					job_ptr->bit_flags |= HAS_STATE_DIR;
-				job_ptr = job_ptr->job_array_next_j;
-			}
+			job_array_tasks_t *array_tasks =
+				_find_array_tasks(job_ptr->array_job_id);
+
+			for (int i = 0; array_tasks && (i < array_tasks->cnt);
+			     i++)
+				array_tasks->job_ptrs[i]->bit_flags |=
+					HAS_STATE_DIR;
 		}
 	}
 	list_iterator_destroy(batch_dir_iter);
@@ -16030,13 +16030,29 @@ void batch_requeue_fini(job_record_t *job_ptr)
 }
 
 
+static int _free_array_tasks(uint64_t key, void *item, void *arg)
+{
+	job_array_tasks_t *array_tasks = item;
+
+	xfree(array_tasks->job_ptrs);
+	xfree(array_tasks);
+	return 0;
+}
+
 /* job_fini - free all memory associated with job records */
 void job_fini (void)
 {
 	FREE_NULL_LIST(job_list);
-	xfree(job_hash);
-	xfree(job_array_hash_j);
-	xfree(job_array_hash_t);
+	id_hash_destroy(job_hash);
+	job_hash = NULL;
+	if (job_array_hash_j)
+		id_hash_for_each(job_array_hash_j, _free_array_tasks, NULL);
+	id_hash_destroy(job_array_hash_j);
+	job_array_hash_j = NULL;
+	id_hash_destroy(job_array_hash_t);
+	job_array_hash_t = NULL;
+	id_hash_destroy(het_job_hash);
+	het_job_hash = NULL;
 	FREE_NULL_LIST(purge_files_list);
 	FREE_NULL_BITMAP(requeue_exit);
 	FREE_NULL_BITMAP(requeue_exit_hold);
@@ -16880,6 +16896,7 @@ extern int job_suspend2(suspend_msg_t *sus_ptr, uid_t uid,
 {
 	int rc = SLURM_SUCCESS, rc2;
 	job_record_t *job_ptr = NULL;
+	job_array_tasks_t *array_tasks;
 	long int long_id;
 	uint32_t job_id = 0;
 	char *end_ptr = NULL, *tok, *tmp;
@@ -16935,20 +16952,17 @@ extern int job_suspend2(suspend_msg_t *sus_ptr, uid_t uid,
 		}
 
 		/* Suspend all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
-		if (!job_ptr && !job_ptr_done) {
+		array_tasks = _find_array_tasks(job_id);
+		if (!array_tasks && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
 		}
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == job_id) &&
-			    (job_ptr != job_ptr_done)) {
-				rc2 = _job_suspend(job_ptr, sus_ptr->op,
-						   indf_susp);
-				_resp_array_add(&resp_array, job_ptr, rc2,
-						NULL);
-			}
-			job_ptr = job_ptr->job_array_next_j;
+		for (int i = 0; array_tasks && (i < array_tasks->cnt); i++) {
+			job_ptr = array_tasks->job_ptrs[i];
+			if (job_ptr == job_ptr_done)
+				continue;
+			rc2 = _job_suspend(job_ptr, sus_ptr->op, indf_susp);
+			_resp_array_add(&resp_array, job_ptr, rc2, NULL);
 		}
 		goto reply;
 	}
@@ -17366,6 +17380,7 @@ extern int job_requeue2(uid_t uid, requeue_msg_t *req_ptr, slurm_msg_t *msg,
 {
 	int rc = SLURM_SUCCESS, rc2;
 	job_record_t *job_ptr = NULL;
+	job_array_tasks_t *array_tasks;
 	long int long_id;
 	uint32_t job_id = 0;
 	char *end_ptr = NULL, *tok, *tmp;
@@ -17412,19 +17427,17 @@ extern int job_requeue2(uid_t uid, requeue_msg_t *req_ptr, slurm_msg_t *msg,
 		}
 
 		/* Requeue all tasks of this job array */
-		job_ptr = job_array_hash_j[JOB_HASH_INX(job_id)];
-		if (!job_ptr && !job_ptr_done) {
+		array_tasks = _find_array_tasks(job_id);
+		if (!array_tasks && !job_ptr_done) {
 			rc = ESLURM_INVALID_JOB_ID;
 			goto reply;
 		}
-		while (job_ptr) {
-			if ((job_ptr->array_job_id == job_id) &&
-			    (job_ptr != job_ptr_done)) {
-				rc2 = _job_requeue(uid, job_ptr, preempt,flags);
-				_resp_array_add(&resp_array, job_ptr, rc2,
-						NULL);
-			}
-			job_ptr = job_ptr->job_array_next_j;
+		for (int i = 0; array_tasks && (i < array_tasks->cnt); i++) {
+			job_ptr = array_tasks->job_ptrs[i];
+			if (job_ptr == job_ptr_done)
+				continue;
+			rc2 = _job_requeue(uid, job_ptr, preempt, flags);
+			_resp_array_add(&resp_array, job_ptr, rc2, NULL);
 		}
 		goto reply;
 	}
@@ -17925,9 +17938,9 @@ extern int update_job_wckey(char *module, job_record_t *job_ptr,
 		}
 	}
 
-	xfree(job_ptr->wckey);
+	xfree_intern(job_ptr->wckey);
 	if (wckey_rec.name && wckey_rec.name[0] != '\0') {
-		job_ptr->wckey = xstrdup(wckey_rec.name);
+		job_ptr->wckey = str_intern(wckey_rec.name);
 		info("%s: setting wckey to %s for %pJ",
 		     module, wckey_rec.name, job_ptr);
 	} else {
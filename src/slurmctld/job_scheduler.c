@@ -60,6 +60,7 @@
 #include "src/common/job_features.h"
 #include "src/common/list.h"
 #include "src/common/macros.h"
+#include "src/common/str_intern.h"
 #include "src/common/strlcpy.h"
 #include "src/common/parse_time.h"
 #include "src/common/timers.h"
@@ -3216,14 +3217,14 @@ static void _copy_tres_opts(job_record_t *job_ptr, job_record_t *dep_job_ptr)
 {
 	xfree(job_ptr->cpus_per_tres);
 	job_ptr->cpus_per_tres = xstrdup(dep_job_ptr->cpus_per_tres);
-	xfree(job_ptr->tres_per_job);
-	job_ptr->tres_per_job = xstrdup(dep_job_ptr->tres_per_job);
-	xfree(job_ptr->tres_per_node);
-	job_ptr->tres_per_node = xstrdup(dep_job_ptr->tres_per_node);
-	xfree(job_ptr->tres_per_socket);
-	job_ptr->tres_per_socket = xstrdup(dep_job_ptr->tres_per_socket);
-	xfree(job_ptr->tres_per_task);
-	job_ptr->tres_per_task = xstrdup(dep_job_ptr->tres_per_task);
+	xfree_intern(job_ptr->tres_per_job);
+	job_ptr->tres_per_job = str_intern_ref(dep_job_ptr->tres_per_job);
+	xfree_intern(job_ptr->tres_per_node);
+	job_ptr->tres_per_node = str_intern_ref(dep_job_ptr->tres_per_node);
+	xfree_intern(job_ptr->tres_per_socket);
+	job_ptr->tres_per_socket = str_intern_ref(dep_job_ptr->tres_per_socket);
+	xfree_intern(job_ptr->tres_per_task);
+	job_ptr->tres_per_task = str_intern_ref(dep_job_ptr->tres_per_task);
 	xfree(job_ptr->mem_per_tres);
 	job_ptr->mem_per_tres = xstrdup(dep_job_ptr->mem_per_tres);
 }
@@ -5173,6 +5174,7 @@ extern void rebuild_job_part_list(job_record_t *job_ptr)
 {
 	ListIterator part_iterator;
 	part_record_t *part_ptr;
+	char *partition;
 
 	if (!job_ptr->part_ptr_list)
 		return;
@@ -5182,17 +5184,20 @@ extern void rebuild_job_part_list(job_record_t *job_ptr)
 		return;
 	}
 
-	xfree(job_ptr->partition);
-	job_ptr->partition = xstrdup(job_ptr->part_ptr->name);
+	partition = xstrdup(job_ptr->part_ptr->name);
 
 	part_iterator = list_iterator_create(job_ptr->part_ptr_list);
 	while ((part_ptr = list_next(part_iterator))) {
 		if (part_ptr == job_ptr->part_ptr)
 			continue;
-		xstrcat(job_ptr->partition, ",");
-		xstrcat(job_ptr->partition, part_ptr->name);
+		xstrcat(partition, ",");
+		xstrcat(partition, part_ptr->name);
 	}
 	list_iterator_destroy(part_iterator);
+
+	xfree_intern(job_ptr->partition);
+	job_ptr->partition = str_intern(partition);
+	xfree(partition);
 }
 
 /* cleanup_completing()
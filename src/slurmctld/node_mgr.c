@@ -61,6 +61,7 @@
 #include "src/common/parse_time.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_resource_info.h"
+#include "src/common/str_intern.h"
 #include "src/common/timers.h"
 #include "src/common/xassert.h"
 #include "src/common/xstring.h"
@@ -2891,9 +2892,8 @@ extern int validate_node_specs(slurm_msg_t *slurm_msg, bool *newly_up)
 	error_code = SLURM_SUCCESS;
 
 	node_ptr->protocol_version = slurm_msg->protocol_version;
-	xfree(node_ptr->version);
-	node_ptr->version = reg_msg->version;
-	reg_msg->version = NULL;
+	xfree_intern(node_ptr->version);
+	node_ptr->version = str_intern(reg_msg->version);
 
 	if (waiting_for_node_boot(node_ptr) ||
 	    waiting_for_node_power_down(node_ptr))
@@ -3084,13 +3084,11 @@ extern int validate_node_specs(slurm_msg_t *slurm_msg, bool *newly_up)
 		FREE_NULL_BITMAP(node_spec_bitmap_old);
 	}
 
-	xfree(node_ptr->arch);
-	node_ptr->arch = reg_msg->arch;
-	reg_msg->arch = NULL;	/* Nothing left to free */
+	xfree_intern(node_ptr->arch);
+	node_ptr->arch = str_intern(reg_msg->arch);
 
-	xfree(node_ptr->os);
-	node_ptr->os = reg_msg->os;
-	reg_msg->os = NULL;	/* Nothing left to free */
+	xfree_intern(node_ptr->os);
+	node_ptr->os = str_intern(reg_msg->os);
 
 	if (node_ptr->cpu_load != reg_msg->cpu_load) {
 		node_ptr->cpu_load = reg_msg->cpu_load;
@@ -57,6 +57,7 @@
 #include "src/common/hostlist.h"
 #include "src/common/job_features.h"
 #include "src/common/list.h"
+#include "src/common/str_intern.h"
 #include "src/common/uid.h"
 #include "src/common/xassert.h"
 #include "src/common/xmalloc.h"
@@ -2348,6 +2349,9 @@ extern int select_nodes(job_record_t *job_ptr, bool test_only,
 	if (!acct_policy_job_runnable_pre_select(job_ptr, false))
 		return ESLURM_ACCOUNTING_POLICY;
 
+	if (!test_only && acct_policy_job_limit_blocked(job_ptr))
+		return ESLURM_ACCOUNTING_POLICY;
+
 	part_ptr = job_ptr->part_ptr;
 
 	/* identify partition */
@@ -3024,8 +3028,11 @@ extern void launch_prolog(job_record_t *job_ptr)
 	prolog_msg_ptr->het_job_id = job_ptr->het_job_id;
 	prolog_msg_ptr->uid = job_ptr->user_id;
 	prolog_msg_ptr->gid = job_ptr->group_id;
-	if (!job_ptr->user_name)
-		job_ptr->user_name = uid_to_string_or_null(job_ptr->user_id);
+	if (!job_ptr->user_name) {
+		char *user_name = uid_to_string_or_null(job_ptr->user_id);
+		job_ptr->user_name = str_intern(user_name);
+		xfree(user_name);
+	}
 	prolog_msg_ptr->user_name = xstrdup(job_ptr->user_name);
 	prolog_msg_ptr->alias_list = xstrdup(job_ptr->alias_list);
 	prolog_msg_ptr->nodes = xstrdup(job_ptr->nodes);
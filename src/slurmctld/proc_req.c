@@ -57,6 +57,7 @@
 #include "src/common/cron.h"
 #include "src/common/fd.h"
 #include "src/common/fetch_config.h"
+#include "src/common/forward.h"
 #include "src/common/group_cache.h"
 #include "src/common/hostlist.h"
 #include "src/common/log.h"
@@ -1177,6 +1178,7 @@ static void _slurm_rpc_allocate_het_job(slurm_msg_t *msg)
 			jobid_hostset = hostset_create(tmp_str);
 		job_ptr->het_job_id     = het_job_id;
 		job_ptr->het_job_offset = het_job_offset++;
+		add_het_job_hash(job_ptr);
 		list_append(submit_job_list, job_ptr);
 		inx++;
 	}
@@ -4003,6 +4005,7 @@ static void _slurm_rpc_submit_batch_het_job(slurm_msg_t *msg)
 				jobid_hostset = hostset_create(tmp_str);
 			job_ptr->het_job_id     = het_job_id;
 			job_ptr->het_job_offset = het_job_offset++;
+			add_het_job_hash(job_ptr);
 			job_ptr->batch_flag      = 1;
 			list_append(submit_job_list, job_ptr);
 		}
@@ -5736,6 +5739,9 @@ static void _clear_rpc_stats(void)
 	memset(rpc_user_id, 0, sizeof(rpc_user_id));
 	memset(rpc_user_time, 0, sizeof(rpc_user_time));
 	slurm_mutex_unlock(&rpc_mutex);
+
+	forward_reset_tree_stats();
+	agent_reset_send_stats();
 }
 
 static void _pack_rpc_stats(char **buffer_ptr, int *buffer_size,
@@ -5769,6 +5775,10 @@ static void _pack_rpc_stats(char **buffer_ptr, int *buffer_size,
 
 		agent_pack_pending_rpc_stats(buffer);
 
+		if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+			forward_pack_tree_stats(buffer);
+			agent_pack_send_stats(buffer);
+		}
 	}
 
 	slurm_mutex_unlock(&rpc_mutex);
@@ -53,11 +53,13 @@
 
 #include "src/common/assoc_mgr.h"
 #include "src/common/cpu_frequency.h"
+#include "src/common/forward.h"
 #include "src/common/hostlist.h"
 #include "src/common/list.h"
 #include "src/common/macros.h"
 #include "src/common/read_config.h"
 #include "src/common/slurm_rlimits_info.h"
+#include "src/common/str_intern.h"
 #include "src/common/strnatcmp.h"
 #include "src/common/xstring.h"
 
@@ -2027,6 +2029,9 @@ int read_slurm_conf(int recover, bool reconfig)
 
 	_set_response_cluster_rec();
 
+	forward_tree_stats_init(xstrcasestr(slurm_conf.slurmctld_params,
+					    "adaptive_fanout"));
+
 	consolidate_config_list(true, true);
 
 	slurm_conf.last_update = time(NULL);
@@ -2656,12 +2661,12 @@ static int _restore_node_state(int recover,
 			old_node_ptr->gres = NULL;
 		}
 		if (old_node_ptr->arch) {
-			xfree(node_ptr->arch);
+			xfree_intern(node_ptr->arch);
 			node_ptr->arch = old_node_ptr->arch;
 			old_node_ptr->arch = NULL;
 		}
 		if (old_node_ptr->os) {
-			xfree(node_ptr->os);
+			xfree_intern(node_ptr->os);
 			node_ptr->os = old_node_ptr->os;
 			old_node_ptr->os = NULL;
 		}
@@ -683,6 +683,41 @@ typedef struct {
 	uint32_t priority;		/* whole hetjob calculated priority */
 } het_job_details_t;
 
+/*
+ * Priority factor components cached by the priority plugin so that an
+ * unchanged job can be re-prioritized without recomputing every factor.
+ * Internal use only, DON'T PACK.
+ */
+typedef struct {
+	uint32_t conf_gen;		/* priority config generation, 0 if
+					 * the cache is invalid */
+	uint32_t fs_gen;		/* fairshare generation of the assoc,
+					 * fairshare and QOS factors below */
+	time_t part_update;		/* last_part_update when cached */
+	uint32_t cluster_cpus;		/* cluster_cpus when cached */
+	int node_cnt;			/* active_node_record_count when
+					 * cached */
+	uint32_t total_cpus;		/* job's total_cpus when cached */
+	part_record_t *part_ptr;	/* job's part_ptr when cached */
+	uint64_t *tres_alloc_cnt;	/* copy of the job's tres_alloc_cnt when
+					 * cached, tres_cnt long */
+	uint64_t *tres_req_cnt;		/* copy of the job's tres_req_cnt when
+					 * cached, tres_cnt long */
+	bool size_set;			/* priority_js and priority_tres set */
+	double priority_assoc;		/* unweighted factors */
+	double priority_fs;
+	double priority_js;
+	double priority_qos;
+	double *priority_tres;		/* unweighted, tres_cnt long */
+	uint32_t tres_cnt;
+	uint32_t part_cnt;		/* size of part_ptrs */
+	part_record_t **part_ptrs;	/* partitions of part_tres, NULL if the
+					 * slot isn't set */
+	double *part_tres;		/* weighted TRES factors of each
+					 * partition of a multi-partition job,
+					 * part_cnt * tres_cnt long */
+} job_prio_cache_t;
+
 /*
  * NOTE: When adding fields to the job_record, or any underlying structures,
  * be sure to sync with job_array_split.
@@ -772,9 +807,6 @@ struct job_record {
 	List het_job_list;		/* List of job pointers to all
 					 * components */
 	uint32_t job_id;		/* job ID */
-	job_record_t *job_next;		/* next entry with same hash index */
-	job_record_t *job_array_next_j;	/* job array linked list by job_id */
-	job_record_t *job_array_next_t;	/* job array linked list by task_id */
 	job_record_t *job_preempt_comp; /* het job preempt component */
 	job_resources_t *job_resrcs;	/* details of allocated cores */
 	uint32_t job_state;		/* state of the job */
@@ -784,6 +816,13 @@ struct job_record {
 	char *licenses;			/* licenses required by the job */
 	List license_list;		/* structure with license info */
 	char *lic_req;		/* required system licenses directly requested*/
+	uint32_t limit_block_id;	/* assoc or QOS id of the GrpTRES limit
+					 * that held the job at its last test,
+					 * internal use only, DON'T PACK */
+	uint16_t limit_block_pos;	/* TRES position + 1 of that limit,
+					 * 0 if not held, DON'T PACK */
+	bool limit_block_qos;		/* limit_block_id is a QOS id,
+					 * DON'T PACK */
 	acct_policy_limit_set_t limit_set; /* flags if indicate an
 					    * associated limit was set from
 					    * a limit instead of from
@@ -841,6 +880,8 @@ struct job_record {
 	priority_factors_t *prio_factors; /* cached value of priority factors
 					   * figured out in the priority plugin
 					   */
+	job_prio_cache_t *prio_cache;	/* priority plugin's cached factor
+					 * components, DON'T PACK */
 	uint32_t profile;		/* Acct_gather_profile option */
 	uint32_t qos_id;		/* quality of service id */
 	slurmdb_qos_rec_t *qos_ptr;	/* pointer to the quality of
@@ -1299,6 +1340,13 @@ extern job_record_t *find_job_array_rec(uint32_t array_job_id,
  */
 extern job_record_t *find_het_job_record(uint32_t job_id, uint32_t het_job_id);
 
+/*
+ * add_het_job_hash - add a hetjob hash entry for given job record so that
+ *	find_het_job_record() can find it, het_job_id and het_job_offset must
+ *	already be set
+ */
+extern void add_het_job_hash(job_record_t *job_ptr);
+
 /*
  * find_job_record - return a pointer to the job record with the given job_id
  * IN job_id - requested job's id
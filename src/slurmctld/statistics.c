@@ -42,6 +42,7 @@
 #include "src/slurmctld/slurmctld.h"
 #include "src/common/list.h"
 #include "src/common/pack.h"
+#include "src/common/str_intern.h"
 #include "src/common/xstring.h"
 #include "src/common/slurmdbd_defs.h"
 
@@ -138,6 +139,24 @@ extern void pack_all_stat(int resp, char **buffer_ptr, int *buffer_size,
 			pack32(slurmctld_diag_stats.bf_active, buffer);
 			pack32(slurmctld_diag_stats.backfilled_het_jobs,
 			       buffer);
+
+			if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION) {
+				str_intern_stats_t intern_stats;
+				uint32_t workers, busy, queued, queued_max;
+
+				str_intern_get_stats(&intern_stats);
+				pack32(intern_stats.strings, buffer);
+				pack64(intern_stats.refs, buffer);
+				pack64(intern_stats.bytes, buffer);
+				pack64(intern_stats.bytes_saved, buffer);
+
+				agent_get_worker_stats(&workers, &busy, &queued,
+						       &queued_max);
+				pack32(workers, buffer);
+				pack32(busy, buffer);
+				pack32(queued, buffer);
+				pack32(queued_max, buffer);
+			}
 		}
 	}
 
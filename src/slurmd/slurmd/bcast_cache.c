@@ -0,0 +1,326 @@
+/****************************************************************************\
+ *  bcast_cache.c - node local cache of broadcast files
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include "config.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/bcast/file_bcast.h"
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/read_config.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+#include "src/slurmd/slurmd/bcast_cache.h"
+#include "src/slurmd/slurmd/slurmd.h"
+
+#define COPY_BUF_SIZE (1024 * 1024)
+#define TMP_PREFIX ".tmp."
+
+typedef struct {
+	char *name;
+	time_t mtime;
+	uint64_t size;
+} cache_file_t;
+
+static char *cache_dir = NULL;
+static uint64_t cache_size = 0;		/* bytes */
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void _free_cache_file(void *x)
+{
+	cache_file_t *file = x;
+
+	xfree(file->name);
+	xfree(file);
+}
+
+/* Oldest first */
+static int _sort_cache_file(void *x, void *y)
+{
+	cache_file_t *file1 = *(cache_file_t **) x;
+	cache_file_t *file2 = *(cache_file_t **) y;
+
+	if (file1->mtime < file2->mtime)
+		return -1;
+	return (file1->mtime > file2->mtime);
+}
+
+static char *_cache_path(uid_t uid, slurm_hash_t *hash)
+{
+	char *path = xstrdup_printf("%s/%u.", cache_dir, uid);
+
+	for (int i = 0; i < sizeof(hash->hash); i++)
+		xstrfmtcat(path, "%02x", hash->hash[i]);
+
+	return path;
+}
+
+static int _copy_fd(int in, int out, uint64_t size)
+{
+	char *buf = xmalloc(COPY_BUF_SIZE);
+	uint64_t offset = 0;
+	ssize_t rd, wr;
+	int rc = SLURM_SUCCESS;
+
+	while (offset < size) {
+		rd = pread(in, buf, MIN(COPY_BUF_SIZE, size - offset), offset);
+		if ((rd < 0) && (errno == EINTR))
+			continue;
+		if (rd <= 0) {
+			rc = SLURM_ERROR;
+			break;
+		}
+		for (ssize_t done = 0; done < rd; done += wr) {
+			wr = pwrite(out, buf + done, rd - done, offset + done);
+			if ((wr < 0) && (errno == EINTR)) {
+				wr = 0;
+				continue;
+			}
+			if (wr < 0) {
+				rc = SLURM_ERROR;
+				goto fini;
+			}
+		}
+		offset += rd;
+	}
+
+fini:
+	xfree(buf);
+	return rc;
+}
+
+/* Remove the least recently used files until they fit in cache_size */
+static void _cache_evict(void)
+{
+	DIR *dp;
+	struct dirent *ent;
+	struct stat st;
+	cache_file_t *file;
+	list_t *files;
+	uint64_t total = 0;
+	char *path = NULL;
+
+	if (!(dp = opendir(cache_dir))) {
+		error("%s: opendir(%s): %m", __func__, cache_dir);
+		return;
+	}
+
+	files = list_create(_free_cache_file);
+	while ((ent = readdir(dp))) {
+		if ((ent->d_name[0] == '.') ||
+		    fstatat(dirfd(dp), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) ||
+		    !S_ISREG(st.st_mode))
+			continue;
+		file = xmalloc(sizeof(*file));
+		file->name = xstrdup(ent->d_name);
+		file->mtime = st.st_mtime;
+		file->size = st.st_size;
+		total += file->size;
+		list_append(files, file);
+	}
+	closedir(dp);
+
+	list_sort(files, _sort_cache_file);
+	while ((total > cache_size) && (file = list_pop(files))) {
+		xstrfmtcat(path, "%s/%s", cache_dir, file->name);
+		if (unlink(path))
+			error("%s: unlink(%s): %m", __func__, path);
+		else
+			debug("%s: removed %s", __func__, path);
+		total -= file->size;
+		xfree(path);
+		_free_cache_file(file);
+	}
+	FREE_NULL_LIST(files);
+}
+
+/* Remove the partial copies left by a previous slurmd */
+static void _cache_clean_tmp(void)
+{
+	DIR *dp;
+	struct dirent *ent;
+
+	if (!(dp = opendir(cache_dir)))
+		return;
+	while ((ent = readdir(dp))) {
+		if (!xstrncmp(ent->d_name, TMP_PREFIX, strlen(TMP_PREFIX)))
+			(void) unlinkat(dirfd(dp), ent->d_name, 0);
+	}
+	closedir(dp);
+}
+
+extern void bcast_cache_init(void)
+{
+	char *dir;
+
+	if (!(cache_size = bcast_cache_size() * 1024 * 1024))
+		return;
+
+	if ((dir = conf_get_opt_str(slurm_conf.bcast_parameters,
+				    "CacheDir=")))
+		cache_dir = dir;
+	else
+		cache_dir = xstrdup_printf("%s/bcast_cache", conf->spooldir);
+
+	if (mkdir(cache_dir, 0700) && (errno != EEXIST)) {
+		error("Unable to create broadcast cache directory %s: %m, broadcast cache disabled",
+		      cache_dir);
+		xfree(cache_dir);
+		cache_size = 0;
+		return;
+	}
+
+	_cache_clean_tmp();
+	_cache_evict();
+	debug("%s: using %s for up to %"PRIu64" bytes",
+	      __func__, cache_dir, cache_size);
+}
+
+extern void bcast_cache_fini(void)
+{
+	xfree(cache_dir);
+	cache_size = 0;
+}
+
+extern bool bcast_cache_enabled(void)
+{
+	return (cache_size != 0);
+}
+
+extern int bcast_cache_restore(uid_t uid, slurm_hash_t *hash, uint64_t size,
+			       int fd)
+{
+	struct stat st;
+	char *path;
+	int in, rc = SLURM_ERROR;
+
+	if (!cache_size || (hash->type != HASH_PLUGIN_K12))
+		return SLURM_ERROR;
+
+	path = _cache_path(uid, hash);
+	if ((in = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+		debug2("%s: %s not cached", __func__, path);
+		goto fini;
+	}
+
+	if (fstat(in, &st) || (st.st_size != size)) {
+		error("%s: %s does not have the expected size", __func__, path);
+	} else if (_copy_fd(in, fd, size)) {
+		error("%s: unable to copy %s: %m", __func__, path);
+	} else {
+		/* The modification time orders the cache for eviction */
+		(void) futimens(in, NULL);
+		debug("%s: restored %s", __func__, path);
+		rc = SLURM_SUCCESS;
+	}
+	close(in);
+
+fini:
+	xfree(path);
+	return rc;
+}
+
+extern void bcast_cache_add(uid_t uid, slurm_hash_t *hash, uint64_t size,
+			    int fd)
+{
+	slurm_hash_t check = { 0 };
+	char *path = NULL, *tmp = NULL;
+	void *data;
+	int tmp_fd = -1;
+
+	if (!cache_size || (hash->type != HASH_PLUGIN_K12) || !size ||
+	    (size > cache_size))
+		return;
+
+	path = _cache_path(uid, hash);
+	if (!access(path, F_OK))
+		goto fini;
+
+	/*
+	 * Copy the file first and check the content of that copy, the user
+	 * owns the original one and could still change it.
+	 */
+	tmp = xstrdup_printf("%s/" TMP_PREFIX "XXXXXX", cache_dir);
+	if ((tmp_fd = mkstemp(tmp)) < 0) {
+		error("%s: mkstemp(%s): %m", __func__, tmp);
+		goto fini;
+	}
+	if (_copy_fd(fd, tmp_fd, size)) {
+		error("%s: unable to copy to %s: %m", __func__, tmp);
+		goto fail;
+	}
+
+	data = mmap(NULL, size, PROT_READ, MAP_SHARED, tmp_fd, 0);
+	if (data == MAP_FAILED) {
+		error("%s: mmap(%s): %m", __func__, tmp);
+		goto fail;
+	}
+	if (bcast_hash_file(data, size, &check) ||
+	    (check.type != hash->type) ||
+	    memcmp(check.hash, hash->hash, sizeof(check.hash))) {
+		munmap(data, size);
+		error("%s: content of broadcast file does not match its hash, not caching it",
+		      __func__);
+		goto fail;
+	}
+	munmap(data, size);
+
+	slurm_mutex_lock(&cache_mutex);
+	if (rename(tmp, path)) {
+		slurm_mutex_unlock(&cache_mutex);
+		error("%s: rename(%s, %s): %m", __func__, tmp, path);
+		goto fail;
+	}
+	debug("%s: added %s", __func__, path);
+	_cache_evict();
+	slurm_mutex_unlock(&cache_mutex);
+	goto fini;
+
+fail:
+	(void) unlink(tmp);
+fini:
+	if (tmp_fd >= 0)
+		close(tmp_fd);
+	xfree(tmp);
+	xfree(path);
+}
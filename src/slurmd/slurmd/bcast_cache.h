@@ -0,0 +1,74 @@
+/****************************************************************************\
+ *  bcast_cache.h - node local cache of broadcast files
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#ifndef _SLURMD_BCAST_CACHE_H
+#define _SLURMD_BCAST_CACHE_H
+
+#include <sys/types.h>
+
+#include "slurm/slurm.h"
+
+/*
+ * Copies of the files broadcast with a hash of their content (see
+ * bcast_hash_file()) are kept in BcastParameters=CacheDir, by default
+ * <SlurmdSpoolDir>/bcast_cache, so a later broadcast of the same content by
+ * the same user can be restored from it instead of being transferred again.
+ * The least recently used files are removed to keep the cache under
+ * BcastParameters=CacheSize.
+ */
+
+/* Read the cache configuration and create the cache directory */
+extern void bcast_cache_init(void);
+
+extern void bcast_cache_fini(void);
+
+/* RET true if BcastParameters=CacheSize is set */
+extern bool bcast_cache_enabled(void);
+
+/*
+ * Copy the cached file of user uid with hash into fd.
+ * RET SLURM_SUCCESS if the file was in the cache, SLURM_ERROR otherwise
+ */
+extern int bcast_cache_restore(uid_t uid, slurm_hash_t *hash, uint64_t size,
+			       int fd);
+
+/*
+ * Add a copy of the first size bytes of fd to the cache of user uid, if their
+ * content does match hash.
+ */
+extern void bcast_cache_add(uid_t uid, slurm_hash_t *hash, uint64_t size,
+			    int fd);
+
+#endif
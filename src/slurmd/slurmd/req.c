@@ -103,6 +103,7 @@
 
 #include "src/bcast/file_bcast.h"
 
+#include "src/slurmd/slurmd/bcast_cache.h"
 #include "src/slurmd/slurmd/get_mach_stat.h"
 #include "src/slurmd/slurmd/slurmd.h"
 
@@ -167,6 +168,7 @@ static int  _terminate_all_steps(uint32_t jobid, bool batch);
 static void _rpc_launch_tasks(slurm_msg_t *);
 static void _rpc_abort_job(slurm_msg_t *);
 static void _rpc_batch_job(slurm_msg_t *msg);
+static void _rpc_batch_job_multi(slurm_msg_t *msg);
 static void _rpc_prolog(slurm_msg_t *msg);
 static void _rpc_job_notify(slurm_msg_t *);
 static void _rpc_signal_tasks(slurm_msg_t *);
@@ -193,6 +195,7 @@ static void _rpc_acct_gather_update(slurm_msg_t *);
 static void _rpc_acct_gather_energy(slurm_msg_t *);
 static void _rpc_step_complete(slurm_msg_t *msg);
 static void _rpc_stat_jobacct(slurm_msg_t *msg);
+static void _rpc_step_io_relay(slurm_msg_t *msg);
 static void _rpc_list_pids(slurm_msg_t *msg);
 static void _rpc_daemon_status(slurm_msg_t *msg);
 static int _run_epilog(job_env_t *job_env, slurm_cred_t *cred);
@@ -309,6 +312,10 @@ slurmd_req(slurm_msg_t *msg)
 		_rpc_batch_job(msg);
 		last_slurmctld_msg = time(NULL);
 		break;
+	case REQUEST_BATCH_JOB_LAUNCH_MULTI:
+		_rpc_batch_job_multi(msg);
+		last_slurmctld_msg = time(NULL);
+		break;
 	case REQUEST_LAUNCH_TASKS:
 		_rpc_launch_tasks(msg);
 		break;
@@ -408,6 +415,9 @@ slurmd_req(slurm_msg_t *msg)
 	case REQUEST_NETWORK_CALLERID:
 		_rpc_network_callerid(msg);
 		break;
+	case REQUEST_STEP_IO_RELAY:
+		_rpc_step_io_relay(msg);
+		break;
 	default:
 		error("%s: invalid request msg type %d",
 		      __func__, msg->msg_type);
@@ -2438,20 +2448,21 @@ notify_result:
 	}
 }
 
-static void _rpc_batch_job(slurm_msg_t *msg)
+/*
+ * Validate a batch job launch request and fill in its user name and groups
+ * from the job credential.
+ * RET SLURM_SUCCESS if the job can be launched, otherwise the error to reply
+ */
+static int _batch_job_check(slurm_msg_t *msg)
 {
 	slurm_cred_arg_t *cred_arg;
-	batch_job_launch_msg_t *req = (batch_job_launch_msg_t *)msg->data;
-	bool     first_job_run;
-	int      rc = SLURM_SUCCESS, node_id = 0;
-	bool	 replied = false, revoked;
-	slurm_addr_t *cli = &msg->orig_addr;
+	batch_job_launch_msg_t *req = msg->data;
+	int rc;
 
 	if (!_slurm_authorized_user(msg->auth_uid)) {
 		error("Security violation, batch launch RPC from uid %u",
 		      msg->auth_uid);
-		rc = ESLURM_USER_ID_MISSING;  /* or bad in this case */
-		goto done;
+		return ESLURM_USER_ID_MISSING;  /* or bad in this case */
 	}
 
 	if (_launch_job_test(req->job_id, true)) {
@@ -2462,15 +2473,14 @@ static void _rpc_batch_job(slurm_msg_t *msg)
 		    (req->het_job_id && (req->het_job_id != NO_VAL)) ?
 		    req->het_job_id : req->job_id,
 		    rc);
-		goto done;
+		return rc;
 	}
 
 	slurm_cred_handle_reissue(conf->vctx, req->cred, false);
 	if (slurm_cred_revoked(conf->vctx, req->cred)) {
 		error("Job %u already killed, do not launch batch job",
 		      req->job_id);
-		rc = ESLURMD_CREDENTIAL_REVOKED;	/* job already ran */
-		goto done;
+		return ESLURMD_CREDENTIAL_REVOKED;	/* job already ran */
 	}
 
 	cred_arg = slurm_cred_get_args(req->cred);
@@ -2493,31 +2503,50 @@ static void _rpc_batch_job(slurm_msg_t *msg)
 
 	task_g_slurmd_batch_request(req);	/* determine task affinity */
 
-	slurm_mutex_lock(&prolog_mutex);
-	first_job_run = !slurm_cred_jobid_cached(conf->vctx, req->job_id);
+	return SLURM_SUCCESS;
+}
 
-	/* BlueGene prolog waits for partition boot and is very slow.
-	 * On any system we might need to load environment variables
-	 * for Moab (see --get-user-env), which could also be slow.
-	 * Just reply now and send a separate kill job request if the
-	 * prolog or launch fail. */
-	replied = true;
-	if (slurm_send_rc_msg(msg, rc) < 1) {
-		/* The slurmctld is no longer waiting for a reply.
-		 * This typically indicates that the slurmd was
-		 * blocked from memory and/or CPUs and the slurmctld
-		 * has requeued the batch job request. */
-		error("Could not confirm batch launch for job %u, "
-		      "aborting request", req->job_id);
-		rc = SLURM_COMMUNICATIONS_SEND_ERROR;
-		slurm_mutex_unlock(&prolog_mutex);
-		goto done;
+/*
+ * Tell slurmctld that a batch job already replied to could not be launched
+ */
+static void _batch_job_fail(batch_job_launch_msg_t *req, int rc)
+{
+	/* prolog or job launch failure,
+	 * tell slurmctld that the job failed */
+	_launch_job_fail(
+	    (req->het_job_id && (req->het_job_id != NO_VAL)) ?
+	    req->het_job_id : req->job_id,
+	    rc);
+
+	/*
+	 *  If job prolog failed or we could not reply,
+	 *  initiate message to slurmctld with current state
+	 */
+	if ((rc == ESLURMD_PROLOG_FAILED)
+	    || (rc == SLURM_COMMUNICATIONS_SEND_ERROR)
+	    || (rc == ESLURMD_SETUP_ENVIRONMENT_ERROR)) {
+		send_registration_msg(rc);
 	}
+}
+
+/*
+ * Run the prolog and start the slurmstepd of a batch job that passed
+ * _batch_job_check() and was replied to.
+ * Called with prolog_mutex locked, which is unlocked on return.
+ * IN first_job_run - job not in the credential context yet
+ * RET SLURM_SUCCESS or error code for _batch_job_fail()
+ */
+static int _batch_job_launch(slurm_msg_t *msg, bool first_job_run)
+{
+	batch_job_launch_msg_t *req = msg->data;
+	int      rc = SLURM_SUCCESS, node_id = 0;
+	bool	 revoked;
+	slurm_addr_t *cli = &msg->orig_addr;
 
 	rc = _wait_for_request_launch_prolog(req->job_id, &first_job_run);
 	if (rc != SLURM_SUCCESS) {
 		slurm_mutex_unlock(&prolog_mutex);
-		goto done;
+		return rc;
 	}
 
 	/*
@@ -2582,8 +2611,7 @@ static void _rpc_batch_job(slurm_msg_t *msg)
 				exit_status = WEXITSTATUS(rc);
 			error("[job %u] prolog failed status=%d:%d",
 			      req->job_id, exit_status, term_sig);
-			rc = ESLURMD_PROLOG_FAILED;
-			goto done;
+			return ESLURMD_PROLOG_FAILED;
 		}
 	} else {
 		slurm_mutex_unlock(&prolog_mutex);
@@ -2592,10 +2620,8 @@ static void _rpc_batch_job(slurm_msg_t *msg)
 
 	if (_get_user_env(req) < 0) {
 		bool requeue = _requeue_setup_env_fail();
-		if (requeue) {
-			rc = ESLURMD_SETUP_ENVIRONMENT_ERROR;
-			goto done;
-		}
+		if (requeue)
+			return ESLURMD_SETUP_ENVIRONMENT_ERROR;
 	}
 	_set_batch_job_limits(msg);
 
@@ -2606,16 +2632,15 @@ static void _rpc_batch_job(slurm_msg_t *msg)
 	if (slurm_cred_revoked(conf->vctx, req->cred)) {
 		info("Job %u already killed, do not launch batch job",
 		     req->job_id);
-		rc = SLURM_SUCCESS;     /* job already ran */
-		goto done;
+		return SLURM_SUCCESS;     /* job already ran */
 	}
 
 	info("Launching batch job %u for UID %u", req->job_id, req->uid);
 
-	debug3("_rpc_batch_job: call to _forkexec_slurmstepd");
+	debug3("%s: call to _forkexec_slurmstepd", __func__);
 	rc = _forkexec_slurmstepd(LAUNCH_BATCH_JOB, (void *)req, cli, NULL,
 				  NULL, SLURM_PROTOCOL_VERSION);
-	debug3("_rpc_batch_job: return from _forkexec_slurmstepd: %d", rc);
+	debug3("%s: return from _forkexec_slurmstepd: %d", __func__, rc);
 
 	_launch_complete_add(req->job_id, true);
 
@@ -2638,43 +2663,133 @@ static void _rpc_batch_job(slurm_msg_t *msg)
 		sleep(1);	/* give slurmstepd time to create
 				 * the communication socket */
 		_terminate_all_steps(req->job_id, true);
-		rc = ESLURMD_CREDENTIAL_REVOKED;
-		goto done;
+		return ESLURMD_CREDENTIAL_REVOKED;
 	}
 
-done:
-	if (!replied) {
-		if (slurm_send_rc_msg(msg, rc) < 1) {
-			/* The slurmctld is no longer waiting for a reply.
-			 * This typically indicates that the slurmd was
-			 * blocked from memory and/or CPUs and the slurmctld
-			 * has requeued the batch job request. */
-			error("Could not confirm batch launch for job %u, "
-			      "aborting request", req->job_id);
-			rc = SLURM_COMMUNICATIONS_SEND_ERROR;
-		} else {
-			/* No need to initiate separate reply below */
-			rc = SLURM_SUCCESS;
-		}
+	return rc;
+}
+
+static void _rpc_batch_job(slurm_msg_t *msg)
+{
+	batch_job_launch_msg_t *req = msg->data;
+	bool first_job_run = false;
+	int rc;
+
+	if ((rc = _batch_job_check(msg)) == SLURM_SUCCESS) {
+		slurm_mutex_lock(&prolog_mutex);
+		first_job_run = !slurm_cred_jobid_cached(conf->vctx,
+							 req->job_id);
 	}
-	if (rc != SLURM_SUCCESS) {
-		/* prolog or job launch failure,
-		 * tell slurmctld that the job failed */
-		_launch_job_fail(
-		    (req->het_job_id && (req->het_job_id != NO_VAL)) ?
-		    req->het_job_id : req->job_id,
-		    rc);
+
+	/* BlueGene prolog waits for partition boot and is very slow.
+	 * On any system we might need to load environment variables
+	 * for Moab (see --get-user-env), which could also be slow.
+	 * Just reply now and send a separate kill job request if the
+	 * prolog or launch fail. */
+	if (slurm_send_rc_msg(msg, rc) < 1) {
+		/* The slurmctld is no longer waiting for a reply.
+		 * This typically indicates that the slurmd was
+		 * blocked from memory and/or CPUs and the slurmctld
+		 * has requeued the batch job request. */
+		error("Could not confirm batch launch for job %u, "
+		      "aborting request", req->job_id);
+		if (rc == SLURM_SUCCESS)
+			slurm_mutex_unlock(&prolog_mutex);
+		_batch_job_fail(req, SLURM_COMMUNICATIONS_SEND_ERROR);
+		return;
 	}
+	if (rc != SLURM_SUCCESS)
+		return;
 
-	/*
-	 *  If job prolog failed or we could not reply,
-	 *  initiate message to slurmctld with current state
-	 */
-	if ((rc == ESLURMD_PROLOG_FAILED)
-	    || (rc == SLURM_COMMUNICATIONS_SEND_ERROR)
-	    || (rc == ESLURMD_SETUP_ENVIRONMENT_ERROR)) {
-		send_registration_msg(rc);
+	if ((rc = _batch_job_launch(msg, first_job_run)) != SLURM_SUCCESS)
+		_batch_job_fail(req, rc);
+}
+
+static void *_batch_job_multi_launch(void *arg)
+{
+	slurm_msg_t *msg = arg;
+	bool first_job_run;
+	int rc;
+
+	slurm_mutex_lock(&prolog_mutex);
+	first_job_run = !slurm_cred_jobid_cached(
+		conf->vctx, ((batch_job_launch_msg_t *) msg->data)->job_id);
+	if ((rc = _batch_job_launch(msg, first_job_run)) != SLURM_SUCCESS)
+		_batch_job_fail(msg->data, rc);
+
+	return NULL;
+}
+
+/*
+ * Launch several batch jobs sent together by slurmctld. Every job is checked
+ * and replied to in a single RESPONSE_BATCH_JOB_LAUNCH_MULTI, then launched
+ * by its own thread as with REQUEST_BATCH_JOB_LAUNCH.
+ */
+static void _rpc_batch_job_multi(slurm_msg_t *msg)
+{
+	batch_job_launch_multi_msg_t *req = msg->data;
+	batch_job_launch_multi_resp_msg_t resp = { 0 };
+	slurm_msg_t resp_msg, *job_msgs;
+	pthread_t *tids;
+	int launch_cnt = 0;
+
+	job_msgs = xcalloc(req->job_cnt, sizeof(*job_msgs));
+	tids = xcalloc(req->job_cnt, sizeof(*tids));
+	resp.job_cnt = req->job_cnt;
+	resp.job_ids = xcalloc(req->job_cnt, sizeof(uint32_t));
+	resp.return_codes = xcalloc(req->job_cnt, sizeof(uint32_t));
+
+	for (int i = 0; i < req->job_cnt; i++) {
+		slurm_msg_t_init(&job_msgs[i]);
+		job_msgs[i].msg_type = REQUEST_BATCH_JOB_LAUNCH;
+		job_msgs[i].protocol_version = msg->protocol_version;
+		job_msgs[i].auth_uid = msg->auth_uid;
+		job_msgs[i].auth_gid = msg->auth_gid;
+		job_msgs[i].auth_ids_set = msg->auth_ids_set;
+		job_msgs[i].address = msg->address;
+		job_msgs[i].orig_addr = msg->orig_addr;
+		job_msgs[i].data = req->launch_msgs[i];
+
+		resp.job_ids[i] = req->launch_msgs[i]->job_id;
+		resp.return_codes[i] = _batch_job_check(&job_msgs[i]);
+	}
+
+	/* Reply now, prologs and launch failures are reported per job */
+	response_init(&resp_msg, msg, RESPONSE_BATCH_JOB_LAUNCH_MULTI, &resp);
+	if (slurm_send_node_msg(msg->conn_fd, &resp_msg) < 1) {
+		error("Could not confirm batch launch for %u jobs, aborting request",
+		      req->job_cnt);
+		for (int i = 0; i < req->job_cnt; i++) {
+			batch_job_launch_msg_t *launch_msg =
+				req->launch_msgs[i];
+
+			if (resp.return_codes[i] != SLURM_SUCCESS)
+				continue;
+			_launch_job_fail(
+			    (launch_msg->het_job_id &&
+			     (launch_msg->het_job_id != NO_VAL)) ?
+			    launch_msg->het_job_id : launch_msg->job_id,
+			    SLURM_COMMUNICATIONS_SEND_ERROR);
+		}
+		send_registration_msg(SLURM_COMMUNICATIONS_SEND_ERROR);
+		goto fini;
 	}
+
+	for (int i = 0; i < req->job_cnt; i++) {
+		if (resp.return_codes[i] != SLURM_SUCCESS)
+			continue;
+		slurm_thread_create(&tids[launch_cnt], _batch_job_multi_launch,
+				    &job_msgs[i]);
+		launch_cnt++;
+	}
+	for (int i = 0; i < launch_cnt; i++)
+		pthread_join(tids[i], NULL);
+
+fini:
+	xfree(job_msgs);
+	xfree(tids);
+	xfree(resp.job_ids);
+	xfree(resp.return_codes);
 }
 
 /*
@@ -3744,6 +3859,59 @@ static void _rpc_stat_jobacct(slurm_msg_t *msg)
 	slurm_free_job_step_stat(resp);
 }
 
+/*
+ * The slurmstepd of a child node in the stdio tree of a step asks for the
+ * step here to relay its stdio (LaunchParameters=stdio_tree). The connection
+ * is handed over to the step, which reads the io init message sent right
+ * after this request. It comes from the child with the privileges of the job
+ * user dropped.
+ */
+static void _rpc_step_io_relay(slurm_msg_t *msg)
+{
+	slurm_step_id_t *req = msg->data;
+	uint16_t protocol_version;
+	int fd, rc;
+	uid_t uid;
+
+	/*
+	 * The child sends its io init message right after the request, do not
+	 * tie up the slurmstepd with a connection which does not. The
+	 * slurmstepd reads it with a timeout as well.
+	 */
+	if (wait_fd_readable(msg->conn_fd, slurm_conf.msg_timeout)) {
+		error("%s: no io init message for %ps", __func__, req);
+		slurm_send_rc_msg(msg, ESLURMD_IO_ERROR);
+		return;
+	}
+
+	fd = stepd_connect(conf->spooldir, conf->node_name,
+			   req, &protocol_version);
+	if (fd == -1) {
+		debug("%s: stepd_connect to %ps failed: %m", __func__, req);
+		slurm_send_rc_msg(msg, ESLURM_INVALID_JOB_ID);
+		return;
+	}
+
+	if ((uid = stepd_get_uid(fd, protocol_version)) == INFINITE) {
+		debug("%s: couldn't read from %ps: %m", __func__, req);
+		rc = ESLURM_INVALID_JOB_ID;
+	} else if ((msg->auth_uid != uid) &&
+		   !_slurm_authorized_user(msg->auth_uid)) {
+		error("%s: uid %u can not relay stdio of %ps owned by uid %u",
+		      __func__, msg->auth_uid, req, uid);
+		rc = ESLURM_USER_ID_MISSING;
+	} else if (!(rc = stepd_relay_io(fd, protocol_version, msg->conn_fd,
+					 msg->protocol_version,
+					 msg->auth_uid))) {
+		/* The slurmstepd answered, it may already relay stdin */
+		close(fd);
+		return;
+	}
+	close(fd);
+
+	slurm_send_rc_msg(msg, rc);
+}
+
 static int
 _callerid_find_job(callerid_conn_t conn, uint32_t *job_id)
 {
@@ -4210,7 +4378,7 @@ void file_bcast_init(void)
 	/* skip locks during slurmd init */
 	file_bcast_list = list_create(_free_file_bcast_info_t);
 	bcast_libdir_list = list_create(_free_libdir_rec_t);
-
+	bcast_cache_init();
 }
 
 void file_bcast_purge(void)
@@ -4218,13 +4386,54 @@ void file_bcast_purge(void)
 	slurm_rwlock_wrlock(&file_bcast_lock);
 	FREE_NULL_LIST(file_bcast_list);
 	FREE_NULL_LIST(bcast_libdir_list);
+	bcast_cache_fini();
 	/* destroying list before exit, no need to unlock */
 }
 
-static void _rpc_file_bcast(slurm_msg_t *msg)
+/*
+ * Decompress and write the data of a block of a registered file.
+ * Must have read lock.
+ */
+static int _file_bcast_write_block(file_bcast_info_t *file_info,
+				   file_bcast_msg_t *req,
+				   file_bcast_info_t *key)
 {
-	int rc = SLURM_SUCCESS;
 	int64_t offset, inx;
+
+	/* now decompress file */
+	if (bcast_decompress_data(req) < 0) {
+		error("sbcast: data decompression error for UID %u, file %s",
+		      key->uid, key->fname);
+		return SLURM_ERROR;
+	}
+
+	/*
+	 * Blocks may arrive in any order and concurrently when sbcast keeps
+	 * several of them in flight, so write each one at its own offset and
+	 * finish the file once all of its bytes have been written.
+	 */
+	offset = 0;
+	while (req->block_len - offset) {
+		inx = pwrite(file_info->fd, &req->block[offset],
+			     (req->block_len - offset),
+			     (req->block_offset + offset));
+		if (inx == -1) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			error("sbcast: uid:%u can't write `%s`: %m",
+			      key->uid, key->fname);
+			return SLURM_ERROR;
+		}
+		offset += inx;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+static void _rpc_file_bcast(slurm_msg_t *msg)
+{
+	int rc = SLURM_SUCCESS, cache_fd = -1;
+	bool last_block, cached = false;
 	sbcast_cred_arg_t *cred_arg;
 	file_bcast_info_t *file_info;
 	file_bcast_msg_t *req = msg->data;
@@ -4327,44 +4536,32 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 		goto done;
 	}
 
-	/* now decompress file */
-	if (bcast_decompress_data(req) < 0) {
-		error("sbcast: data decompression error for UID %u, file %s",
-		      key.uid, key.fname);
+	if ((req->block_no == 1) &&
+	    !bcast_cache_restore(key.uid, &req->file_hash, req->file_size,
+				 file_info->fd)) {
+		/* Nothing else will be sent to this node */
+		file_info->received_size = file_info->file_size;
+		last_block = cached = true;
+	} else if ((rc = _file_bcast_write_block(file_info, req, &key))) {
 		slurm_rwlock_unlock(&file_bcast_lock);
-		rc = SLURM_ERROR;
 		goto done;
+	} else {
+		last_block = (__atomic_add_fetch(&file_info->received_size,
+						 req->block_len,
+						 __ATOMIC_ACQ_REL) ==
+			      file_info->file_size);
 	}
-
-	offset = 0;
-	while (req->block_len - offset) {
-		inx = write(file_info->fd, &req->block[offset],
-			    (req->block_len - offset));
-		if (inx == -1) {
-			if ((errno == EINTR) || (errno == EAGAIN))
-				continue;
-			error("sbcast: uid:%u can't write `%s`: %m",
-			      key.uid, key.fname);
-			slurm_rwlock_unlock(&file_bcast_lock);
-			rc = SLURM_ERROR;
-			goto done;
-		}
-		offset += inx;
-	}
-
 	file_info->last_update = time(NULL);
 
-	if ((req->flags & FILE_BCAST_LAST_BLOCK) &&
-	    fchmod(file_info->fd, (req->modes & 0777))) {
+	if (last_block && fchmod(file_info->fd, (req->modes & 0777))) {
 		error("sbcast: uid:%u can't chmod `%s`: %m",
 		      key.uid, key.fname);
 	}
-	if ((req->flags & FILE_BCAST_LAST_BLOCK) &&
-	    fchown(file_info->fd, key.uid, key.gid)) {
+	if (last_block && fchown(file_info->fd, key.uid, key.gid)) {
 		error("sbcast: uid:%u gid:%u can't chown `%s`: %m",
 		      key.uid, key.gid, key.fname);
 	}
-	if ((req->flags & FILE_BCAST_LAST_BLOCK) && req->atime) {
+	if (last_block && req->atime) {
 		struct utimbuf time_buf;
 		time_buf.actime  = req->atime;
 		time_buf.modtime = req->mtime;
@@ -4374,14 +4571,29 @@ static void _rpc_file_bcast(slurm_msg_t *msg)
 		}
 	}
 
+	/* The file descriptor is closed with the transfer */
+	if (last_block && !cached && bcast_cache_enabled() &&
+	    (req->file_hash.type == HASH_PLUGIN_K12) &&
+	    ((cache_fd = dup(file_info->fd)) < 0))
+		error("sbcast: uid:%u can't dup `%s` to cache it: %m",
+		      key.uid, key.fname);
+
 	slurm_rwlock_unlock(&file_bcast_lock);
 
-	if (req->flags & FILE_BCAST_LAST_BLOCK) {
+	if (last_block) {
 		_file_bcast_close_file(&key);
 	}
 
+	if (cached)
+		rc = ESLURMD_FILE_BCAST_CACHED;
 done:
 	slurm_send_rc_msg(msg, rc);
+
+	if (cache_fd >= 0) {
+		bcast_cache_add(key.uid, &req->file_hash, req->file_size,
+				cache_fd);
+		close(cache_fd);
+	}
 }
 
 static int _file_bcast_register_file(slurm_msg_t *msg,
@@ -4401,7 +4613,8 @@ static int _file_bcast_register_file(slurm_msg_t *msg,
 						     &cred_arg->gids);
 	force_opt = req->flags & FILE_BCAST_FORCE;
 
-	flags = O_WRONLY | O_CREAT;
+	/* The broadcast cache reads the file back once complete */
+	flags = (bcast_cache_enabled() ? O_RDWR : O_WRONLY) | O_CREAT;
 	if (force_opt)
 		flags |= O_TRUNC;
 	else
@@ -4450,6 +4663,7 @@ static int _file_bcast_register_file(slurm_msg_t *msg,
 	file_info->uid = key->uid;
 	file_info->gid = key->gid;
 	file_info->job_id = key->job_id;
+	file_info->file_size = req->file_size;
 	file_info->last_update = file_info->start_time = time(NULL);
 
 	//TODO: mmap the file here
@@ -50,29 +50,37 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <poll.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <unistd.h>
 
 #include "src/common/cbuf.h"
 #include "src/common/eio.h"
 #include "src/common/fd.h"
+#include "src/common/hostlist.h"
+#include "src/common/id_hash.h"
 #include "src/common/io_hdr.h"
 #include "src/common/list.h"
 #include "src/common/log.h"
 #include "src/common/macros.h"
 #include "src/common/net.h"
 #include "src/common/read_config.h"
+#include "src/common/reverse_tree.h"
 #include "src/common/write_labelled_message.h"
 #include "src/common/xmalloc.h"
 #include "src/common/xsignal.h"
 #include "src/common/xstring.h"
 
+#include "src/interfaces/auth.h"
+
 #include "src/slurmd/common/fname.h"
 #include "src/slurmd/slurmd/slurmd.h"
 #include "src/slurmd/slurmstepd/io.h"
@@ -118,6 +126,12 @@ struct client_io_info {
 
 	/* true if writing to a file, false if writing to a socket */
 	bool is_local_file;
+
+	/* largest message body the client accepts */
+	uint32_t max_msg_len;
+
+	/* true if the stdio of relayed child nodes goes to this client */
+	bool relays;
 };
 
 
@@ -176,6 +190,77 @@ struct task_read_info {
 	bool		 eof_msg_sent;
 };
 
+/**********************************************************************
+ * Relay declarations (LaunchParameters=stdio_tree)
+ **********************************************************************/
+static bool _relay_readable(eio_obj_t *);
+static bool _relay_writable(eio_obj_t *);
+static int  _relay_read(eio_obj_t *, List);
+static int  _relay_write(eio_obj_t *, List);
+static int  _relay_enqueue_stdin(void *x, void *arg);
+static void _relay_release_missing(stepd_step_rec_t *step);
+
+struct io_operations relay_ops = {
+	.readable = &_relay_readable,
+	.writable = &_relay_writable,
+	.handle_read = &_relay_read,
+	.handle_write = &_relay_write,
+};
+
+#define RELAY_IO_MAGIC 0x10104
+struct relay_io_info {
+	int              magic;
+	stepd_step_rec_t *step; /* pointer back to step data */
+
+	/* the child node, announced to srun by the first read */
+	io_relay_init_t init;
+	bool announced;
+	/* gtids of the tasks of the child and of its own children */
+	uint32_t *gtids;
+	uint32_t gtid_cnt;
+
+	/* incoming variables, messages relayed upstream as they are */
+	io_hdr_t header;
+	struct io_buf *in_msg;
+	int32_t in_remaining;
+	bool in_eof;
+	/* output streams of the child and its children not closed yet */
+	int stdout_objs;
+	int stderr_objs;
+
+	/* outgoing variables, stdin for the child */
+	List msg_queue;
+	struct io_buf *out_msg;
+	buf_t *out_hdr;
+	int32_t out_remaining;
+	bool out_eof;
+};
+
+/*
+ * With LaunchParameters=stdio_tree the slurmstepd of each node connects to
+ * the slurmstepd of its parent in the reverse tree rooted at srun, rather
+ * than to srun itself, and relays the stdio of its children. The initial
+ * connection of each node counts one extra stdout stream for each of its
+ * direct children, srun closes one of them for each SLURM_IO_RELAY_INIT it
+ * gets and we send an eof for the children which never showed up.
+ *
+ * Only the IO thread uses the variables below, except for the ones under
+ * relay_lock which are shared with io_relay_add() and io_close_all().
+ */
+static bool stdio_tree = false;
+static int relay_parent = -1;		/* nodeid of our parent, -1 for srun */
+static int relay_expected = 0;		/* number of direct children */
+static int relay_announced = 0;		/* children announced to srun */
+static id_hash_t *relay_gtids = NULL;	/* gtid -> relay eio_obj_t */
+static List relay_objs = NULL;		/* announced relay eio_obj_t's */
+
+static pthread_mutex_t relay_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t relay_cond = PTHREAD_COND_INITIALIZER;
+static int relay_accepted = 0;		/* children connected */
+static int relay_active = 0;		/* children connected, not done yet */
+static bool relay_closed = false;	/* no more children accepted */
+static bool relay_shutdown = false;	/* IO shutdown waiting on children */
+
 /**********************************************************************
  * Pseudo terminal declarations
  **********************************************************************/
@@ -206,8 +291,133 @@ static void _free_all_outgoing_msgs(List msg_queue, stepd_step_rec_t *step);
 static bool _incoming_buf_free(stepd_step_rec_t *step);
 static bool _outgoing_buf_free(stepd_step_rec_t *step);
 static int  _send_connection_okay_response(stepd_step_rec_t *step);
+
+/*
+ * Largest stdout/stderr message body built from task output, and the number
+ * of outgoing message buffers it is allowed to use.
+ */
+static uint32_t io_msg_len = MAX_MSG_LEN;
+static int max_outgoing_bufs = STDIO_MAX_FREE_BUF;
 static struct io_buf *_build_connection_okay_message(stepd_step_rec_t *step);
 
+/* RET largest message body a client at protocol_version accepts */
+static uint32_t _client_max_msg_len(uint16_t protocol_version)
+{
+	if (protocol_version >= SLURM_23_11_PROTOCOL_VERSION)
+		return MAX_IO_MSG_LEN;
+	return MAX_MSG_LEN;
+}
+
+static void _set_io_msg_len(uint32_t msg_len)
+{
+	io_msg_len = msg_len;
+	max_outgoing_bufs = MAX(STDIO_MAX_FREE_BUF * MAX_MSG_LEN / msg_len,
+				STDIO_MAX_MSG_CACHE * 2);
+}
+
+/*
+ * Use LaunchParameters=stdio_msg_size for the task output messages, unless
+ * one of the sruns of the step can not receive messages that large.
+ */
+static void _init_io_msg_len(stepd_step_rec_t *step)
+{
+	char *tmp_ptr;
+	uint32_t msg_len = MAX_MSG_LEN;
+	list_itr_t *itr;
+	srun_info_t *srun;
+
+	if ((tmp_ptr = conf_get_opt_str(slurm_conf.launch_params,
+					"stdio_msg_size="))) {
+		unsigned long val = strtoul(tmp_ptr, NULL, 10);
+
+		if ((val < MAX_MSG_LEN) || (val > MAX_IO_MSG_LEN)) {
+			error("Invalid LaunchParameters=stdio_msg_size=%s, must be between %u and %u",
+			      tmp_ptr, MAX_MSG_LEN, MAX_IO_MSG_LEN);
+			val = MIN(MAX(val, MAX_MSG_LEN), MAX_IO_MSG_LEN);
+		}
+		msg_len = val;
+		xfree(tmp_ptr);
+	}
+
+	itr = list_iterator_create(step->sruns);
+	while ((srun = list_next(itr)))
+		msg_len = MIN(msg_len,
+			      _client_max_msg_len(srun->protocol_version));
+	list_iterator_destroy(itr);
+
+	_set_io_msg_len(msg_len);
+	debug2("%s: stdio message size is %u", __func__, io_msg_len);
+}
+
+/* RET nodeid of the parent of nodeid in the stdio tree, -1 for srun */
+static int _relay_parent_of(stepd_step_rec_t *step, uint32_t nodeid)
+{
+	int parent, children, depth, max_depth;
+
+	reverse_tree_info(nodeid + 1, step->nnodes + 1, slurm_conf.tree_width,
+			  &parent, &children, &depth, &max_depth);
+	if (parent <= 0)
+		return -1;
+	return parent - 1;
+}
+
+/*
+ * Relay the stdio of the step up the reverse tree with
+ * LaunchParameters=stdio_tree, if every srun of the step understands
+ * SLURM_IO_RELAY_INIT. srun is rank 0 of the tree, each node its nodeid + 1.
+ */
+static void _init_io_relay(stepd_step_rec_t *step)
+{
+#ifndef HAVE_FRONT_END
+	int parent, children, depth, max_depth, *ranks;
+	list_itr_t *itr;
+	srun_info_t *srun;
+
+	if (!xstrcasestr(slurm_conf.launch_params, "stdio_tree") ||
+	    step->batch || !step->msg || (step->nnodes < 2) ||
+	    (step->step_id.step_het_comp != NO_VAL) ||
+	    (step->flags & LAUNCH_PTY))
+		return;
+
+	if (!(srun = list_peek(step->sruns)) ||
+	    (!slurm_addr_is_unspec(&srun->ioaddr) &&
+	     (slurm_get_port(&srun->ioaddr) == 0)))
+		return;
+
+	itr = list_iterator_create(step->sruns);
+	while ((srun = list_next(itr))) {
+		if (srun->protocol_version < SLURM_23_11_PROTOCOL_VERSION)
+			break;
+	}
+	list_iterator_destroy(itr);
+	if (srun) {
+		debug("%s: srun too old for stdio_tree", __func__);
+		return;
+	}
+
+	reverse_tree_info(step->nodeid + 1, step->nnodes + 1,
+			  slurm_conf.tree_width, &parent, &children, &depth,
+			  &max_depth);
+	ranks = xcalloc(slurm_conf.tree_width, sizeof(*ranks));
+	relay_expected = reverse_tree_direct_children(step->nodeid + 1,
+						      step->nnodes + 1,
+						      slurm_conf.tree_width,
+						      depth, ranks);
+	xfree(ranks);
+	relay_parent = _relay_parent_of(step, step->nodeid);
+
+	/* TreeWidth larger than the step, every node talks to srun */
+	if ((relay_parent < 0) && !relay_expected)
+		return;
+
+	stdio_tree = true;
+	relay_gtids = id_hash_create(step->ntasks);
+	relay_objs = list_create(NULL);
+	debug("%s: stdio relayed through node %d, relaying %d nodes",
+	      __func__, relay_parent, relay_expected);
+#endif
+}
+
 /**********************************************************************
  * IO client socket functions
  **********************************************************************/
@@ -219,6 +429,9 @@ _client_readable(eio_obj_t *obj)
 	debug5("Called _client_readable");
 	xassert(client->magic == CLIENT_IO_MAGIC);
 
+	if (client->relays && obj->shutdown)
+		_relay_release_missing(client->step);
+
 	if (client->in_eof) {
 		debug5("  false, in_eof");
 		/* We no longer want the _client_read() function to handle
@@ -268,6 +481,12 @@ _client_writable(eio_obj_t *obj)
 		client->msg_queue = list_create(NULL); /* need destructor */
 		msgs = list_iterator_create(client->step->outgoing_cache);
 		while ((msg = list_next(msgs))) {
+			if ((msg->length - io_hdr_packed_size()) >
+			    client->max_msg_len) {
+				debug("%s: skipping cached message of %u bytes too large for new client",
+				      __func__, msg->length);
+				continue;
+			}
 			msg->ref_count++;
 			list_enqueue(client->msg_queue, msg);
 		}
@@ -397,6 +616,7 @@ _client_read(eio_obj_t *obj, List objs)
 		struct task_write_info *io;
 
 		client->in_msg->ref_count = 0;
+		client->in_msg->header = client->header;
 		if (client->header.type == SLURM_IO_ALLSTDIN) {
 			for (i = 0; i < client->step->node_tasks; i++) {
 				task = client->step->task[i];
@@ -404,8 +624,13 @@ _client_read(eio_obj_t *obj, List objs)
 				client->in_msg->ref_count++;
 				list_enqueue(io->msg_queue, client->in_msg);
 			}
+			if (relay_objs)
+				list_for_each(relay_objs, _relay_enqueue_stdin,
+					      client->in_msg);
 			debug5("  message ref_count = %d", client->in_msg->ref_count);
 		} else {
+			eio_obj_t *relay;
+
 			for (i = 0; i < client->step->node_tasks; i++) {
 				task = client->step->task[i];
 				if (task->in == NULL)
@@ -417,6 +642,11 @@ _client_read(eio_obj_t *obj, List objs)
 				list_enqueue(io->msg_queue, client->in_msg);
 				break;
 			}
+			/* Not a local task, maybe one of a relayed node */
+			if (!client->in_msg->ref_count && relay_gtids &&
+			    (relay = id_hash_find(relay_gtids,
+						  client->header.gtaskid)))
+				_relay_enqueue_stdin(relay, client->in_msg);
 		}
 	}
 	client->in_msg = NULL;
@@ -490,6 +720,428 @@ again:
 }
 
 
+/**********************************************************************
+ * Relay functions (LaunchParameters=stdio_tree)
+ **********************************************************************/
+/* Make room for a message body of len bytes in msg */
+static void _io_buf_reserve(struct io_buf *msg, uint32_t len)
+{
+	if (len <= msg->size)
+		return;
+	xrealloc_nz(msg->data, len + io_hdr_packed_size() + 1);
+	msg->size = len;
+}
+
+/* Pack header at the start of msg->data */
+static void _io_buf_pack_hdr(struct io_buf *msg, io_hdr_t *header)
+{
+	buf_t *packbuf = create_buf(msg->data, io_hdr_packed_size());
+
+	io_hdr_pack(header, packbuf);
+	msg->length = io_hdr_packed_size() + header->length;
+
+	/* free packbuf, but not the memory to which it points */
+	packbuf->head = NULL;
+	FREE_NULL_BUFFER(packbuf);
+}
+
+/* Queue a message for the clients taking the output of relayed nodes */
+static void _relay_forward(stepd_step_rec_t *step, struct io_buf *msg)
+{
+	struct client_io_info *client;
+	list_itr_t *clients;
+	eio_obj_t *eio;
+
+	msg->ref_count = 0;
+	clients = list_iterator_create(step->clients);
+	while ((eio = list_next(clients))) {
+		client = eio->arg;
+		xassert(client->magic == CLIENT_IO_MAGIC);
+		if (!client->relays || client->out_eof)
+			continue;
+		list_enqueue(client->msg_queue, msg);
+		msg->ref_count++;
+	}
+	list_iterator_destroy(clients);
+
+	if (!msg->ref_count)
+		list_enqueue(step->free_outgoing, msg);
+}
+
+/* Send cnt eof messages of type upstream, for streams closed on our side */
+static void _relay_send_eofs(stepd_step_rec_t *step, uint16_t type, int cnt)
+{
+	io_hdr_t header = { .type = type };
+	struct io_buf *msg;
+
+	for (int i = 0; i < cnt; i++) {
+		/* Allowed to allocate, as for _send_eof_msg() */
+		if (_outgoing_buf_free(step))
+			msg = list_dequeue(step->free_outgoing);
+		else
+			msg = alloc_io_buf();
+		_io_buf_pack_hdr(msg, &header);
+		_relay_forward(step, msg);
+	}
+}
+
+/*
+ * Release the extra stdout stream counted for each child which never
+ * connected, once we are shutting down and no more children are accepted.
+ */
+static void _relay_release_missing(stepd_step_rec_t *step)
+{
+	int missing = relay_expected - relay_announced;
+
+	if (missing <= 0)
+		return;
+
+	debug("%s: %d child nodes did not relay their stdio through us",
+	      __func__, missing);
+	_relay_send_eofs(step, SLURM_IO_STDOUT, missing);
+	relay_announced = relay_expected;
+}
+
+static void _relay_add_gtids(eio_obj_t *obj, uint32_t *gtids, uint32_t cnt)
+{
+	struct relay_io_info *relay = obj->arg;
+
+	xrecalloc(relay->gtids, relay->gtid_cnt + cnt, sizeof(*relay->gtids));
+	for (int i = 0; i < cnt; i++) {
+		relay->gtids[relay->gtid_cnt++] = gtids[i];
+		id_hash_add(relay_gtids, gtids[i], obj);
+	}
+}
+
+/* Tell srun about the child node, and route the stdin of its tasks to it */
+static void _relay_announce(eio_obj_t *obj)
+{
+	struct relay_io_info *relay = obj->arg;
+	io_hdr_t header = { .type = SLURM_IO_RELAY_INIT };
+	struct io_buf *msg;
+	buf_t *body;
+
+	body = init_buf(BUF_SIZE);
+	io_relay_init_pack(&relay->init, body);
+	header.length = get_buf_offset(body);
+
+	/* Allowed to allocate, as for _send_eof_msg() */
+	if (_outgoing_buf_free(relay->step))
+		msg = list_dequeue(relay->step->free_outgoing);
+	else
+		msg = alloc_io_buf();
+	_io_buf_reserve(msg, header.length);
+	_io_buf_pack_hdr(msg, &header);
+	memcpy(msg->data + io_hdr_packed_size(), get_buf_data(body),
+	       header.length);
+	FREE_NULL_BUFFER(body);
+	_relay_forward(relay->step, msg);
+
+	_relay_add_gtids(obj, relay->init.gtids, relay->init.ntasks);
+	list_append(relay_objs, obj);
+	relay->announced = true;
+	relay_announced++;
+}
+
+/* A child is done, the last one lets io_close_all() shut down */
+static void _relay_done(stepd_step_rec_t *step)
+{
+	bool shutdown = false;
+
+	slurm_mutex_lock(&relay_lock);
+	relay_active--;
+	if (!relay_active && relay_shutdown) {
+		relay_shutdown = false;
+		shutdown = true;
+	}
+	slurm_mutex_unlock(&relay_lock);
+
+	/* io_close_all() was waiting on us */
+	if (shutdown)
+		eio_signal_shutdown(step->eio);
+}
+
+/*
+ * The child is gone, close the streams it left open so srun does not wait on
+ * them forever.
+ */
+static void _relay_close(eio_obj_t *obj)
+{
+	struct relay_io_info *relay = obj->arg;
+	stepd_step_rec_t *step = relay->step;
+
+	if (relay->in_eof)
+		return;
+	relay->in_eof = true;
+	relay->out_eof = true;
+
+	if (relay->in_msg) {
+		list_enqueue(step->free_outgoing, relay->in_msg);
+		relay->in_msg = NULL;
+	}
+	if (relay->out_msg) {
+		_free_incoming_msg(relay->out_msg, step);
+		relay->out_msg = NULL;
+	}
+	while ((relay->out_msg = list_dequeue(relay->msg_queue)))
+		_free_incoming_msg(relay->out_msg, step);
+
+	if (relay->announced) {
+		if ((relay->stdout_objs > 0) || (relay->stderr_objs > 0))
+			error("%s: node %u closed its stdio connection with %d stdout and %d stderr streams open",
+			      __func__, relay->init.nodeid,
+			      relay->stdout_objs, relay->stderr_objs);
+		_relay_send_eofs(step, SLURM_IO_STDOUT, relay->stdout_objs);
+		_relay_send_eofs(step, SLURM_IO_STDERR, relay->stderr_objs);
+		for (int i = 0; i < relay->gtid_cnt; i++)
+			id_hash_remove(relay_gtids, relay->gtids[i], obj);
+		list_delete_ptr(relay_objs, obj);
+	}
+	debug("%s: done relaying stdio of node %u",
+	      __func__, relay->init.nodeid);
+
+	close(obj->fd);
+	obj->fd = -1;
+
+	_relay_done(step);
+}
+
+/* RET largest body of a message of type a child may send */
+static uint32_t _relay_max_len(stepd_step_rec_t *step, uint16_t type)
+{
+	if (type == SLURM_IO_RELAY_INIT)
+		return (4 + step->ntasks) * sizeof(uint32_t);
+	return MAX_IO_MSG_LEN;
+}
+
+/* Handle a complete message from the child, then send it upstream */
+static void _relay_route(eio_obj_t *obj, struct io_buf *msg)
+{
+	struct relay_io_info *relay = obj->arg;
+	io_relay_init_t init = { 0 };
+	buf_t *buffer;
+	int rc;
+
+	switch (relay->header.type) {
+	case SLURM_IO_STDOUT:
+		if (!relay->header.length)
+			relay->stdout_objs--;
+		break;
+	case SLURM_IO_STDERR:
+		if (!relay->header.length)
+			relay->stderr_objs--;
+		break;
+	case SLURM_IO_RELAY_INIT:
+		/* A grandchild, srun closes the stream counted for it */
+		buffer = create_buf(msg->data + io_hdr_packed_size(),
+				    relay->header.length);
+		rc = io_relay_init_unpack(&init, buffer);
+		buffer->head = NULL;
+		FREE_NULL_BUFFER(buffer);
+		if (rc != SLURM_SUCCESS) {
+			list_enqueue(relay->step->free_outgoing, msg);
+			_relay_close(obj);
+			return;
+		}
+		relay->stdout_objs += init.stdout_objs - 1;
+		relay->stderr_objs += init.stderr_objs;
+		_relay_add_gtids(obj, init.gtids, init.ntasks);
+		io_relay_init_free_members(&init);
+		break;
+	default:
+		error("%s: invalid message type %hu from node %u",
+		      __func__, relay->header.type, relay->init.nodeid);
+		list_enqueue(relay->step->free_outgoing, msg);
+		return;
+	}
+
+	_relay_forward(relay->step, msg);
+}
+
+static bool _relay_readable(eio_obj_t *obj)
+{
+	struct relay_io_info *relay = obj->arg;
+
+	xassert(relay->magic == RELAY_IO_MAGIC);
+
+	/*
+	 * obj->shutdown is ignored, the child tells us when its stdio is done
+	 * by closing the connection.
+	 */
+	if (relay->in_eof)
+		return false;
+
+	/*
+	 * Announce the child as soon as it is added rather than on its first
+	 * message: srun holds stdin until every node is announced and the
+	 * child may have nothing to send before its tasks get stdin. The
+	 * clients were possibly set up already in this pass, wake the loop
+	 * up so they send it.
+	 */
+	if (!relay->announced) {
+		_relay_announce(obj);
+		eio_signal_wakeup(relay->step->eio);
+	}
+
+	return (relay->in_msg || _outgoing_buf_free(relay->step));
+}
+
+static int _relay_read(eio_obj_t *obj, List objs)
+{
+	struct relay_io_info *relay = obj->arg;
+	stepd_step_rec_t *step = relay->step;
+	struct io_buf *msg;
+	void *buf;
+	int n;
+
+	xassert(relay->magic == RELAY_IO_MAGIC);
+
+	/*
+	 * Read the header, if a message read is not already in progress
+	 */
+	if (!relay->in_msg) {
+		if (!_outgoing_buf_free(step))
+			return SLURM_SUCCESS;
+		relay->in_msg = list_dequeue(step->free_outgoing);
+
+		n = io_hdr_read_fd(obj->fd, &relay->header);
+		if (n <= 0) {
+			_relay_close(obj);
+			return SLURM_SUCCESS;
+		}
+		if (relay->header.length > _relay_max_len(step,
+							  relay->header.type)) {
+			error("%s: message length %u from node %u exceeds maximum",
+			      __func__, relay->header.length,
+			      relay->init.nodeid);
+			_relay_close(obj);
+			return SLURM_SUCCESS;
+		}
+		_io_buf_reserve(relay->in_msg, relay->header.length);
+		_io_buf_pack_hdr(relay->in_msg, &relay->header);
+		relay->in_remaining = relay->header.length;
+	}
+
+	/*
+	 * Read the body
+	 */
+	if (relay->in_remaining) {
+		buf = relay->in_msg->data +
+			(relay->in_msg->length - relay->in_remaining);
+	again:
+		if ((n = read(obj->fd, buf, relay->in_remaining)) < 0) {
+			if (errno == EINTR)
+				goto again;
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+				return SLURM_SUCCESS;
+			debug("%s: read from node %u: %m",
+			      __func__, relay->init.nodeid);
+		}
+		if (n <= 0) {
+			_relay_close(obj);
+			return SLURM_SUCCESS;
+		}
+		relay->in_remaining -= n;
+		if (relay->in_remaining > 0)
+			return SLURM_SUCCESS;
+	}
+
+	msg = relay->in_msg;
+	relay->in_msg = NULL;
+	_relay_route(obj, msg);
+
+	return SLURM_SUCCESS;
+}
+
+static bool _relay_writable(eio_obj_t *obj)
+{
+	struct relay_io_info *relay = obj->arg;
+
+	xassert(relay->magic == RELAY_IO_MAGIC);
+
+	if (relay->out_eof)
+		return false;
+
+	return (relay->out_msg || !list_is_empty(relay->msg_queue));
+}
+
+/*
+ * Write stdin messages to the child. Their header is packed here as the
+ * message data only holds the body, see _client_read().
+ */
+static int _relay_write(eio_obj_t *obj, List objs)
+{
+	struct relay_io_info *relay = obj->arg;
+	uint32_t hdr_len = io_hdr_packed_size();
+	struct iovec iov[2];
+	uint32_t offset;
+	int iovcnt = 0;
+	ssize_t n;
+
+	xassert(relay->magic == RELAY_IO_MAGIC);
+
+	if (!relay->out_msg) {
+		io_hdr_t header;
+
+		if (!(relay->out_msg = list_dequeue(relay->msg_queue)))
+			return SLURM_SUCCESS;
+		header = relay->out_msg->header;
+		header.length = relay->out_msg->length;
+		set_buf_offset(relay->out_hdr, 0);
+		io_hdr_pack(&header, relay->out_hdr);
+		relay->out_remaining = hdr_len + relay->out_msg->length;
+	}
+
+	offset = hdr_len + relay->out_msg->length - relay->out_remaining;
+	if (offset < hdr_len) {
+		iov[iovcnt].iov_base = get_buf_data(relay->out_hdr) + offset;
+		iov[iovcnt].iov_len = hdr_len - offset;
+		iovcnt++;
+		offset = hdr_len;
+	}
+	if (relay->out_msg->length) {
+		iov[iovcnt].iov_base = relay->out_msg->data + offset - hdr_len;
+		iov[iovcnt].iov_len = hdr_len + relay->out_msg->length - offset;
+		iovcnt++;
+	}
+
+again:
+	if ((n = writev(obj->fd, iov, iovcnt)) < 0) {
+		if (errno == EINTR)
+			goto again;
+		if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+			return SLURM_SUCCESS;
+		debug("%s: write to node %u: %m",
+		      __func__, relay->init.nodeid);
+		/* The read side notices the child is gone and cleans up */
+		relay->out_eof = true;
+		return SLURM_SUCCESS;
+	}
+
+	relay->out_remaining -= n;
+	if (relay->out_remaining > 0)
+		return SLURM_SUCCESS;
+
+	_free_incoming_msg(relay->out_msg, relay->step);
+	relay->out_msg = NULL;
+
+	return SLURM_SUCCESS;
+}
+
+static int _relay_enqueue_stdin(void *x, void *arg)
+{
+	eio_obj_t *obj = x;
+	struct relay_io_info *relay = obj->arg;
+	struct io_buf *msg = arg;
+
+	if (relay->out_eof)
+		return 0;
+
+	msg->ref_count++;
+	list_enqueue(relay->msg_queue, msg);
+	return 0;
+}
+
 static bool
 _local_file_writable(eio_obj_t *obj)
 {
@@ -712,7 +1364,7 @@ _create_task_out_eio(int fd, uint16_t type,
 	out->gtaskid = task->gtid;
 	out->ltaskid = task->id;
 	out->step = step;
-	out->buf = cbuf_create(MAX_MSG_LEN, MAX_MSG_LEN*4);
+	out->buf = cbuf_create(io_msg_len, io_msg_len * 4);
 	out->eof = false;
 	out->eof_msg_sent = false;
 	if (cbuf_opt_set(out->buf, CBUF_OPT_OVERWRITE, CBUF_NO_DROP) == -1)
@@ -1178,6 +1830,9 @@ io_init_tasks_stdio(stepd_step_rec_t *step)
 {
 	int i, rc = SLURM_SUCCESS, tmprc;
 
+	_init_io_msg_len(step);
+	_init_io_relay(step);
+
 	for (i = 0; i < step->node_tasks; i++) {
 		tmprc = _init_task_stdio_fds(step->task[i], step);
 		if (tmprc != SLURM_SUCCESS)
@@ -1431,6 +2086,30 @@ io_close_all(stepd_step_rec_t *step)
 		(void) close(devnull);
 	}
 
+	if (stdio_tree) {
+		struct timespec ts = { 0, 0 };
+		bool shutdown = true;
+
+		slurm_mutex_lock(&relay_lock);
+		/* Give the children still launching a chance to connect */
+		ts.tv_sec = time(NULL) + REVERSE_TREE_PARENT_RETRY;
+		while ((relay_accepted < relay_expected) &&
+		       (time(NULL) < ts.tv_sec))
+			slurm_cond_timedwait(&relay_cond, &relay_lock, &ts);
+		relay_closed = true;
+		if (relay_active) {
+			debug("Waiting on stdio of %d relayed nodes",
+			      relay_active);
+			relay_shutdown = true;
+			shutdown = false;
+		}
+		slurm_mutex_unlock(&relay_lock);
+
+		/* The last relay to close signals the shutdown */
+		if (!shutdown)
+			return;
+	}
+
 	/* Signal IO thread to close appropriate
 	 * client connections
 	 */
@@ -1484,6 +2163,16 @@ _io_thr(void *arg)
 	debug("IO handler started pid=%lu", (unsigned long) getpid());
 	rc = eio_handle_mainloop(step->eio);
 	debug("IO handler exited, rc=%d", rc);
+
+	if (stdio_tree) {
+		slurm_mutex_lock(&relay_lock);
+		relay_closed = true;
+		if (relay_active)
+			error("%s: dropping stdio of %d relayed nodes",
+			      __func__, relay_active);
+		relay_active = 0;
+		slurm_mutex_unlock(&relay_lock);
+	}
 	slurm_mutex_lock(&step->io_mutex);
 	step->io_running = false;
 	slurm_cond_broadcast(&step->io_cond);
@@ -1522,6 +2211,7 @@ io_create_local_client(const char *filename, int file_flags,
 	client->ltaskid_stderr = stderr_tasks;
 	client->labelio = labelio;
 	client->is_local_file = true;
+	client->max_msg_len = MAX_IO_MSG_LEN;
 
 	client->taskid_width = 1;
 	tmp = step->node_tasks - 1;
@@ -1537,6 +2227,79 @@ io_create_local_client(const char *filename, int file_flags,
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Connect to the slurmstepd of our parent node for it to relay our stdio.
+ * Our slurmd can not tell where the step of the parent listens, so the
+ * connection goes to the parent slurmd which hands it over to the step.
+ * The io init message is sent along with the request, the step checks it
+ * before accepting the connection.
+ * RET the connection or -1 to connect to srun directly
+ */
+static int _relay_connect(srun_info_t *srun, stepd_step_rec_t *step)
+{
+	hostlist_t *hl;
+	char *parent_name;
+	slurm_addr_t addr;
+	slurm_msg_t req, resp;
+	int fd = -1, rc = SLURM_ERROR;
+
+	hl = hostlist_create(step->msg->complete_nodelist);
+	parent_name = hostlist_nth(hl, relay_parent);
+	hostlist_destroy(hl);
+	if (!parent_name || slurm_conf_get_addr(parent_name, &addr, 0)) {
+		error("%s: unable to get address of parent node %s",
+		      __func__, parent_name);
+		free(parent_name);
+		return -1;
+	}
+
+	slurm_msg_t_init(&req);
+	slurm_msg_set_r_uid(&req, slurm_conf.slurmd_user_id);
+	req.msg_type = REQUEST_STEP_IO_RELAY;
+	req.data = &step->step_id;
+
+	for (int retry = 0; retry < REVERSE_TREE_PARENT_RETRY; retry++) {
+		if (retry)
+			sleep(1);
+		if ((fd = slurm_open_msg_conn(&addr)) < 0) {
+			debug("%s: connect to %s: %m", __func__, parent_name);
+			continue;
+		}
+
+		slurm_msg_t_init(&resp);
+		if ((slurm_send_node_msg(fd, &req) < 0) ||
+		    _send_io_init_msg(fd, srun, step, true) ||
+		    slurm_receive_msg(fd, &resp, 0)) {
+			debug("%s: request to %s: %m", __func__, parent_name);
+			rc = SLURM_ERROR;
+		} else {
+			if (resp.auth_cred)
+				auth_g_destroy(resp.auth_cred);
+			rc = slurm_get_return_code(resp.msg_type, resp.data);
+			slurm_free_msg_data(resp.msg_type, resp.data);
+		}
+		if (rc == SLURM_SUCCESS)
+			break;
+
+		close(fd);
+		fd = -1;
+		debug("%s: %s refused to relay stdio: %s",
+		      __func__, parent_name, slurm_strerror(rc));
+		/* The step of the parent is already done with its stdio */
+		if (rc == ESLURMD_IO_ERROR)
+			break;
+	}
+
+	if (fd < 0)
+		info("Unable to relay stdio through %s, connecting to srun",
+		     parent_name);
+	else
+		debug("%s: stdio relayed through %s", __func__, parent_name);
+	free(parent_name);
+
+	return fd;
+}
+
 /*
  * Create the initial TCP connection back to a waiting client (e.g. srun).
  *
@@ -1565,18 +2328,23 @@ io_initial_client_connect(srun_info_t *srun, stepd_step_rec_t *step,
 		debug4("connecting IO back to %pA", &srun->ioaddr);
 	}
 
-	if ((sock = (int) slurm_open_stream(&srun->ioaddr, true)) < 0) {
+	if (stdio_tree && (relay_parent >= 0))
+		sock = _relay_connect(srun, step);
+
+	if (sock >= 0) {
+		/* io init message already sent by _relay_connect() */
+	} else if ((sock = (int) slurm_open_stream(&srun->ioaddr, true)) < 0) {
 		error("connect io: %m");
 		/* XXX retry or silently fail?
 		 *     fail for now.
 		 */
 		return SLURM_ERROR;
+	} else {
+		fd_set_blocking(sock);  /* just in case... */
+		_send_io_init_msg(sock, srun, step, true);
+		debug5("  back from _send_io_init_msg");
 	}
 
-	fd_set_blocking(sock);  /* just in case... */
-	_send_io_init_msg(sock, srun, step, true);
-
-	debug5("  back from _send_io_init_msg");
 	fd_set_nonblocking(sock);
 
 	/* Now set up the eio object */
@@ -1584,12 +2352,14 @@ io_initial_client_connect(srun_info_t *srun, stepd_step_rec_t *step,
 	client->magic = CLIENT_IO_MAGIC;
 	client->step = step;
 	client->msg_queue = list_create(NULL); /* FIXME - destructor */
+	client->relays = stdio_tree;
 
 	client->ltaskid_stdout = stdout_tasks;
 	client->ltaskid_stderr = stderr_tasks;
 	client->labelio = false;
 	client->taskid_width = 0;
 	client->is_local_file = false;
+	client->max_msg_len = _client_max_msg_len(srun->protocol_version);
 
 	obj = eio_obj_create(sock, &client_ops, (void *)client);
 	list_append(step->clients, (void *)obj);
@@ -1644,6 +2414,14 @@ io_client_connect(srun_info_t *srun, stepd_step_rec_t *step)
 	client->labelio = false;
 	client->taskid_width = 0;
 	client->is_local_file = false;
+	client->max_msg_len = _client_max_msg_len(srun->protocol_version);
+
+	/*
+	 * Messages built from now on have to fit an older sattach, the ones
+	 * already cached that do not are skipped for it.
+	 */
+	if (client->max_msg_len < io_msg_len)
+		_set_io_msg_len(client->max_msg_len);
 
 	/* client object adds itself to step->clients in _client_writable */
 
@@ -1655,6 +2433,158 @@ io_client_connect(srun_info_t *srun, stepd_step_rec_t *step)
 	return SLURM_SUCCESS;
 }
 
+/*
+ * Answer the REQUEST_STEP_IO_RELAY of a child, see _relay_connect(). Nothing
+ * else may be written to fd before.
+ */
+static int _relay_reply(int fd, uint16_t protocol_version, uid_t uid, int rc)
+{
+	slurm_msg_t req;
+
+	slurm_msg_t_init(&req);
+	req.conn_fd = fd;
+	req.protocol_version = protocol_version;
+	req.auth_uid = uid;
+	req.auth_ids_set = true;
+
+	if (slurm_send_rc_msg(&req, rc) < 0) {
+		error("%s: unable to answer relay request: %m", __func__);
+		return SLURM_ERROR;
+	}
+
+	return SLURM_SUCCESS;
+}
+
+/*
+ * A child node which dies leaves its connection open, have keepalive turn
+ * that into a read error even if KeepAliveTime is not configured.
+ */
+static void _relay_keep_alive(int fd)
+{
+	int opt_int = 1;
+
+	if (slurm_conf.keepalive_time != NO_VAL) {
+		net_set_keep_alive(fd);
+		return;
+	}
+
+	if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &opt_int,
+		       sizeof(opt_int)) < 0) {
+		error("%s: unable to set keepalive socket option: %m",
+		      __func__);
+		return;
+	}
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL)
+	opt_int = slurm_conf.msg_timeout;
+	if ((setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &opt_int,
+			sizeof(opt_int)) < 0) ||
+	    (setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &opt_int,
+			sizeof(opt_int)) < 0))
+		error("%s: unable to set keepalive times: %m", __func__);
+#endif
+}
+
+extern int io_relay_add(stepd_step_rec_t *step, int fd,
+			uint16_t protocol_version, uid_t uid)
+{
+	io_init_msg_t msg = { 0 };
+	struct relay_io_info *relay;
+	srun_info_t *srun;
+	eio_obj_t *obj;
+	int rc = SLURM_SUCCESS;
+
+	if (!stdio_tree || !(srun = list_peek(step->sruns))) {
+		rc = ESLURM_NOT_SUPPORTED;
+		goto done;
+	}
+
+	/* Sent by the child right after its request, see _relay_connect() */
+	if (io_init_msg_read_from_fd_timeout(fd, &msg,
+					     slurm_conf.msg_timeout * 1000) ||
+	    io_init_msg_validate(&msg, srun->key->data, srun->key->len)) {
+		rc = ESLURMD_IO_ERROR;
+		goto done;
+	}
+	if ((msg.nodeid >= step->nnodes) ||
+	    (_relay_parent_of(step, msg.nodeid) != step->nodeid)) {
+		error("%s: node %u is not a child of node %u",
+		      __func__, msg.nodeid, step->nodeid);
+		rc = ESLURMD_IO_ERROR;
+		goto done;
+	}
+
+	slurm_mutex_lock(&relay_lock);
+	if (relay_closed) {
+		rc = ESLURMD_IO_ERROR;
+	} else {
+		relay_accepted++;
+		relay_active++;
+		slurm_cond_broadcast(&relay_cond);
+	}
+	slurm_mutex_unlock(&relay_lock);
+	if (rc != SLURM_SUCCESS) {
+		debug("%s: stdio of node %u refused, already done with stdio",
+		      __func__, msg.nodeid);
+		goto done;
+	}
+
+	/*
+	 * Answer before the IO thread can announce the child to srun, which
+	 * may then send stdin for it on fd.
+	 */
+	if (_relay_reply(fd, protocol_version, uid, SLURM_SUCCESS)) {
+		slurm_mutex_lock(&relay_lock);
+		relay_accepted--;
+		slurm_mutex_unlock(&relay_lock);
+		_relay_done(step);
+		close(fd);
+		xfree(msg.io_key);
+		return SLURM_ERROR;
+	}
+
+	relay = xmalloc(sizeof(*relay));
+	relay->magic = RELAY_IO_MAGIC;
+	relay->step = step;
+	relay->init.nodeid = msg.nodeid;
+	relay->init.stdout_objs = msg.stdout_objs;
+	relay->init.stderr_objs = msg.stderr_objs;
+	relay->init.ntasks = step->msg->tasks_to_launch[msg.nodeid];
+	relay->init.gtids = xcalloc(relay->init.ntasks, sizeof(uint32_t));
+	memcpy(relay->init.gtids, step->msg->global_task_ids[msg.nodeid],
+	       relay->init.ntasks * sizeof(uint32_t));
+	relay->stdout_objs = msg.stdout_objs;
+	relay->stderr_objs = msg.stderr_objs;
+	relay->msg_queue = list_create(NULL);
+	relay->out_hdr = init_buf(io_hdr_packed_size());
+
+	fd_set_nonblocking(fd);
+	fd_set_close_on_exec(fd);
+	_relay_keep_alive(fd);
+
+	obj = eio_obj_create(fd, &relay_ops, relay);
+	eio_new_obj(step->eio, obj);
+	debug("%s: relaying stdio of node %u", __func__, msg.nodeid);
+
+done:
+	if (rc != SLURM_SUCCESS) {
+		(void) _relay_reply(fd, protocol_version, uid, rc);
+		close(fd);
+	}
+	xfree(msg.io_key);
+	return rc;
+}
+
+extern bool io_relay_active(void)
+{
+	bool active;
+
+	slurm_mutex_lock(&relay_lock);
+	active = (relay_active > 0);
+	slurm_mutex_unlock(&relay_lock);
+
+	return active;
+}
+
 static int
 _send_io_init_msg(int sock, srun_info_t *srun, stepd_step_rec_t *step, bool init)
 {
@@ -1682,6 +2612,10 @@ _send_io_init_msg(int sock, srun_info_t *srun, stepd_step_rec_t *step, bool init
 	else
 		msg.stderr_objs = list_count(step->stderr_eio_objs);
 
+	/* One more stream for each child relaying through us, see stdio_tree */
+	if (init && stdio_tree)
+		msg.stdout_objs += relay_expected;
+
 	if (io_init_msg_write_to_fd(sock, &msg) != SLURM_SUCCESS) {
 		error("Couldn't sent slurm_io_init_msg");
 		xfree(msg.io_key);
@@ -1810,10 +2744,10 @@ static struct io_buf *_task_build_message(struct task_read_info *out,
 	ptr = msg->data + io_hdr_packed_size();
 
 	if (buffered_stdio) {
-		avail = cbuf_peek_line(cbuf, ptr, MAX_MSG_LEN, 1);
-		if (avail >= MAX_MSG_LEN)
+		avail = cbuf_peek_line(cbuf, ptr, io_msg_len, 1);
+		if (avail >= io_msg_len)
 			must_truncate = true;
-		else if (avail == 0 && cbuf_used(cbuf) >= MAX_MSG_LEN)
+		else if (avail == 0 && cbuf_used(cbuf) >= io_msg_len)
 			must_truncate = true;
 	}
 
@@ -1828,9 +2762,9 @@ static struct io_buf *_task_build_message(struct task_read_info *out,
 	 * Hence the "|| out->eof".
 	 */
 	if (must_truncate || !buffered_stdio || out->eof) {
-		n = cbuf_read(cbuf, ptr, MAX_MSG_LEN);
+		n = cbuf_read(cbuf, ptr, io_msg_len);
 	} else {
-		n = cbuf_read_line(cbuf, ptr, MAX_MSG_LEN, -1);
+		n = cbuf_read_line(cbuf, ptr, io_msg_len, -1);
 		if (n == 0) {
 			debug5("  partial line in buffer, ignoring");
 			debug4("Leaving  _task_build_message");
@@ -1869,9 +2803,10 @@ alloc_io_buf(void)
 
 	buf->ref_count = 0;
 	buf->length = 0;
+	buf->size = io_msg_len;
 	/* The following "+ 1" is just temporary so I can stick a \0 at
 	   the end and do a printf of the data pointer */
-	buf->data = xmalloc(MAX_MSG_LEN + io_hdr_packed_size() + 1);
+	buf->data = xmalloc(io_msg_len + io_hdr_packed_size() + 1);
 
 	return buf;
 }
@@ -1911,7 +2846,7 @@ _outgoing_buf_free(stepd_step_rec_t *step)
 
 	if (list_count(step->free_outgoing) > 0) {
 		return true;
-	} else if (step->outgoing_count < STDIO_MAX_FREE_BUF) {
+	} else if (step->outgoing_count < max_outgoing_bufs) {
 		buf = alloc_io_buf();
 		list_enqueue(step->free_outgoing, buf);
 		step->outgoing_count++;
@@ -40,6 +40,7 @@
 #define _IO_H
 
 #include "src/common/eio.h"
+#include "src/common/io_hdr.h"
 
 #include "src/slurmd/slurmstepd/slurmstepd_job.h"
 
@@ -53,6 +54,8 @@
 struct io_buf {
 	int ref_count;
 	uint32_t length;
+	uint32_t size;	/* capacity of data, excluding the header */
+	io_hdr_t header; /* of stdin messages, data only holds the body */
 	void *data;
 };
 
@@ -94,6 +97,22 @@ int io_initial_client_connect(srun_info_t *srun, stepd_step_rec_t *step,
  */
 int io_client_connect(srun_info_t *srun, stepd_step_rec_t *step);
 
+/*
+ * Relay the stdio of a child node of the step (LaunchParameters=stdio_tree)
+ * over fd, a connection from its slurmstepd handed over by our slurmd. The
+ * REQUEST_STEP_IO_RELAY of the child, sent with protocol_version by uid, is
+ * answered on fd and fd is closed if it is refused.
+ * RET SLURM_SUCCESS, or an error code if the connection is refused
+ */
+extern int io_relay_add(stepd_step_rec_t *step, int fd,
+			uint16_t protocol_version, uid_t uid);
+
+/*
+ * RET true while the stdio of child nodes is relayed through this step, the
+ * IO thread keeps running until they are done.
+ */
+extern bool io_relay_active(void);
+
 
 /*
  * Open a local file and create and eio object for files written
@@ -2363,7 +2363,7 @@ _wait_for_io(stepd_step_rec_t *step)
 	io_close_all(step);
 
 	slurm_mutex_lock(&step->io_mutex);
-	if (step->io_running) {
+	while (step->io_running) {
 		/*
 		 * Give the I/O thread up to 300 seconds to cleanup before
 		 * continuing with shutdown. Note that it is *not* safe to
@@ -2372,10 +2372,17 @@ _wait_for_io(stepd_step_rec_t *step)
 		 * on step teardown, which is infinitely worse than letting
 		 * that thread attempt to continue as we quickly head towards
 		 * the process exiting anyways.
+		 *
+		 * Keep waiting while it relays the stdio of other nodes, which
+		 * may run for much longer than our own tasks. A child node
+		 * which dies is found by keepalive on its connection, see
+		 * io_relay_add().
 		 */
 		struct timespec ts = { 0, 0 };
 		ts.tv_sec = time(NULL) + 300;
 		slurm_cond_timedwait(&step->io_cond, &step->io_mutex, &ts);
+		if (!io_relay_active())
+			break;
 	}
 	slurm_mutex_unlock(&step->io_mutex);
 
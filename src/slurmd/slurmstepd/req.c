@@ -109,6 +109,7 @@ static int _handle_task_info(int fd, stepd_step_rec_t *step);
 static int _handle_list_pids(int fd, stepd_step_rec_t *step);
 static int _handle_reconfig(int fd, stepd_step_rec_t *step, uid_t uid);
 static int _handle_get_ns_fd(int fd, stepd_step_rec_t *step);
+static int _handle_io_relay(int fd, stepd_step_rec_t *step, uid_t uid);
 static bool _msg_socket_readable(eio_obj_t *obj);
 static int _msg_socket_accept(eio_obj_t *obj, List objs);
 
@@ -591,6 +592,10 @@ int _handle_request(int fd, stepd_step_rec_t *step, uid_t uid, pid_t remote_pid)
 		debug("Handling REQUEST_GETHOST");
 		rc = _handle_gethost(fd, step, remote_pid);
 		break;
+	case REQUEST_IO_RELAY:
+		debug("Handling REQUEST_IO_RELAY");
+		rc = _handle_io_relay(fd, step, uid);
+		break;
 	default:
 		error("Unrecognized request: %d", req);
 		rc = SLURM_ERROR;
@@ -1114,6 +1119,41 @@ rwfail:
 	return SLURM_ERROR;
 }
 
+static int _handle_io_relay(int fd, stepd_step_rec_t *step, uid_t uid)
+{
+	int relay_fd, rc = SLURM_SUCCESS;
+	uint16_t protocol_version;
+	uid_t relay_uid;
+
+	/* The fd has to be read even if it is refused */
+	relay_fd = receive_fd_over_pipe(fd);
+	safe_read(fd, &protocol_version, sizeof(uint16_t));
+	safe_read(fd, &relay_uid, sizeof(uid_t));
+
+	if (!_slurm_authorized_user(uid)) {
+		error("uid %u attempt to relay stdio of %ps (owned by %u)",
+		      uid, &step->step_id, step->uid);
+		rc = ESLURM_USER_ID_MISSING;
+	} else if (relay_fd < 0) {
+		rc = SLURM_ERROR;
+	} else {
+		/* Answers the child itself, whether it is refused or not */
+		(void) io_relay_add(step, relay_fd, protocol_version,
+				    relay_uid);
+		relay_fd = -1;
+	}
+
+	if (relay_fd >= 0)
+		close(relay_fd);
+
+	safe_write(fd, &rc, sizeof(int));
+	return SLURM_SUCCESS;
+rwfail:
+	if (relay_fd >= 0)
+		close(relay_fd);
+	return SLURM_ERROR;
+}
+
 static void _block_on_pid(pid_t pid)
 {
 	/* I wish there was another way to wait on a foreign pid, but
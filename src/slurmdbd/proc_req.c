@@ -63,6 +63,12 @@
 #include "src/slurmdbd/slurmdbd.h"
 #include "src/slurmctld/slurmctld.h"
 
+typedef struct {
+	uint32_t cnt;		/* count of queued requests */
+	uint16_t msg_type;	/* type of queued requests, 0 if none */
+	List rets;		/* responses to queued requests */
+} mult_batch_t;
+
 /* Local functions */
 static bool _validate_slurm_user(slurmdbd_conn_t *dbd_conn);
 static bool _validate_super_user(slurmdbd_conn_t *dbd_conn);
@@ -1074,6 +1080,29 @@ static int _get_events(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	return rc;
 }
 
+/* Send one part of a DBD_GET_JOBS_COND response back as it is read */
+static int _send_jobs_part(void *x, void *arg)
+{
+	dbd_list_msg_t list_msg = { .my_list = x };
+	slurmdbd_conn_t *slurmdbd_conn = arg;
+	buf_t *buffer = init_buf(BUF_SIZE);
+	int rc;
+
+	pack16((uint16_t) DBD_GOT_JOBS_PART, buffer);
+	slurmdbd_pack_list_msg(&list_msg, slurmdbd_conn->conn->version,
+			       DBD_GOT_JOBS_PART, buffer);
+	rc = slurm_persist_send_msg(slurmdbd_conn->conn, buffer);
+	FREE_NULL_BUFFER(buffer);
+
+	if (rc != SLURM_SUCCESS) {
+		error("%s: unable to send part of DBD_GOT_JOBS on CONN %d: %s",
+		      __func__, slurmdbd_conn->conn->fd, slurm_strerror(rc));
+		return -1;
+	}
+
+	return 0;
+}
+
 static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 			  buf_t **out_buffer)
 {
@@ -1119,9 +1148,23 @@ static int _get_jobs_cond(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 		}
 	}
 
-	list_msg.my_list = jobacct_storage_g_get_jobs_cond(
-		slurmdbd_conn->db_conn, slurmdbd_conn->conn->auth_uid,
-		job_cond);
+	/*
+	 * Send the jobs back in parts as they are read, the final empty
+	 * DBD_GOT_JOBS below ends the response.
+	 */
+	if ((job_cond->flags & JOBCOND_FLAG_STREAM) &&
+	    (slurmdbd_conn->conn->version >= SLURM_23_11_PROTOCOL_VERSION)) {
+		errno = 0;
+		/* A failure after some parts were sent still ends in an rc */
+		rc = jobacct_storage_g_get_jobs_cond_parts(
+			slurmdbd_conn->db_conn, slurmdbd_conn->conn->auth_uid,
+			job_cond, _send_jobs_part, slurmdbd_conn);
+		if ((rc != SLURM_SUCCESS) && !errno)
+			errno = rc;
+	} else
+		list_msg.my_list = jobacct_storage_g_get_jobs_cond(
+			slurmdbd_conn->db_conn, slurmdbd_conn->conn->auth_uid,
+			job_cond);
 
 	if (!errno) {
 		if (!list_msg.my_list)
@@ -3100,11 +3143,124 @@ static int _send_mult_job_start(slurmdbd_conn_t *slurmdbd_conn,
 	return SLURM_SUCCESS;
 }
 
+static slurmdb_rpc_obj_t *_get_rpc_obj(List rpc_list, int id)
+{
+	slurmdb_rpc_obj_t *rpc_obj;
+
+	if (!(rpc_obj = list_find_first(rpc_list, _find_rpc_obj_in_list, &id))) {
+		rpc_obj = xmalloc(sizeof(slurmdb_rpc_obj_t));
+		rpc_obj->id = id;
+		list_append(rpc_list, rpc_obj);
+	}
+
+	return rpc_obj;
+}
+
+/*
+ * Batched requests are counted here rather than in proc_req(), along with the
+ * time it took to write them out.
+ */
+static void _add_batch_stats(slurmdbd_conn_t *slurmdbd_conn, uint16_t msg_type,
+			     uint32_t rows, uint64_t usec, bool written)
+{
+	slurmdb_rpc_obj_t *rpc_obj;
+
+	slurm_mutex_lock(&rpc_mutex);
+	rpc_obj = _get_rpc_obj(rpc_stats.rpc_list, msg_type);
+	rpc_obj->cnt += rows;
+	rpc_obj->time += usec;
+	if (written) {
+		rpc_obj->batch_cnt++;
+		rpc_obj->batch_rows += rows;
+	}
+
+	rpc_obj = _get_rpc_obj(rpc_stats.user_list,
+			       slurmdbd_conn->conn->auth_uid);
+	rpc_obj->cnt += rows;
+	rpc_obj->time += usec;
+	slurm_mutex_unlock(&rpc_mutex);
+}
+
+/*
+ * Write out the steps queued from a DBD_SEND_MULT_MSG and commit them. If any
+ * of them could not be written, including by a flush while they were being
+ * queued, roll the batch back and fail every queued request. None of them is
+ * acknowledged so the slurmctld sends them all again; with CommitDelay the
+ * rows written by earlier flushes stay, which is fine since the step queries
+ * are idempotent.
+ */
+static int _mult_msg_batch_end(slurmdbd_conn_t *slurmdbd_conn,
+			       mult_batch_t *batch, List ret_list)
+{
+	int rc;
+	DEF_TIMERS;
+
+	if (!batch->msg_type)
+		return SLURM_SUCCESS;
+
+	START_TIMER;
+	rc = jobacct_storage_g_step_batch(slurmdbd_conn->db_conn, false);
+	slurmdbd_conn->step_batch = false;
+	if (slurmdbd_conn->conn->rem_port && !slurmdbd_conf->commit_delay)
+		acct_storage_g_commit(slurmdbd_conn->db_conn,
+				      (rc == SLURM_SUCCESS));
+	END_TIMER;
+
+	_add_batch_stats(slurmdbd_conn, batch->msg_type, batch->cnt,
+			 DELTA_TIMER, (rc == SLURM_SUCCESS));
+
+	if (rc == SLURM_SUCCESS) {
+		list_transfer(ret_list, batch->rets);
+	} else {
+		error("CONN:%d writing %u batched %s failed, none of them were recorded",
+		      slurmdbd_conn->conn->fd, batch->cnt,
+		      slurmdbd_msg_type_2_str(batch->msg_type, 1));
+		list_flush(batch->rets);
+	}
+
+	batch->cnt = 0;
+	batch->msg_type = 0;
+
+	return rc;
+}
+
+/*
+ * Queue consecutive DBD_STEP_START or DBD_STEP_COMPLETE messages of a
+ * DBD_SEND_MULT_MSG so the storage plugin can write them together.
+ */
+static int _mult_msg_batch(slurmdbd_conn_t *slurmdbd_conn, mult_batch_t *batch,
+			   uint16_t msg_type, List ret_list)
+{
+	int rc;
+
+	if (batch->msg_type == msg_type) {
+		batch->cnt++;
+		return SLURM_SUCCESS;
+	}
+
+	if ((rc = _mult_msg_batch_end(slurmdbd_conn, batch, ret_list)))
+		return rc;
+
+	if ((msg_type != DBD_STEP_START) && (msg_type != DBD_STEP_COMPLETE))
+		return SLURM_SUCCESS;
+
+	/* If the plugin can't batch just write the steps one at a time */
+	if (jobacct_storage_g_step_batch(slurmdbd_conn->db_conn, true))
+		return SLURM_SUCCESS;
+
+	slurmdbd_conn->step_batch = true;
+	batch->msg_type = msg_type;
+	batch->cnt = 1;
+
+	return SLURM_SUCCESS;
+}
+
 static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 			  buf_t **out_buffer)
 {
 	dbd_list_msg_t *get_msg = msg->data;
 	dbd_list_msg_t list_msg = { NULL };
+	mult_batch_t batch = { 0 };
 	char *comment = NULL;
 	ListIterator itr = NULL;
 	buf_t *req_buf = NULL, *ret_buf = NULL;
@@ -3122,6 +3278,21 @@ static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 	}
 
 	list_msg.my_list = list_create(slurmdbd_free_buffer);
+	list_msg.seq = get_msg->seq;
+
+	/*
+	 * The slurmctld pipelines sequenced messages. Once one fails the ones
+	 * sent after it are refused so nothing is written out of order, until
+	 * the slurmctld goes back and starts over from the failed one.
+	 */
+	if (get_msg->seq && slurmdbd_conn->mult_seq_fail &&
+	    ((int32_t) (get_msg->seq - slurmdbd_conn->mult_seq) >= 0)) {
+		debug("CONN:%d refusing DBD_SEND_MULT_MSG seq %u sent after a failed one",
+		      slurmdbd_conn->conn->fd, get_msg->seq);
+		goto end_it;
+	}
+
+	batch.rets = list_create(slurmdbd_free_buffer);
 	/* START_TIMER; */
 	itr = list_iterator_create(get_msg->my_list);
 	while ((req_buf = list_next(itr))) {
@@ -3135,19 +3306,38 @@ static int _send_mult_msg(slurmdbd_conn_t *slurmdbd_conn, persist_msg_t *msg,
 			size_buf(req_buf), &ret_buf, 0);
 
 		if (rc == SLURM_SUCCESS) {
-			rc = proc_req(slurmdbd_conn, &sub_msg, &ret_buf);
+			rc = _mult_msg_batch(slurmdbd_conn, &batch,
+					     sub_msg.msg_type,
+					     list_msg.my_list);
+			if (rc == SLURM_SUCCESS)
+				rc = proc_req(slurmdbd_conn, &sub_msg,
+					      &ret_buf);
 			slurmdbd_free_msg(&sub_msg);
 		}
 
 		if (ret_buf)
-			list_append(list_msg.my_list, ret_buf);
+			list_append(batch.msg_type ?
+				    batch.rets : list_msg.my_list, ret_buf);
 		if (rc != SLURM_SUCCESS)
 			break;
 	}
 	list_iterator_destroy(itr);
+	if (_mult_msg_batch_end(slurmdbd_conn, &batch, list_msg.my_list))
+		rc = SLURM_ERROR;
+	FREE_NULL_LIST(batch.rets);
 	/* END_TIMER; */
 	/* info("%d multi took %s", list_count(get_msg->my_list), TIME_STR); */
 
+	if (get_msg->seq) {
+		slurmdbd_conn->mult_seq = get_msg->seq +
+			list_count(get_msg->my_list);
+		slurmdbd_conn->mult_seq_fail =
+			((rc != SLURM_SUCCESS) ||
+			 (list_count(list_msg.my_list) !=
+			  list_count(get_msg->my_list)));
+	}
+
+end_it:
 	*out_buffer = init_buf(1024);
 	pack16((uint16_t) DBD_GOT_MULT_MSG, *out_buffer);
 	slurmdbd_pack_list_msg(&list_msg, slurmdbd_conn->conn->version,
@@ -3662,7 +3852,8 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer)
 		      slurmdbd_conn->conn->fd,
 		      slurmdbd_msg_type_2_str(msg->msg_type, 1));
 	else if (slurmdbd_conn->conn->rem_port
-		 && !slurmdbd_conf->commit_delay) {
+		 && !slurmdbd_conf->commit_delay
+		 && !slurmdbd_conn->step_batch) {
 		/* If we are dealing with the slurmctld do the
 		   commit (SUCCESS or NOT) afterwards since we
 		   do transactions for performance reasons.
@@ -3675,24 +3866,16 @@ extern int proc_req(void *conn, persist_msg_t *msg, buf_t **out_buffer)
 
 	slurm_mutex_lock(&rpc_mutex);
 
-	if (!(rpc_obj = list_find_first(rpc_stats.rpc_list,
-					_find_rpc_obj_in_list,
-					&msg->msg_type))) {
-		rpc_obj = xmalloc(sizeof(slurmdb_rpc_obj_t));
-		rpc_obj->id = msg->msg_type;
-		list_append(rpc_stats.rpc_list, rpc_obj);
-	}
-	rpc_obj->cnt++;
+	/* Batched requests are counted by _add_batch_stats() */
+	rpc_obj = _get_rpc_obj(rpc_stats.rpc_list, msg->msg_type);
+	if (!slurmdbd_conn->step_batch)
+		rpc_obj->cnt++;
 	rpc_obj->time += DELTA_TIMER;
 
-	if (!(rpc_obj = list_find_first(rpc_stats.user_list,
-					_find_rpc_obj_in_list,
-					&slurmdbd_conn->conn->auth_uid))) {
-		rpc_obj = xmalloc(sizeof(slurmdb_rpc_obj_t));
-		rpc_obj->id = slurmdbd_conn->conn->auth_uid;
-		list_append(rpc_stats.user_list, rpc_obj);
-	}
-	rpc_obj->cnt++;
+	rpc_obj = _get_rpc_obj(rpc_stats.user_list,
+			       slurmdbd_conn->conn->auth_uid);
+	if (!slurmdbd_conn->step_batch)
+		rpc_obj->cnt++;
 	rpc_obj->time += DELTA_TIMER;
 
 	slurm_mutex_unlock(&rpc_mutex);
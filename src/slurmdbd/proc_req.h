@@ -47,6 +47,9 @@ typedef struct {
 	slurm_persist_conn_t *conn;
 	slurm_persist_conn_t *conn_send;
 	void *db_conn; /* database connection */
+	bool step_batch; /* steps are being queued, don't commit yet */
+	bool mult_seq_fail; /* last sequenced DBD_SEND_MULT_MSG failed */
+	uint32_t mult_seq; /* sequence number following the last one */
 	char *tres_str;
 } slurmdbd_conn_t;
 
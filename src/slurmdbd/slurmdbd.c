@@ -394,6 +394,10 @@ extern void handle_rollup_stats(List rollup_stats_list,
 				    rollup_stats->time_total[i]);
 			rpc_rollup_stats->timestamp[i] =
 				rollup_stats->timestamp[i];
+			rpc_rollup_stats->time_window_max[i] =
+				rollup_stats->time_window_max[i];
+			rpc_rollup_stats->windows[i] =
+				rollup_stats->windows[i];
 		}
 	}
 	list_iterator_destroy(itr);
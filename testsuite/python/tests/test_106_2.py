@@ -0,0 +1,37 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import os
+import pytest
+
+node_count = 2
+
+
+# Setup
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_config_parameter_includes("BcastParameters", "CacheSize=64")
+    atf.require_nodes(node_count)
+    atf.require_slurm_running()
+
+
+def test_cache_restore(tmp_path):
+    """Verify a file broadcast again is restored from the slurmd cache"""
+
+    file_in = str(tmp_path / "bcast.in")
+    file_out = str(tmp_path / "bcast.out")
+    with open(file_in, "wb") as f:
+        f.write(os.urandom(4 * 1024 * 1024))
+
+    sbcast_cmd = f"sbcast -v --force --size=1m {file_in} {file_out} 2>&1"
+    output = atf.run_command_output(
+        f"salloc -N{node_count} bash -c '{sbcast_cmd}'", fatal=True)
+    assert "restored from the broadcast cache" not in output
+
+    os.remove(file_out)
+    output = atf.run_command_output(
+        f"salloc -N{node_count} bash -c '{sbcast_cmd} && srun cmp {file_in} {file_out}'",
+        fatal=True)
+    assert "restored from the broadcast cache" in output
+    assert os.path.getsize(file_out) == os.path.getsize(file_in)
@@ -0,0 +1,29 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import logging
+import pytest
+import time
+
+output_size = 10 * 1024 * 1024 * 1024
+
+
+# Setup
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_config_parameter_includes("LaunchParameters", "stdio_msg_size=65536")
+    atf.require_slurm_running()
+
+
+def test_stdout_throughput():
+    """Verify all the output of a task writing 10 GB to stdout gets through srun"""
+
+    start = time.time()
+    output = atf.run_command_output(
+        f"srun -N1 -n1 -t10 head -c {output_size} /dev/zero | wc -c",
+        timeout=600, fatal=True)
+    elapsed = time.time() - start
+
+    assert int(output) == output_size
+    logging.info(f"srun stdout throughput: {output_size / elapsed / (1024 * 1024):.1f} MB/s")
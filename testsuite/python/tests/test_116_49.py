@@ -0,0 +1,38 @@
+############################################################################
+# Copyright (C) SchedMD LLC.
+############################################################################
+import atf
+import pytest
+
+node_count = 4
+
+
+# Setup
+@pytest.fixture(scope="module", autouse=True)
+def setup():
+    atf.require_config_parameter_includes("LaunchParameters", "stdio_tree")
+    atf.require_config_parameter("TreeWidth", 2)
+    atf.require_nodes(node_count, [("CPUs", 2)])
+    atf.require_slurm_running()
+
+
+def test_stdout_all_nodes():
+    """Verify the output of the tasks of every node gets through the stdio tree"""
+
+    output = atf.run_command_output(
+        f"srun -N{node_count} --ntasks-per-node=2 -l echo hello",
+        fatal=True)
+
+    lines = sorted(output.splitlines())
+    assert lines == sorted(f"{i}: hello" for i in range(node_count * 2))
+
+
+def test_stdin_relayed_task():
+    """Verify stdin reaches a task on a node relayed through another one"""
+
+    last_task = node_count - 1
+    output = atf.run_command_output(
+        f"echo relayed | srun -N{node_count} -n{node_count} --input={last_task} cat",
+        fatal=True)
+
+    assert output.strip() == "relayed"
@@ -0,0 +1,294 @@
+/*****************************************************************************\
+ *  archive_file-test.c - unit tests for the chunked archive files
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "src/common/pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/plugins/accounting_storage/common/common_as.h"
+
+/* Normally defined by the plugin linking common_as */
+const char plugin_type[] = "accounting_storage/test";
+char *assoc_day_table = "assoc_usage_day_table";
+char *assoc_hour_table = "assoc_usage_hour_table";
+char *assoc_month_table = "assoc_usage_month_table";
+char *cluster_day_table = "usage_day_table";
+char *cluster_hour_table = "usage_hour_table";
+char *cluster_month_table = "usage_month_table";
+char *wckey_day_table = "wckey_usage_day_table";
+char *wckey_hour_table = "wckey_usage_hour_table";
+char *wckey_month_table = "wckey_usage_month_table";
+
+#define CHUNK_CNT 4
+
+static char *tmp_dir = NULL;
+
+/* Chunk i, alternately compressible and not, the same every time */
+static buf_t *_chunk(int i)
+{
+	buf_t *buffer = init_buf(BUF_SIZE);
+	char *data = xmalloc((i + 1) * 10000);
+	uint32_t seed = i;
+
+	for (int j = 0; j < ((i + 1) * 10000); j++) {
+		seed = seed * 1103515245 + 12345;
+		data[j] = (i % 2) ? (char) (seed >> 16) : (char) (j / 100);
+	}
+
+	pack32(i, buffer);
+	packmem(data, (i + 1) * 10000, buffer);
+	xfree(data);
+
+	return buffer;
+}
+
+/* Write CHUNK_CNT chunks to a new archive file, RET its name */
+static char *_write_archive(void)
+{
+	archive_file_t *arch_file;
+	struct dirent *ent;
+	char *name = NULL;
+	DIR *dir;
+
+	arch_file = archive_file_create("test", 0, 3600, tmp_dir, "job", 0);
+	ck_assert(arch_file != NULL);
+
+	for (int i = 0; i < CHUNK_CNT; i++) {
+		buf_t *buffer = _chunk(i);
+
+		ck_assert_int_eq(archive_file_write(arch_file, buffer),
+				 SLURM_SUCCESS);
+		FREE_NULL_BUFFER(buffer);
+	}
+	ck_assert_int_eq(archive_file_close(arch_file, true), SLURM_SUCCESS);
+
+	ck_assert((dir = opendir(tmp_dir)) != NULL);
+	while ((ent = readdir(dir))) {
+		if (ent->d_name[0] != '.')
+			name = xstrdup_printf("%s/%s", tmp_dir, ent->d_name);
+	}
+	closedir(dir);
+	ck_assert(name != NULL);
+
+	return name;
+}
+
+/* RET true if data of size is chunk i as written by _write_archive() */
+static bool _chunk_eq(char *data, uint32_t size, int i)
+{
+	buf_t *buffer = _chunk(i);
+	bool eq;
+
+	eq = ((size == get_buf_offset(buffer)) &&
+	      !memcmp(data, get_buf_data(buffer), size));
+	FREE_NULL_BUFFER(buffer);
+
+	return eq;
+}
+
+static void _setup(void)
+{
+	tmp_dir = xstrdup("/tmp/archive_file-test.XXXXXX");
+	ck_assert(mkdtemp(tmp_dir) != NULL);
+}
+
+static void _teardown(void)
+{
+	struct dirent *ent;
+	char *path;
+	DIR *dir;
+
+	if ((dir = opendir(tmp_dir))) {
+		while ((ent = readdir(dir))) {
+			if (ent->d_name[0] == '.')
+				continue;
+			path = xstrdup_printf("%s/%s", tmp_dir, ent->d_name);
+			unlink(path);
+			xfree(path);
+		}
+		closedir(dir);
+	}
+	rmdir(tmp_dir);
+	xfree(tmp_dir);
+}
+
+START_TEST(round_trip)
+{
+	char *name, *data = NULL;
+	uint32_t size;
+	int fd;
+
+	name = _write_archive();
+
+	fd = open(name, O_RDONLY);
+	ck_assert(fd >= 0);
+	ck_assert(archive_file_is_chunked(fd));
+
+	for (int i = 0; i < CHUNK_CNT; i++) {
+		ck_assert_int_eq(archive_file_read(fd, &data, &size),
+				 SLURM_SUCCESS);
+		ck_assert(data != NULL);
+		ck_assert(_chunk_eq(data, size, i));
+		xfree(data);
+	}
+
+	/* A clean end of file */
+	ck_assert_int_eq(archive_file_read(fd, &data, &size), SLURM_SUCCESS);
+	ck_assert(data == NULL);
+	ck_assert_int_eq(size, 0);
+
+	close(fd);
+	xfree(name);
+}
+END_TEST
+
+START_TEST(truncated)
+{
+	char *name, *data = NULL;
+	struct stat st;
+	uint32_t size;
+	int fd;
+
+	name = _write_archive();
+	ck_assert_int_eq(stat(name, &st), 0);
+	ck_assert_int_eq(truncate(name, st.st_size - 10), 0);
+
+	fd = open(name, O_RDONLY);
+	ck_assert(fd >= 0);
+	for (int i = 0; i < (CHUNK_CNT - 1); i++) {
+		ck_assert_int_eq(archive_file_read(fd, &data, &size),
+				 SLURM_SUCCESS);
+		ck_assert(_chunk_eq(data, size, i));
+		xfree(data);
+	}
+
+	/* The last chunk is cut short, it must not look like the end */
+	ck_assert_int_eq(archive_file_read(fd, &data, &size), SLURM_ERROR);
+	ck_assert(data == NULL);
+
+	close(fd);
+	xfree(name);
+}
+END_TEST
+
+START_TEST(corrupt)
+{
+	char *name, *data = NULL;
+	uint32_t size;
+	int fd;
+
+	name = _write_archive();
+
+	/* Clobber the magic of the second chunk */
+	fd = open(name, O_RDWR);
+	ck_assert(fd >= 0);
+	ck_assert_int_eq(archive_file_read(fd, &data, &size), SLURM_SUCCESS);
+	xfree(data);
+	ck_assert_int_eq(write(fd, "XXXX", 4), 4);
+	ck_assert(lseek(fd, 0, SEEK_SET) == 0);
+
+	ck_assert_int_eq(archive_file_read(fd, &data, &size), SLURM_SUCCESS);
+	ck_assert(_chunk_eq(data, size, 0));
+	xfree(data);
+	ck_assert_int_eq(archive_file_read(fd, &data, &size), SLURM_ERROR);
+	ck_assert(data == NULL);
+
+	close(fd);
+	xfree(name);
+}
+END_TEST
+
+START_TEST(not_kept)
+{
+	archive_file_t *arch_file;
+	buf_t *buffer = _chunk(0);
+	DIR *dir;
+	int cnt = 0;
+
+	arch_file = archive_file_create("test", 0, 3600, tmp_dir, "job", 0);
+	ck_assert(arch_file != NULL);
+	ck_assert_int_eq(archive_file_write(arch_file, buffer), SLURM_SUCCESS);
+	FREE_NULL_BUFFER(buffer);
+	ck_assert_int_eq(archive_file_close(arch_file, false), SLURM_SUCCESS);
+
+	/* An incomplete archive is removed */
+	ck_assert((dir = opendir(tmp_dir)) != NULL);
+	while (readdir(dir))
+		cnt++;
+	closedir(dir);
+	ck_assert_int_eq(cnt, 2);
+}
+END_TEST
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("archive_file");
+	TCase *tc_core = tcase_create("archive_file");
+	tcase_add_checked_fixture(tc_core, _setup, _teardown);
+	tcase_add_test(tc_core, round_trip);
+	tcase_add_test(tc_core, truncated);
+	tcase_add_test(tc_core, corrupt);
+	tcase_add_test(tc_core, not_kept);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
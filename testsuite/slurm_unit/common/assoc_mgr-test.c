@@ -0,0 +1,364 @@
+/*****************************************************************************\
+ *  assoc_mgr-test.c - assoc_mgr lookup tests and benchmark
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/assoc_mgr.h"
+#include "src/common/log.h"
+#include "src/common/read_config.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+/* Associations used by the benchmark, a large site */
+#define BENCH_ACCTS 500
+#define BENCH_USERS_PER_ACCT 200
+#define BENCH_LOOKUPS 200000
+
+static void _update(slurmdb_update_type_t type, List objects)
+{
+	slurmdb_update_object_t update = {
+		.objects = objects,
+		.type = type,
+	};
+	bool locked = false;
+
+	ck_assert_int_eq(assoc_mgr_update_object(&update, &locked),
+			 SLURM_SUCCESS);
+	FREE_NULL_LIST(objects);
+}
+
+static slurmdb_user_rec_t *_user_rec(char *name)
+{
+	slurmdb_user_rec_t *user = xmalloc(sizeof(*user));
+
+	user->admin_level = SLURMDB_ADMIN_NOTSET;
+	user->name = xstrdup(name);
+
+	return user;
+}
+
+static slurmdb_assoc_rec_t *_assoc_rec(uint32_t id, uint32_t parent_id,
+				       char *acct, char *user)
+{
+	slurmdb_assoc_rec_t *assoc = xmalloc(sizeof(*assoc));
+
+	slurmdb_init_assoc_rec(assoc, false);
+	assoc->id = id;
+	assoc->parent_id = parent_id;
+	assoc->cluster = xstrdup(slurm_conf.cluster_name);
+	assoc->acct = xstrdup(acct);
+	assoc->user = xstrdup(user);
+	assoc->is_def = 1;
+
+	return assoc;
+}
+
+static void _setup(void)
+{
+	List tres_list = list_create(slurmdb_destroy_tres_rec);
+	slurmdb_tres_rec_t *tres = xmalloc(sizeof(*tres));
+	assoc_mgr_lock_t locks = { .assoc = WRITE_LOCK, .qos = WRITE_LOCK,
+				   .tres = WRITE_LOCK };
+
+	xfree(slurm_conf.cluster_name);
+	slurm_conf.cluster_name = xstrdup("cluster");
+
+	tres->id = TRES_CPU;
+	tres->type = xstrdup("cpu");
+	list_append(tres_list, tres);
+	assoc_mgr_lock(&locks);
+	assoc_mgr_post_tres_list(tres_list);
+	assoc_mgr_unlock(&locks);
+
+	assoc_mgr_assoc_list = list_create(slurmdb_destroy_assoc_rec);
+	assoc_mgr_coord_list = list_create(NULL);
+	assoc_mgr_qos_list = list_create(slurmdb_destroy_qos_rec);
+	assoc_mgr_user_list = list_create(slurmdb_destroy_user_rec);
+	assoc_mgr_wckey_list = list_create(slurmdb_destroy_wckey_rec);
+}
+
+static void _teardown(void)
+{
+	assoc_mgr_fini(false);
+}
+
+START_TEST(test_user_lookup)
+{
+	List objects = list_create(slurmdb_destroy_user_rec);
+	slurmdb_user_rec_t user = { 0 }, *user_ptr = NULL;
+
+	list_append(objects, _user_rec("root"));
+	list_append(objects, _user_rec("Alice"));
+	list_append(objects, _user_rec("bob"));
+	_update(SLURMDB_ADD_USER, objects);
+
+	/* root is found by its uid, the others have none */
+	user.uid = 0;
+	ck_assert_int_eq(assoc_mgr_fill_in_user(NULL, &user,
+						ACCOUNTING_ENFORCE_ASSOCS,
+						&user_ptr, false),
+			 SLURM_SUCCESS);
+	ck_assert_str_eq(user_ptr->name, "root");
+
+	memset(&user, 0, sizeof(user));
+	user.uid = NO_VAL;
+	user.name = "alice";
+	ck_assert_int_eq(assoc_mgr_fill_in_user(NULL, &user,
+						ACCOUNTING_ENFORCE_ASSOCS,
+						&user_ptr, false),
+			 SLURM_SUCCESS);
+	ck_assert_str_eq(user_ptr->name, "Alice");
+
+	/* Renaming must move the user in the index */
+	objects = list_create(slurmdb_destroy_user_rec);
+	list_append(objects, _user_rec("carol"));
+	((slurmdb_user_rec_t *) list_peek(objects))->old_name =
+		xstrdup("bob");
+	_update(SLURMDB_MODIFY_USER, objects);
+
+	user.name = "bob";
+	ck_assert_int_eq(assoc_mgr_fill_in_user(NULL, &user,
+						ACCOUNTING_ENFORCE_ASSOCS,
+						NULL, false),
+			 SLURM_ERROR);
+	user.name = "carol";
+	ck_assert_int_eq(assoc_mgr_fill_in_user(NULL, &user,
+						ACCOUNTING_ENFORCE_ASSOCS,
+						&user_ptr, false),
+			 SLURM_SUCCESS);
+	ck_assert_str_eq(user_ptr->name, "carol");
+
+	objects = list_create(slurmdb_destroy_user_rec);
+	list_append(objects, _user_rec("carol"));
+	_update(SLURMDB_REMOVE_USER, objects);
+	ck_assert_int_eq(assoc_mgr_fill_in_user(NULL, &user,
+						ACCOUNTING_ENFORCE_ASSOCS,
+						NULL, false),
+			 SLURM_ERROR);
+	ck_assert_int_eq(list_count(assoc_mgr_user_list), 2);
+}
+END_TEST
+
+START_TEST(test_qos_lookup)
+{
+	List objects = list_create(slurmdb_destroy_qos_rec);
+	slurmdb_qos_rec_t qos = { 0 }, *qos_ptr = NULL;
+	char *names[] = { "normal", "high", "Low" };
+
+	for (int i = 0; i < ARRAY_SIZE(names); i++) {
+		slurmdb_qos_rec_t *object = xmalloc(sizeof(*object));
+
+		slurmdb_init_qos_rec(object, false, NO_VAL);
+		object->id = i + 1;
+		object->name = xstrdup(names[i]);
+		list_append(objects, object);
+	}
+	_update(SLURMDB_ADD_QOS, objects);
+
+	qos.name = "HIGH";
+	ck_assert_int_eq(assoc_mgr_fill_in_qos(NULL, &qos,
+					       ACCOUNTING_ENFORCE_QOS,
+					       &qos_ptr, false),
+			 SLURM_SUCCESS);
+	ck_assert_int_eq(qos_ptr->id, 2);
+
+	memset(&qos, 0, sizeof(qos));
+	qos.id = 3;
+	ck_assert_int_eq(assoc_mgr_fill_in_qos(NULL, &qos,
+					       ACCOUNTING_ENFORCE_QOS,
+					       &qos_ptr, false),
+			 SLURM_SUCCESS);
+	ck_assert_str_eq(qos_ptr->name, "Low");
+
+	objects = list_create(slurmdb_destroy_qos_rec);
+	qos_ptr = xmalloc(sizeof(*qos_ptr));
+	slurmdb_init_qos_rec(qos_ptr, false, NO_VAL);
+	qos_ptr->id = 2;
+	list_append(objects, qos_ptr);
+	_update(SLURMDB_REMOVE_QOS, objects);
+
+	memset(&qos, 0, sizeof(qos));
+	qos.name = "high";
+	ck_assert_int_eq(assoc_mgr_fill_in_qos(NULL, &qos,
+					       ACCOUNTING_ENFORCE_QOS,
+					       NULL, false),
+			 SLURM_ERROR);
+}
+END_TEST
+
+START_TEST(test_wckey_lookup)
+{
+	List objects = list_create(slurmdb_destroy_wckey_rec);
+	slurmdb_wckey_rec_t wckey = { 0 }, *wckey_ptr = NULL;
+	char *names[] = { "Sim", "viz" };
+
+	for (int i = 0; i < ARRAY_SIZE(names); i++) {
+		slurmdb_wckey_rec_t *object = xmalloc(sizeof(*object));
+
+		slurmdb_init_wckey_rec(object, false);
+		object->id = i + 1;
+		object->name = xstrdup(names[i]);
+		object->user = xstrdup("root");
+		object->cluster = xstrdup(slurm_conf.cluster_name);
+		list_append(objects, object);
+	}
+	_update(SLURMDB_ADD_WCKEY, objects);
+
+	wckey.uid = 0;
+	wckey.name = "sim";
+	ck_assert_int_eq(assoc_mgr_fill_in_wckey(NULL, &wckey,
+						 ACCOUNTING_ENFORCE_WCKEYS,
+						 &wckey_ptr, false),
+			 SLURM_SUCCESS);
+	ck_assert_int_eq(wckey_ptr->id, 1);
+
+	memset(&wckey, 0, sizeof(wckey));
+	wckey.id = 2;
+	ck_assert_int_eq(assoc_mgr_fill_in_wckey(NULL, &wckey,
+						 ACCOUNTING_ENFORCE_WCKEYS,
+						 &wckey_ptr, false),
+			 SLURM_SUCCESS);
+	ck_assert_str_eq(wckey_ptr->name, "viz");
+
+	objects = list_create(slurmdb_destroy_wckey_rec);
+	wckey_ptr = xmalloc(sizeof(*wckey_ptr));
+	slurmdb_init_wckey_rec(wckey_ptr, false);
+	wckey_ptr->id = 1;
+	wckey_ptr->cluster = xstrdup(slurm_conf.cluster_name);
+	list_append(objects, wckey_ptr);
+	_update(SLURMDB_REMOVE_WCKEY, objects);
+
+	memset(&wckey, 0, sizeof(wckey));
+	wckey.uid = 0;
+	wckey.name = "sim";
+	ck_assert_int_eq(assoc_mgr_fill_in_wckey(NULL, &wckey,
+						 ACCOUNTING_ENFORCE_WCKEYS,
+						 NULL, false),
+			 SLURM_ERROR);
+}
+END_TEST
+
+/*
+ * Time assoc_mgr_fill_in_assoc() as done for every job submitted, first with
+ * a partition that has no association, on a site with BENCH_ACCTS accounts of
+ * BENCH_USERS_PER_ACCT users each.
+ */
+START_TEST(test_benchmark)
+{
+	List objects = list_create(slurmdb_destroy_assoc_rec);
+	uint32_t id = 1, total = BENCH_ACCTS * (BENCH_USERS_PER_ACCT + 1) + 1;
+	char acct[32], user[32];
+	DEF_TIMERS;
+
+	list_append(objects, _assoc_rec(id++, 0, "root", NULL));
+	for (int i = 0; i < BENCH_ACCTS; i++) {
+		uint32_t acct_id = id++;
+
+		snprintf(acct, sizeof(acct), "acct%d", i);
+		list_append(objects, _assoc_rec(acct_id, 1, acct, NULL));
+		for (int j = 0; j < BENCH_USERS_PER_ACCT; j++) {
+			snprintf(user, sizeof(user), "user%d", j);
+			list_append(objects,
+				    _assoc_rec(id++, acct_id, acct, user));
+		}
+	}
+
+	START_TIMER;
+	_update(SLURMDB_ADD_ASSOC, objects);
+	END_TIMER;
+	info("adding %u associations: %s", total, TIME_STR);
+	ck_assert_int_eq(list_count(assoc_mgr_assoc_list), total);
+
+	START_TIMER;
+	for (int i = 0; i < BENCH_LOOKUPS; i++) {
+		slurmdb_assoc_rec_t assoc, *assoc_ptr = NULL;
+		int a = i % BENCH_ACCTS, u = (i / BENCH_ACCTS) %
+					    BENCH_USERS_PER_ACCT;
+
+		snprintf(acct, sizeof(acct), "acct%d", a);
+		snprintf(user, sizeof(user), "USER%d", u);
+		slurmdb_init_assoc_rec(&assoc, false);
+		/* No such users here so they have no uid */
+		assoc.uid = NO_VAL;
+		assoc.acct = acct;
+		assoc.user = user;
+		assoc.partition = "debug";
+		ck_assert_int_eq(assoc_mgr_fill_in_assoc(
+					 NULL, &assoc,
+					 ACCOUNTING_ENFORCE_ASSOCS,
+					 &assoc_ptr, false),
+				 SLURM_SUCCESS);
+		ck_assert_int_eq(assoc_ptr->id,
+				 2 + (a * (BENCH_USERS_PER_ACCT + 1)) + 1 + u);
+	}
+	END_TIMER;
+	info("assoc_mgr_fill_in_assoc %d times: %s", BENCH_LOOKUPS,
+	     TIME_STR);
+}
+END_TEST
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("assoc_mgr");
+	TCase *tc_core = tcase_create("assoc_mgr");
+	tcase_add_checked_fixture(tc_core, _setup, _teardown);
+	tcase_set_timeout(tc_core, 120); /* Avoid timeouts with --coverage */
+	tcase_add_test(tc_core, test_user_lookup);
+	tcase_add_test(tc_core, test_qos_lookup);
+	tcase_add_test(tc_core, test_wckey_lookup);
+	tcase_add_test(tc_core, test_benchmark);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("assoc_mgr-test", log_opts, 0, NULL);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	log_fini();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,429 @@
+/*****************************************************************************\
+ *  eio-test.c - unit tests and wakeup latency benchmark for eio
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "src/common/eio.h"
+#include "src/common/log.h"
+#include "src/common/macros.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+
+#define BENCH_OBJS 10000
+#define BENCH_WAKEUPS 10000
+
+static pthread_mutex_t handled_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t handled_cond = PTHREAD_COND_INITIALIZER;
+static int handled = 0;
+
+static void _handled(void)
+{
+	slurm_mutex_lock(&handled_lock);
+	handled++;
+	slurm_cond_signal(&handled_cond);
+	slurm_mutex_unlock(&handled_lock);
+}
+
+/* Wait until the handlers have been called cnt times in total */
+static void _wait_handled(int cnt)
+{
+	slurm_mutex_lock(&handled_lock);
+	while (handled < cnt)
+		slurm_cond_wait(&handled_cond, &handled_lock);
+	slurm_mutex_unlock(&handled_lock);
+}
+
+static bool _readable(eio_obj_t *obj)
+{
+	return !obj->shutdown;
+}
+
+static int _read_eventfd(eio_obj_t *obj, List objs)
+{
+	uint64_t val;
+
+	if (read(obj->fd, &val, sizeof(val)) != sizeof(val))
+		return SLURM_ERROR;
+	_handled();
+	return SLURM_SUCCESS;
+}
+
+static struct io_operations eventfd_ops = {
+	.readable = _readable,
+	.handle_read = _read_eventfd,
+};
+
+static void *_mainloop(void *arg)
+{
+	eio_handle_mainloop(arg);
+	return NULL;
+}
+
+/* Start the mainloop of a new eio handle with objs */
+static eio_handle_t *_start(eio_obj_t **objs, int cnt, pthread_t *thread)
+{
+	eio_handle_t *eio = eio_handle_create(0);
+
+	for (int i = 0; i < cnt; i++)
+		eio_new_initial_obj(eio, objs[i]);
+	slurm_thread_create(thread, _mainloop, eio);
+
+	return eio;
+}
+
+static void _stop(eio_handle_t *eio, pthread_t thread)
+{
+	eio_signal_shutdown(eio);
+	pthread_join(thread, NULL);
+	eio_handle_destroy(eio);
+}
+
+static void _signal_eventfd(int fd)
+{
+	uint64_t val = 1;
+
+	ck_assert(write(fd, &val, sizeof(val)) == sizeof(val));
+}
+
+START_TEST(test_read)
+{
+	int fds[3];
+	eio_obj_t *objs[3];
+	eio_handle_t *eio;
+	pthread_t thread;
+
+	handled = 0;
+	for (int i = 0; i < 3; i++) {
+		fds[i] = eventfd(0, EFD_NONBLOCK);
+		objs[i] = eio_obj_create(fds[i], &eventfd_ops, NULL);
+	}
+	eio = _start(objs, 3, &thread);
+
+	for (int i = 0; i < 30; i++) {
+		_signal_eventfd(fds[i % 3]);
+		_wait_handled(i + 1);
+	}
+
+	/* New objects are picked up by the running mainloop */
+	fds[0] = eventfd(0, EFD_NONBLOCK);
+	eio_new_obj(eio, eio_obj_create(fds[0], &eventfd_ops, NULL));
+	_signal_eventfd(fds[0]);
+	_wait_handled(31);
+
+	_stop(eio, thread);
+	ck_assert_int_eq(handled, 31);
+}
+END_TEST
+
+static bool _writable(eio_obj_t *obj)
+{
+	int *pending = obj->arg;
+
+	return !obj->shutdown && *pending;
+}
+
+static int _write_byte(eio_obj_t *obj, List objs)
+{
+	int *pending = obj->arg;
+
+	if (write(obj->fd, "x", 1) != 1)
+		return SLURM_ERROR;
+	(*pending)--;
+	_handled();
+	return SLURM_SUCCESS;
+}
+
+static int _read_byte(eio_obj_t *obj, List objs)
+{
+	char c;
+
+	if (read(obj->fd, &c, 1) != 1)
+		return SLURM_ERROR;
+	_handled();
+	return SLURM_SUCCESS;
+}
+
+static struct io_operations read_ops = {
+	.readable = _readable,
+	.handle_read = _read_byte,
+};
+
+static struct io_operations write_ops = {
+	.writable = _writable,
+	.handle_write = _write_byte,
+};
+
+/* A reader and a writer on the same fd, as done for a pty */
+START_TEST(test_shared_fd)
+{
+	int sv[2];
+	int pending = 0;
+	eio_obj_t *objs[2];
+	eio_handle_t *eio;
+	pthread_t thread;
+	char c;
+
+	handled = 0;
+	ck_assert(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+	objs[0] = eio_obj_create(sv[0], &read_ops, NULL);
+	objs[1] = eio_obj_create(sv[0], &write_ops, &pending);
+	eio = _start(objs, 2, &thread);
+
+	/* Read side */
+	ck_assert(write(sv[1], "a", 1) == 1);
+	_wait_handled(1);
+
+	/* Write side, only polled once it has something to write */
+	pending = 1;
+	eio_signal_wakeup(eio);
+	_wait_handled(2);
+	ck_assert(read(sv[1], &c, 1) == 1);
+	ck_assert(c == 'x');
+
+	_stop(eio, thread);
+	ck_assert_int_eq(handled, 2);
+	close(sv[0]);
+	close(sv[1]);
+}
+END_TEST
+
+/* Regular files can not be polled by epoll, they are always ready */
+START_TEST(test_regular_file)
+{
+	char path[] = "/tmp/eio-test.XXXXXX";
+	int fd = mkstemp(path);
+	int pending = 3;
+	eio_obj_t *obj;
+	eio_handle_t *eio;
+	pthread_t thread;
+
+	handled = 0;
+	ck_assert(fd >= 0);
+	unlink(path);
+	obj = eio_obj_create(fd, &write_ops, &pending);
+	eio = _start(&obj, 1, &thread);
+
+	/* The mainloop returns once nothing is left to write */
+	pthread_join(thread, NULL);
+	eio_handle_destroy(eio);
+	ck_assert_int_eq(pending, 0);
+	ck_assert(lseek(fd, 0, SEEK_END) == 3);
+	close(fd);
+}
+END_TEST
+
+static int _replace_eventfd(eio_obj_t *obj, List objs)
+{
+	int *new_fd = obj->arg;
+
+	close(obj->fd);
+	obj->fd = *new_fd;
+	_handled();
+	return SLURM_SUCCESS;
+}
+
+static struct io_operations replace_ops = {
+	.readable = _readable,
+	.handle_read = _replace_eventfd,
+};
+
+/* A handler closing its fd and replacing it with another */
+START_TEST(test_replace_fd)
+{
+	int fd = eventfd(0, EFD_NONBLOCK);
+	int new_fd = eventfd(0, EFD_NONBLOCK);
+	eio_obj_t *obj;
+	eio_handle_t *eio;
+	pthread_t thread;
+
+	handled = 0;
+	obj = eio_obj_create(fd, &replace_ops, &new_fd);
+	eio = _start(&obj, 1, &thread);
+
+	_signal_eventfd(fd);
+	_wait_handled(1);
+
+	/* Events come from the new fd now */
+	obj->ops->handle_read = _read_eventfd;
+	_signal_eventfd(new_fd);
+	_wait_handled(2);
+
+	_stop(eio, thread);
+	ck_assert_int_eq(handled, 2);
+	close(new_fd);
+}
+END_TEST
+
+static int _reuse_eventfd(eio_obj_t *obj, List objs)
+{
+	int *new_fd = obj->arg;
+
+	/* The old eventfd is closed, the new one gets the same number */
+	ck_assert(dup2(*new_fd, obj->fd) == obj->fd);
+	close(*new_fd);
+	*new_fd = obj->fd;
+	_handled();
+	return SLURM_SUCCESS;
+}
+
+static int reuse_errors = 0;
+
+static int _reuse_error(eio_obj_t *obj, List objs)
+{
+	reuse_errors++;
+	return SLURM_SUCCESS;
+}
+
+static struct io_operations reuse_ops = {
+	.readable = _readable,
+	.handle_read = _reuse_eventfd,
+	.handle_error = _reuse_error,
+};
+
+/* A handler replacing its fd with another on the same number */
+START_TEST(test_reuse_fd)
+{
+	int fd = eventfd(0, EFD_NONBLOCK);
+	int new_fd = eventfd(0, EFD_NONBLOCK);
+	eio_obj_t *obj;
+	eio_handle_t *eio;
+	pthread_t thread;
+
+	handled = 0;
+	reuse_errors = 0;
+	obj = eio_obj_create(fd, &reuse_ops, &new_fd);
+	eio = _start(&obj, 1, &thread);
+
+	_signal_eventfd(fd);
+	_wait_handled(1);
+	ck_assert_int_eq(new_fd, fd);
+
+	/* The new file is registered again rather than taken as closed */
+	obj->ops->handle_read = _read_eventfd;
+	_signal_eventfd(fd);
+	_wait_handled(2);
+
+	_stop(eio, thread);
+	ck_assert_int_eq(handled, 2);
+	ck_assert_int_eq(reuse_errors, 0);
+	close(fd);
+}
+END_TEST
+
+/*
+ * Time from an object becoming readable until its handler gets called with
+ * BENCH_OBJS idle objects in the mainloop, like slurmstepd and srun have with
+ * thousands of tasks.
+ */
+START_TEST(test_benchmark)
+{
+	int *fds = xcalloc(BENCH_OBJS, sizeof(*fds));
+	eio_obj_t **objs = xcalloc(BENCH_OBJS, sizeof(*objs));
+	eio_handle_t *eio;
+	pthread_t thread;
+	struct rlimit rlim;
+	int cnt = BENCH_OBJS;
+	DEF_TIMERS;
+
+	/* Leave room for other fds */
+	if (!getrlimit(RLIMIT_NOFILE, &rlim)) {
+		rlim.rlim_cur = rlim.rlim_max;
+		(void) setrlimit(RLIMIT_NOFILE, &rlim);
+		if (rlim.rlim_cur < (BENCH_OBJS + 64))
+			cnt = rlim.rlim_cur - 64;
+	}
+
+	handled = 0;
+	for (int i = 0; i < cnt; i++) {
+		ck_assert((fds[i] = eventfd(0, EFD_NONBLOCK)) >= 0);
+		objs[i] = eio_obj_create(fds[i], &eventfd_ops, NULL);
+	}
+	eio = _start(objs, cnt, &thread);
+
+	START_TIMER;
+	for (int i = 0; i < BENCH_WAKEUPS; i++) {
+		_signal_eventfd(fds[(i * 7919) % cnt]);
+		_wait_handled(i + 1);
+	}
+	END_TIMER;
+	info("eio wakeup latency with %d objects: %.1f usec",
+	     cnt, (double) DELTA_TIMER / BENCH_WAKEUPS);
+
+	_stop(eio, thread);
+	ck_assert_int_eq(handled, BENCH_WAKEUPS);
+
+	for (int i = 0; i < cnt; i++)
+		close(fds[i]);
+	xfree(fds);
+	xfree(objs);
+}
+END_TEST
+
+Suite *suite_eio(void)
+{
+	Suite *s = suite_create("eio");
+	TCase *tc_core = tcase_create("eio");
+	tcase_set_timeout(tc_core, 120); /* Avoid timeouts with --coverage */
+	tcase_add_test(tc_core, test_read);
+	tcase_add_test(tc_core, test_shared_fd);
+	tcase_add_test(tc_core, test_regular_file);
+	tcase_add_test(tc_core, test_replace_fd);
+	tcase_add_test(tc_core, test_reuse_fd);
+	tcase_add_test(tc_core, test_benchmark);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("eio-test", log_opts, 0, NULL);
+
+	int number_failed;
+	SRunner *sr = srunner_create(suite_eio());
+	srunner_run_all(sr, CK_ENV);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,208 @@
+/*****************************************************************************\
+ *  hostlist_bench-test.c - hostlist correctness and performance tests
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/hostlist.h"
+#include "src/common/log.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+/* Number of nodes used by the benchmarks, a large cluster */
+#define BENCH_NODES 20000
+
+START_TEST(test_uniq)
+{
+	hostlist_t *hl = hostlist_create("tux[5-9],tux[1-3],login,tux[2-6],"
+					 "tux[010-012],login,tux4,tux[011-020]");
+	char *str;
+
+	hostlist_uniq(hl);
+	str = hostlist_ranged_string_xmalloc(hl);
+	ck_assert_str_eq(str, "login,tux[1-9,010-020]");
+	ck_assert_int_eq(hostlist_count(hl), 21);
+	xfree(str);
+	hostlist_destroy(hl);
+}
+END_TEST
+
+START_TEST(test_copy_push)
+{
+	hostlist_t *hl = hostlist_create("tux[1-3]");
+	hostlist_t *copy = hostlist_copy(hl);
+	char *str;
+
+	/* copies share prefixes, changing one must not change the other */
+	hostlist_push_host(copy, "tux5");
+	hostlist_push_host(copy, "login");
+	hostlist_destroy(hl);
+
+	str = hostlist_ranged_string_xmalloc(copy);
+	ck_assert_str_eq(str, "tux[1-3,5],login");
+	xfree(str);
+
+	hl = hostlist_create(NULL);
+	for (int i = 0; i < 40; i += 2) {
+		str = xstrdup_printf("tux%d", i);
+		hostlist_push_host(hl, str);
+		xfree(str);
+	}
+	hostlist_push_list(hl, copy);
+	hostlist_destroy(copy);
+	ck_assert_int_eq(hostlist_count(hl), 25);
+	str = hostlist_shift(hl);
+	ck_assert_str_eq(str, "tux0");
+	free(str);
+	hostlist_uniq(hl);
+	str = hostlist_ranged_string_xmalloc(hl);
+	ck_assert_str_eq(str, "login,tux[1-6,8,10,12,14,16,18,20,22,24,26,28,"
+			 "30,32,34,36,38]");
+	xfree(str);
+	hostlist_destroy(hl);
+}
+END_TEST
+
+START_TEST(test_hostset_insert)
+{
+	hostset_t *hs = hostset_create("tux[10-20]");
+	char *str;
+
+	ck_assert_int_eq(hostset_insert(hs, "tux[30-40]"), 11);
+	ck_assert_int_eq(hostset_insert(hs, "tux[1-5]"), 5);
+	ck_assert_int_eq(hostset_insert(hs, "tux[18-32]"), 9);
+	ck_assert_int_eq(hostset_insert(hs, "tux25"), 0);
+	ck_assert_int_eq(hostset_insert(hs, "login"), 1);
+	str = hostset_ranged_string_xmalloc(hs);
+	ck_assert_str_eq(str, "login,tux[1-5,10-40]");
+	xfree(str);
+	hostset_destroy(hs);
+}
+END_TEST
+
+/*
+ * Time common operations on a cluster sized hostlist. Every other node is
+ * used so that each host is its own range, the worst case for squeue and
+ * sinfo output of fragmented allocations.
+ */
+START_TEST(test_benchmark)
+{
+	hostlist_t *hl, *copy;
+	hostset_t *hs;
+	char name[32], *str;
+	DEF_TIMERS;
+
+	hl = hostlist_create(NULL);
+	START_TIMER;
+	for (int i = 0; i < BENCH_NODES; i += 2) {
+		snprintf(name, sizeof(name), "tux%05d", i);
+		hostlist_push_host(hl, name);
+	}
+	END_TIMER;
+	info("hostlist_push_host of %d hosts: %s", BENCH_NODES / 2, TIME_STR);
+
+	START_TIMER;
+	copy = hostlist_copy(hl);
+	END_TIMER;
+	info("hostlist_copy of %d ranges: %s", BENCH_NODES / 2, TIME_STR);
+
+	START_TIMER;
+	for (int i = BENCH_NODES - 1; i > 0; i -= 2) {
+		snprintf(name, sizeof(name), "tux%05d", i);
+		hostlist_push_host(copy, name);
+	}
+	hostlist_uniq(copy);
+	END_TIMER;
+	info("hostlist_uniq of %d reversed ranges: %s", BENCH_NODES, TIME_STR);
+	ck_assert_int_eq(hostlist_count(copy), BENCH_NODES);
+	str = hostlist_ranged_string_xmalloc(copy);
+	ck_assert_str_eq(str, "tux[00000-19999]");
+	xfree(str);
+
+	START_TIMER;
+	str = hostlist_ranged_string_xmalloc(hl);
+	END_TIMER;
+	info("hostlist_ranged_string of %d ranges: %s", BENCH_NODES / 2,
+	     TIME_STR);
+	ck_assert_int_eq(strlen(str), 4 + (BENCH_NODES / 2) * 6);
+	xfree(str);
+
+	hs = hostset_create(NULL);
+	START_TIMER;
+	for (int i = 0; i < BENCH_NODES; i += 2) {
+		snprintf(name, sizeof(name), "tux%05d", i);
+		hostset_insert(hs, name);
+	}
+	END_TIMER;
+	info("hostset_insert of %d hosts: %s", BENCH_NODES / 2, TIME_STR);
+	ck_assert_int_eq(hostset_count(hs), BENCH_NODES / 2);
+
+	hostset_destroy(hs);
+	hostlist_destroy(copy);
+	hostlist_destroy(hl);
+}
+END_TEST
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("hostlist_bench");
+	TCase *tc_core = tcase_create("hostlist_bench");
+	tcase_set_timeout(tc_core, 60); /* Avoid timeouts with --coverage */
+	tcase_add_test(tc_core, test_uniq);
+	tcase_add_test(tc_core, test_copy_push);
+	tcase_add_test(tc_core, test_hostset_insert);
+	tcase_add_test(tc_core, test_benchmark);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("hostlist_bench-test", log_opts, 0, NULL);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	log_fini();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
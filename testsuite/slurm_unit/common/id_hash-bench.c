@@ -0,0 +1,132 @@
+/*****************************************************************************\
+ *  id_hash-bench.c - lookup benchmark for id_hash
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+/*
+ * Not part of "make check", build and run it with "make id_hash-bench".
+ * Usage: id_hash-bench [record_count]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "src/common/id_hash.h"
+#include "src/common/log.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+
+#define BENCH_RECORDS 1000000
+
+typedef struct rec {
+	uint32_t id;
+	struct rec *next;		/* for the chained table */
+} rec_t;
+
+/* Visit the records in a scattered order */
+static uint32_t _bench_id(uint32_t i, uint32_t cnt)
+{
+	return (uint32_t) ((((uint64_t) i) * 7919) % cnt) + 1;
+}
+
+/* Table with a fixed number of chained buckets, as job_mgr.c used to use */
+static uint32_t _chained_find(rec_t **chained, uint32_t size, uint32_t id)
+{
+	rec_t *rec = chained[id % size];
+
+	while (rec && (rec->id != id))
+		rec = rec->next;
+
+	return rec ? rec->id : 0;
+}
+
+/*
+ * Compare lookup latency with the chained table job_mgr.c used to use for
+ * find_job_record(). Both tables are sized for the record count.
+ */
+int main(int argc, char **argv)
+{
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	uint32_t cnt = BENCH_RECORDS;
+	rec_t *recs, **chained;
+	id_hash_t *table;
+	uint64_t sum = 0;
+	DEF_TIMERS;
+
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("id_hash-bench", log_opts, 0, NULL);
+
+	if ((argc > 1) && ((cnt = strtoul(argv[1], NULL, 10)) < 1)) {
+		error("Usage: %s [record_count]", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	recs = xcalloc(cnt, sizeof(*recs));
+	chained = xcalloc(cnt, sizeof(*chained));
+	table = id_hash_create(cnt);
+	for (uint32_t i = 0; i < cnt; i++) {
+		rec_t **head;
+
+		recs[i].id = i + 1;
+		head = &chained[recs[i].id % cnt];
+		recs[i].next = *head;
+		*head = &recs[i];
+		id_hash_add(table, recs[i].id, &recs[i]);
+	}
+
+	START_TIMER;
+	for (uint32_t i = 0; i < cnt; i++)
+		sum += _chained_find(chained, cnt, _bench_id(i, cnt));
+	END_TIMER;
+	info("chained find of %u records: %s", cnt, TIME_STR);
+
+	START_TIMER;
+	for (uint32_t i = 0; i < cnt; i++) {
+		rec_t *rec = id_hash_find(table, _bench_id(i, cnt));
+		sum -= rec->id;
+	}
+	END_TIMER;
+	info("id_hash find of %u records: %s", cnt, TIME_STR);
+
+	id_hash_destroy(table);
+	xfree(chained);
+	xfree(recs);
+	log_fini();
+
+	if (sum) {
+		error("lookups returned different records");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*****************************************************************************\
+ *  id_hash-test.c - unit tests for id_hash
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/id_hash.h"
+#include "src/common/log.h"
+#include "src/common/xmalloc.h"
+
+typedef struct rec {
+	uint32_t id;
+} rec_t;
+
+static rec_t *_make_recs(int cnt)
+{
+	rec_t *recs = xcalloc(cnt, sizeof(*recs));
+
+	for (int i = 0; i < cnt; i++)
+		recs[i].id = i + 1;
+
+	return recs;
+}
+
+START_TEST(test_add_find)
+{
+	id_hash_t *table = id_hash_create(0);
+	rec_t *recs = _make_recs(1000);
+
+	for (int i = 0; i < 1000; i++)
+		ck_assert(id_hash_add(table, recs[i].id, &recs[i]) == NULL);
+	ck_assert_int_eq(id_hash_count(table), 1000);
+
+	for (int i = 0; i < 1000; i++)
+		ck_assert(id_hash_find(table, recs[i].id) == &recs[i]);
+	ck_assert(id_hash_find(table, 0) == NULL);
+	ck_assert(id_hash_find(table, 1001) == NULL);
+
+	/* Replacing an entry returns the old item */
+	ck_assert(id_hash_add(table, 1, &recs[1]) == &recs[0]);
+	ck_assert(id_hash_find(table, 1) == &recs[1]);
+	ck_assert_int_eq(id_hash_count(table), 1000);
+
+	id_hash_destroy(table);
+	xfree(recs);
+}
+END_TEST
+
+START_TEST(test_remove)
+{
+	id_hash_t *table = id_hash_create(16);
+	rec_t *recs = _make_recs(5000);
+
+	for (int i = 0; i < 5000; i++)
+		id_hash_add(table, recs[i].id, &recs[i]);
+
+	/* Only remove matching item */
+	ck_assert(!id_hash_remove(table, recs[0].id, &recs[1]));
+	ck_assert(id_hash_remove(table, recs[0].id, &recs[0]));
+	ck_assert(!id_hash_remove(table, recs[0].id, NULL));
+
+	/* Remove every other entry, the rest must remain reachable */
+	for (int i = 2; i < 5000; i += 2)
+		ck_assert(id_hash_remove(table, recs[i].id, NULL));
+	ck_assert_int_eq(id_hash_count(table), 2500);
+
+	for (int i = 0; i < 5000; i++) {
+		if ((i % 2) == 0)
+			ck_assert(id_hash_find(table, recs[i].id) == NULL);
+		else
+			ck_assert(id_hash_find(table, recs[i].id) == &recs[i]);
+	}
+
+	id_hash_destroy(table);
+	xfree(recs);
+}
+END_TEST
+
+static int _count_cb(uint64_t key, void *item, void *arg)
+{
+	rec_t *rec = item;
+	int *cnt = arg;
+
+	if (rec->id == key)
+		(*cnt)++;
+
+	return 0;
+}
+
+START_TEST(test_for_each)
+{
+	id_hash_t *table = id_hash_create(0);
+	rec_t *recs = _make_recs(300);
+	int cnt = 0;
+
+	for (int i = 0; i < 300; i++)
+		id_hash_add(table, recs[i].id, &recs[i]);
+
+	ck_assert_int_eq(id_hash_for_each(table, _count_cb, &cnt), 300);
+	ck_assert_int_eq(cnt, 300);
+
+	id_hash_destroy(table);
+	xfree(recs);
+}
+END_TEST
+
+Suite *suite_id_hash(void)
+{
+	Suite *s = suite_create("id_hash");
+	TCase *tc_core = tcase_create("id_hash");
+	tcase_add_test(tc_core, test_add_find);
+	tcase_add_test(tc_core, test_remove);
+	tcase_add_test(tc_core, test_for_each);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("id_hash-test", log_opts, 0, NULL);
+
+	int number_failed;
+	SRunner *sr = srunner_create(suite_id_hash());
+	srunner_run_all(sr, CK_ENV);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,180 @@
+/*****************************************************************************\
+ *  node_conf-test.c - tests for node name to bitmap conversion
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/bitstring.h"
+#include "src/common/hostlist.h"
+#include "src/common/log.h"
+#include "src/common/node_conf.h"
+#include "src/common/xhash.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+/* Node table: tux[0-9], tux[010-019], tux020, tux15 and login */
+static void _build_nodes(void)
+{
+	config_record_t *config_ptr;
+	char name[32];
+
+	init_node_conf();
+	config_ptr = create_config_record();
+	for (int i = 0; i < 10; i++) {
+		snprintf(name, sizeof(name), "tux%d", i);
+		create_node_record(config_ptr, name);
+	}
+	for (int i = 10; i < 21; i++) {
+		snprintf(name, sizeof(name), "tux%03d", i);
+		create_node_record(config_ptr, name);
+	}
+	create_node_record(config_ptr, "tux15");
+	create_node_record(config_ptr, "login");
+	rehash_node();
+}
+
+static char *_bitmap_fmt(char *node_names, bool best_effort, int *rc)
+{
+	bitstr_t *bitmap = NULL;
+	char *str;
+
+	*rc = node_name2bitmap(node_names, best_effort, &bitmap);
+	str = bit_fmt_full(bitmap);
+	FREE_NULL_BITMAP(bitmap);
+	return str;
+}
+
+START_TEST(test_node_name2bitmap)
+{
+	struct {
+		char *names;
+		char *bits;
+		int rc;
+	} tests[] = {
+		{ "tux[0-9]", "0-9", 0 },
+		{ "tux[2-4,7]", "2-4,7", 0 },
+		{ "tux[010-020]", "10-20", 0 },
+		{ "tux[8-15]", "8-9,21", EINVAL },
+		{ "tux[015],tux15", "15,21", 0 },
+		{ "tux[000-001]", NULL, EINVAL },
+		{ "tux[5-6],login", "5-6,22", 0 },
+		{ "tux[19-21]", NULL, EINVAL },
+		{ "tux[018-021]", "18-20", EINVAL },
+		{ "nosuch[1-3]", NULL, EINVAL },
+		{ "tux[0-9],tux[010-020],tux15,login", "0-22", 0 },
+	};
+
+	for (int i = 0; i < ARRAY_SIZE(tests); i++) {
+		int rc;
+		char *bits = _bitmap_fmt(tests[i].names, false, &rc);
+
+		ck_assert_msg(!xstrcmp(bits, tests[i].bits),
+			      "%s: got \"%s\" expected \"%s\"",
+			      tests[i].names, bits, tests[i].bits);
+		ck_assert_int_eq(rc, tests[i].rc);
+		xfree(bits);
+	}
+}
+END_TEST
+
+START_TEST(test_node_name2bitmap_delete)
+{
+	int rc;
+	char *bits;
+
+	/* As delete_node() does */
+	xhash_pop_str(node_hash_table, node_record_table_ptr[5]->name);
+	delete_node_record(node_record_table_ptr[5]);
+	bits = _bitmap_fmt("tux[3-7]", false, &rc);
+	ck_assert_str_eq(bits, "3-4,6-7");
+	ck_assert_int_eq(rc, EINVAL);
+	xfree(bits);
+}
+END_TEST
+
+static int _count_ranges(const char *prefix, unsigned long lo,
+			 unsigned long hi, int width, void *arg)
+{
+	int *cnt = arg;
+
+	if (width >= 0)
+		cnt[0] += hi - lo + 1;
+	else
+		cnt[1]++;
+	return 0;
+}
+
+START_TEST(test_hostlist_for_each_range)
+{
+	hostlist_t *hl = hostlist_create("tux[0-1023],login,tux[02000-02999]");
+	int cnt[2] = { 0, 0 };
+
+	ck_assert_int_eq(hostlist_for_each_range(hl, _count_ranges, cnt), 0);
+	ck_assert_int_eq(cnt[0], 2024);
+	ck_assert_int_eq(cnt[1], 1);
+	hostlist_destroy(hl);
+}
+END_TEST
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("node_conf");
+	TCase *tc_core = tcase_create("node_conf");
+
+	tcase_add_checked_fixture(tc_core, _build_nodes, node_fini2);
+	tcase_add_test(tc_core, test_node_name2bitmap);
+	tcase_add_test(tc_core, test_node_name2bitmap_delete);
+	tcase_add_test(tc_core, test_hostlist_for_each_range);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_QUIET;
+	log_init("node_conf-test", log_opts, 0, NULL);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	log_fini();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
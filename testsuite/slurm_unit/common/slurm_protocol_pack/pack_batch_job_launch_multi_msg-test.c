@@ -0,0 +1,241 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/common/slurm_protocol_common.h"
+#include "src/interfaces/cred.h"
+#include "src/interfaces/gres.h"
+
+/*
+ * Build an unsigned credential for job_id without the cred plugin, packing
+ * the fields of the current credential format with only the step set.
+ */
+static slurm_cred_t *_fake_cred(uint32_t job_id)
+{
+	slurm_step_id_t step_id = {
+		.job_id = job_id,
+		.step_id = SLURM_BATCH_SCRIPT,
+		.step_het_comp = NO_VAL,
+	};
+	slurm_cred_t *cred = xmalloc(sizeof(*cred));
+	buf_t *buf = init_buf(1024);
+
+	slurm_rwlock_init(&cred->mutex);
+	cred->magic = CRED_MAGIC;
+	cred->buffer = buf;
+	cred->buf_version = SLURM_PROTOCOL_VERSION;
+
+	pack_step_id(&step_id, buf, SLURM_PROTOCOL_VERSION);
+	pack32(1000, buf);			/* uid */
+	pack32(1000, buf);			/* gid */
+	packnull(buf);				/* pw_name */
+	packnull(buf);				/* pw_gecos */
+	packnull(buf);				/* pw_dir */
+	packnull(buf);				/* pw_shell */
+	pack32_array(NULL, 0, buf);		/* gids */
+	packstr_array(NULL, 0, buf);		/* gr_names */
+	(void) gres_job_state_pack(NULL, buf, job_id, false,
+				   SLURM_PROTOCOL_VERSION);
+	gres_step_state_pack(NULL, buf, &step_id, SLURM_PROTOCOL_VERSION);
+	pack16(0, buf);				/* job_core_spec */
+	packnull(buf);				/* job_account */
+	packnull(buf);				/* job_alias_list */
+	packnull(buf);				/* job_comment */
+	packnull(buf);				/* job_constraints */
+	pack_time(0, buf);			/* job_end_time */
+	packnull(buf);				/* job_extra */
+	pack16(0, buf);				/* job_oversubscribe */
+	packnull(buf);				/* job_partition */
+	packnull(buf);				/* job_reservation */
+	pack16(0, buf);				/* job_restart_cnt */
+	pack_time(0, buf);			/* job_start_time */
+	packnull(buf);				/* job_std_err */
+	packnull(buf);				/* job_std_in */
+	packnull(buf);				/* job_std_out */
+	packnull(buf);				/* step_hostlist */
+	pack16(0, buf);				/* x11 */
+	pack_time(time(NULL), buf);		/* ctime */
+	pack32(0, buf);				/* tot_core_cnt */
+	pack_bit_str_hex(NULL, buf);		/* job_core_bitmap */
+	pack_bit_str_hex(NULL, buf);		/* step_core_bitmap */
+	pack16(0, buf);				/* core_array_size */
+	pack32(0, buf);				/* cpu_array_count */
+	pack32(1, buf);				/* job_nhosts */
+	pack32(1, buf);				/* job_ntasks */
+	packnull(buf);				/* job_hostlist */
+	packnull(buf);				/* job_licenses */
+	pack32(0, buf);				/* job_mem_alloc_size */
+	pack32(0, buf);				/* step_mem_alloc_size */
+	packnull(buf);				/* selinux_context */
+
+	return cred;
+}
+
+static batch_job_launch_msg_t *_launch_msg(uint32_t job_id)
+{
+	batch_job_launch_msg_t *launch = xmalloc(sizeof(*launch));
+
+	launch->job_id = job_id;
+	launch->het_job_id = NO_VAL;
+	launch->uid = 1000;
+	launch->gid = 1000;
+	launch->ntasks = 1;
+	launch->array_job_id = 0;
+	launch->array_task_id = NO_VAL;
+	launch->nodes = xstrdup("node1");
+	launch->partition = xstrdup("debug");
+	launch->script = xstrdup_printf("#!/bin/sh\necho %u\n", job_id);
+	launch->work_dir = xstrdup("/tmp");
+	launch->std_out = xstrdup_printf("slurm-%u.out", job_id);
+	launch->cred = _fake_cred(job_id);
+
+	return launch;
+}
+
+START_TEST(pack_current_msg)
+{
+	int rc;
+	buf_t *buf = init_buf(1024);
+	slurm_msg_t msg = {0};
+	batch_job_launch_msg_t *launch_msgs[] = {
+		_launch_msg(100),
+		_launch_msg(101),
+		_launch_msg(102),
+	};
+	batch_job_launch_multi_msg_t pack_multi = {
+		.job_cnt = ARRAY_SIZE(launch_msgs),
+		.launch_msgs = launch_msgs,
+	};
+	batch_job_launch_multi_msg_t *unpack_multi;
+
+	msg.msg_type         = REQUEST_BATCH_JOB_LAUNCH_MULTI;
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+	msg.data             = &pack_multi;
+
+	rc = pack_msg(&msg, buf);
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+
+	set_buf_offset(buf, 0);
+	msg.data = NULL;
+
+	rc = unpack_msg(&msg, buf);
+	unpack_multi = msg.data;
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+	ck_assert(unpack_multi);
+	ck_assert_uint_eq(unpack_multi->job_cnt, pack_multi.job_cnt);
+	for (int i = 0; i < pack_multi.job_cnt; i++) {
+		batch_job_launch_msg_t *pack_launch = launch_msgs[i];
+		batch_job_launch_msg_t *unpack_launch =
+			unpack_multi->launch_msgs[i];
+
+		ck_assert(unpack_launch);
+		ck_assert_uint_eq(unpack_launch->job_id, pack_launch->job_id);
+		ck_assert_uint_eq(unpack_launch->het_job_id,
+				  pack_launch->het_job_id);
+		ck_assert_uint_eq(unpack_launch->uid, pack_launch->uid);
+		ck_assert_uint_eq(unpack_launch->gid, pack_launch->gid);
+		ck_assert_uint_eq(unpack_launch->ntasks, pack_launch->ntasks);
+		ck_assert_uint_eq(unpack_launch->array_task_id,
+				  pack_launch->array_task_id);
+		ck_assert_str_eq(unpack_launch->nodes, pack_launch->nodes);
+		ck_assert_str_eq(unpack_launch->partition,
+				 pack_launch->partition);
+		ck_assert_str_eq(unpack_launch->script, pack_launch->script);
+		ck_assert_str_eq(unpack_launch->work_dir,
+				 pack_launch->work_dir);
+		ck_assert_str_eq(unpack_launch->std_out, pack_launch->std_out);
+		ck_assert(unpack_launch->cred);
+		ck_assert_uint_eq(unpack_launch->cred->arg->step_id.job_id,
+				  pack_launch->job_id);
+	}
+
+	free_buf(buf);
+	slurm_free_msg_data(msg.msg_type, msg.data);
+	for (int i = 0; i < ARRAY_SIZE(launch_msgs); i++)
+		slurm_free_job_launch_msg(launch_msgs[i]);
+}
+END_TEST
+
+START_TEST(pack_empty_msg)
+{
+	int rc;
+	buf_t *buf = init_buf(1024);
+	slurm_msg_t msg = {0};
+	batch_job_launch_multi_msg_t pack_multi = {0};
+	batch_job_launch_multi_msg_t *unpack_multi;
+
+	msg.msg_type         = REQUEST_BATCH_JOB_LAUNCH_MULTI;
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+	msg.data             = &pack_multi;
+
+	rc = pack_msg(&msg, buf);
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+
+	set_buf_offset(buf, 0);
+	msg.data = NULL;
+
+	rc = unpack_msg(&msg, buf);
+	unpack_multi = msg.data;
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+	ck_assert(unpack_multi);
+	ck_assert_uint_eq(unpack_multi->job_cnt, 0);
+
+	free_buf(buf);
+	slurm_free_msg_data(msg.msg_type, msg.data);
+}
+END_TEST
+
+START_TEST(unpack_too_many_jobs)
+{
+	int rc;
+	buf_t *buf = init_buf(1024);
+	slurm_msg_t msg = {0};
+
+	pack32(BATCH_LAUNCH_MAX_JOBS + 1, buf);
+	set_buf_offset(buf, 0);
+
+	msg.msg_type         = REQUEST_BATCH_JOB_LAUNCH_MULTI;
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+
+	rc = unpack_msg(&msg, buf);
+	ck_assert_int_ne(rc, SLURM_SUCCESS);
+	ck_assert(!msg.data);
+
+	free_buf(buf);
+}
+END_TEST
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("Pack batch_job_launch_multi_msg_t");
+	TCase *tc_core = tcase_create("Pack batch_job_launch_multi_msg_t");
+	tcase_add_test(tc_core, pack_current_msg);
+	tcase_add_test(tc_core, pack_empty_msg);
+	tcase_add_test(tc_core, unpack_too_many_jobs);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
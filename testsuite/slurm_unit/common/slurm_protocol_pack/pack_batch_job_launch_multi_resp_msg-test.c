@@ -0,0 +1,112 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/slurm_protocol_pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/slurm_protocol_common.h"
+
+START_TEST(pack_current_resp)
+{
+	int rc;
+	buf_t *buf = init_buf(1024);
+	slurm_msg_t msg = {0};
+	uint32_t job_ids[] = { 100, 101, 102 };
+	uint32_t return_codes[] = { SLURM_SUCCESS, ESLURM_DUPLICATE_JOB_ID,
+				    ESLURMD_PROLOG_FAILED };
+	batch_job_launch_multi_resp_msg_t pack_resp = {
+		.job_cnt = ARRAY_SIZE(job_ids),
+		.job_ids = job_ids,
+		.return_codes = return_codes,
+	};
+	batch_job_launch_multi_resp_msg_t *unpack_resp;
+
+	msg.msg_type         = RESPONSE_BATCH_JOB_LAUNCH_MULTI;
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+	msg.data             = &pack_resp;
+
+	rc = pack_msg(&msg, buf);
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+
+	set_buf_offset(buf, 0);
+	msg.data = NULL;
+
+	rc = unpack_msg(&msg, buf);
+	unpack_resp = msg.data;
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+	ck_assert(unpack_resp);
+	ck_assert_uint_eq(unpack_resp->job_cnt, pack_resp.job_cnt);
+	for (int i = 0; i < pack_resp.job_cnt; i++) {
+		ck_assert_uint_eq(unpack_resp->job_ids[i], job_ids[i]);
+		ck_assert_uint_eq(unpack_resp->return_codes[i],
+				  return_codes[i]);
+	}
+	/* The first error is the return code of the whole reply */
+	ck_assert_int_eq(slurm_get_return_code(msg.msg_type, msg.data),
+			 ESLURM_DUPLICATE_JOB_ID);
+
+	free_buf(buf);
+	slurm_free_msg_data(msg.msg_type, msg.data);
+}
+END_TEST
+
+START_TEST(pack_empty_resp)
+{
+	int rc;
+	buf_t *buf = init_buf(1024);
+	slurm_msg_t msg = {0};
+	batch_job_launch_multi_resp_msg_t pack_resp = {0};
+	batch_job_launch_multi_resp_msg_t *unpack_resp;
+
+	msg.msg_type         = RESPONSE_BATCH_JOB_LAUNCH_MULTI;
+	msg.protocol_version = SLURM_PROTOCOL_VERSION;
+	msg.data             = &pack_resp;
+
+	rc = pack_msg(&msg, buf);
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+
+	set_buf_offset(buf, 0);
+	msg.data = NULL;
+
+	rc = unpack_msg(&msg, buf);
+	unpack_resp = msg.data;
+	ck_assert_int_eq(rc, SLURM_SUCCESS);
+	ck_assert(unpack_resp);
+	ck_assert_uint_eq(unpack_resp->job_cnt, 0);
+	ck_assert_int_eq(slurm_get_return_code(msg.msg_type, msg.data),
+			 SLURM_SUCCESS);
+
+	free_buf(buf);
+	slurm_free_msg_data(msg.msg_type, msg.data);
+}
+END_TEST
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("Pack batch_job_launch_multi_resp_msg_t");
+	TCase *tc_core = tcase_create("Pack batch_job_launch_multi_resp_msg_t");
+	tcase_add_test(tc_core, pack_current_resp);
+	tcase_add_test(tc_core, pack_empty_resp);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/slurmdbd_defs.h"
+#include "src/common/slurmdbd_pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/slurm_protocol_common.h"
+#include "src/common/list.h"
+#include "src/common/pack.h"
+
+static buf_t *_pack_mult_msg(uint16_t msg_type, uint32_t seq,
+			     uint16_t protocol_version)
+{
+	dbd_list_msg_t list_msg = { 0 };
+	persist_msg_t req = {
+		.msg_type = msg_type,
+		.data = &list_msg,
+	};
+	buf_t *buf;
+
+	list_msg.my_list = list_create(slurmdbd_free_buffer);
+	list_msg.seq = seq;
+	for (int i = 0; i < 3; i++) {
+		buf_t *sub = init_buf(16);
+
+		pack16(DBD_STEP_START, sub);
+		pack32(i, sub);
+		list_append(list_msg.my_list, sub);
+	}
+
+	buf = pack_slurmdbd_msg(&req, protocol_version);
+	FREE_NULL_LIST(list_msg.my_list);
+
+	return buf;
+}
+
+static dbd_list_msg_t *_unpack_mult_msg(buf_t *buf, uint16_t msg_type,
+					uint16_t protocol_version)
+{
+	persist_msg_t resp = { 0 };
+	uint32_t packed = get_buf_offset(buf);
+
+	set_buf_offset(buf, 0);
+	ck_assert(unpack_slurmdbd_msg(&resp, protocol_version, buf) ==
+		  SLURM_SUCCESS);
+	ck_assert(resp.msg_type == msg_type);
+	ck_assert(get_buf_offset(buf) == packed);
+
+	return resp.data;
+}
+
+START_TEST(pack_current_mult_msg)
+{
+	uint16_t types[] = { DBD_SEND_MULT_MSG, DBD_GOT_MULT_MSG };
+
+	for (int i = 0; i < ARRAY_SIZE(types); i++) {
+		buf_t *buf = _pack_mult_msg(types[i], 4242,
+					    SLURM_PROTOCOL_VERSION);
+		dbd_list_msg_t *msg;
+
+		msg = _unpack_mult_msg(buf, types[i], SLURM_PROTOCOL_VERSION);
+		ck_assert(list_count(msg->my_list) == 3);
+		ck_assert(msg->seq == 4242);
+
+		slurmdbd_free_list_msg(msg);
+		free_buf(buf);
+	}
+}
+END_TEST
+
+START_TEST(pack_min_mult_msg)
+{
+	buf_t *buf = _pack_mult_msg(DBD_SEND_MULT_MSG, 4242,
+				    SLURM_MIN_PROTOCOL_VERSION);
+	dbd_list_msg_t *msg;
+
+	msg = _unpack_mult_msg(buf, DBD_SEND_MULT_MSG,
+			       SLURM_MIN_PROTOCOL_VERSION);
+	ck_assert(list_count(msg->my_list) == 3);
+	/* Not sent to older versions, they are never pipelined */
+	ck_assert(msg->seq == 0);
+
+	slurmdbd_free_list_msg(msg);
+	free_buf(buf);
+}
+END_TEST
+
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("Pack DBD_SEND_MULT_MSG");
+	TCase *tc_core = tcase_create("Pack DBD_SEND_MULT_MSG");
+	tcase_add_test(tc_core, pack_current_mult_msg);
+	tcase_add_test(tc_core, pack_min_mult_msg);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
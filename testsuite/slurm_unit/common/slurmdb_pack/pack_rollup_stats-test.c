@@ -0,0 +1,141 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/slurmdb_pack.h"
+#include "src/common/xmalloc.h"
+#include "src/common/slurm_protocol_common.h"
+#include "src/common/list.h"
+#include "src/common/pack.h"
+
+static slurmdb_rollup_stats_t *_create_rollup_stats(void)
+{
+	slurmdb_rollup_stats_t *rollup_stats =
+		xmalloc(sizeof(slurmdb_rollup_stats_t));
+
+	rollup_stats->cluster_name = xstrdup("Giuseppe Peano");
+	for (int i = 0; i < DBD_ROLLUP_COUNT; i++) {
+		rollup_stats->count[i] = 10 + i;
+		rollup_stats->timestamp[i] = 1000 + i;
+		rollup_stats->time_last[i] = 20 + i;
+		rollup_stats->time_max[i] = 30 + i;
+		rollup_stats->time_total[i] = 40 + i;
+		rollup_stats->time_window_max[i] = 50 + i;
+		rollup_stats->windows[i] = 2 + i;
+	}
+
+	return rollup_stats;
+}
+
+START_TEST(invalid_protocol)
+{
+	int rc;
+	uint32_t x;
+	slurmdb_rollup_stats_t *rollup_stats = _create_rollup_stats();
+	slurmdb_rollup_stats_t *unpack_rs;
+	buf_t *buf = init_buf(1024);
+
+	pack32(22, buf);
+	set_buf_offset(buf, 0);
+
+	slurmdb_pack_rollup_stats(rollup_stats, 0, buf);
+	unpack32(&x, buf);
+	rc = slurmdb_unpack_rollup_stats((void **)&unpack_rs, 0, buf);
+	ck_assert_int_eq(rc, SLURM_ERROR);
+	ck_assert(x == 22);
+	free_buf(buf);
+	slurmdb_destroy_rollup_stats(rollup_stats);
+}
+END_TEST
+
+START_TEST(pack_current_rollup_stats)
+{
+	int rc;
+	slurmdb_rollup_stats_t *pack_rs = _create_rollup_stats();
+	slurmdb_rollup_stats_t *unpack_rs;
+	buf_t *buf = init_buf(1024);
+
+	slurmdb_pack_rollup_stats(pack_rs, SLURM_PROTOCOL_VERSION, buf);
+	set_buf_offset(buf, 0);
+	rc = slurmdb_unpack_rollup_stats((void **)&unpack_rs,
+					 SLURM_PROTOCOL_VERSION, buf);
+	ck_assert(rc == SLURM_SUCCESS);
+	ck_assert_str_eq(pack_rs->cluster_name, unpack_rs->cluster_name);
+	for (int i = 0; i < DBD_ROLLUP_COUNT; i++) {
+		ck_assert(pack_rs->count[i] == unpack_rs->count[i]);
+		ck_assert(pack_rs->timestamp[i] == unpack_rs->timestamp[i]);
+		ck_assert(pack_rs->time_last[i] == unpack_rs->time_last[i]);
+		ck_assert(pack_rs->time_max[i] == unpack_rs->time_max[i]);
+		ck_assert(pack_rs->time_total[i] == unpack_rs->time_total[i]);
+		ck_assert(pack_rs->time_window_max[i] ==
+			  unpack_rs->time_window_max[i]);
+		ck_assert(pack_rs->windows[i] == unpack_rs->windows[i]);
+	}
+
+	free_buf(buf);
+	slurmdb_destroy_rollup_stats(pack_rs);
+	slurmdb_destroy_rollup_stats(unpack_rs);
+}
+END_TEST
+
+START_TEST(pack_min_rollup_stats)
+{
+	int rc;
+	uint32_t packed;
+	slurmdb_rollup_stats_t *pack_rs = _create_rollup_stats();
+	slurmdb_rollup_stats_t *unpack_rs;
+	buf_t *buf = init_buf(1024);
+
+	slurmdb_pack_rollup_stats(pack_rs, SLURM_MIN_PROTOCOL_VERSION, buf);
+	packed = get_buf_offset(buf);
+	set_buf_offset(buf, 0);
+	rc = slurmdb_unpack_rollup_stats((void **)&unpack_rs,
+					 SLURM_MIN_PROTOCOL_VERSION, buf);
+	ck_assert(rc == SLURM_SUCCESS);
+	ck_assert_str_eq(pack_rs->cluster_name, unpack_rs->cluster_name);
+	for (int i = 0; i < DBD_ROLLUP_COUNT; i++) {
+		ck_assert(pack_rs->count[i] == unpack_rs->count[i]);
+		ck_assert(pack_rs->time_total[i] == unpack_rs->time_total[i]);
+		/* Not sent to older versions */
+		ck_assert(unpack_rs->time_window_max[i] == 0);
+		ck_assert(unpack_rs->windows[i] == 0);
+	}
+	ck_assert(get_buf_offset(buf) == packed);
+
+	free_buf(buf);
+	slurmdb_destroy_rollup_stats(pack_rs);
+	slurmdb_destroy_rollup_stats(unpack_rs);
+}
+END_TEST
+
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("Pack slurmdb_rollup_stats_t");
+	TCase *tc_core = tcase_create("Pack slurmdb_rollup_stats_t");
+	tcase_add_test(tc_core, invalid_protocol);
+	tcase_add_test(tc_core, pack_current_rollup_stats);
+	tcase_add_test(tc_core, pack_min_rollup_stats);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
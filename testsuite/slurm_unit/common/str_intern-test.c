@@ -0,0 +1,131 @@
+/*****************************************************************************\
+ *  str_intern-test.c - tests for shared string interning
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src/common/log.h"
+#include "src/common/str_intern.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+START_TEST(test_share)
+{
+	str_intern_stats_t stats;
+	char *buf = xstrdup("debug");
+	char *s1 = str_intern(buf), *s2, *s3;
+
+	xfree(buf);
+	s2 = str_intern("debug");
+	s3 = str_intern_ref(s2);
+
+	ck_assert_ptr_eq(s1, s2);
+	ck_assert_ptr_eq(s2, s3);
+	ck_assert_str_eq(s1, "debug");
+	ck_assert_ptr_eq(str_intern(NULL), NULL);
+	ck_assert_ptr_eq(str_intern_ref(NULL), NULL);
+
+	str_intern_get_stats(&stats);
+	ck_assert_int_eq(stats.strings, 1);
+	ck_assert_int_eq(stats.refs, 3);
+	ck_assert_int_eq(stats.bytes_saved, 2 * strlen("debug") + 2);
+
+	xfree_intern(s1);
+	ck_assert_ptr_eq(s1, NULL);
+	xfree_intern(s2);
+	ck_assert_str_eq(s3, "debug");
+	xfree_intern(s3);
+
+	str_intern_get_stats(&stats);
+	ck_assert_int_eq(stats.strings, 0);
+	ck_assert_int_eq(stats.refs, 0);
+	ck_assert_int_eq(stats.bytes, 0);
+	ck_assert_int_eq(stats.bytes_saved, 0);
+}
+END_TEST
+
+START_TEST(test_distinct)
+{
+	char *names[100];
+	str_intern_stats_t stats;
+
+	for (int i = 0; i < 100; i++) {
+		char *name = xstrdup_printf("acct%d", i % 10);
+		names[i] = str_intern(name);
+		xfree(name);
+	}
+
+	str_intern_get_stats(&stats);
+	ck_assert_int_eq(stats.strings, 10);
+	ck_assert_int_eq(stats.refs, 100);
+	ck_assert_ptr_eq(names[3], names[93]);
+	ck_assert_ptr_ne(names[3], names[4]);
+	ck_assert_str_eq(names[57], "acct7");
+
+	/* empty strings are interned too */
+	ck_assert_str_eq(str_intern(""), "");
+
+	for (int i = 0; i < 100; i++)
+		xfree_intern(names[i]);
+}
+END_TEST
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("str_intern");
+	TCase *tc_core = tcase_create("str_intern");
+	tcase_add_test(tc_core, test_share);
+	tcase_add_test(tc_core, test_distinct);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_DEBUG5;
+	log_init("str_intern-test", log_opts, 0, NULL);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	log_fini();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
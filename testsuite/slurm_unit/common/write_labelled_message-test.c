@@ -0,0 +1,189 @@
+/*****************************************************************************\
+ *  write_labelled_message-test.c - unit tests for write_labelled_message
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "src/common/write_labelled_message.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+
+/* Write msg with write_labelled_message() and return what came out */
+static char *_write_msg(char *msg, bool label, int task_id_width,
+			uint32_t het_job_offset, int *rc)
+{
+	char path[] = "/tmp/wlm-test.XXXXXX";
+	char *out;
+	int fd, len;
+
+	fd = mkstemp(path);
+	ck_assert(fd >= 0);
+	unlink(path);
+
+	*rc = write_labelled_message(fd, msg, strlen(msg), 3, het_job_offset,
+				     NO_VAL, label, task_id_width);
+
+	len = lseek(fd, 0, SEEK_END);
+	out = xmalloc(len + 1);
+	ck_assert(pread(fd, out, len, 0) == len);
+	close(fd);
+
+	return out;
+}
+
+START_TEST(no_label)
+{
+	char *msg = "line one\nline two\npartial";
+	char *out;
+	int rc;
+
+	out = _write_msg(msg, false, 1, NO_VAL, &rc);
+	ck_assert_int_eq(rc, strlen(msg));
+	ck_assert_str_eq(out, msg);
+	xfree(out);
+}
+END_TEST
+
+START_TEST(labelled)
+{
+	char *msg = "line one\n\nline three\npartial";
+	char *out;
+	int rc;
+
+	out = _write_msg(msg, true, 2, NO_VAL, &rc);
+	ck_assert_int_eq(rc, strlen(msg));
+	ck_assert_str_eq(out, " 3: line one\n 3: \n 3: line three\n 3: partial\n");
+	xfree(out);
+
+	out = _write_msg("het\n", true, 1, 1, &rc);
+	ck_assert_int_eq(rc, 4);
+	ck_assert_str_eq(out, "P1 3: het\n");
+	xfree(out);
+}
+END_TEST
+
+START_TEST(labelled_many_lines)
+{
+	/* More lines than fit in a single writev() */
+	char *msg = NULL, *expect = NULL, *out;
+	int rc;
+
+	for (int i = 0; i < 5000; i++) {
+		xstrfmtcat(msg, "%d\n", i);
+		xstrfmtcat(expect, "3: %d\n", i);
+	}
+
+	out = _write_msg(msg, true, 1, NO_VAL, &rc);
+	ck_assert_int_eq(rc, strlen(msg));
+	ck_assert_str_eq(out, expect);
+	xfree(out);
+	xfree(msg);
+	xfree(expect);
+}
+END_TEST
+
+START_TEST(labelled_long_lines)
+{
+	/* Lines around and over PIPE_BUF, which a writev() is kept to */
+	char *msg = NULL, *expect = NULL, *out;
+	int sizes[] = { 1, PIPE_BUF - 4, PIPE_BUF - 3, PIPE_BUF, 3 * PIPE_BUF,
+			10 };
+	int rc;
+
+	for (int i = 0; i < ARRAY_SIZE(sizes); i++) {
+		char *line = xmalloc(sizes[i] + 1);
+
+		memset(line, 'a' + i, sizes[i]);
+		xstrfmtcat(msg, "%s\n", line);
+		xstrfmtcat(expect, "3: %s\n", line);
+		xfree(line);
+	}
+
+	out = _write_msg(msg, true, 1, NO_VAL, &rc);
+	ck_assert_int_eq(rc, strlen(msg));
+	ck_assert_str_eq(out, expect);
+	xfree(out);
+	xfree(msg);
+	xfree(expect);
+}
+END_TEST
+
+START_TEST(empty)
+{
+	int rc;
+	char *out = _write_msg("", true, 1, NO_VAL, &rc);
+
+	ck_assert_int_eq(rc, -1);
+	ck_assert_str_eq(out, "");
+	xfree(out);
+}
+END_TEST
+
+/*****************************************************************************
+ * TEST SUITE                                                                *
+ ****************************************************************************/
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("write_labelled_message");
+	TCase *tc_core = tcase_create("write_labelled_message");
+	tcase_add_test(tc_core, no_label);
+	tcase_add_test(tc_core, labelled);
+	tcase_add_test(tc_core, labelled_many_lines);
+	tcase_add_test(tc_core, labelled_long_lines);
+	tcase_add_test(tc_core, empty);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+/*****************************************************************************
+ * TEST RUNNER                                                               *
+ ****************************************************************************/
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	srunner_run_all(sr, CK_VERBOSE);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,299 @@
+/*****************************************************************************\
+ *  rollup_usage-test.c - hourly rollup accumulation tests and benchmark
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "src/common/log.h"
+#include "src/common/slurmdb_defs.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/plugins/accounting_storage/mysql/as_mysql_rollup_usage.h"
+
+/* An hour of a large site */
+#define BENCH_JOBS 100000
+#define BENCH_ASSOCS 50000
+#define BENCH_WCKEYS 5000
+#define BENCH_RESV_ASSOCS 10000
+#define BENCH_GRES_TRES 1001
+
+static uint64_t _id_time(local_id_usage_t *usage, rollup_tres_pos_t *tres_pos,
+			 uint32_t id)
+{
+	int pos = rollup_tres_pos_find(tres_pos, id);
+
+	if ((pos < 0) || (pos >= usage->tres_cnt))
+		return 0;
+	return usage->time_alloc[pos];
+}
+
+START_TEST(test_tres_pos)
+{
+	rollup_tres_pos_t tres_pos = { 0 };
+
+	ck_assert_int_eq(rollup_tres_pos_find(&tres_pos, TRES_CPU), -1);
+	ck_assert_int_eq(rollup_tres_pos_get(&tres_pos, TRES_MEM), 0);
+	ck_assert_int_eq(rollup_tres_pos_get(&tres_pos, 1005), 1);
+	ck_assert_int_eq(rollup_tres_pos_get(&tres_pos, TRES_CPU), 2);
+	ck_assert_int_eq(rollup_tres_pos_get(&tres_pos, 1005), 1);
+	ck_assert_int_eq(rollup_tres_pos_find(&tres_pos, TRES_MEM), 0);
+	ck_assert_int_eq(rollup_tres_pos_find(&tres_pos, 1004), -1);
+	ck_assert_int_eq(rollup_tres_pos_find(&tres_pos, 5000), -1);
+	ck_assert_int_eq(tres_pos.cnt, 3);
+	ck_assert_int_eq(tres_pos.id[1], 1005);
+
+	/* Enough ids to grow the position array */
+	for (int i = 0; i < 100; i++)
+		ck_assert_int_eq(rollup_tres_pos_get(&tres_pos, 2000 + i),
+				 3 + i);
+	ck_assert_int_eq(rollup_tres_pos_find(&tres_pos, 1005), 1);
+	ck_assert_int_eq(tres_pos.id[102], 2099);
+
+	rollup_tres_pos_free(&tres_pos);
+	ck_assert_int_eq(tres_pos.cnt, 0);
+}
+END_TEST
+
+START_TEST(test_job_tres)
+{
+	rollup_tres_pos_t tres_pos = { 0 };
+	local_job_tres_t job_tres = { 0 };
+	int pos;
+
+	/* Suspended time only comes off CPU, energy isn't per second */
+	rollup_job_tres_set(&job_tres, &tres_pos, "1=4,2=1000,3=500,4=1",
+			    100, 40);
+	ck_assert_int_eq(job_tres.used_cnt, 4);
+	pos = rollup_job_tres_find(&job_tres, &tres_pos, TRES_CPU);
+	ck_assert_int_ge(pos, 0);
+	ck_assert_uint_eq(job_tres.count[pos], 4);
+	ck_assert_uint_eq(job_tres.time_alloc[pos], 4 * 60);
+	pos = rollup_job_tres_find(&job_tres, &tres_pos, TRES_MEM);
+	ck_assert_uint_eq(job_tres.time_alloc[pos], 1000 * 100);
+	pos = rollup_job_tres_find(&job_tres, &tres_pos, TRES_ENERGY);
+	ck_assert_uint_eq(job_tres.time_alloc[pos], 500);
+	pos = rollup_job_tres_find(&job_tres, &tres_pos, TRES_NODE);
+	ck_assert_uint_eq(job_tres.time_alloc[pos], 100);
+
+	/* A new job clears what the last one left, no energy gathered */
+	rollup_job_tres_set(&job_tres, &tres_pos,
+			    "1=2,3=18446744073709551614,1001=3", 10, 0);
+	ck_assert_int_eq(job_tres.used_cnt, 2);
+	ck_assert_int_eq(rollup_job_tres_find(&job_tres, &tres_pos, TRES_MEM),
+			 -1);
+	ck_assert_int_eq(rollup_job_tres_find(&job_tres, &tres_pos,
+					      TRES_ENERGY), -1);
+	pos = rollup_job_tres_find(&job_tres, &tres_pos, 1001);
+	ck_assert_uint_eq(job_tres.time_alloc[pos], 30);
+
+	/* No time, no TRES */
+	rollup_job_tres_set(&job_tres, &tres_pos, "1=2,2=100", 0, 0);
+	ck_assert_int_eq(job_tres.used_cnt, 0);
+	rollup_job_tres_set(&job_tres, &tres_pos, NULL, 10, 0);
+	ck_assert_int_eq(job_tres.used_cnt, 0);
+	ck_assert_int_eq(rollup_job_tres_find(&job_tres, &tres_pos, 5000), -1);
+
+	rollup_job_tres_free(&job_tres);
+	rollup_tres_pos_free(&tres_pos);
+}
+END_TEST
+
+START_TEST(test_id_table)
+{
+	rollup_tres_pos_t tres_pos = { 0 };
+	local_job_tres_t job_tres = { 0 };
+	local_id_table_t table = { 0 };
+	local_id_usage_t *usage, *usage2;
+
+	usage = rollup_id_table_get(&table, 7);
+	ck_assert_ptr_nonnull(usage);
+	ck_assert_ptr_eq(rollup_id_table_get(&table, 7), usage);
+	usage2 = rollup_id_table_get(&table, 3);
+	ck_assert_ptr_ne(usage, usage2);
+	ck_assert_int_eq(list_count(table.list), 2);
+	ck_assert_ptr_eq(list_peek(table.list), usage);
+
+	rollup_job_tres_set(&job_tres, &tres_pos, "1=2,2=100", 10, 0);
+	rollup_id_usage_add_job(usage, &job_tres);
+	rollup_id_usage_add_job(usage, &job_tres);
+	rollup_id_usage_add(usage, &tres_pos, TRES_CPU, 5);
+	rollup_id_usage_add(usage, &tres_pos, 1002, 7);
+	rollup_id_usage_add(usage, &tres_pos, TRES_ENERGY, NO_VAL64);
+	rollup_id_usage_add(usage, &tres_pos, TRES_NODE, 0);
+	ck_assert_uint_eq(_id_time(usage, &tres_pos, TRES_CPU), 45);
+	ck_assert_uint_eq(_id_time(usage, &tres_pos, TRES_MEM), 2000);
+	ck_assert_uint_eq(_id_time(usage, &tres_pos, 1002), 7);
+	ck_assert_uint_eq(_id_time(usage, &tres_pos, TRES_ENERGY), 0);
+	ck_assert_uint_eq(_id_time(usage, &tres_pos, TRES_NODE), 0);
+	ck_assert_uint_eq(_id_time(usage2, &tres_pos, TRES_CPU), 0);
+
+	rollup_id_table_flush(&table);
+	ck_assert_int_eq(list_count(table.list), 0);
+	usage = rollup_id_table_get(&table, 7);
+	ck_assert_uint_eq(_id_time(usage, &tres_pos, TRES_CPU), 0);
+	ck_assert_int_eq(list_count(table.list), 1);
+
+	rollup_id_table_free(&table);
+	rollup_job_tres_free(&job_tres);
+	rollup_tres_pos_free(&tres_pos);
+}
+END_TEST
+
+/*
+ * Feed an hour of synthetic job rows through the accumulation the way the
+ * hourly rollup does: jobs sorted by association, wckeys all over the place,
+ * then a reservation's idle time spread over its associations.
+ */
+START_TEST(test_benchmark)
+{
+	rollup_tres_pos_t tres_pos = { 0 };
+	local_job_tres_t job_tres = { 0 };
+	local_id_table_t assoc_usage = { 0 };
+	local_id_table_t wckey_usage = { 0 };
+	local_id_usage_t *a_usage = NULL, *w_usage = NULL;
+	char **tres_str = xcalloc(BENCH_JOBS, sizeof(*tres_str));
+	uint64_t cpu_total = 0, cpu_sum = 0, gres_sum = 0;
+	int last_id = -1;
+	ListIterator itr;
+	DEF_TIMERS;
+
+	for (int i = 0; i < BENCH_JOBS; i++)
+		tres_str[i] = xstrdup_printf("1=%d,2=%d,3=%d,4=1,5=%d,%d=%d",
+					     1 + (i % 64), 1024 * (1 + i % 8),
+					     i % 3 ? 0 : 100, 1 + (i % 64),
+					     BENCH_GRES_TRES + (i % 4),
+					     i % 5);
+
+	START_TIMER;
+	for (int i = 0; i < BENCH_JOBS; i++) {
+		uint32_t assoc_id = (uint64_t) i * BENCH_ASSOCS / BENCH_JOBS;
+		uint32_t wckey_id = (i * 7919) % BENCH_WCKEYS;
+
+		if (last_id != assoc_id) {
+			a_usage = rollup_id_table_get(&assoc_usage, assoc_id);
+			last_id = assoc_id;
+		}
+		w_usage = rollup_id_table_get(&wckey_usage, wckey_id);
+
+		rollup_job_tres_set(&job_tres, &tres_pos, tres_str[i],
+				    3600 - (i % 3600), 0);
+		rollup_id_usage_add_job(w_usage, &job_tres);
+		rollup_id_usage_add_job(a_usage, &job_tres);
+		cpu_total += (uint64_t) (1 + (i % 64)) * (3600 - (i % 3600));
+	}
+	for (int i = 0; i < BENCH_RESV_ASSOCS; i++) {
+		uint32_t assoc_id = (i * 4999) % (BENCH_ASSOCS * 2);
+
+		a_usage = rollup_id_table_get(&assoc_usage, assoc_id);
+		rollup_id_usage_add(a_usage, &tres_pos, TRES_CPU, 360);
+		cpu_total += 360;
+	}
+	END_TIMER;
+	info("accumulated %d jobs over %d associations and %d wckeys: %s",
+	     BENCH_JOBS, list_count(assoc_usage.list),
+	     list_count(wckey_usage.list), TIME_STR);
+
+	ck_assert_int_ge(list_count(assoc_usage.list), BENCH_ASSOCS);
+	ck_assert_int_eq(list_count(wckey_usage.list), BENCH_WCKEYS);
+
+	/* What the inserts would go through */
+	START_TIMER;
+	itr = list_iterator_create(assoc_usage.list);
+	while ((a_usage = list_next(itr))) {
+		cpu_sum += _id_time(a_usage, &tres_pos, TRES_CPU);
+		for (int t = 0; t < 4; t++)
+			gres_sum += _id_time(a_usage, &tres_pos,
+					     BENCH_GRES_TRES + t);
+	}
+	list_iterator_destroy(itr);
+	END_TIMER;
+	info("walked the association usage: %s", TIME_STR);
+	ck_assert_uint_eq(cpu_sum, cpu_total);
+	ck_assert_uint_gt(gres_sum, 0);
+
+	cpu_sum = 0;
+	itr = list_iterator_create(wckey_usage.list);
+	while ((w_usage = list_next(itr)))
+		cpu_sum += _id_time(w_usage, &tres_pos, TRES_CPU);
+	list_iterator_destroy(itr);
+	ck_assert_uint_eq(cpu_sum, cpu_total - (BENCH_RESV_ASSOCS * 360));
+
+	START_TIMER;
+	rollup_id_table_flush(&assoc_usage);
+	rollup_id_table_flush(&wckey_usage);
+	END_TIMER;
+	info("flushed the hour: %s", TIME_STR);
+
+	for (int i = 0; i < BENCH_JOBS; i++)
+		xfree(tres_str[i]);
+	xfree(tres_str);
+	rollup_id_table_free(&assoc_usage);
+	rollup_id_table_free(&wckey_usage);
+	rollup_job_tres_free(&job_tres);
+	rollup_tres_pos_free(&tres_pos);
+}
+END_TEST
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("rollup_usage");
+	TCase *tc_core = tcase_create("rollup_usage");
+	tcase_set_timeout(tc_core, 60); /* Avoid timeouts with --coverage */
+	tcase_add_test(tc_core, test_tres_pos);
+	tcase_add_test(tc_core, test_job_tres);
+	tcase_add_test(tc_core, test_id_table);
+	tcase_add_test(tc_core, test_benchmark);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("rollup_usage-test", log_opts, 0, NULL);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	log_fini();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
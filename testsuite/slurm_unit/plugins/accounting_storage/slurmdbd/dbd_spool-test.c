@@ -0,0 +1,365 @@
+/*****************************************************************************\
+ *  dbd_spool-test.c - slurmdbd message spool record format and recovery tests
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "src/common/list.h"
+#include "src/common/log.h"
+#include "src/common/pack.h"
+#include "src/common/slurm_protocol_defs.h"
+#include "src/common/slurmdbd_defs.h"
+#include "src/common/xmalloc.h"
+#include "src/common/xstring.h"
+#include "src/plugins/accounting_storage/slurmdbd/dbd_spool.h"
+
+/* Normally defined by the plugin linking dbd_spool */
+const char plugin_type[] = "accounting_storage/test";
+
+static char *tmp_dir = NULL;
+static char *spool_dir = NULL;
+static char *seg_file = NULL;
+
+/* A message with msg_type first, like the agent queues them */
+static buf_t *_msg(uint16_t msg_type, uint32_t payload)
+{
+	buf_t *buffer = init_buf(64);
+
+	pack16(msg_type, buffer);
+	pack32(payload, buffer);
+	packstr("spooled", buffer);
+
+	return buffer;
+}
+
+static void _append(uint16_t msg_type, uint32_t payload)
+{
+	buf_t *buffer = _msg(msg_type, payload);
+
+	ck_assert_int_eq(dbd_spool_append(buffer, SLURM_PROTOCOL_VERSION),
+			 SLURM_SUCCESS);
+	FREE_NULL_BUFFER(buffer);
+}
+
+static uint32_t _msg_size(void)
+{
+	buf_t *buffer = _msg(0, 0);
+	uint32_t size = get_buf_offset(buffer);
+
+	FREE_NULL_BUFFER(buffer);
+	return size;
+}
+
+/* Read the whole segment file left by dbd_spool_fini() */
+static char *_read_seg(size_t *size)
+{
+	int fd = open(seg_file, O_RDONLY);
+	off_t len;
+	char *data;
+
+	ck_assert_int_ge(fd, 0);
+	len = lseek(fd, 0, SEEK_END);
+	ck_assert_int_gt(len, 0);
+	data = xmalloc(len);
+	ck_assert_int_eq(pread(fd, data, len, 0), len);
+	close(fd);
+	*size = len;
+
+	return data;
+}
+
+static void _write_seg(char *data, size_t size)
+{
+	int fd = open(seg_file, O_WRONLY);
+
+	ck_assert_int_ge(fd, 0);
+	ck_assert_int_eq(pwrite(fd, data, size, 0), size);
+	close(fd);
+}
+
+/* Peek the pending messages and check their payloads, then give them back */
+static void _check_payloads(uint32_t *payloads, int cnt)
+{
+	List list = list_create(slurmdbd_free_buffer);
+	buf_t *buffer;
+	int i = 0;
+
+	ck_assert_int_eq(dbd_spool_peek(list, INT_MAX, UINT32_MAX,
+					SLURM_PROTOCOL_VERSION), cnt);
+	while ((buffer = list_dequeue(list))) {
+		uint16_t msg_type;
+		uint32_t payload;
+
+		set_buf_offset(buffer, 0);
+		ck_assert_int_eq(unpack16(&msg_type, buffer), SLURM_SUCCESS);
+		ck_assert_int_eq(unpack32(&payload, buffer), SLURM_SUCCESS);
+		ck_assert_int_lt(i, cnt);
+		ck_assert_int_eq(payload, payloads[i++]);
+		FREE_NULL_BUFFER(buffer);
+	}
+	ck_assert_int_eq(i, cnt);
+	dbd_spool_unpeek();
+	FREE_NULL_LIST(list);
+}
+
+static void _setup(void)
+{
+	tmp_dir = xstrdup("/tmp/dbd_spool-test.XXXXXX");
+	ck_assert_ptr_ne(mkdtemp(tmp_dir), NULL);
+	spool_dir = xstrdup_printf("%s/spool", tmp_dir);
+	seg_file = xstrdup_printf("%s/%010u.seg", spool_dir, 0);
+	ck_assert_int_eq(dbd_spool_init(spool_dir, true), SLURM_SUCCESS);
+}
+
+static void _teardown(void)
+{
+	DIR *dp;
+	struct dirent *ent;
+
+	dbd_spool_fini();
+	if ((dp = opendir(spool_dir))) {
+		while ((ent = readdir(dp))) {
+			char *path = xstrdup_printf("%s/%s", spool_dir,
+						    ent->d_name);
+			(void) unlink(path);
+			xfree(path);
+		}
+		closedir(dp);
+	}
+	(void) rmdir(spool_dir);
+	(void) rmdir(tmp_dir);
+	xfree(seg_file);
+	xfree(spool_dir);
+	xfree(tmp_dir);
+}
+
+START_TEST(test_record_format)
+{
+	uint32_t size = _msg_size();
+	size_t seg_size;
+	spool_rec_t *rec;
+	char *data;
+
+	/* The header is part of the on disk format */
+	ck_assert_int_eq(sizeof(spool_rec_t), 24);
+	ck_assert_int_eq(offsetof(spool_rec_t, magic), 0);
+	ck_assert_int_eq(offsetof(spool_rec_t, size), 4);
+	ck_assert_int_eq(offsetof(spool_rec_t, crc), 8);
+	ck_assert_int_eq(offsetof(spool_rec_t, msg_type), 12);
+	ck_assert_int_eq(offsetof(spool_rec_t, rpc_version), 14);
+	ck_assert_int_eq(offsetof(spool_rec_t, flags), 16);
+	ck_assert_int_eq(SPOOL_REC_LEN(1), 32);
+	ck_assert_int_eq(SPOOL_REC_LEN(8), 32);
+	ck_assert_int_eq(SPOOL_REC_LEN(9), 40);
+
+	_append(DBD_JOB_START, 1);
+	_append(DBD_STEP_START, 2);
+	ck_assert_int_eq(dbd_spool_count(), 2);
+	dbd_spool_fini();
+
+	data = _read_seg(&seg_size);
+	ck_assert_int_ge(seg_size, 2 * SPOOL_REC_LEN(size));
+
+	rec = (spool_rec_t *) data;
+	ck_assert_uint_eq(rec->magic, SPOOL_REC_MAGIC);
+	ck_assert_int_eq(rec->size, size);
+	ck_assert_int_eq(rec->msg_type, DBD_JOB_START);
+	ck_assert_int_eq(rec->rpc_version, SLURM_PROTOCOL_VERSION);
+	ck_assert_int_eq(rec->flags, 0);
+
+	rec = (spool_rec_t *) (data + SPOOL_REC_LEN(size));
+	ck_assert_uint_eq(rec->magic, SPOOL_REC_MAGIC);
+	ck_assert_int_eq(rec->msg_type, DBD_STEP_START);
+
+	/* Nothing follows the last record */
+	rec = (spool_rec_t *) (data + 2 * SPOOL_REC_LEN(size));
+	ck_assert_uint_eq(rec->magic, 0);
+	xfree(data);
+
+	ck_assert_int_eq(dbd_spool_init(spool_dir, false), SLURM_SUCCESS);
+	ck_assert_int_eq(dbd_spool_count(), 2);
+	_check_payloads((uint32_t []) { 1, 2 }, 2);
+}
+END_TEST
+
+START_TEST(test_torn_record)
+{
+	uint32_t size = _msg_size();
+	size_t seg_size;
+	spool_rec_t *rec;
+	char *data;
+
+	_append(DBD_JOB_START, 1);
+	_append(DBD_JOB_START, 2);
+	_append(DBD_JOB_START, 3);
+	dbd_spool_fini();
+
+	/* The slurmctld died before writing the magic of the last record */
+	data = _read_seg(&seg_size);
+	rec = (spool_rec_t *) (data + 2 * SPOOL_REC_LEN(size));
+	rec->magic = 0;
+	_write_seg(data, seg_size);
+	xfree(data);
+
+	ck_assert_int_eq(dbd_spool_init(spool_dir, false), SLURM_SUCCESS);
+	ck_assert_int_eq(dbd_spool_count(), 2);
+	_check_payloads((uint32_t []) { 1, 2 }, 2);
+
+	/* New messages go to a new segment, after the recovered ones */
+	_append(DBD_JOB_START, 4);
+	ck_assert_int_eq(dbd_spool_count(), 3);
+	_check_payloads((uint32_t []) { 1, 2, 4 }, 3);
+}
+END_TEST
+
+START_TEST(test_crc_mismatch)
+{
+	uint32_t size = _msg_size();
+	size_t seg_size;
+	char *data;
+
+	_append(DBD_JOB_START, 1);
+	_append(DBD_JOB_START, 2);
+	_append(DBD_JOB_START, 3);
+	dbd_spool_fini();
+
+	/* Corrupt the payload of the second record */
+	data = _read_seg(&seg_size);
+	data[SPOOL_REC_LEN(size) + sizeof(spool_rec_t) + 2] ^= 0xff;
+	_write_seg(data, seg_size);
+	xfree(data);
+
+	/* Recovery stops at the first record that isn't whole */
+	ck_assert_int_eq(dbd_spool_init(spool_dir, false), SLURM_SUCCESS);
+	ck_assert_int_eq(dbd_spool_count(), 1);
+	_check_payloads((uint32_t []) { 1 }, 1);
+}
+END_TEST
+
+START_TEST(test_sent_flags)
+{
+	uint32_t size = _msg_size();
+	List list = list_create(slurmdbd_free_buffer);
+	size_t seg_size;
+	spool_rec_t *rec;
+	char *data;
+
+	_append(DBD_JOB_START, 1);
+	_append(DBD_JOB_START, 2);
+	_append(DBD_JOB_START, 3);
+
+	/* Two sent, nothing else in flight */
+	ck_assert_int_eq(dbd_spool_peek(list, 2, UINT32_MAX,
+					SLURM_PROTOCOL_VERSION), 2);
+	ck_assert_int_eq(dbd_spool_inflight(), 2);
+	dbd_spool_pop();
+	dbd_spool_pop();
+	ck_assert_int_eq(dbd_spool_inflight(), 0);
+	ck_assert_int_eq(dbd_spool_count(), 1);
+	FREE_NULL_LIST(list);
+	dbd_spool_fini();
+
+	data = _read_seg(&seg_size);
+	rec = (spool_rec_t *) data;
+	ck_assert_int_eq(rec->flags, SPOOL_REC_SENT);
+	rec = (spool_rec_t *) (data + SPOOL_REC_LEN(size));
+	ck_assert_int_eq(rec->flags, SPOOL_REC_SENT);
+	rec = (spool_rec_t *) (data + 2 * SPOOL_REC_LEN(size));
+	ck_assert_int_eq(rec->flags, 0);
+	xfree(data);
+
+	ck_assert_int_eq(dbd_spool_init(spool_dir, false), SLURM_SUCCESS);
+	ck_assert_int_eq(dbd_spool_count(), 1);
+	_check_payloads((uint32_t []) { 3 }, 1);
+}
+END_TEST
+
+START_TEST(test_unpeek)
+{
+	List list = list_create(slurmdbd_free_buffer);
+
+	_append(DBD_JOB_START, 1);
+	_append(DBD_JOB_START, 2);
+
+	/* What was in flight is sent again, in order */
+	ck_assert_int_eq(dbd_spool_peek(list, 1, UINT32_MAX,
+					SLURM_PROTOCOL_VERSION), 1);
+	ck_assert_int_eq(dbd_spool_inflight(), 1);
+	dbd_spool_unpeek();
+	ck_assert_int_eq(dbd_spool_inflight(), 0);
+	ck_assert_int_eq(dbd_spool_count(), 2);
+	FREE_NULL_LIST(list);
+	_check_payloads((uint32_t []) { 1, 2 }, 2);
+}
+END_TEST
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("dbd_spool");
+	TCase *tc_core = tcase_create("dbd_spool");
+
+	tcase_add_checked_fixture(tc_core, _setup, _teardown);
+	tcase_add_test(tc_core, test_record_format);
+	tcase_add_test(tc_core, test_torn_record);
+	tcase_add_test(tc_core, test_crc_mismatch);
+	tcase_add_test(tc_core, test_sent_flags);
+	tcase_add_test(tc_core, test_unpeek);
+	suite_add_tcase(s, tc_core);
+
+	return s;
+}
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("dbd_spool-test", log_opts, 0, NULL);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	log_fini();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
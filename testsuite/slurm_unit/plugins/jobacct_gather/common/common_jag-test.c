@@ -0,0 +1,218 @@
+/*****************************************************************************\
+ *  common_jag-test.c - jobacct_gather /proc sampling tests
+ *****************************************************************************
+ *  Copyright (C) SchedMD LLC.
+ *
+ *  This file is part of Slurm, a resource management program.
+ *  For details, see <https://slurm.schedmd.com/>.
+ *  Please also read the included file: DISCLAIMER.
+ *
+ *  Slurm is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 2 of the License, or (at your option)
+ *  any later version.
+ *
+ *  In addition, as a special exception, the copyright holders give permission
+ *  to link the code of portions of this program with the OpenSSL library under
+ *  certain conditions as described in each individual source file, and
+ *  distribute linked combinations including the two. You must obey the GNU
+ *  General Public License in all respects for all of the code used other than
+ *  OpenSSL. If you modify file(s) with this exception, you may extend this
+ *  exception to your version of the file(s), but you are not obligated to do
+ *  so. If you do not wish to do so, delete this exception statement from your
+ *  version.  If you delete this exception statement from all source files in
+ *  the program, then also delete it here.
+ *
+ *  Slurm is distributed in the hope that it will be useful, but WITHOUT ANY
+ *  WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Slurm; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA.
+\*****************************************************************************/
+
+#include <check.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "src/common/assoc_mgr.h"
+#include "src/common/log.h"
+#include "src/common/timers.h"
+#include "src/common/xmalloc.h"
+#include "src/interfaces/acct_gather_profile.h"
+#include "src/interfaces/gpu.h"
+#include "src/interfaces/jobacct_gather.h"
+#include "src/interfaces/proctrack.h"
+#include "src/plugins/jobacct_gather/common/common_jag.h"
+
+/* A step of a large MPI job on a single node */
+#define BENCH_PROCS 1000
+#define BENCH_POLLS 10
+
+#define JAG_FLAGS (JAG_PROC_MEM | JAG_PROC_IO)
+
+static pid_t pids[BENCH_PROCS];
+static int pid_cnt = 0;
+
+/* Normally defined by the plugin linking common_jag */
+const char plugin_type[] = "jobacct_gather/test";
+
+/* No gpu nor proctrack plugin is loaded in here */
+extern int gpu_g_usage_read(pid_t pid, acct_gather_data_t *data)
+{
+	return SLURM_SUCCESS;
+}
+
+extern int proctrack_g_get_pids(uint64_t cont_id, pid_t **pids, int *npids)
+{
+	*pids = NULL;
+	*npids = 0;
+	return SLURM_SUCCESS;
+}
+
+static void _start_procs(int cnt)
+{
+	for (pid_cnt = 0; pid_cnt < cnt; pid_cnt++) {
+		pid_t pid = fork();
+
+		ck_assert_int_ge(pid, 0);
+		if (!pid) {
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			while (true)
+				pause();
+		}
+		pids[pid_cnt] = pid;
+	}
+}
+
+static void _stop_procs(void)
+{
+	for (int i = 0; i < pid_cnt; i++) {
+		if (pids[i] <= 0)
+			continue;
+		kill(pids[i], SIGKILL);
+		waitpid(pids[i], NULL, 0);
+	}
+	pid_cnt = 0;
+}
+
+static void _setup(void)
+{
+	struct rlimit rlim;
+
+	/* The slurmstepd runs with the max number of files allowed too */
+	if (!getrlimit(RLIMIT_NOFILE, &rlim)) {
+		rlim.rlim_cur = rlim.rlim_max;
+		(void) setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+
+	ck_assert_int_eq(acct_gather_profile_init(), SLURM_SUCCESS);
+	jag_common_init(sysconf(_SC_CLK_TCK));
+}
+
+static void _teardown(void)
+{
+	_stop_procs();
+	jag_common_fini();
+}
+
+START_TEST(test_get_prec)
+{
+	jag_prec_t *prec, *prec2;
+
+	_start_procs(2);
+
+	prec = jag_common_get_prec(pids[0], TRES_ARRAY_TOTAL_CNT, JAG_FLAGS);
+	ck_assert_ptr_nonnull(prec);
+	ck_assert_int_eq(prec->pid, pids[0]);
+	ck_assert_int_eq(prec->ppid, getpid());
+	ck_assert_int_eq(prec->tres_count, TRES_ARRAY_TOTAL_CNT);
+	ck_assert(prec->tres_data[TRES_ARRAY_VMEM].size_read > 0);
+	ck_assert(prec->tres_data[TRES_ARRAY_FS_DISK].size_read != INFINITE64);
+
+	/* Read again from the open files, the record is updated in place */
+	prec2 = jag_common_get_prec(pids[0], TRES_ARRAY_TOTAL_CNT, JAG_FLAGS);
+	ck_assert_ptr_eq(prec, prec2);
+	ck_assert_int_eq(prec->pid, pids[0]);
+
+	/* Without JAG_PROC_IO the io is left unset */
+	prec = jag_common_get_prec(pids[1], TRES_ARRAY_TOTAL_CNT, 0);
+	ck_assert_ptr_nonnull(prec);
+	ck_assert(prec->tres_data[TRES_ARRAY_FS_DISK].size_read == INFINITE64);
+
+	/* A process that went away must not be read from its open files */
+	kill(pids[0], SIGKILL);
+	waitpid(pids[0], NULL, 0);
+	ck_assert_ptr_null(jag_common_get_prec(pids[0], TRES_ARRAY_TOTAL_CNT,
+					       JAG_FLAGS));
+	pids[0] = 0;
+}
+END_TEST
+
+/* Time polling a step of BENCH_PROCS processes */
+START_TEST(test_benchmark)
+{
+	DEF_TIMERS;
+
+	_start_procs(BENCH_PROCS);
+
+	START_TIMER;
+	for (int i = 0; i < BENCH_PROCS; i++)
+		ck_assert_ptr_nonnull(jag_common_get_prec(pids[i],
+							  TRES_ARRAY_TOTAL_CNT,
+							  JAG_FLAGS));
+	END_TIMER;
+	info("first poll of %d processes: %s", BENCH_PROCS, TIME_STR);
+
+	START_TIMER;
+	for (int p = 0; p < BENCH_POLLS; p++) {
+		for (int i = 0; i < BENCH_PROCS; i++) {
+			jag_prec_t *prec =
+				jag_common_get_prec(pids[i],
+						    TRES_ARRAY_TOTAL_CNT,
+						    JAG_FLAGS);
+			ck_assert_ptr_nonnull(prec);
+			ck_assert_int_eq(prec->pid, pids[i]);
+		}
+	}
+	END_TIMER;
+	info("%d polls of %d processes: %s (%ld usec per poll)",
+	     BENCH_POLLS, BENCH_PROCS, TIME_STR, DELTA_TIMER / BENCH_POLLS);
+}
+END_TEST
+
+Suite *suite(void)
+{
+	Suite *s = suite_create("common_jag");
+	TCase *tc_core = tcase_create("common_jag");
+	tcase_add_checked_fixture(tc_core, _setup, _teardown);
+	tcase_set_timeout(tc_core, 60); /* Avoid timeouts with --coverage */
+	tcase_add_test(tc_core, test_get_prec);
+	tcase_add_test(tc_core, test_benchmark);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int main(void)
+{
+	int number_failed;
+	SRunner *sr = srunner_create(suite());
+
+	log_options_t log_opts = LOG_OPTS_INITIALIZER;
+	log_opts.stderr_level = LOG_LEVEL_INFO;
+	log_init("common_jag-test", log_opts, 0, NULL);
+
+	srunner_run_all(sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	log_fini();
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}